@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
 #include <vulkan/vulkan_core.h>
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -22,6 +27,15 @@ namespace tracer
 // forward declaration
 class RectangularBezierSurface;
 
+// how the AABBs of the bezier patches are computed
+enum class BezierBoundsMode
+{
+	// the box of the control points, the patch lies inside their convex hull
+	ControlPoints,
+	// the union of the control point boxes of sub patches, see AABB::fromBezierPatchSubdivision()
+	Subdivision,
+};
+
 // Axis Aligned Bounding Box
 class AABB
 {
@@ -34,6 +48,12 @@ class AABB
 
 	VkAabbPositionsKHR getAabbPositions() const;
 
+	[[nodiscard]] float getVolume() const
+	{
+		const glm::vec3 extent = max - min;
+		return extent.x * extent.y * extent.z;
+	}
+
 	static AABB
 	fromRectangularBezierSurface2x2(const RectangularBezierSurface2x2& rectangularBezierSurface2x2);
 
@@ -49,10 +69,17 @@ class AABB
 	template <typename T>
 	static AABB fromBezierTriangle(const T& bezierTriangle)
 	{
-		glm::vec3 min = bezierTriangle.controlPoints[0];
-		glm::vec3 max = bezierTriangle.controlPoints[0];
+		return fromControlPoints(bezierTriangle.controlPoints);
+	}
+
+	// bezier patches lie inside the convex hull of their control points
+	static AABB fromControlPoints(const std::span<const glm::vec3> controlPoints)
+	{
+		assert(!controlPoints.empty());
+		glm::vec3 min = controlPoints[0];
+		glm::vec3 max = controlPoints[0];
 
-		for (const glm::vec3& point : bezierTriangle.controlPoints)
+		for (const glm::vec3& point : controlPoints)
 		{
 			min.x = glm::min(min.x, point.x);
 			min.y = glm::min(min.y, point.y);
@@ -69,6 +96,32 @@ class AABB
 		};
 	}
 
+	static AABB fromBezierPatch(const std::span<const glm::vec3> controlPoints,
+	                            const uint32_t degree,
+	                            const BezierBoundsMode mode)
+	{
+		if (mode == BezierBoundsMode::Subdivision)
+		{
+			return fromBezierPatchSubdivision(controlPoints, degree);
+		}
+		return fromControlPoints(controlPoints);
+	}
+
+	/**
+	 * @brief Tighter bounds of a bezier triangle for strongly curved patches, whose control points
+	 * can lie far away from the surface. The patch is split into 4 sub patches until the control
+	 * points of a sub patch are closer than the tolerance to the flat triangle through its corners,
+	 * the result is the union of the control point boxes of these sub patches.
+	 *
+	 * @param controlPoints the control points in the order of getBezierPatchControlPointIndex()
+	 * @param relativeTolerance the tolerance as fraction of the diagonal of the control point box
+	 * @param maxDepth at most 4^maxDepth sub patches are created
+	 */
+	static AABB fromBezierPatchSubdivision(const std::span<const glm::vec3> controlPoints,
+	                                       const uint32_t degree,
+	                                       const float relativeTolerance = 0.01f,
+	                                       const int maxDepth = 4);
+
 	// localSpace is used to determine if the AABB should be created in local space or
 	// in global space.
 	// We need the global space if the transform matrix of the BLAS that contains this sphere is the
@@ -80,4 +133,36 @@ class AABB
 	static AABB fromSphere(const Sphere& sphere, const bool localSpace);
 };
 
+// the volume of the AABBs of the bezier patches compared to the boxes of their control points
+struct BezierBoundsTelemetry
+{
+	size_t patchCount = 0;
+	double controlPointsVolume = 0.0;
+	double boundsVolume = 0.0;
+
+	void add(const std::span<const glm::vec3> controlPoints, const AABB& bounds)
+	{
+		patchCount++;
+		controlPointsVolume
+		    += static_cast<double>(AABB::fromControlPoints(controlPoints).getVolume());
+		boundsVolume += static_cast<double>(bounds.getVolume());
+	}
+
+	// takes back add() when the control points of a patch are replaced
+	void remove(const std::span<const glm::vec3> controlPoints, const AABB& bounds)
+	{
+		assert(patchCount > 0);
+		patchCount--;
+		controlPointsVolume
+		    -= static_cast<double>(AABB::fromControlPoints(controlPoints).getVolume());
+		boundsVolume -= static_cast<double>(bounds.getVolume());
+	}
+
+	// 1 for the control point boxes, smaller for tighter bounds
+	[[nodiscard]] double getVolumeRatio() const
+	{
+		return controlPointsVolume > 0.0 ? boundsVolume / controlPointsVolume : 1.0;
+	}
+};
+
 } // namespace tracer
@@ -120,6 +120,9 @@ class Application
 	// whether the GPU supports ray tracing, if false, only the ui is renderer
 	bool raytracingSupported = false;
 
+	// whether VK_EXT_memory_budget is enabled, VMA then reports the real heap budgets
+	bool memoryBudgetSupported = false;
+
 	// whether vulkan has been initialized, to make sure window events don't trigger beforehand,
 	// e.g. window resize
 	bool vulkan_initialized = false;
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "common_types.h"
+
+// Compile time tables of the control point indices and the multinomial coefficients
+// n! / (i! j! k! [l!]) of the Bernstein polynomials of bezier triangles and tetrahedra, so the
+// surface evaluations only do lookups instead of factorials or branch chains. The shaders get the
+// same triangle coefficients from bernstein_tables.glsl, which is written by
+// writeBernsteinTablesGLSL() during the build (see tools/generate_bernstein_tables.cpp).
+
+// (degree + 1)(degree + 2) / 2 control points per bezier triangle
+inline constexpr uint32_t getBezierTriangleControlPointCount(const uint32_t degree)
+{
+	return (degree + 1) * (degree + 2) / 2;
+}
+
+// (degree + 1)(degree + 2)(degree + 3) / 6 control points per bezier tetrahedron
+inline constexpr uint32_t getBezierTetrahedronControlPointCount(const uint32_t degree)
+{
+	return (degree + 1) * (degree + 2) * (degree + 3) / 6;
+}
+
+// returns the index of the control point b_ijk (k = n - i - j) of a bezier triangle of degree n,
+// the control points are stored row by row with increasing j
+inline constexpr uint32_t getBezierPatchControlPointIndex(const int n, const int i, const int j)
+{
+	return static_cast<uint32_t>(j * (n + 1) - (j * (j - 1)) / 2 + i);
+}
+
+// returns the index of the control point b_ijkl (l = n - i - j - k) of a bezier tetrahedron of
+// degree n, the control points are ordered by i, then j, then k
+inline constexpr uint32_t
+getBezierTetrahedronControlPointIndex(const int n, const int i, const int j, const int k)
+{
+	uint32_t index = 0;
+	// the control points with a smaller i form triangles of the degrees n, n - 1, ...
+	for (int a = 0; a < i; a++)
+	{
+		index += getBezierTriangleControlPointCount(static_cast<uint32_t>(n - a));
+	}
+	// the rows with the same i and a smaller j
+	for (int b = 0; b < j; b++)
+	{
+		index += static_cast<uint32_t>(n - i - b + 1);
+	}
+	return index + static_cast<uint32_t>(k);
+}
+
+// exact for all degrees of the tables, the factorials would overflow
+inline constexpr uint64_t binomialCoefficient(const int n, const int k)
+{
+	if (k < 0 || k > n)
+	{
+		return 0;
+	}
+	uint64_t result = 1;
+	for (int d = 1; d <= k; d++)
+	{
+		result = result * static_cast<uint64_t>(n - k + d) / static_cast<uint64_t>(d);
+	}
+	return result;
+}
+
+template <int N>
+struct BezierTriangleTable
+{
+	static_assert(N >= 0);
+
+	// the control point index of b_ijk, indexed by [i][j]
+	std::array<std::array<uint32_t, N + 1>, N + 1> indices{};
+	// n! / (i! j! k!) in control point order
+	std::array<float, getBezierTriangleControlPointCount(N)> coefficients{};
+};
+
+template <int N>
+struct BezierTetrahedronTable
+{
+	static_assert(N >= 0);
+
+	// the control point index of b_ijkl, indexed by [i][j][k]
+	std::array<std::array<std::array<uint32_t, N + 1>, N + 1>, N + 1> indices{};
+	// n! / (i! j! k! l!) in control point order
+	std::array<float, getBezierTetrahedronControlPointCount(N)> coefficients{};
+};
+
+template <int N>
+inline constexpr BezierTriangleTable<N> makeBezierTriangleTable()
+{
+	BezierTriangleTable<N> table;
+	for (int j = 0; j <= N; j++)
+	{
+		for (int i = 0; i <= N - j; i++)
+		{
+			const uint32_t index = getBezierPatchControlPointIndex(N, i, j);
+			table.indices[static_cast<size_t>(i)][static_cast<size_t>(j)] = index;
+			table.coefficients[index]
+			    = static_cast<float>(binomialCoefficient(N, i) * binomialCoefficient(N - i, j));
+		}
+	}
+	return table;
+}
+
+template <int N>
+inline constexpr BezierTetrahedronTable<N> makeBezierTetrahedronTable()
+{
+	BezierTetrahedronTable<N> table;
+	for (int i = 0; i <= N; i++)
+	{
+		for (int j = 0; j <= N - i; j++)
+		{
+			for (int k = 0; k <= N - i - j; k++)
+			{
+				const uint32_t index = getBezierTetrahedronControlPointIndex(N, i, j, k);
+				table.indices[static_cast<size_t>(i)][static_cast<size_t>(j)]
+				             [static_cast<size_t>(k)]
+				    = index;
+				table.coefficients[index] = static_cast<float>(
+				    binomialCoefficient(N, i) * binomialCoefficient(N - i, j)
+				    * binomialCoefficient(N - i - j, k));
+			}
+		}
+	}
+	return table;
+}
+
+template <int N>
+inline constexpr BezierTriangleTable<N> BEZIER_TRIANGLE_TABLE = makeBezierTriangleTable<N>();
+
+template <int N>
+inline constexpr BezierTetrahedronTable<N> BEZIER_TETRAHEDRON_TABLE
+    = makeBezierTetrahedronTable<N>();
+
+// the coefficients of degree n start at this offset of BERNSTEIN_TRIANGLE_COEFFICIENTS
+inline constexpr uint32_t getBernsteinCoefficientOffset(const int n)
+{
+	return static_cast<uint32_t>(n * (n + 1) * (n + 2) / 6);
+}
+
+// the triangle coefficients of the degrees 0 to MAX_BEZIER_PATCH_DEGREE back to back, for the
+// patches whose degree is only known at runtime
+inline constexpr auto BERNSTEIN_TRIANGLE_COEFFICIENTS = []
+{
+	std::array<float, getBernsteinCoefficientOffset(MAX_BEZIER_PATCH_DEGREE + 1)> coefficients{};
+	for (int n = 0; n <= MAX_BEZIER_PATCH_DEGREE; n++)
+	{
+		for (int j = 0; j <= n; j++)
+		{
+			for (int i = 0; i <= n - j; i++)
+			{
+				const uint32_t index
+				    = getBernsteinCoefficientOffset(n) + getBezierPatchControlPointIndex(n, i, j);
+				coefficients[index]
+				    = static_cast<float>(binomialCoefficient(n, i) * binomialCoefficient(n - i, j));
+			}
+		}
+	}
+	return coefficients;
+}();
+
+// n! / (i! j! k!) of the Bernstein polynomial B_ijk (k = n - i - j) of a bezier triangle
+inline constexpr float getBernsteinCoefficient(const int n, const int i, const int j)
+{
+	return BERNSTEIN_TRIANGLE_COEFFICIENTS[getBernsteinCoefficientOffset(n)
+	                                       + getBezierPatchControlPointIndex(n, i, j)];
+}
+
+static_assert(static_cast<uint64_t>(getBernsteinCoefficient(2, 1, 1)) == 2);
+static_assert(static_cast<uint64_t>(getBernsteinCoefficient(12, 4, 4)) == 34650);
+static_assert(BEZIER_TETRAHEDRON_TABLE<4>.indices[1][2][1] == 23);
+
+// writes BERNSTEIN_TRIANGLE_COEFFICIENTS and getBernsteinCoefficient() as GLSL
+inline void writeBernsteinTablesGLSL(std::ostream& out)
+{
+	out << "// generated by tools/generate_bernstein_tables.cpp from bernstein_tables.hpp\n"
+	    << "#ifndef BERNSTEIN_TABLES\n"
+	    << "#define BERNSTEIN_TABLES\n\n"
+	    << "// n! / (i! j! k!) of the bezier triangles of the degrees 0 to "
+	    << MAX_BEZIER_PATCH_DEGREE << ", see getBernsteinCoefficient()\n"
+	    << "const float BERNSTEIN_TRIANGLE_COEFFICIENTS[" << BERNSTEIN_TRIANGLE_COEFFICIENTS.size()
+	    << "] = float[](";
+	for (int n = 0; n <= MAX_BEZIER_PATCH_DEGREE; n++)
+	{
+		out << (n == 0 ? "" : ",") << "\n\t// degree " << n << "\n\t";
+		for (uint32_t i = 0; i < getBezierTriangleControlPointCount(static_cast<uint32_t>(n)); i++)
+		{
+			// the coefficients are integers
+			const float coefficient
+			    = BERNSTEIN_TRIANGLE_COEFFICIENTS[getBernsteinCoefficientOffset(n) + i];
+			out << (i == 0 ? "" : ", ") << static_cast<uint64_t>(coefficient) << ".0";
+		}
+	}
+	out << ");\n\n"
+	    << "// returns the index of the control point b_ijk (k = n - i - j) of a bezier triangle "
+	       "of degree n,\n"
+	    << "// the control points are stored row by row with increasing j, e.g. for n = 2:\n"
+	    << "// b_002, b_101, b_200, b_011, b_110, b_020\n"
+	    << "int getBezierPatchControlPointIndex(int n, int i, int j)\n"
+	    << "{\n"
+	    << "\treturn j * (n + 1) - (j * (j - 1)) / 2 + i;\n"
+	    << "}\n\n"
+	    << "float getBernsteinCoefficient(int n, int i, int j)\n"
+	    << "{\n"
+	    << "\treturn BERNSTEIN_TRIANGLE_COEFFICIENTS[n * (n + 1) * (n + 2) / 6\n"
+	    << "\t                                       + getBezierPatchControlPointIndex(n, i, j)];\n"
+	    << "}\n\n"
+	    << "#endif\n";
+}
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_FORCE_LEFT_HANDED
 #define GLM_FORCE_RADIANS
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/ext/vector_float3.hpp>
-#include <glm/exponential.hpp>
+
+#include "bernstein_tables.hpp"
 
 inline constexpr int getControlPointIndicesBezierTriangle2(const int i, const int j, const int k)
 {
@@ -18,14 +24,15 @@ inline constexpr int getControlPointIndicesBezierTriangle2(const int i, const in
 	return 0;
 }
 
-inline constexpr int factorial(int n)
+// same as customPow() in the shaders, plain multiplications instead of glm::pow
+inline float customPow(const float x, const int i)
 {
-	// NOTE : we only work with small numbers, so we can (hopefully) safely use int instead of
-	// unsigned ints
-	int ret = 1;
-	for (int i = 1; i <= n; ++i)
-		ret *= i;
-	return static_cast<int>(ret);
+	float result = 1.0f;
+	for (int c = 0; c < i; c++)
+	{
+		result *= x;
+	}
+	return result;
 }
 
 inline glm::vec3
@@ -37,18 +44,80 @@ bezierTriangleSurfacePoint(const glm::vec3 controlPoints[6], int n, double u, do
 	{
 		for (int j = 0; j <= n - i; j++)
 		{
-			for (int k = 0; k <= n - i - j; k++)
-			{
-				if (i + j + k == n)
-				{
-					int idx = getControlPointIndicesBezierTriangle2(i, j, k);
-					sum += controlPoints[idx]
-					       * (static_cast<float>(factorial(n))
-					          / static_cast<float>(factorial(i) * factorial(j) * factorial(k)))
-					       * static_cast<float>(glm::pow(u, i) * glm::pow(v, j) * glm::pow(w, k));
-				}
-			}
+			const int k = n - i - j;
+			const int idx = getControlPointIndicesBezierTriangle2(i, j, k);
+			sum += controlPoints[idx]
+			       * (getBernsteinCoefficient(n, i, j) * customPow(static_cast<float>(u), i)
+			          * customPow(static_cast<float>(v), j) * customPow(static_cast<float>(w), k));
 		}
 	}
 	return sum;
 }
+
+// the surface point and the partial derivatives in the directions (1, 0, -1) and (0, 1, -1)
+struct BezierPatchEvaluation
+{
+	glm::vec3 point;
+	glm::vec3 partialU;
+	glm::vec3 partialV;
+};
+
+/**
+ * @brief Evaluates the point and both partial derivatives of a bezier triangle of degree N in one
+ * pass. The last de Casteljau step works on the three points b_100, b_010 and b_001, which are the
+ * degree N - 1 Bernstein sums of the control points shifted in u, v and w. The point is their
+ * barycentric combination and the derivatives are N times their differences, so only the degree
+ * N - 1 terms are evaluated instead of one sum for the point and one per derivative.
+ *
+ * Same operations as evaluateBezierPatch() in shader_aabb.rint, so the CPU reference renderer and
+ * the shaders produce the same images.
+ *
+ * @param controlPoints the control points in the order of getBezierPatchControlPointIndex()
+ */
+template <int N>
+inline BezierPatchEvaluation
+evaluateBezierPatch(const std::span<const glm::vec3> controlPoints, const float u, const float v)
+{
+	static_assert(N >= 1);
+	constexpr const auto& coefficients = BEZIER_TRIANGLE_TABLE<N - 1>.coefficients;
+	const float w = 1.0f - u - v;
+
+	// the powers up to N - 1, the same values as customPow()
+	std::array<float, N> powU;
+	std::array<float, N> powV;
+	std::array<float, N> powW;
+	powU[0] = 1.0f;
+	powV[0] = 1.0f;
+	powW[0] = 1.0f;
+	for (size_t p = 1; p < static_cast<size_t>(N); p++)
+	{
+		powU[p] = powU[p - 1] * u;
+		powV[p] = powV[p - 1] * v;
+		powW[p] = powW[p - 1] * w;
+	}
+
+	glm::vec3 cornerU = glm::vec3(0);
+	glm::vec3 cornerV = glm::vec3(0);
+	glm::vec3 cornerW = glm::vec3(0);
+	// the terms of degree N - 1 are in control point order
+	size_t term = 0;
+	for (int j = 0; j <= N - 1; j++)
+	{
+		for (int i = 0; i <= N - 1 - j; i++)
+		{
+			const float basis = coefficients[term++] * powU[static_cast<size_t>(i)]
+			                    * powV[static_cast<size_t>(j)]
+			                    * powW[static_cast<size_t>(N - 1 - i - j)];
+			cornerU += controlPoints[getBezierPatchControlPointIndex(N, i + 1, j)] * basis;
+			cornerV += controlPoints[getBezierPatchControlPointIndex(N, i, j + 1)] * basis;
+			cornerW += controlPoints[getBezierPatchControlPointIndex(N, i, j)] * basis;
+		}
+	}
+
+	constexpr auto degree = static_cast<float>(N);
+	return BezierPatchEvaluation{
+	    .point = u * cornerU + v * cornerV + w * cornerW,
+	    .partialU = degree * (cornerU - cornerW),
+	    .partialV = degree * (cornerV - cornerW),
+	};
+}
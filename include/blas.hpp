@@ -1,12 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
 #include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan_core.h>
 
+#include "blas_build_policy.hpp"
+#include "blas_clustering.hpp"
 #include "deletion_queue.hpp"
 #include "device_procedures.hpp"
-#include "raytracing_worldobject.hpp"
+#include "object_pool.hpp"
 #include "vk_utils.hpp"
 
 namespace tracer
@@ -26,29 +35,45 @@ struct BLASBuildData
 // Holds a collection of objects to put into one BLAS
 struct SceneObject
 {
-	// we only store pointers to the actual data in the raytracingScene
-	// NOTE: idk why normal pointer caused issues here, instead of further debugging we just
-	// use shared pointers...
-	std::vector<std::shared_ptr<RaytracingWorldObject<RectangularBezierSurface2x2>>>
-	    rectangularBezierSurfaces2x2{};
-	// std::vector<rt::RaytracingWorldObject<Tetrahedron2>::Ptr> tetrahedrons2;
-	std::vector<std::shared_ptr<RaytracingWorldObject<Sphere>>> spheres{};
-	std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle2>>> bezierTriangles2{};
-	std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle3>>> bezierTriangles3{};
-	std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle4>>> bezierTriangles4{};
+	// the objects are stored in the ObjectPools of the RaytracingScene, the objects of a
+	// SceneObject are consecutive. The offset of a range is also the offset into the
+	// spheres[]/bezierPatches[] etc. buffers inside the shader
+	ObjectRange rectangularBezierSurfaces2x2{};
+	ObjectRange spheres{};
+	// bezier triangles of all degrees
+	ObjectRange bezierPatches{};
 
 	const std::string name;
 	VkTransformMatrixKHR transformMatrix;
 	const uint32_t instanceCustomIndex;
 
-	// store the buffer offsets for the objects inside the SceneObject
-	// inside the shader we need to start accessing the objects with with this offet into the
-	// spheres[]/tetrahedrons2[] etc. buffers
-	const size_t spheresBufferOffset;
-	const size_t bezierTriangles2BufferOffset;
-	const size_t bezierTriangles3BufferOffset;
-	const size_t bezierTriangles4BufferOffset;
-	const size_t rectangularBezierSurfaces2x2BufferOffset;
+	// transforms of the additional TLAS instances of the SceneObject (the first instance uses
+	// transformMatrix), all instances share the BLAS's, the objects and the gpuObjects, see
+	// RaytracingScene::addSceneObjectInstance()
+	std::vector<VkTransformMatrixKHR> instanceTransforms{};
+
+	// size of the BLAS in bytes as built and after compaction (0 if it was not compacted)
+	VkDeviceSize blasSize = 0;
+	VkDeviceSize blasCompactedSize = 0;
+
+	// decides the build flags of the BLAS's of this SceneObject, dynamic objects (e.g. while
+	// editing control points) get BLAS's that are refitted in place when their AABBs move
+	// instead of being rebuilt, they are never compacted or cached
+	BLASBuildPolicy buildPolicy = BLASBuildPolicy::Static;
+
+	// the category of the TLAS instances, decides which rays traverse the SceneObject
+	InstanceMask instanceMask = InstanceMask::t_ModelInstance;
+
+	// order in which the objects are packed into the AABB buffer and the gpuObjects (indices
+	// into the list of spheres, bezier patches and rectangular surfaces, in that order),
+	// empty if the objects are not reordered
+	std::vector<uint32_t> primitiveOrder{};
+	// large SceneObjects are split into several clusters, each one gets its own BLAS and TLAS
+	// instance
+	std::vector<BLASCluster> clusters{};
+	// index of the TLAS instance of the first cluster, the other clusters follow. The clusters
+	// of the additional instances follow the ones of the first instance
+	size_t blasInstanceOffset = 0;
 
 	~SceneObject() = default;
 	SceneObject(const SceneObject&) = delete;
@@ -59,8 +84,7 @@ struct SceneObject
 
 	size_t totalElementsCount() const
 	{
-		return spheres.size() + bezierTriangles2.size() + bezierTriangles3.size()
-		       + bezierTriangles4.size() + rectangularBezierSurfaces2x2.size();
+		return spheres.size() + bezierPatches.size() + rectangularBezierSurfaces2x2.size();
 	}
 
 	void setTransformMatrix(const VkTransformMatrixKHR& newTransformMatrix)
@@ -68,20 +92,28 @@ struct SceneObject
 		transformMatrix = newTransformMatrix;
 	}
 
+	[[nodiscard]] size_t instanceCount() const
+	{
+		return 1 + instanceTransforms.size();
+	}
+
+	[[nodiscard]] const VkTransformMatrixKHR& getInstanceTransform(const size_t instanceIndex) const
+	{
+		assert(instanceIndex < instanceCount());
+		return instanceIndex == 0 ? transformMatrix : instanceTransforms[instanceIndex - 1];
+	}
+
 	SceneObject(const std::string& name,
 	            const VkTransformMatrixKHR& transformMatrix,
 	            const uint32_t instanceCustomIndex,
 	            const size_t spheresBufferOffset,
-	            const size_t bezierTriangles2BufferOffset,
-	            const size_t bezierTriangles3BufferOffset,
-	            const size_t bezierTriangles4BufferOffset,
+	            const size_t bezierPatchesBufferOffset,
 	            const size_t rectangularBezierSurfaces2x2BufferOffset)
-	    : name(name), transformMatrix(transformMatrix), instanceCustomIndex(instanceCustomIndex),
-	      spheresBufferOffset(spheresBufferOffset),
-	      bezierTriangles2BufferOffset(bezierTriangles2BufferOffset),
-	      bezierTriangles3BufferOffset(bezierTriangles3BufferOffset),
-	      bezierTriangles4BufferOffset(bezierTriangles4BufferOffset),
-	      rectangularBezierSurfaces2x2BufferOffset(rectangularBezierSurfaces2x2BufferOffset)
+	    : rectangularBezierSurfaces2x2{.offset = rectangularBezierSurfaces2x2BufferOffset,
+	                                   .count = 0},
+	      spheres{.offset = spheresBufferOffset, .count = 0},
+	      bezierPatches{.offset = bezierPatchesBufferOffset, .count = 0}, name(name),
+	      transformMatrix(transformMatrix), instanceCustomIndex(instanceCustomIndex)
 	{
 	}
 	// allow only the RaytracingScene to create a SceneObject
@@ -94,11 +126,50 @@ struct BLASSceneObjectBuildData
 	std::vector<BLASBuildData> blasData;
 	const VkTransformMatrixKHR transformMatrix;
 	const uint32_t instanceCustomIndex;
+	// picks the build flags, see getBLASBuildFlags()
+	const BLASBuildPolicy buildPolicy = BLASBuildPolicy::Static;
+};
+
+// holds the result of a BLAS build, sizes are in bytes
+struct BLASBuildResult
+{
+	VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
+	VkDeviceSize originalSize = 0;
+	// 0 if the BLAS was not compacted
+	VkDeviceSize compactedSize = 0;
+	// scratch sizes needed to rebuild/refit the BLAS in place (only used for dynamic BLAS's)
+	VkDeviceSize buildScratchSize = 0;
+	VkDeviceSize updateScratchSize = 0;
+};
+
+// a BLAS that is refitted in place when the AABBs of its SceneObject move, the primitive count
+// has to stay the same
+struct DynamicBLAS
+{
+	std::shared_ptr<SceneObject> sceneObject = nullptr;
+	RaytracingObjectAABBBuffer aabbBuffer = {};
+	VkAccelerationStructureGeometryKHR geometry = {};
+	VkAccelerationStructureBuildRangeInfoKHR buildRangeInfo = {};
+	// the range of the SceneObject's packed AABBs this BLAS is built from
+	BLASCluster cluster = {};
+	VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
+	// the flags of the initial build, refits and rebuilds have to use the same ones
+	VkBuildAccelerationStructureFlagsKHR buildFlags = 0;
+	// sized for both builds and refits
+	VkDeviceAddress scratchBufferDeviceAddress = 0;
+	// refits since the last build, every refit lowers the quality of the BLAS since the tree
+	// structure is kept and only the bounds are grown/shrunk
+	uint32_t refitCount = 0;
+	bool refitPending = false;
+	// the AABBs of the pending refit, they are copied into aabbBuffer inside the frame command
+	// buffer since the refits of the submitted frames might still read it
+	std::vector<VkAabbPositionsKHR> pendingAabbs{};
 };
 
 [[nodiscard]] inline BLASBuildData
 createBottomLevelAccelerationStructureBuildDataAABB(VkDevice logicalDevice,
-                                                    VkBuffer aabbBufferHandle)
+                                                    VkBuffer aabbBufferHandle,
+                                                    const uint32_t primitiveCount)
 {
 	VkBufferDeviceAddressInfo aabbPositionsDeviceAddressInfo = {
 	    .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
@@ -130,7 +201,7 @@ createBottomLevelAccelerationStructureBuildDataAABB(VkDevice logicalDevice,
 	};
 
 	VkAccelerationStructureBuildRangeInfoKHR bottomLevelAccelerationStructureBuildRangeInfo = {
-	    .primitiveCount = 1, // primitiveCount,
+	    .primitiveCount = primitiveCount,
 	    .primitiveOffset = 0,
 	    .firstVertex = 0,
 	    .transformOffset = 0,
@@ -185,74 +256,23 @@ createBottomLevelAccelerationStructureBuildDataTriangle(uint32_t primitiveCount,
 	};
 }
 
-inline VkAccelerationStructureKHR buildBottomLevelAccelerationStructure(
-    VkPhysicalDevice physicalDevice,
-    VkDevice logicalDevice,
-    VmaAllocator vmaAllocator,
-    DeletionQueue& deletionQueue,
-    const VkCommandBuffer bottomLevelCommandBuffer,
-    const VkQueue graphicsQueue,
-    const BLASSceneObjectBuildData blasBuildDatas,
-    const VkFence accelerationStructureBuildFence,
-    const VkDeviceSize minAccelerationStructureScratchOffsetAlignment)
+// creates a bottom level acceleration structure (and its buffer) of the given size, both are
+// added to the deletion queue
+[[nodiscard]] inline VkAccelerationStructureKHR
+createBottomLevelAccelerationStructure(VkPhysicalDevice physicalDevice,
+                                       VkDevice logicalDevice,
+                                       VmaAllocator vmaAllocator,
+                                       DeletionQueue& deletionQueue,
+                                       const VkDeviceSize accelerationStructureSize)
 {
-	VkAccelerationStructureKHR bottomLevelAccelerationStructureHandle = VK_NULL_HANDLE;
-
-	std::vector<uint32_t> bottomLevelMaxPrimitiveCountList;
-	std::vector<VkAccelerationStructureGeometryKHR> geometries;
-	std::vector<VkAccelerationStructureBuildRangeInfoKHR>
-	    bottomLevelAccelerationStructureBuildRangeInfos;
-
-	bottomLevelMaxPrimitiveCountList.resize(blasBuildDatas.blasData.size());
-	geometries.resize(blasBuildDatas.blasData.size());
-	bottomLevelAccelerationStructureBuildRangeInfos.resize(blasBuildDatas.blasData.size());
-
-	for (size_t i = 0; i < blasBuildDatas.blasData.size(); i++)
-	{
-		auto& buildData = blasBuildDatas.blasData[i];
-		geometries[i] = buildData.geometry;
-		bottomLevelMaxPrimitiveCountList[i] = buildData.buildRangeInfo.primitiveCount;
-		bottomLevelAccelerationStructureBuildRangeInfos[i] = buildData.buildRangeInfo;
-	}
-
-	// Create buffer for the bottom level acceleration structure
-	VkAccelerationStructureBuildGeometryInfoKHR bottomLevelAccelerationStructureBuildGeometryInfo
-	    = {
-	        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
-	        .pNext = NULL,
-	        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
-	        .flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
-	        .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
-	        .srcAccelerationStructure = VK_NULL_HANDLE,
-	        .dstAccelerationStructure = VK_NULL_HANDLE,
-	        .geometryCount = static_cast<uint32_t>(geometries.size()),
-	        .pGeometries = geometries.data(),
-	        .ppGeometries = NULL,
-	        .scratchData = {.deviceAddress = 0},
-	    };
-
-	VkAccelerationStructureBuildSizesInfoKHR bottomLevelAccelerationStructureBuildSizesInfo = {
-	    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
-	    .pNext = NULL,
-	    .accelerationStructureSize = 0,
-	    .updateScratchSize = 0,
-	    .buildScratchSize = 0,
-	};
-
-	tracer::procedures::pvkGetAccelerationStructureBuildSizesKHR(
-	    logicalDevice,
-	    VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-	    &bottomLevelAccelerationStructureBuildGeometryInfo,
-	    bottomLevelMaxPrimitiveCountList.data(),
-	    &bottomLevelAccelerationStructureBuildSizesInfo);
-
 	VkBuffer bottomLevelAccelerationStructureBufferHandle = VK_NULL_HANDLE;
 	VmaAllocation bottomLevelAccelerationStructureBufferAllocation = VK_NULL_HANDLE;
 	createBuffer(physicalDevice,
 	             logicalDevice,
 	             vmaAllocator,
 	             deletionQueue,
-	             bottomLevelAccelerationStructureBuildSizesInfo.accelerationStructureSize,
+	             AllocationCategory::BLAS,
+	             accelerationStructureSize,
 	             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR
 	                 | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
 	             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
@@ -266,67 +286,53 @@ inline VkAccelerationStructureKHR buildBottomLevelAccelerationStructure(
 	    .createFlags = 0,
 	    .buffer = bottomLevelAccelerationStructureBufferHandle,
 	    .offset = 0,
-	    .size = bottomLevelAccelerationStructureBuildSizesInfo.accelerationStructureSize,
+	    .size = accelerationStructureSize,
 	    .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
 	    .deviceAddress = 0,
 	};
 
+	VkAccelerationStructureKHR bottomLevelAccelerationStructureHandle = VK_NULL_HANDLE;
 	VK_CHECK_RESULT(tracer::procedures::pvkCreateAccelerationStructureKHR(
 	    logicalDevice,
 	    &bottomLevelAccelerationStructureCreateInfo,
 	    NULL,
 	    &bottomLevelAccelerationStructureHandle));
 
-	deletionQueue.push_function(
-	    [=]()
-	    {
-		    tracer::procedures::pvkDestroyAccelerationStructureKHR(
-		        logicalDevice, bottomLevelAccelerationStructureHandle, NULL);
-	    });
+	deletionQueue.push_acceleration_structure(logicalDevice,
+	                                          bottomLevelAccelerationStructureHandle);
 
-	// Build Bottom Level Acceleration Structure
-	VkBuffer bottomLevelAccelerationStructureScratchBufferHandle = VK_NULL_HANDLE;
-	VmaAllocation bottomLevelAccelerationStructureScratchBufferAllocation = VK_NULL_HANDLE;
-	createBuffer(physicalDevice,
-	             logicalDevice,
-	             vmaAllocator,
-	             deletionQueue,
-	             bottomLevelAccelerationStructureBuildSizesInfo.buildScratchSize,
-	             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-	             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-	             memoryAllocateFlagsInfo,
-	             bottomLevelAccelerationStructureScratchBufferHandle,
-	             bottomLevelAccelerationStructureScratchBufferAllocation,
-	             minAccelerationStructureScratchOffsetAlignment);
-
-	VkBufferDeviceAddressInfo bottomLevelAccelerationStructureScratchBufferDeviceAddressInfo = {
-	    .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
-	    .pNext = NULL,
-	    .buffer = bottomLevelAccelerationStructureScratchBufferHandle,
-	};
-
-	VkDeviceAddress bottomLevelAccelerationStructureScratchBufferDeviceAddress
-	    = tracer::procedures::pvkGetBufferDeviceAddressKHR(
-	        logicalDevice, &bottomLevelAccelerationStructureScratchBufferDeviceAddressInfo);
+	return bottomLevelAccelerationStructureHandle;
+}
 
-	bottomLevelAccelerationStructureBuildGeometryInfo.dstAccelerationStructure
-	    = bottomLevelAccelerationStructureHandle;
+// makes the following acceleration structure builds wait until the previously submitted frames are
+// done tracing rays against (or updating) the acceleration structures that are going to be written
+inline void recordAccelerationStructureWriteAfterReadBarrier(const VkCommandBuffer commandBuffer)
+{
+	VkMemoryBarrier2 waitForPreviousFramesBarrier = {};
+	waitForPreviousFramesBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	waitForPreviousFramesBarrier.srcStageMask
+	    = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR
+	      | VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+	waitForPreviousFramesBarrier.srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
+	                                             | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+	waitForPreviousFramesBarrier.dstStageMask
+	    = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+	waitForPreviousFramesBarrier.dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
+	                                             | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
 
-	bottomLevelAccelerationStructureBuildGeometryInfo.scratchData = {
-	    .deviceAddress = bottomLevelAccelerationStructureScratchBufferDeviceAddress,
-	};
+	VkDependencyInfo dependencyInfo = {};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.dependencyFlags = 0;
+	dependencyInfo.memoryBarrierCount = 1;
+	dependencyInfo.pMemoryBarriers = &waitForPreviousFramesBarrier;
 
-	VkCommandBufferBeginInfo bottomLevelCommandBufferBeginInfo = {
-	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-	    .pNext = NULL,
-	    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-	    .pInheritanceInfo = NULL,
-	};
-
-	VK_CHECK_RESULT(
-	    vkBeginCommandBuffer(bottomLevelCommandBuffer, &bottomLevelCommandBufferBeginInfo));
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
 
-	// TODO: this doesn't seem to be strictly necessary? Keeping it here just to be sure
+// makes the acceleration structure writes visible to the following build/copy commands and the
+// ray tracing shaders
+inline void recordAccelerationStructureBarrier(const VkCommandBuffer commandBuffer)
+{
 	VkMemoryBarrier2 waitForAccelerationStructureBarrier = {};
 	waitForAccelerationStructureBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
 	waitForAccelerationStructureBarrier.srcAccessMask
@@ -336,7 +342,8 @@ inline VkAccelerationStructureKHR buildBottomLevelAccelerationStructure(
 	waitForAccelerationStructureBarrier.srcStageMask
 	    = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
 	waitForAccelerationStructureBarrier.dstStageMask
-	    = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+	    = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR
+	      | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
 
 	VkDependencyInfo dependencyInfoWaitforAccelerationStructure = {};
 	dependencyInfoWaitforAccelerationStructure.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
@@ -345,42 +352,485 @@ inline VkAccelerationStructureKHR buildBottomLevelAccelerationStructure(
 	dependencyInfoWaitforAccelerationStructure.pMemoryBarriers
 	    = &waitForAccelerationStructureBarrier;
 
-	vkCmdPipelineBarrier2(bottomLevelCommandBuffer, &dependencyInfoWaitforAccelerationStructure);
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfoWaitforAccelerationStructure);
+}
 
-	const VkAccelerationStructureBuildRangeInfoKHR* const buildRangeInfo[1]
-	    = {bottomLevelAccelerationStructureBuildRangeInfos.data()};
+inline void beginAccelerationStructureCommandBuffer(const VkCommandBuffer commandBuffer)
+{
+	VkCommandBufferBeginInfo commandBufferBeginInfo = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+	    .pNext = NULL,
+	    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	    .pInheritanceInfo = NULL,
+	};
 
-	tracer::procedures::pvkCmdBuildAccelerationStructuresKHR(
-	    bottomLevelCommandBuffer,
-	    1,
-	    &bottomLevelAccelerationStructureBuildGeometryInfo,
-	    buildRangeInfo);
+	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo));
+}
 
-	VK_CHECK_RESULT(vkEndCommandBuffer(bottomLevelCommandBuffer));
+// ends the command buffer, submits it and waits until the GPU is done
+inline void submitAccelerationStructureCommandBufferAndWait(VkDevice logicalDevice,
+                                                           const VkCommandBuffer commandBuffer,
+                                                           const VkQueue graphicsQueue,
+                                                           const VkFence fence)
+{
+	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
 
-	VkSubmitInfo bottomLevelAccelerationStructureBuildSubmitInfo = {
+	VkSubmitInfo submitInfo = {
 	    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 	    .pNext = NULL,
 	    .waitSemaphoreCount = 0,
 	    .pWaitSemaphores = NULL,
 	    .pWaitDstStageMask = NULL,
 	    .commandBufferCount = 1,
-	    .pCommandBuffers = &bottomLevelCommandBuffer,
+	    .pCommandBuffers = &commandBuffer,
 	    .signalSemaphoreCount = 0,
 	    .pSignalSemaphores = NULL,
 	};
 
-	VK_CHECK_RESULT(vkQueueSubmit(graphicsQueue,
-	                              1,
-	                              &bottomLevelAccelerationStructureBuildSubmitInfo,
-	                              accelerationStructureBuildFence));
+	VK_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence));
+	VK_CHECK_RESULT(vkWaitForFences(logicalDevice, 1, &fence, true, UINT64_MAX));
+	VK_CHECK_RESULT(vkResetFences(logicalDevice, 1, &fence));
+}
 
-	VK_CHECK_RESULT(
-	    vkWaitForFences(logicalDevice, 1, &accelerationStructureBuildFence, true, UINT32_MAX));
+/**
+ * @brief Builds the bottom level acceleration structures for all passed scene objects at once.
+ * All builds are recorded into a single command buffer, share one scratch buffer (each build
+ * gets its own aligned region so they can run in parallel) and are submitted with a single
+ * fence wait.
+ *
+ * The build flags of every BLAS are picked from its BLASBuildPolicy. If compact is set, the
+ * compacted size of every static BLAS is queried after the build and the BLAS is copied into a
+ * right-sized acceleration structure, the original one is freed afterwards.
+ *
+ * The builds are recorded grouped by their policy with a timestamp after every group, so the
+ * build time of each policy can be reported in the telemetry.
+ *
+ * @param blasDeletionQueues resized to one deletion queue per BLAS, the acceleration structure
+ * and its buffer are added to the queue of the corresponding BLAS so each BLAS can be freed
+ * individually
+ * @param blasBuildDatas the build data of each scene object, one BLAS is created per entry
+ * @param compact whether to compact the acceleration structures after building them
+ * @param telemetry the counts, sizes and build times of the built BLAS's are added to it
+ * @return the BLAS handles and sizes in the same order as blasBuildDatas
+ */
+[[nodiscard]] inline std::vector<BLASBuildResult> buildBottomLevelAccelerationStructures(
+    VkPhysicalDevice physicalDevice,
+    VkDevice logicalDevice,
+    VmaAllocator vmaAllocator,
+    std::vector<DeletionQueue>& blasDeletionQueues,
+    const VkCommandBuffer bottomLevelCommandBuffer,
+    const VkQueue graphicsQueue,
+    const std::vector<BLASSceneObjectBuildData>& blasBuildDatas,
+    const VkFence accelerationStructureBuildFence,
+    const VkDeviceSize minAccelerationStructureScratchOffsetAlignment,
+    const bool compact,
+    BLASBuildTelemetry& telemetry)
+{
+	const auto buildStartTime = std::chrono::high_resolution_clock::now();
 
-	VK_CHECK_RESULT(vkResetFences(logicalDevice, 1, &accelerationStructureBuildFence));
+	const size_t blasCount = blasBuildDatas.size();
+	std::vector<BLASBuildResult> buildResults(blasCount);
+	blasDeletionQueues.clear();
+	blasDeletionQueues.resize(blasCount);
 
-	return bottomLevelAccelerationStructureHandle;
+	if (blasCount == 0)
+	{
+		return buildResults;
+	}
+
+	// holds the resources only needed during the build (scratch buffer and the uncompacted
+	// acceleration structures), flushed once the GPU is done
+	DeletionQueue buildDeletionQueue;
+
+	// the geometries and range infos need to stay alive until the build is recorded
+	std::vector<std::vector<VkAccelerationStructureGeometryKHR>> geometries(blasCount);
+	std::vector<std::vector<VkAccelerationStructureBuildRangeInfoKHR>>
+	    bottomLevelAccelerationStructureBuildRangeInfos(blasCount);
+	std::vector<VkAccelerationStructureBuildGeometryInfoKHR>
+	    bottomLevelAccelerationStructureBuildGeometryInfos(blasCount);
+	std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> buildRangeInfoPointers(blasCount);
+	std::vector<VkAccelerationStructureKHR> bottomLevelAccelerationStructureHandles(blasCount);
+	std::vector<VkDeviceSize> scratchOffsets(blasCount, 0);
+
+	const VkDeviceSize scratchAlignment
+	    = std::max<VkDeviceSize>(minAccelerationStructureScratchOffsetAlignment, 1);
+	VkDeviceSize totalScratchSize = 0;
+
+	// indices of the BLAS's that get compacted, only static BLAS's are compacted
+	std::vector<size_t> compactedBLASIndices;
+
+	for (size_t blasIndex = 0; blasIndex < blasCount; blasIndex++)
+	{
+		const auto& blasData = blasBuildDatas[blasIndex].blasData;
+		const BLASBuildPolicy buildPolicy = blasBuildDatas[blasIndex].buildPolicy;
+		const VkBuildAccelerationStructureFlagsKHR buildFlags
+		    = getBLASBuildFlags(buildPolicy, compact);
+		const bool compactBLAS
+		    = (buildFlags & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR) != 0;
+		if (compactBLAS)
+		{
+			compactedBLASIndices.push_back(blasIndex);
+		}
+
+		std::vector<uint32_t> bottomLevelMaxPrimitiveCountList(blasData.size());
+		geometries[blasIndex].resize(blasData.size());
+		bottomLevelAccelerationStructureBuildRangeInfos[blasIndex].resize(blasData.size());
+
+		for (size_t i = 0; i < blasData.size(); i++)
+		{
+			auto& buildData = blasData[i];
+			geometries[blasIndex][i] = buildData.geometry;
+			bottomLevelMaxPrimitiveCountList[i] = buildData.buildRangeInfo.primitiveCount;
+			bottomLevelAccelerationStructureBuildRangeInfos[blasIndex][i]
+			    = buildData.buildRangeInfo;
+			telemetry[buildPolicy].primitiveCount += buildData.buildRangeInfo.primitiveCount;
+		}
+		telemetry[buildPolicy].builtCount++;
+
+		VkAccelerationStructureBuildGeometryInfoKHR& bottomLevelAccelerationStructureBuildGeometryInfo
+		    = bottomLevelAccelerationStructureBuildGeometryInfos[blasIndex];
+		bottomLevelAccelerationStructureBuildGeometryInfo = {
+		    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+		    .pNext = NULL,
+		    .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+		    .flags = buildFlags,
+		    .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+		    .srcAccelerationStructure = VK_NULL_HANDLE,
+		    .dstAccelerationStructure = VK_NULL_HANDLE,
+		    .geometryCount = static_cast<uint32_t>(geometries[blasIndex].size()),
+		    .pGeometries = geometries[blasIndex].data(),
+		    .ppGeometries = NULL,
+		    .scratchData = {.deviceAddress = 0},
+		};
+
+		VkAccelerationStructureBuildSizesInfoKHR bottomLevelAccelerationStructureBuildSizesInfo = {
+		    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
+		    .pNext = NULL,
+		    .accelerationStructureSize = 0,
+		    .updateScratchSize = 0,
+		    .buildScratchSize = 0,
+		};
+
+		tracer::procedures::pvkGetAccelerationStructureBuildSizesKHR(
+		    logicalDevice,
+		    VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+		    &bottomLevelAccelerationStructureBuildGeometryInfo,
+		    bottomLevelMaxPrimitiveCountList.data(),
+		    &bottomLevelAccelerationStructureBuildSizesInfo);
+
+		bottomLevelAccelerationStructureHandles[blasIndex] = createBottomLevelAccelerationStructure(
+		    physicalDevice,
+		    logicalDevice,
+		    vmaAllocator,
+		    compactBLAS ? buildDeletionQueue : blasDeletionQueues[blasIndex],
+		    bottomLevelAccelerationStructureBuildSizesInfo.accelerationStructureSize);
+
+		buildResults[blasIndex].handle = bottomLevelAccelerationStructureHandles[blasIndex];
+		buildResults[blasIndex].originalSize
+		    = bottomLevelAccelerationStructureBuildSizesInfo.accelerationStructureSize;
+		buildResults[blasIndex].buildScratchSize
+		    = bottomLevelAccelerationStructureBuildSizesInfo.buildScratchSize;
+		buildResults[blasIndex].updateScratchSize
+		    = bottomLevelAccelerationStructureBuildSizesInfo.updateScratchSize;
+
+		bottomLevelAccelerationStructureBuildGeometryInfo.dstAccelerationStructure
+		    = bottomLevelAccelerationStructureHandles[blasIndex];
+
+		// reserve an aligned region of the shared scratch buffer for this build
+		scratchOffsets[blasIndex] = totalScratchSize;
+		totalScratchSize += (bottomLevelAccelerationStructureBuildSizesInfo.buildScratchSize
+		                     + scratchAlignment - 1)
+		                    / scratchAlignment * scratchAlignment;
+
+		buildRangeInfoPointers[blasIndex]
+		    = bottomLevelAccelerationStructureBuildRangeInfos[blasIndex].data();
+	}
+
+	// Build Bottom Level Acceleration Structures
+	VkBuffer bottomLevelAccelerationStructureScratchBufferHandle = VK_NULL_HANDLE;
+	VmaAllocation bottomLevelAccelerationStructureScratchBufferAllocation = VK_NULL_HANDLE;
+	createBuffer(physicalDevice,
+	             logicalDevice,
+	             vmaAllocator,
+	             buildDeletionQueue,
+	             AllocationCategory::Scratch,
+	             std::max<VkDeviceSize>(totalScratchSize, scratchAlignment),
+	             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+	             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	             memoryAllocateFlagsInfo,
+	             bottomLevelAccelerationStructureScratchBufferHandle,
+	             bottomLevelAccelerationStructureScratchBufferAllocation,
+	             minAccelerationStructureScratchOffsetAlignment);
+
+	VkBufferDeviceAddressInfo bottomLevelAccelerationStructureScratchBufferDeviceAddressInfo = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+	    .pNext = NULL,
+	    .buffer = bottomLevelAccelerationStructureScratchBufferHandle,
+	};
+
+	VkDeviceAddress bottomLevelAccelerationStructureScratchBufferDeviceAddress
+	    = tracer::procedures::pvkGetBufferDeviceAddressKHR(
+	        logicalDevice, &bottomLevelAccelerationStructureScratchBufferDeviceAddressInfo);
+
+	for (size_t blasIndex = 0; blasIndex < blasCount; blasIndex++)
+	{
+		bottomLevelAccelerationStructureBuildGeometryInfos[blasIndex].scratchData = {
+		    .deviceAddress = bottomLevelAccelerationStructureScratchBufferDeviceAddress
+		                     + scratchOffsets[blasIndex],
+		};
+	}
+
+	// group the builds by their policy, pBuildInfos of a build call has to be contiguous
+	std::array<std::vector<VkAccelerationStructureBuildGeometryInfoKHR>, BLAS_BUILD_POLICY_COUNT>
+	    policyBuildGeometryInfos;
+	std::array<std::vector<const VkAccelerationStructureBuildRangeInfoKHR*>,
+	           BLAS_BUILD_POLICY_COUNT>
+	    policyBuildRangeInfoPointers;
+	for (size_t blasIndex = 0; blasIndex < blasCount; blasIndex++)
+	{
+		const auto policyIndex = static_cast<size_t>(blasBuildDatas[blasIndex].buildPolicy);
+		policyBuildGeometryInfos[policyIndex].push_back(
+		    bottomLevelAccelerationStructureBuildGeometryInfos[blasIndex]);
+		policyBuildRangeInfoPointers[policyIndex].push_back(buildRangeInfoPointers[blasIndex]);
+	}
+
+	// one timestamp before the first and one after every policy group
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+	const bool timestampsSupported
+	    = physicalDeviceProperties.limits.timestampComputeAndGraphics == VK_TRUE;
+	constexpr auto timestampCount = static_cast<uint32_t>(BLAS_BUILD_POLICY_COUNT + 1);
+
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+	if (timestampsSupported)
+	{
+		VkQueryPoolCreateInfo timestampQueryPoolCreateInfo = {
+		    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		    .pNext = NULL,
+		    .flags = 0,
+		    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+		    .queryCount = timestampCount,
+		    .pipelineStatistics = 0,
+		};
+
+		VK_CHECK_RESULT(vkCreateQueryPool(
+		    logicalDevice, &timestampQueryPoolCreateInfo, NULL, &timestampQueryPool));
+
+		buildDeletionQueue.push_function(
+		    [=]() { vkDestroyQueryPool(logicalDevice, timestampQueryPool, NULL); });
+	}
+
+	const size_t compactedCount = compactedBLASIndices.size();
+	std::vector<VkAccelerationStructureKHR> compactedBLASHandles(compactedCount);
+	for (size_t i = 0; i < compactedCount; i++)
+	{
+		compactedBLASHandles[i] = bottomLevelAccelerationStructureHandles[compactedBLASIndices[i]];
+	}
+
+	VkQueryPool compactedSizeQueryPool = VK_NULL_HANDLE;
+	if (compactedCount > 0)
+	{
+		VkQueryPoolCreateInfo compactedSizeQueryPoolCreateInfo = {
+		    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		    .pNext = NULL,
+		    .flags = 0,
+		    .queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+		    .queryCount = static_cast<uint32_t>(compactedCount),
+		    .pipelineStatistics = 0,
+		};
+
+		VK_CHECK_RESULT(vkCreateQueryPool(
+		    logicalDevice, &compactedSizeQueryPoolCreateInfo, NULL, &compactedSizeQueryPool));
+
+		buildDeletionQueue.push_function(
+		    [=]() { vkDestroyQueryPool(logicalDevice, compactedSizeQueryPool, NULL); });
+	}
+
+	beginAccelerationStructureCommandBuffer(bottomLevelCommandBuffer);
+
+	if (compactedCount > 0)
+	{
+		vkCmdResetQueryPool(bottomLevelCommandBuffer,
+		                    compactedSizeQueryPool,
+		                    0,
+		                    static_cast<uint32_t>(compactedCount));
+	}
+
+	if (timestampsSupported)
+	{
+		vkCmdResetQueryPool(bottomLevelCommandBuffer, timestampQueryPool, 0, timestampCount);
+		vkCmdWriteTimestamp(
+		    bottomLevelCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 0);
+	}
+
+	// every build uses its own scratch region, therefore all builds of a policy can be recorded
+	// in one call
+	for (size_t policyIndex = 0; policyIndex < BLAS_BUILD_POLICY_COUNT; policyIndex++)
+	{
+		if (!policyBuildGeometryInfos[policyIndex].empty())
+		{
+			tracer::procedures::pvkCmdBuildAccelerationStructuresKHR(
+			    bottomLevelCommandBuffer,
+			    static_cast<uint32_t>(policyBuildGeometryInfos[policyIndex].size()),
+			    policyBuildGeometryInfos[policyIndex].data(),
+			    policyBuildRangeInfoPointers[policyIndex].data());
+		}
+
+		// make the finished BLAS's visible to the following TLAS build/compaction query and the
+		// ray tracing shaders, this also keeps the next group from overlapping with this one so
+		// the timestamps measure each policy on its own
+		recordAccelerationStructureBarrier(bottomLevelCommandBuffer);
+
+		if (timestampsSupported)
+		{
+			vkCmdWriteTimestamp(bottomLevelCommandBuffer,
+			                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			                    timestampQueryPool,
+			                    static_cast<uint32_t>(policyIndex + 1));
+		}
+	}
+
+	if (compactedCount > 0)
+	{
+		tracer::procedures::pvkCmdWriteAccelerationStructuresPropertiesKHR(
+		    bottomLevelCommandBuffer,
+		    static_cast<uint32_t>(compactedCount),
+		    compactedBLASHandles.data(),
+		    VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+		    compactedSizeQueryPool,
+		    0);
+	}
+
+	submitAccelerationStructureCommandBufferAndWait(
+	    logicalDevice, bottomLevelCommandBuffer, graphicsQueue, accelerationStructureBuildFence);
+
+	if (timestampsSupported)
+	{
+		std::array<uint64_t, timestampCount> timestamps{};
+		VK_CHECK_RESULT(vkGetQueryPoolResults(logicalDevice,
+		                                      timestampQueryPool,
+		                                      0,
+		                                      timestampCount,
+		                                      timestamps.size() * sizeof(uint64_t),
+		                                      timestamps.data(),
+		                                      sizeof(uint64_t),
+		                                      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+		for (size_t policyIndex = 0; policyIndex < BLAS_BUILD_POLICY_COUNT; policyIndex++)
+		{
+			if (!policyBuildGeometryInfos[policyIndex].empty())
+			{
+				telemetry.policies[policyIndex].buildTimeMs
+				    += static_cast<double>(timestamps[policyIndex + 1] - timestamps[policyIndex])
+				       * static_cast<double>(physicalDeviceProperties.limits.timestampPeriod)
+				       / 1e6;
+			}
+		}
+	}
+
+	if (compactedCount > 0)
+	{
+		std::vector<VkDeviceSize> compactedSizes(compactedCount, 0);
+		VK_CHECK_RESULT(vkGetQueryPoolResults(logicalDevice,
+		                                      compactedSizeQueryPool,
+		                                      0,
+		                                      static_cast<uint32_t>(compactedCount),
+		                                      compactedSizes.size() * sizeof(VkDeviceSize),
+		                                      compactedSizes.data(),
+		                                      sizeof(VkDeviceSize),
+		                                      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+		beginAccelerationStructureCommandBuffer(bottomLevelCommandBuffer);
+
+		// copy each BLAS into a right-sized acceleration structure
+		for (size_t i = 0; i < compactedCount; i++)
+		{
+			const size_t blasIndex = compactedBLASIndices[i];
+			VkAccelerationStructureKHR compactedAccelerationStructureHandle
+			    = createBottomLevelAccelerationStructure(physicalDevice,
+			                                             logicalDevice,
+			                                             vmaAllocator,
+			                                             blasDeletionQueues[blasIndex],
+			                                             compactedSizes[i]);
+
+			VkCopyAccelerationStructureInfoKHR copyAccelerationStructureInfo = {
+			    .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
+			    .pNext = NULL,
+			    .src = bottomLevelAccelerationStructureHandles[blasIndex],
+			    .dst = compactedAccelerationStructureHandle,
+			    .mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR,
+			};
+
+			tracer::procedures::pvkCmdCopyAccelerationStructureKHR(bottomLevelCommandBuffer,
+			                                                       &copyAccelerationStructureInfo);
+
+			buildResults[blasIndex].handle = compactedAccelerationStructureHandle;
+			buildResults[blasIndex].compactedSize = compactedSizes[i];
+		}
+
+		recordAccelerationStructureBarrier(bottomLevelCommandBuffer);
+
+		submitAccelerationStructureCommandBufferAndWait(logicalDevice,
+		                                                bottomLevelCommandBuffer,
+		                                                graphicsQueue,
+		                                                accelerationStructureBuildFence);
+	}
+
+	// the GPU is done with the build, free the scratch buffer (and the uncompacted BLAS's)
+	buildDeletionQueue.flush();
+
+	for (size_t blasIndex = 0; blasIndex < blasCount; blasIndex++)
+	{
+		const auto& buildResult = buildResults[blasIndex];
+		telemetry[blasBuildDatas[blasIndex].buildPolicy].sizeInBytes
+		    += buildResult.compactedSize > 0 ? buildResult.compactedSize
+		                                     : buildResult.originalSize;
+	}
+	telemetry.totalBuildTimeMs
+	    += std::chrono::duration<double, std::chrono::milliseconds::period>(
+	           std::chrono::high_resolution_clock::now() - buildStartTime)
+	           .count();
+
+	return buildResults;
+}
+
+/**
+ * @brief Records a refit (UPDATE build) of the dynamic BLAS from its AABB buffer. Once the BLAS
+ * was refitted maxRefits times it is rebuilt in place instead, the size of the BLAS stays the
+ * same since the primitive count does not change.
+ *
+ * The caller has to record the barriers around the refits, see
+ * recordAccelerationStructureWriteAfterReadBarrier() and recordAccelerationStructureBarrier().
+ */
+inline void recordBottomLevelAccelerationStructureRefit(const VkCommandBuffer commandBuffer,
+                                                        DynamicBLAS& dynamicBLAS,
+                                                        const uint32_t maxRefits)
+{
+	const bool rebuild = dynamicBLAS.refitCount >= maxRefits;
+
+	VkAccelerationStructureBuildGeometryInfoKHR bottomLevelAccelerationStructureBuildGeometryInfo
+	    = {
+	        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+	        .pNext = NULL,
+	        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+	        .flags = dynamicBLAS.buildFlags,
+	        .mode = rebuild ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR
+	                        : VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR,
+	        .srcAccelerationStructure = rebuild ? VK_NULL_HANDLE : dynamicBLAS.handle,
+	        .dstAccelerationStructure = dynamicBLAS.handle,
+	        .geometryCount = 1,
+	        .pGeometries = &dynamicBLAS.geometry,
+	        .ppGeometries = NULL,
+	        .scratchData = {.deviceAddress = dynamicBLAS.scratchBufferDeviceAddress},
+	    };
+
+	const VkAccelerationStructureBuildRangeInfoKHR* buildRangeInfos = &dynamicBLAS.buildRangeInfo;
+
+	tracer::procedures::pvkCmdBuildAccelerationStructuresKHR(
+	    commandBuffer, 1, &bottomLevelAccelerationStructureBuildGeometryInfo, &buildRangeInfos);
+
+	dynamicBLAS.refitCount = rebuild ? 0 : dynamicBLAS.refitCount + 1;
+	dynamicBLAS.refitPending = false;
 }
 
 template <typename T>
@@ -396,6 +846,7 @@ inline std::pair<VkBuffer, VmaAllocation> createObjectBuffer(VkPhysicalDevice ph
 	             logicalDevice,
 	             vmaAllocator,
 	             deletionQueue,
+	             AllocationCategory::StorageBuffer,
 	             sizeof(T),
 	             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 	             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
@@ -466,15 +917,16 @@ inline std::pair<VkBuffer, VmaAllocation> createObjectBuffer(VkPhysicalDevice ph
  * instances, to which the acceleration structure is added
  * @param objectsBufferHandle the buffer handle of the objects
  * @param aabbObjectsBufferHandle the buffer handle of the AABBs for the objects
+ * @param primitiveCount the amount of AABBs packed into the buffer
  */
 template <typename T>
 [[nodiscard]] inline BLASBuildData
 createBottomLevelAccelerationStructureBuildDataForObject(VkDevice logicalDevice,
-                                                         VkBuffer& aabbObjectBufferHandle)
+                                                         VkBuffer& aabbObjectBufferHandle,
+                                                         const uint32_t primitiveCount)
 {
-	// TODO: Make it possible to have multiple BLAS with their individual AABBs
-	return createBottomLevelAccelerationStructureBuildDataAABB(logicalDevice,
-	                                                           aabbObjectBufferHandle);
+	return createBottomLevelAccelerationStructureBuildDataAABB(
+	    logicalDevice, aabbObjectBufferHandle, primitiveCount);
 }
 
 } // namespace rt
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+namespace tracer
+{
+namespace rt
+{
+
+// decides which flags the BLAS of a SceneObject is built with and how it is updated
+enum class BLASBuildPolicy : uint8_t
+{
+	// built once and traced every frame, prefers fast tracing and is compacted if enabled
+	Static = 0,
+	// the AABBs move (e.g. while editing control points), the BLAS is refitted in place and
+	// regularly rebuilt, therefore it prefers fast builds and is never compacted
+	Dynamic = 1,
+	// debug visualizations (control points, sampled surface/volume spheres) that only exist
+	// to inspect the scene, they are rebuilt with every reload and never compacted
+	Debug = 2,
+};
+
+constexpr size_t BLAS_BUILD_POLICY_COUNT = 3;
+
+[[nodiscard]] inline const char* getBLASBuildPolicyName(const BLASBuildPolicy policy)
+{
+	switch (policy)
+	{
+	case BLASBuildPolicy::Static:
+		return "Static";
+	case BLASBuildPolicy::Dynamic:
+		return "Dynamic";
+	case BLASBuildPolicy::Debug:
+		return "Debug";
+	}
+	return "Unknown";
+}
+
+// only BLAS's of dynamic SceneObjects are refitted
+[[nodiscard]] inline bool isBLASRefittable(const BLASBuildPolicy policy)
+{
+	return policy == BLASBuildPolicy::Dynamic;
+}
+
+/**
+ * @brief Returns the build flags of a BLAS with the given policy. Refits and rebuilds of a BLAS
+ * have to use the same flags as its initial build.
+ *
+ * @param compact whether compaction is enabled for the scene, only static BLAS's are compacted
+ */
+[[nodiscard]] inline VkBuildAccelerationStructureFlagsKHR
+getBLASBuildFlags(const BLASBuildPolicy policy, const bool compact)
+{
+	switch (policy)
+	{
+	case BLASBuildPolicy::Static:
+	{
+		VkBuildAccelerationStructureFlagsKHR buildFlags
+		    = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+		if (compact)
+		{
+			buildFlags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+		}
+		return buildFlags;
+	}
+	case BLASBuildPolicy::Dynamic:
+		return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR
+		       | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+	case BLASBuildPolicy::Debug:
+		return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
+	}
+	return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+}
+
+// statistics of the BLAS's of one policy, collected during the last full rebuild
+struct BLASBuildPolicyStatistics
+{
+	// BLAS's built during the rebuild, the ones taken from the BLASCache are counted separately
+	uint32_t builtCount = 0;
+	uint32_t cachedCount = 0;
+	uint64_t primitiveCount = 0;
+	// GPU time of the builds (without the compaction), 0 if timestamps are not supported
+	double buildTimeMs = 0.0;
+	// size of the built BLAS's (after compaction)
+	VkDeviceSize sizeInBytes = 0;
+};
+
+struct BLASBuildTelemetry
+{
+	std::array<BLASBuildPolicyStatistics, BLAS_BUILD_POLICY_COUNT> policies{};
+	// CPU time of the whole batched build including the compaction
+	double totalBuildTimeMs = 0.0;
+
+	[[nodiscard]] BLASBuildPolicyStatistics& operator[](const BLASBuildPolicy policy)
+	{
+		return policies[static_cast<size_t>(policy)];
+	}
+
+	[[nodiscard]] const BLASBuildPolicyStatistics& operator[](const BLASBuildPolicy policy) const
+	{
+		return policies[static_cast<size_t>(policy)];
+	}
+};
+
+} // namespace rt
+} // namespace tracer
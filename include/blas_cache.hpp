@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "blas.hpp"
+#include "deletion_queue.hpp"
+#include "logger.hpp"
+
+namespace tracer
+{
+namespace rt
+{
+
+// Keeps built BLAS's alive across full rebuilds (e.g. scene reloads) so SceneObjects with the
+// same AABBs don't need to be rebuilt. Entries are keyed by a hash of the packed AABBs, the
+// least recently used entries are evicted once the cache exceeds its budget
+class BLASCache
+{
+  public:
+	static constexpr VkDeviceSize DEFAULT_BUDGET_IN_BYTES = 256ull * 1024ull * 1024ull;
+
+	explicit BLASCache(const VkDeviceSize budgetInBytes = DEFAULT_BUDGET_IN_BYTES)
+	    : budgetInBytes(budgetInBytes)
+	{
+	}
+
+	~BLASCache() = default;
+
+	BLASCache(const BLASCache&) = delete;
+	BLASCache& operator=(const BLASCache&) = delete;
+
+	BLASCache(BLASCache&&) noexcept = delete;
+	BLASCache& operator=(BLASCache&&) noexcept = delete;
+
+	// FNV-1a hash over the AABB positions and the build flags, the BLAS only depends on these
+	// (the object data itself is only read in the shaders)
+	[[nodiscard]] static uint64_t computeKey(const std::vector<VkAabbPositionsKHR>& aabbPositions,
+	                                         const VkBuildAccelerationStructureFlagsKHR buildFlags)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		const auto* bytes = reinterpret_cast<const uint8_t*>(aabbPositions.data());
+		const size_t byteCount = aabbPositions.size() * sizeof(VkAabbPositionsKHR);
+		for (size_t i = 0; i < byteCount; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		hash ^= buildFlags;
+		hash *= 1099511628211ull;
+		return hash;
+	}
+
+	[[nodiscard]] static bool isSameAABBs(const std::vector<VkAabbPositionsKHR>& a,
+	                                      const std::vector<VkAabbPositionsKHR>& b)
+	{
+		return a.size() == b.size()
+		       && (a.empty()
+		           || std::memcmp(a.data(), b.data(), a.size() * sizeof(VkAabbPositionsKHR))
+		                  == 0);
+	}
+
+	// starts a new generation, entries used during the current generation are never evicted
+	void beginGeneration()
+	{
+		currentGeneration++;
+		hits = 0;
+		misses = 0;
+	}
+
+	[[nodiscard]] std::optional<BLASBuildResult>
+	find(const uint64_t key,
+	     const std::vector<VkAabbPositionsKHR>& aabbPositions,
+	     const VkBuildAccelerationStructureFlagsKHR buildFlags)
+	{
+		auto range = entries.equal_range(key);
+		for (auto it = range.first; it != range.second; it++)
+		{
+			auto& entry = it->second;
+			if (entry.buildFlags == buildFlags && isSameAABBs(entry.aabbPositions, aabbPositions))
+			{
+				entry.lastUsedGeneration = currentGeneration;
+				hits++;
+				return entry.result;
+			}
+		}
+
+		misses++;
+		return std::nullopt;
+	}
+
+	// takes ownership of the BLAS, it gets destroyed when it's evicted or the cache is cleared
+	void insert(const uint64_t key,
+	            std::vector<VkAabbPositionsKHR>&& aabbPositions,
+	            const VkBuildAccelerationStructureFlagsKHR buildFlags,
+	            const BLASBuildResult& result,
+	            DeletionQueue&& deletionQueue)
+	{
+		sizeInBytes += getEntrySize(result);
+		entries.emplace(key,
+		                Entry{
+		                    .aabbPositions = std::move(aabbPositions),
+		                    .buildFlags = buildFlags,
+		                    .result = result,
+		                    .deletionQueue = std::move(deletionQueue),
+		                    .lastUsedGeneration = currentGeneration,
+		                });
+	}
+
+	// evicts the least recently used entries until the cache is within its budget, the evicted
+	// BLAS's are moved into evictedQueue and are destroyed once it is flushed (the previous frames
+	// might still trace rays against them)
+	void evict(DeletionQueue& evictedQueue)
+	{
+		if (sizeInBytes <= budgetInBytes)
+		{
+			return;
+		}
+
+		std::vector<std::unordered_multimap<uint64_t, Entry>::iterator> candidates;
+		for (auto it = entries.begin(); it != entries.end(); it++)
+		{
+			if (it->second.lastUsedGeneration < currentGeneration)
+			{
+				candidates.push_back(it);
+			}
+		}
+
+		std::sort(candidates.begin(),
+		          candidates.end(),
+		          [](const auto& a, const auto& b)
+		          { return a->second.lastUsedGeneration < b->second.lastUsedGeneration; });
+
+		for (auto& it : candidates)
+		{
+			if (sizeInBytes <= budgetInBytes)
+			{
+				break;
+			}
+
+			sizeInBytes -= getEntrySize(it->second.result);
+			evictedQueue.append(std::move(it->second.deletionQueue));
+			entries.erase(it);
+		}
+
+		debug_printFmt("BLASCache - %zu entries (%llu bytes) after eviction\n",
+		               entries.size(),
+		               static_cast<unsigned long long>(sizeInBytes));
+	}
+
+	// destroys all cached BLAS's, the GPU must not use them anymore
+	void clear()
+	{
+		for (auto& [key, entry] : entries)
+		{
+			entry.deletionQueue.flush();
+		}
+		entries.clear();
+		sizeInBytes = 0;
+	}
+
+	[[nodiscard]] size_t getEntryCount() const
+	{
+		return entries.size();
+	}
+
+	[[nodiscard]] VkDeviceSize getSizeInBytes() const
+	{
+		return sizeInBytes;
+	}
+
+	[[nodiscard]] size_t getHits() const
+	{
+		return hits;
+	}
+
+	[[nodiscard]] size_t getMisses() const
+	{
+		return misses;
+	}
+
+  private:
+	struct Entry
+	{
+		// stored to rule out hash collisions
+		std::vector<VkAabbPositionsKHR> aabbPositions;
+		VkBuildAccelerationStructureFlagsKHR buildFlags;
+		BLASBuildResult result;
+		DeletionQueue deletionQueue;
+		uint64_t lastUsedGeneration;
+	};
+
+	static VkDeviceSize getEntrySize(const BLASBuildResult& result)
+	{
+		return result.compactedSize > 0 ? result.compactedSize : result.originalSize;
+	}
+
+	std::unordered_multimap<uint64_t, Entry> entries;
+	VkDeviceSize budgetInBytes;
+	VkDeviceSize sizeInBytes = 0;
+	uint64_t currentGeneration = 0;
+	size_t hits = 0;
+	size_t misses = 0;
+};
+
+} // namespace rt
+} // namespace tracer
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_RADIANS
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/common.hpp>
+#include <glm/ext/vector_float3.hpp>
+
+namespace tracer
+{
+namespace rt
+{
+
+// SceneObjects with more objects than this are split into multiple BLAS's by default
+constexpr uint32_t DEFAULT_BLAS_CLUSTER_SIZE = 4096;
+
+// a contiguous range of the (Morton ordered) packed AABBs of a SceneObject, every cluster gets
+// its own BLAS and TLAS instance
+struct BLASCluster
+{
+	uint32_t primitiveOffset = 0;
+	uint32_t primitiveCount = 0;
+};
+
+// inserts two zero bits between each of the lower 10 bits
+// see https://developer.nvidia.com/blog/thinking-parallel-part-iii-tree-construction-gpu/
+[[nodiscard]] inline uint32_t expandBitsForMortonCode(uint32_t v)
+{
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+// 30 bit Morton code for a point inside the unit cube
+[[nodiscard]] inline uint32_t mortonCode3D(const glm::vec3 normalizedPosition)
+{
+	const glm::vec3 p = glm::clamp(normalizedPosition * 1024.0f, 0.0f, 1023.0f);
+	return (expandBitsForMortonCode(static_cast<uint32_t>(p.x)) << 2)
+	       | (expandBitsForMortonCode(static_cast<uint32_t>(p.y)) << 1)
+	       | expandBitsForMortonCode(static_cast<uint32_t>(p.z));
+}
+
+/**
+ * @brief Sorts the AABBs along a Morton curve over their centers, neighbouring entries of the
+ * returned order are therefore spatially close which keeps the clusters (and their BLAS's) tight.
+ *
+ * @return order[i] is the index into aabbPositions of the i-th AABB along the curve
+ */
+[[nodiscard]] inline std::vector<uint32_t>
+computeMortonOrder(const std::vector<VkAabbPositionsKHR>& aabbPositions)
+{
+	std::vector<uint32_t> order(aabbPositions.size());
+	std::iota(order.begin(), order.end(), 0u);
+	if (aabbPositions.empty())
+	{
+		return order;
+	}
+
+	std::vector<glm::vec3> centers(aabbPositions.size());
+	glm::vec3 minCenter = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 maxCenter = glm::vec3(std::numeric_limits<float>::lowest());
+	for (size_t i = 0; i < aabbPositions.size(); i++)
+	{
+		const auto& aabb = aabbPositions[i];
+		centers[i] = glm::vec3(aabb.minX + aabb.maxX, aabb.minY + aabb.maxY, aabb.minZ + aabb.maxZ)
+		             * 0.5f;
+		minCenter = glm::min(minCenter, centers[i]);
+		maxCenter = glm::max(maxCenter, centers[i]);
+	}
+
+	// avoid dividing by zero for flat scenes
+	const glm::vec3 extent = glm::max(maxCenter - minCenter, glm::vec3(1e-6f));
+
+	std::vector<uint32_t> mortonCodes(aabbPositions.size());
+	for (size_t i = 0; i < aabbPositions.size(); i++)
+	{
+		mortonCodes[i] = mortonCode3D((centers[i] - minCenter) / extent);
+	}
+
+	// stable so equal codes keep the original order and the result is deterministic
+	std::stable_sort(order.begin(),
+	                 order.end(),
+	                 [&mortonCodes](const uint32_t a, const uint32_t b)
+	                 { return mortonCodes[a] < mortonCodes[b]; });
+	return order;
+}
+
+// splits primitiveCount primitives into clusters of at most clusterSize primitives, a
+// clusterSize of 0 puts everything into a single cluster
+[[nodiscard]] inline std::vector<BLASCluster> createClusters(const uint32_t primitiveCount,
+                                                             const uint32_t clusterSize)
+{
+	std::vector<BLASCluster> clusters;
+	if (primitiveCount == 0)
+	{
+		return clusters;
+	}
+
+	const uint32_t size = clusterSize == 0 ? primitiveCount : clusterSize;
+	for (uint32_t offset = 0; offset < primitiveCount; offset += size)
+	{
+		clusters.push_back(BLASCluster{
+		    .primitiveOffset = offset,
+		    .primitiveCount = std::min(size, primitiveCount - offset),
+		});
+	}
+	return clusters;
+}
+
+} // namespace rt
+} // namespace tracer
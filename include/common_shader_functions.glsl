@@ -1,6 +1,9 @@
 #ifndef COMMON_SHADER_FUNCTIONS
 #define COMMON_SHADER_FUNCTIONS
 
+// generated during the build, see bernstein_tables.hpp
+#include "bernstein_tables.glsl"
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////// Basic Math functions //////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////
@@ -47,6 +50,14 @@ float customPow(float x, int i)
 	{
 		return x * x * x * x * x * x;
 	}
+
+	// higher degree bezier patches
+	float result = x * x * x * x * x * x;
+	for (int c = 6; c < i; c++)
+	{
+		result *= x;
+	}
+	return result;
 }
 
 float nChooseK(int N, int K)
@@ -77,31 +88,6 @@ int iter_factorial(int n)
 	return ret;
 }
 
-int iter_factorial2(int n)
-{
-	if (n == 0)
-	{
-		return 1;
-	}
-	else if (n == 1)
-	{
-		return 1;
-	}
-	else if (n == 2)
-	{
-		return 2;
-	}
-	else if (n == 3)
-	{
-		return 3 * 2;
-	}
-	else if (n == 4)
-	{
-		return 4 * 3 * 2;
-	}
-	return 0;
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////// Helper functions //////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////
@@ -186,8 +172,7 @@ float BernsteinPolynomialBivariate(int n, int i, int j, int k, float u, float v,
 		return 0;
 	}
 
-	float fraction
-	    = iter_factorial2(n) / (iter_factorial2(i) * iter_factorial2(j) * iter_factorial2(k));
+	float fraction = getBernsteinCoefficient(n, i, j);
 
 	float powi = customPow(u, i);
 	float powj = customPow(v, j);
@@ -265,168 +250,6 @@ vec3 partialHw(
 	return n * sum;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////
-////////////////////// Bezier Triangle functions /////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////
-// returns the control point index for the bezier triangle of degree 2
-int getControlPointIndicesBezierTriangle2(int i, int j, int k)
-{
-	if (i == 0 && j == 0 && k == 2) return 0;
-	if (i == 1 && j == 0 && k == 1) return 1;
-	if (i == 2 && j == 0 && k == 0) return 2;
-	if (i == 0 && j == 1 && k == 1) return 3;
-	if (i == 1 && j == 1 && k == 0) return 4;
-	if (i == 0 && j == 2 && k == 0) return 5;
-	debugPrintfEXT("Error: getControlPointIndicesBezierTriangle2: %d, %d, %d", i, j, k);
-	return 0;
-}
-
-// returns the control point index for the bezier triangle of degree 3
-int getControlPointIndicesBezierTriangle3(int i, int j, int k)
-{
-	if (i == 0 && j == 0 && k == 3) return 0;
-	if (i == 1 && j == 0 && k == 2) return 1;
-	if (i == 2 && j == 0 && k == 1) return 2;
-	if (i == 3 && j == 0 && k == 0) return 3;
-	if (i == 0 && j == 1 && k == 2) return 4;
-	if (i == 1 && j == 1 && k == 1) return 5;
-	if (i == 2 && j == 1 && k == 0) return 6;
-	if (i == 0 && j == 2 && k == 1) return 7;
-	if (i == 1 && j == 2 && k == 0) return 8;
-	if (i == 0 && j == 3 && k == 0) return 9;
-	debugPrintfEXT("Error: getControlPointIndicesBezierTriangle3: %d, %d, %d", i, j, k);
-	return 0;
-}
-
-// returns the control point index for the bezier triangle of degree 3
-int getControlPointIndicesBezierTriangle4(int i, int j, int k)
-{
-	if (i == 0 && j == 0 && k == 4) return 0;
-	if (i == 1 && j == 0 && k == 3) return 1;
-	if (i == 2 && j == 0 && k == 2) return 2;
-	if (i == 3 && j == 0 && k == 1) return 3;
-	if (i == 4 && j == 0 && k == 0) return 4;
-	if (i == 0 && j == 1 && k == 3) return 5;
-	if (i == 1 && j == 1 && k == 2) return 6;
-	if (i == 2 && j == 1 && k == 1) return 7;
-	if (i == 3 && j == 1 && k == 0) return 8;
-	if (i == 0 && j == 2 && k == 2) return 9;
-	if (i == 1 && j == 2 && k == 1) return 10;
-	if (i == 2 && j == 2 && k == 0) return 11;
-	if (i == 0 && j == 3 && k == 1) return 12;
-	if (i == 1 && j == 3 && k == 0) return 13;
-	if (i == 0 && j == 4 && k == 0) return 14;
-
-	debugPrintfEXT("Error: getControlPointIndicesBezierTriangle4: %d, %d, %d", i, j, k);
-	return 0;
-}
-
-// returns the partial directional derivative for bezier triangles of degree 2
-vec3 partialBezierTriangle2Directional(vec3 controlPoints[6], vec3 direction, float u, float v)
-{
-	int n = 2;
-	vec3 sum = vec3(0);
-	float w = 1.0 - u - v;
-
-	sum += (controlPoints[2] * direction.x + controlPoints[4] * direction.y
-	        + controlPoints[1] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 1, 0, 0, u, v, w);
-
-	sum += (controlPoints[4] * direction.x + controlPoints[5] * direction.y
-	        + controlPoints[3] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 0, 1, 0, u, v, w);
-
-	sum += (controlPoints[1] * direction.x + controlPoints[3] * direction.y
-	        + controlPoints[0] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 0, 0, 1, u, v, w);
-
-	return n * sum;
-}
-
-// returns the partial directional derivative for bezier triangles of degree 3
-vec3 partialBezierTriangle3Directional(vec3 controlPoints[10], vec3 direction, float u, float v)
-{
-	int n = 3;
-	vec3 sum = vec3(0);
-	float w = 1.0 - u - v;
-
-	sum += (controlPoints[3] * direction.x + controlPoints[6] * direction.y
-	        + controlPoints[2] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 2, 0, 0, u, v, w);
-
-	sum += (controlPoints[6] * direction.x + controlPoints[8] * direction.y
-	        + controlPoints[5] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 1, 1, 0, u, v, w);
-
-	sum += (controlPoints[8] * direction.x + controlPoints[9] * direction.y
-	        + controlPoints[7] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 0, 2, 0, u, v, w);
-
-	sum += (controlPoints[2] * direction.x + controlPoints[5] * direction.y
-	        + controlPoints[1] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 1, 0, 1, u, v, w);
-
-	sum += (controlPoints[5] * direction.x + controlPoints[7] * direction.y
-	        + controlPoints[4] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 0, 1, 1, u, v, w);
-
-	sum += (controlPoints[1] * direction.x + controlPoints[4] * direction.y
-	        + controlPoints[0] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 0, 0, 2, u, v, w);
-
-	return n * sum;
-}
-
-// returns the partial directional derivative for bezier triangles of degree 4
-vec3 partialBezierTriangle4Directional(vec3 controlPoints[15], vec3 direction, float u, float v)
-{
-	int n = 4;
-	vec3 sum = vec3(0);
-	float w = 1.0 - u - v;
-
-	sum += (controlPoints[4] * direction.x + controlPoints[8] * direction.y
-	        + controlPoints[3] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 3, 0, 0, u, v, w);
-
-	sum += (controlPoints[8] * direction.x + controlPoints[11] * direction.y
-	        + controlPoints[7] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 2, 1, 0, u, v, w);
-
-	sum += (controlPoints[11] * direction.x + controlPoints[13] * direction.y
-	        + controlPoints[10] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 1, 2, 0, u, v, w);
-
-	sum += (controlPoints[13] * direction.x + controlPoints[14] * direction.y
-	        + controlPoints[12] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 0, 3, 0, u, v, w);
-
-	sum += (controlPoints[3] * direction.x + controlPoints[7] * direction.y
-	        + controlPoints[2] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 2, 0, 1, u, v, w);
-
-	sum += (controlPoints[7] * direction.x + controlPoints[10] * direction.y
-	        + controlPoints[6] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 1, 1, 1, u, v, w);
-
-	sum += (controlPoints[10] * direction.x + controlPoints[12] * direction.y
-	        + controlPoints[9] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 0, 2, 1, u, v, w);
-
-	sum += (controlPoints[2] * direction.x + controlPoints[6] * direction.y
-	        + controlPoints[1] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 1, 0, 2, u, v, w);
-
-	sum += (controlPoints[6] * direction.x + controlPoints[9] * direction.y
-	        + controlPoints[5] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 0, 1, 2, u, v, w);
-
-	sum += (controlPoints[1] * direction.x + controlPoints[5] * direction.y
-	        + controlPoints[0] * direction.z)
-	       * BernsteinPolynomialBivariate(n - 1, 0, 0, 3, u, v, w);
-
-	return n * sum;
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////// Intersection functions
 ///////////////////////////////////////////////////////
@@ -28,6 +28,11 @@
 #define COMMON_TYPES
 
 const int MAX_NEWTON_ITERATIONS = 30;
+// the shaders look the Bernstein coefficients up in BERNSTEIN_TRIANGLE_COEFFICIENTS, generated
+// for the degrees 0 to MAX_BEZIER_PATCH_DEGREE (see bernstein_tables.hpp). The table grows with
+// the cube of the degree and is compiled into every shader that includes it, the CPU packet
+// solver sizes its power arrays with it. The coefficients stay exact in float far beyond 12.
+const int MAX_BEZIER_PATCH_DEGREE = 12;
 
 #ifdef __cplusplus
 #include <glm/glm.hpp>
@@ -59,17 +64,10 @@ START_BINDING(ObjectType)
 	// not used
 	t_RectangularBezierSurface2x2 = 10,
 
-	// represents the sides of a tetrahedron that are outside, default
-	t_BezierTriangle1 = 11,
-	t_BezierTriangle2 = 12,
-	t_BezierTriangle3 = 13,
-	t_BezierTriangle4 = 14,
-
-	// represents the sides of a tetrahedron that are inside (used for the slicing plane calculations)
-	t_BezierTriangleInside1 = 21,
-	t_BezierTriangleInside2 = 22,
-	t_BezierTriangleInside3 = 23,
-	t_BezierTriangleInside4 = 24,
+	// bezier triangle of any degree, the degree is stored in its BezierPatch
+	t_BezierPatch = 11,
+	// only used as hit kind, marks hits of patches with the t_BezierPatchFlagInside flag
+	t_BezierPatchInside = 21,
 
 	t_Sphere = 99,
 	t_AABBDebug = 100
@@ -87,6 +85,25 @@ START_BINDING(ColorIdx)
 	t_purple = 8,
 	t_black = 9
 END_BINDING();
+
+// categories of the TLAS instances (stored in the 8 bit instance mask), rays only traverse the
+// instances whose mask shares a bit with the cull mask of the ray
+START_BINDING(InstanceMask)
+	t_ModelInstance = 0x01,
+	t_LightInstance = 0x02,
+	// control points, sampled surface/volume spheres etc.
+	t_DebugInstance = 0x04,
+	t_SlicingPlaneHelperInstance = 0x08,
+
+	t_PrimaryRayCullMask = 0xFF,
+	// only the models cast shadows
+	t_ShadowRayCullMask = t_ModelInstance
+END_BINDING();
+
+START_BINDING(BezierPatchFlags)
+	// represents the sides of a tetrahedron that are inside (used for the slicing plane calculations)
+	t_BezierPatchFlagInside = 0x01
+END_BINDING();
 // clang-format on
 
 #define UNIFORM_MEMBERS                                                                            \
@@ -232,6 +249,18 @@ struct BezierTriangle4
 	Aabb aabb;
 };
 
+// Bezier triangle of any degree, its (degree+1)(degree+2)/2 control points are stored
+// consecutively in the shared control point buffer starting at controlPointOffset. The control
+// point order is the same as in the BezierTriangle structs above (row by row along v).
+struct BezierPatch
+{
+	uint controlPointOffset;
+	uint degree;
+	// BezierPatchFlags
+	uint flags;
+	Aabb aabb;
+};
+
 struct SlicingPlane
 {
 	vec3 planeOrigin;
@@ -1,19 +1,98 @@
 #pragma once
 
-#include <deque>
+#include <cstdint>
 #include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan_core.h>
+
+#include "device_procedures.hpp"
+#include "memory_telemetry.hpp"
 
 namespace tracer
 {
 
 // A simple deletion queue to handle cleanup of created vulkan objects
+// Buffers and acceleration structures are by far the most common entries (every rebuild creates
+// a few per SceneObject), they are stored by value instead of in a heap allocated closure.
 struct DeletionQueue
 {
-	std::deque<std::function<void()>> deletors;
+	enum class DeletionType : uint8_t
+	{
+		Function,
+		Buffer,
+		AccelerationStructure,
+	};
+
+	struct Deletion
+	{
+		DeletionType type = DeletionType::Function;
+
+		// DeletionType::Buffer
+		VmaAllocator allocator = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+		AllocationCategory category = AllocationCategory::StorageBuffer;
+		VkDeviceSize allocationSize = 0;
+
+		// DeletionType::AccelerationStructure
+		VkDevice device = VK_NULL_HANDLE;
+		VkAccelerationStructureKHR accelerationStructure = VK_NULL_HANDLE;
+
+		// DeletionType::Function
+		std::function<void()> function;
+	};
+
+	std::vector<Deletion> deletors;
 
 	void push_function(std::function<void()>&& function)
 	{
-		deletors.push_back(function);
+		deletors.push_back({.type = DeletionType::Function, .function = std::move(function)});
+	}
+
+	// destroys the buffer and removes its allocation from the MemoryTelemetry
+	void push_buffer(VmaAllocator allocator,
+	                 VkBuffer buffer,
+	                 VmaAllocation allocation,
+	                 AllocationCategory category,
+	                 VkDeviceSize allocationSize)
+	{
+		deletors.push_back({
+		    .type = DeletionType::Buffer,
+		    .allocator = allocator,
+		    .buffer = buffer,
+		    .allocation = allocation,
+		    .category = category,
+		    .allocationSize = allocationSize,
+		});
+	}
+
+	void push_acceleration_structure(VkDevice device,
+	                                 VkAccelerationStructureKHR accelerationStructure)
+	{
+		deletors.push_back({
+		    .type = DeletionType::AccelerationStructure,
+		    .device = device,
+		    .accelerationStructure = accelerationStructure,
+		});
+	}
+
+	// moves the entries of the other queue into this one, they are destroyed before the entries
+	// that are already queued (same as if they were pushed one by one)
+	void append(DeletionQueue&& other)
+	{
+		deletors.insert(deletors.end(),
+		                std::make_move_iterator(other.deletors.begin()),
+		                std::make_move_iterator(other.deletors.end()));
+		other.deletors.clear();
+	}
+
+	[[nodiscard]] bool empty() const
+	{
+		return deletors.empty();
 	}
 
 	void flush()
@@ -21,7 +100,20 @@ struct DeletionQueue
 		// reverse iterate the deletion queue to execute all the functions
 		for (auto it = deletors.rbegin(); it != deletors.rend(); it++)
 		{
-			(*it)(); // call the function
+			switch (it->type)
+			{
+			case DeletionType::Function:
+				it->function();
+				break;
+			case DeletionType::Buffer:
+				vmaDestroyBuffer(it->allocator, it->buffer, it->allocation);
+				getMemoryTelemetry().trackFree(it->category, it->allocationSize);
+				break;
+			case DeletionType::AccelerationStructure:
+				tracer::procedures::pvkDestroyAccelerationStructureKHR(
+				    it->device, it->accelerationStructure, NULL);
+				break;
+			}
 		}
 
 		deletors.clear();
@@ -17,6 +17,9 @@ extern PFN_vkGetAccelerationStructureDeviceAddressKHR pvkGetAccelerationStructur
 extern PFN_vkCmdBuildAccelerationStructuresKHR pvkCmdBuildAccelerationStructuresKHR;
 extern PFN_vkDestroyAccelerationStructureKHR pvkDestroyAccelerationStructureKHR;
 extern PFN_vkGetRayTracingShaderGroupHandlesKHR pvkGetRayTracingShaderGroupHandlesKHR;
+extern PFN_vkCmdWriteAccelerationStructuresPropertiesKHR
+    pvkCmdWriteAccelerationStructuresPropertiesKHR;
+extern PFN_vkCmdCopyAccelerationStructureKHR pvkCmdCopyAccelerationStructureKHR;
 
 void grabDeviceProcAddr(VkDevice logicalDevice);
 
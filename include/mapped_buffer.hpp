@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+#include <vulkan/vulkan_core.h>
+
+#include "vk_mem_alloc.h"
+
+namespace tracer
+{
+
+// Typed view over the memory of a persistently mapped allocation (created with
+// VMA_ALLOCATION_CREATE_MAPPED_BIT, see createMappedBuffer()). Writes only mark the written
+// elements as dirty, flush() then flushes the dirty range once instead of mapping, copying and
+// unmapping the whole allocation for every write.
+template <typename T>
+class MappedBufferView
+{
+  public:
+	MappedBufferView() = default;
+
+	MappedBufferView(VmaAllocator vmaAllocator,
+	                 VmaAllocation allocation,
+	                 void* mappedData,
+	                 const size_t count)
+	    : vmaAllocator(vmaAllocator), allocation(allocation),
+	      mappedData(static_cast<T*>(mappedData)), count(count)
+	{
+		assert(mappedData != nullptr && "MappedBufferView - allocation is not mapped");
+	}
+
+	[[nodiscard]] bool isMapped() const
+	{
+		return mappedData != nullptr;
+	}
+
+	[[nodiscard]] size_t size() const
+	{
+		return count;
+	}
+
+	[[nodiscard]] const T& operator[](const size_t index) const
+	{
+		assert(index < count);
+		return mappedData[index];
+	}
+
+	// copies elementCount elements to index and marks them as dirty
+	void write(const size_t index, const T* elements, const size_t elementCount)
+	{
+		if (elementCount == 0)
+		{
+			return;
+		}
+
+		assert(index + elementCount <= count && "MappedBufferView::write - out of range");
+		memcpy(mappedData + index, elements, sizeof(T) * elementCount);
+		dirtyBegin = std::min(dirtyBegin, index);
+		dirtyEnd = std::max(dirtyEnd, index + elementCount);
+	}
+
+	void write(const size_t index, const T& element)
+	{
+		write(index, &element, 1);
+	}
+
+	[[nodiscard]] bool isDirty() const
+	{
+		return dirtyBegin < dirtyEnd;
+	}
+
+	// flushes the dirty range (rounded to nonCoherentAtomSize by VMA), no-op for host coherent
+	// memory
+	void flush()
+	{
+		if (!isDirty())
+		{
+			return;
+		}
+
+		[[maybe_unused]] VkResult result
+		    = vmaFlushAllocation(vmaAllocator,
+		                         allocation,
+		                         static_cast<VkDeviceSize>(sizeof(T) * dirtyBegin),
+		                         static_cast<VkDeviceSize>(sizeof(T) * (dirtyEnd - dirtyBegin)));
+		assert(result == VK_SUCCESS);
+
+		dirtyBegin = std::numeric_limits<size_t>::max();
+		dirtyEnd = 0;
+	}
+
+  private:
+	VmaAllocator vmaAllocator = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+	T* mappedData = nullptr;
+	size_t count = 0;
+
+	// dirty elements [dirtyBegin, dirtyEnd)
+	size_t dirtyBegin = std::numeric_limits<size_t>::max();
+	size_t dirtyEnd = 0;
+};
+
+} // namespace tracer
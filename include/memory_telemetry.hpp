@@ -0,0 +1,231 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <string>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan_core.h>
+
+namespace tracer
+{
+
+// what a buffer/image allocation is used for, every createBuffer() call site is tagged with one
+enum class AllocationCategory : uint8_t
+{
+	// AABBs read by the BLAS builds
+	AABBInput = 0,
+	BLAS,
+	// the TLAS and its instance buffers
+	TLAS,
+	// scratch memory of the BLAS/TLAS builds and refits
+	Scratch,
+	// the scene buffers read by the ray tracing shaders
+	StorageBuffer,
+	ShaderBindingTable,
+	Uniform,
+	Staging,
+	Image,
+	// host visible copies of images (e.g. screenshots)
+	Readback,
+};
+
+constexpr size_t ALLOCATION_CATEGORY_COUNT = 10;
+
+[[nodiscard]] inline const char* getAllocationCategoryName(const AllocationCategory category)
+{
+	switch (category)
+	{
+	case AllocationCategory::AABBInput:
+		return "AABB Input";
+	case AllocationCategory::BLAS:
+		return "BLAS";
+	case AllocationCategory::TLAS:
+		return "TLAS";
+	case AllocationCategory::Scratch:
+		return "Scratch";
+	case AllocationCategory::StorageBuffer:
+		return "SSBO";
+	case AllocationCategory::ShaderBindingTable:
+		return "SBT";
+	case AllocationCategory::Uniform:
+		return "Uniform";
+	case AllocationCategory::Staging:
+		return "Staging";
+	case AllocationCategory::Image:
+		return "Image";
+	case AllocationCategory::Readback:
+		return "Readback";
+	}
+	return "Unknown";
+}
+
+struct AllocationCategoryStatistics
+{
+	// size of the live allocations (as reported by VMA, including the alignment padding)
+	VkDeviceSize sizeInBytes = 0;
+	uint32_t allocationCount = 0;
+
+	bool operator==(const AllocationCategoryStatistics&) const = default;
+};
+
+// Tracks the live allocations per AllocationCategory and the heap budgets reported by VMA. The
+// budgets are only exact when VK_EXT_memory_budget is enabled, otherwise VMA estimates them
+// from the heap sizes.
+class MemoryTelemetry
+{
+  public:
+	void trackAllocation(const AllocationCategory category, const VkDeviceSize size)
+	{
+		auto& statistics = categories[static_cast<size_t>(category)];
+		statistics.sizeInBytes += size;
+		statistics.allocationCount++;
+	}
+
+	void trackFree(const AllocationCategory category, const VkDeviceSize size)
+	{
+		auto& statistics = categories[static_cast<size_t>(category)];
+		assert(statistics.sizeInBytes >= size && statistics.allocationCount > 0);
+		statistics.sizeInBytes -= size;
+		statistics.allocationCount--;
+	}
+
+	// has to be called once per frame, VMA only fetches new budgets from the driver when the
+	// frame index changes
+	void updateHeapBudgets(VmaAllocator vmaAllocator, const uint32_t frameIndex)
+	{
+		vmaSetCurrentFrameIndex(vmaAllocator, frameIndex);
+
+		const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+		vmaGetMemoryProperties(vmaAllocator, &memoryProperties);
+		heapCount = memoryProperties->memoryHeapCount;
+		for (uint32_t i = 0; i < heapCount; i++)
+		{
+			heapFlags[i] = memoryProperties->memoryHeaps[i].flags;
+		}
+		vmaGetHeapBudgets(vmaAllocator, heapBudgets.data());
+	}
+
+	[[nodiscard]] const AllocationCategoryStatistics&
+	operator[](const AllocationCategory category) const
+	{
+		return categories[static_cast<size_t>(category)];
+	}
+
+	[[nodiscard]] uint32_t getHeapCount() const
+	{
+		return heapCount;
+	}
+
+	[[nodiscard]] const VmaBudget& getHeapBudget(const uint32_t heapIndex) const
+	{
+		assert(heapIndex < heapCount);
+		return heapBudgets[heapIndex];
+	}
+
+	[[nodiscard]] bool isDeviceLocalHeap(const uint32_t heapIndex) const
+	{
+		assert(heapIndex < heapCount);
+		return (heapFlags[heapIndex] & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+
+	void setMemoryBudgetExtensionEnabled(const bool enabled)
+	{
+		memoryBudgetExtensionEnabled = enabled;
+	}
+
+	[[nodiscard]] bool isMemoryBudgetExtensionEnabled() const
+	{
+		return memoryBudgetExtensionEnabled;
+	}
+
+	// remembers the current category totals, see matchesBaseline()
+	void captureBaseline()
+	{
+		baseline = categories;
+	}
+
+	/**
+	 * @brief Compares the current category totals with the captured baseline, prints every
+	 * category that differs.
+	 *
+	 * @return true if all categories match the baseline
+	 */
+	[[nodiscard]] bool matchesBaseline() const
+	{
+		bool matches = true;
+		for (size_t i = 0; i < ALLOCATION_CATEGORY_COUNT; i++)
+		{
+			if (categories[i] != baseline[i])
+			{
+				std::printf("MemoryTelemetry - %s: %llu bytes in %u allocations, baseline: %llu "
+				            "bytes in %u allocations\n",
+				            getAllocationCategoryName(static_cast<AllocationCategory>(i)),
+				            static_cast<unsigned long long>(categories[i].sizeInBytes),
+				            categories[i].allocationCount,
+				            static_cast<unsigned long long>(baseline[i].sizeInBytes),
+				            baseline[i].allocationCount);
+				matches = false;
+			}
+		}
+		return matches;
+	}
+
+	[[nodiscard]] std::string toJSON() const
+	{
+		std::string json = "{\n";
+		json += std::format("  \"memoryBudgetExtension\": {},\n", memoryBudgetExtensionEnabled);
+
+		json += "  \"categories\": {\n";
+		for (size_t i = 0; i < ALLOCATION_CATEGORY_COUNT; i++)
+		{
+			json += std::format("    \"{}\": {{\"bytes\": {}, \"allocations\": {}}}{}\n",
+			                    getAllocationCategoryName(static_cast<AllocationCategory>(i)),
+			                    categories[i].sizeInBytes,
+			                    categories[i].allocationCount,
+			                    i + 1 < ALLOCATION_CATEGORY_COUNT ? "," : "");
+		}
+		json += "  },\n";
+
+		json += "  \"heaps\": [\n";
+		for (uint32_t i = 0; i < heapCount; i++)
+		{
+			const auto& budget = heapBudgets[i];
+			json += std::format("    {{\"index\": {}, \"deviceLocal\": {}, \"usage\": {}, "
+			                    "\"budget\": {}, \"allocationBytes\": {}, \"blockBytes\": {}}}{}\n",
+			                    i,
+			                    isDeviceLocalHeap(i),
+			                    budget.usage,
+			                    budget.budget,
+			                    budget.statistics.allocationBytes,
+			                    budget.statistics.blockBytes,
+			                    i + 1 < heapCount ? "," : "");
+		}
+		json += "  ]\n";
+		json += "}\n";
+		return json;
+	}
+
+  private:
+	std::array<AllocationCategoryStatistics, ALLOCATION_CATEGORY_COUNT> categories{};
+	std::array<AllocationCategoryStatistics, ALLOCATION_CATEGORY_COUNT> baseline{};
+
+	uint32_t heapCount = 0;
+	std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> heapBudgets{};
+	std::array<VkMemoryHeapFlags, VK_MAX_MEMORY_HEAPS> heapFlags{};
+	bool memoryBudgetExtensionEnabled = false;
+};
+
+// the allocations are created by free functions (see createBuffer()) all over the code base,
+// therefore there is one telemetry instance for the whole application
+inline MemoryTelemetry& getMemoryTelemetry()
+{
+	static MemoryTelemetry memoryTelemetry;
+	return memoryTelemetry;
+}
+
+} // namespace tracer
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_RADIANS
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/geometric.hpp>
+
+#include "bezier_math.hpp"
+
+namespace tracer
+{
+namespace rt
+{
+
+// rays per packet of the packet newton solver, one AVX2 register or two SSE2/NEON registers.
+// The kernel is chosen at runtime for the CPU, see getNewtonPacketKernel()
+inline constexpr size_t RAY_PACKET_WIDTH = 8;
+
+// uint8_t instead of bool so a mask has the same layout as the float lanes
+template <size_t N>
+using LaneMask = std::array<uint8_t, N>;
+
+// a vec3 per lane, stored as structure of arrays so the lanes can be loaded into SIMD registers
+template <size_t N>
+struct PacketVec3
+{
+	std::array<float, N> x{};
+	std::array<float, N> y{};
+	std::array<float, N> z{};
+
+	void set(const size_t lane, const glm::vec3 value)
+	{
+		x[lane] = value.x;
+		y[lane] = value.y;
+		z[lane] = value.z;
+	}
+
+	[[nodiscard]] glm::vec3 get(const size_t lane) const
+	{
+		return glm::vec3(x[lane], y[lane], z[lane]);
+	}
+};
+
+// see the newton settings of the RaytracingDataConstants
+struct NewtonSettings
+{
+	float toleranceF;
+	float minDeterminant;
+	int maxIterations;
+	// stop lanes whose error increases (newtonErrorFIgnoreIncrease disabled)
+	bool abortOnIncrease;
+	// whether converged lanes count as hit (newtonErrorFHitBelowTolerance)
+	bool hitBelowTolerance;
+};
+
+template <size_t N>
+struct NewtonPacketResult
+{
+	LaneMask<N> hit{};
+	// the newton steps of the lane until it converged or was aborted
+	std::array<int, N> iterations{};
+	std::array<float, N> u{};
+	std::array<float, N> v{};
+	// the surface point and the partial derivatives at (u, v)
+	PacketVec3<N> point{};
+	PacketVec3<N> partialU{};
+	PacketVec3<N> partialV{};
+};
+
+/**
+ * @brief evaluateBezierPatch() for a runtime degree and all lanes. One pass over the Bernstein
+ * polynomials of degree n - 1 gives the corners of the last de Casteljau step, the point and both
+ * partial derivatives (in the directions (1, 0, -1) and (0, 1, -1)) follow from them.
+ */
+template <size_t N>
+inline void evaluateBezierPatchPacket(const std::span<const glm::vec3> controlPoints,
+                                      const int n,
+                                      const std::array<float, N>& u,
+                                      const std::array<float, N>& v,
+                                      PacketVec3<N>& point,
+                                      PacketVec3<N>& partialU,
+                                      PacketVec3<N>& partialV)
+{
+	std::array<float, N> w;
+	for (size_t lane = 0; lane < N; lane++)
+	{
+		w[lane] = 1.0f - u[lane] - v[lane];
+	}
+
+	// the powers 0 to n - 1 of u, v and w of all lanes, same values as customPow()
+	std::array<std::array<float, N>, MAX_BEZIER_PATCH_DEGREE> powU;
+	std::array<std::array<float, N>, MAX_BEZIER_PATCH_DEGREE> powV;
+	std::array<std::array<float, N>, MAX_BEZIER_PATCH_DEGREE> powW;
+	powU[0].fill(1.0f);
+	powV[0].fill(1.0f);
+	powW[0].fill(1.0f);
+	for (size_t e = 1; e < static_cast<size_t>(n); e++)
+	{
+		for (size_t lane = 0; lane < N; lane++)
+		{
+			powU[e][lane] = powU[e - 1][lane] * u[lane];
+			powV[e][lane] = powV[e - 1][lane] * v[lane];
+			powW[e][lane] = powW[e - 1][lane] * w[lane];
+		}
+	}
+
+	PacketVec3<N> cornerU;
+	PacketVec3<N> cornerV;
+	PacketVec3<N> cornerW;
+	for (int j = 0; j <= n - 1; j++)
+	{
+		for (int i = 0; i <= n - 1 - j; i++)
+		{
+			const glm::vec3 bU = controlPoints[getBezierPatchControlPointIndex(n, i + 1, j)];
+			const glm::vec3 bV = controlPoints[getBezierPatchControlPointIndex(n, i, j + 1)];
+			const glm::vec3 bW = controlPoints[getBezierPatchControlPointIndex(n, i, j)];
+			const float coefficient = getBernsteinCoefficient(n - 1, i, j);
+			const auto& laneU = powU[static_cast<size_t>(i)];
+			const auto& laneV = powV[static_cast<size_t>(j)];
+			const auto& laneW = powW[static_cast<size_t>(n - 1 - i - j)];
+			for (size_t lane = 0; lane < N; lane++)
+			{
+				const float basis = coefficient * laneU[lane] * laneV[lane] * laneW[lane];
+				cornerU.x[lane] += bU.x * basis;
+				cornerU.y[lane] += bU.y * basis;
+				cornerU.z[lane] += bU.z * basis;
+				cornerV.x[lane] += bV.x * basis;
+				cornerV.y[lane] += bV.y * basis;
+				cornerV.z[lane] += bV.z * basis;
+				cornerW.x[lane] += bW.x * basis;
+				cornerW.y[lane] += bW.y * basis;
+				cornerW.z[lane] += bW.z * basis;
+			}
+		}
+	}
+
+	const auto degree = static_cast<float>(n);
+	for (size_t lane = 0; lane < N; lane++)
+	{
+		point.x[lane] = u[lane] * cornerU.x[lane] + v[lane] * cornerV.x[lane]
+		                + w[lane] * cornerW.x[lane];
+		point.y[lane] = u[lane] * cornerU.y[lane] + v[lane] * cornerV.y[lane]
+		                + w[lane] * cornerW.y[lane];
+		point.z[lane] = u[lane] * cornerU.z[lane] + v[lane] * cornerV.z[lane]
+		                + w[lane] * cornerW.z[lane];
+		partialU.x[lane] = degree * (cornerU.x[lane] - cornerW.x[lane]);
+		partialU.y[lane] = degree * (cornerU.y[lane] - cornerW.y[lane]);
+		partialU.z[lane] = degree * (cornerU.z[lane] - cornerW.z[lane]);
+		partialV.x[lane] = degree * (cornerV.x[lane] - cornerW.x[lane]);
+		partialV.y[lane] = degree * (cornerV.y[lane] - cornerW.y[lane]);
+		partialV.z[lane] = degree * (cornerV.z[lane] - cornerW.z[lane]);
+	}
+}
+
+/**
+ * @brief Newton iterations of the 2x2 system of newtonsMethodBezierPatch() in shader_aabb.rint
+ * for a packet of rays against one patch. Every lane has its own ray (the planes n1, n2 through the
+ * ray origin) and stops on its own when it converges or is aborted, the packet is done once all
+ * lanes stopped. Coherent rays (e.g. the primary rays of a tile) converge after about the same
+ * amount of steps, so few lanes idle.
+ *
+ * This is the portable scalar version, it is used for single rays (N = 1) and for full packets
+ * if the CPU has none of the SIMD kernels of newton_packet.cpp.
+ *
+ * @param active the lanes to solve, the other lanes are never hit
+ * @return hit is only set for the lanes whose solution lies inside the patch, the caller still
+ * has to check that the point lies in front of the ray
+ */
+template <size_t N>
+inline NewtonPacketResult<N> newtonsMethodBezierPatchPacket(
+    const std::span<const glm::vec3> controlPoints,
+    const int n,
+    const PacketVec3<N>& rayOrigin,
+    const PacketVec3<N>& n1,
+    const PacketVec3<N>& n2,
+    const glm::vec2 initialGuess,
+    LaneMask<N> active,
+    const NewtonSettings& settings)
+{
+	NewtonPacketResult<N> result;
+	result.u.fill(initialGuess.x);
+	result.v.fill(initialGuess.y);
+	result.iterations.fill(settings.maxIterations);
+
+	// project onto planes
+	std::array<float, N> d1;
+	std::array<float, N> d2;
+	for (size_t lane = 0; lane < N; lane++)
+	{
+		d1[lane] = -n1.x[lane] * rayOrigin.x[lane] - n1.y[lane] * rayOrigin.y[lane]
+		           - n1.z[lane] * rayOrigin.z[lane];
+		d2[lane] = -n2.x[lane] * rayOrigin.x[lane] - n2.y[lane] * rayOrigin.y[lane]
+		           - n2.z[lane] * rayOrigin.z[lane];
+	}
+
+	std::array<float, N> previousErrorF;
+	std::array<float, N> errorF;
+	errorF.fill(100000.0f);
+
+	PacketVec3<N> point;
+	PacketVec3<N> partialU;
+	PacketVec3<N> partialV;
+	for (int c = 0; c < settings.maxIterations; c++)
+	{
+		bool anyActive = false;
+		for (size_t lane = 0; lane < N; lane++)
+		{
+			anyActive = anyActive || active[lane] != 0;
+		}
+		if (!anyActive)
+		{
+			break;
+		}
+
+		evaluateBezierPatchPacket<N>(
+		    controlPoints, n, result.u, result.v, point, partialU, partialV);
+
+		for (size_t lane = 0; lane < N; lane++)
+		{
+			if (active[lane] == 0)
+			{
+				continue;
+			}
+
+			const glm::vec3 pu = partialU.get(lane);
+			const glm::vec3 pv = partialV.get(lane);
+			const glm::vec3 p = point.get(lane);
+			const glm::vec3 laneN1 = n1.get(lane);
+			const glm::vec3 laneN2 = n2.get(lane);
+
+			// the columns of the jacobian
+			const float j00 = glm::dot(laneN1, pu);
+			const float j01 = glm::dot(laneN2, pu);
+			const float j10 = glm::dot(laneN1, pv);
+			const float j11 = glm::dot(laneN2, pv);
+
+			const float determinant = j00 * j11 - j10 * j01;
+			const float fx = glm::dot(laneN1, p) + d1[lane];
+			const float fy = glm::dot(laneN2, p) + d2[lane];
+			previousErrorF[lane] = errorF[lane];
+			errorF[lane] = std::abs(fx) + std::abs(fy);
+
+			const bool singular = std::abs(determinant) < settings.minDeterminant;
+			const bool increased
+			    = settings.abortOnIncrease && errorF[lane] > previousErrorF[lane];
+			const bool converged = errorF[lane] <= settings.toleranceF;
+			if (singular || increased || converged)
+			{
+				active[lane] = 0;
+				result.iterations[lane] = c + 1;
+				result.hit[lane] = !singular && !increased && settings.hitBelowTolerance;
+				result.point.set(lane, p);
+				result.partialU.set(lane, pu);
+				result.partialV.set(lane, pv);
+				continue;
+			}
+
+			// inverse of the jacobian times f
+			const float inverseDeterminant = 1.0f / determinant;
+			result.u[lane] -= inverseDeterminant * j11 * fx + inverseDeterminant * -j10 * fy;
+			result.v[lane] -= inverseDeterminant * -j01 * fx + inverseDeterminant * j00 * fy;
+		}
+	}
+
+	for (size_t lane = 0; lane < N; lane++)
+	{
+		const float u = result.u[lane];
+		const float v = result.v[lane];
+		if (u < 0 || v < 0 || (u + v) > 1)
+		{
+			result.hit[lane] = 0;
+		}
+	}
+	return result;
+}
+
+// newtonsMethodBezierPatchPacket() for a full packet
+using NewtonPacketKernel
+    = NewtonPacketResult<RAY_PACKET_WIDTH> (*)(const std::span<const glm::vec3> controlPoints,
+                                               const int n,
+                                               const PacketVec3<RAY_PACKET_WIDTH>& rayOrigin,
+                                               const PacketVec3<RAY_PACKET_WIDTH>& n1,
+                                               const PacketVec3<RAY_PACKET_WIDTH>& n2,
+                                               const glm::vec2 initialGuess,
+                                               LaneMask<RAY_PACKET_WIDTH> active,
+                                               const NewtonSettings& settings);
+
+struct NewtonPacketKernelInfo
+{
+	NewtonPacketKernel solve;
+	// the instruction set of the kernel, e.g. "AVX2"
+	const char* name;
+};
+
+// the widest kernel the CPU supports, selected once on the first call
+[[nodiscard]] const NewtonPacketKernelInfo& getNewtonPacketKernel();
+
+// full packets are solved by the SIMD kernel of the CPU, smaller ones by the scalar version
+template <size_t N>
+inline NewtonPacketResult<N> solveNewtonPacket(const std::span<const glm::vec3> controlPoints,
+                                               const int n,
+                                               const PacketVec3<N>& rayOrigin,
+                                               const PacketVec3<N>& n1,
+                                               const PacketVec3<N>& n2,
+                                               const glm::vec2 initialGuess,
+                                               const LaneMask<N> active,
+                                               const NewtonSettings& settings)
+{
+	if constexpr (N == RAY_PACKET_WIDTH)
+	{
+		return getNewtonPacketKernel().solve(
+		    controlPoints, n, rayOrigin, n1, n2, initialGuess, active, settings);
+	}
+	else
+	{
+		return newtonsMethodBezierPatchPacket<N>(
+		    controlPoints, n, rayOrigin, n1, n2, initialGuess, active, settings);
+	}
+}
+
+} // namespace rt
+} // namespace tracer
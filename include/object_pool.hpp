@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_RADIANS
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/ext/vector_float3.hpp"
+
+#include "aabb.hpp"
+#include "common_types.h"
+#include "transform.hpp"
+
+namespace tracer
+{
+namespace rt
+{
+
+// refers to an object inside an ObjectPool, the handle becomes invalid once the pool is cleared
+// (e.g. when another scene is loaded)
+template <typename T>
+struct ObjectHandle
+{
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	uint32_t index = INVALID_INDEX;
+	uint32_t generation = 0;
+
+	bool operator==(const ObjectHandle&) const = default;
+};
+
+// consecutive objects inside an ObjectPool, e.g. the spheres of a SceneObject
+struct ObjectRange
+{
+	size_t offset = 0;
+	size_t count = 0;
+
+	[[nodiscard]] size_t size() const
+	{
+		return count;
+	}
+
+	[[nodiscard]] bool empty() const
+	{
+		return count == 0;
+	}
+
+	[[nodiscard]] size_t end() const
+	{
+		return offset + count;
+	}
+};
+
+// Stores all objects of one type (e.g. all BezierTriangle2 of the scene) contiguously, every
+// property lives in its own array. The objects have the layout of the storage buffer and are
+// uploaded with a single copy, the AABBs are packed for the BLAS builds. Objects are only
+// appended and removed all at once with clear(), the index of an object is therefore also its
+// index inside the storage buffer.
+template <typename T>
+class ObjectPool
+{
+  public:
+	ObjectPool() = default;
+	~ObjectPool() = default;
+
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	ObjectPool(ObjectPool&&) noexcept = default;
+	ObjectPool& operator=(ObjectPool&&) noexcept = default;
+
+	// @param worldSpaceAabb whether the AABB moves with the position of the object (spheres that
+	// are not placed with the transform of their SceneObject)
+	ObjectHandle<T> add(const T& object,
+	                    const ObjectType type,
+	                    const AABB& aabb,
+	                    const glm::vec3 position,
+	                    const bool worldSpaceAabb = false)
+	{
+		assert(objects.size() < ObjectHandle<T>::INVALID_INDEX);
+		const auto index = static_cast<uint32_t>(objects.size());
+		objects.push_back(object);
+		aabbPositions.push_back(aabb.getAabbPositions());
+		types.push_back(type);
+		positions.push_back(position);
+		dirtyFlags.push_back(0);
+		worldSpaceAabbFlags.push_back(worldSpaceAabb ? 1 : 0);
+		return {.index = index, .generation = generation};
+	}
+
+	// appends the objects with a single copy per array, all of them get the same type and
+	// position
+	// @return the index of the first appended object
+	size_t append(const std::span<const T> newObjects,
+	              const std::span<const VkAabbPositionsKHR> newAabbPositions,
+	              const ObjectType type,
+	              const glm::vec3 position)
+	{
+		assert(newObjects.size() == newAabbPositions.size());
+		assert(objects.size() + newObjects.size() <= ObjectHandle<T>::INVALID_INDEX);
+		const size_t firstIndex = objects.size();
+		const size_t newSize = firstIndex + newObjects.size();
+		objects.insert(objects.end(), newObjects.begin(), newObjects.end());
+		aabbPositions.insert(aabbPositions.end(), newAabbPositions.begin(), newAabbPositions.end());
+		types.resize(newSize, type);
+		positions.resize(newSize, position);
+		dirtyFlags.resize(newSize, 0);
+		worldSpaceAabbFlags.resize(newSize, 0);
+		return firstIndex;
+	}
+
+	void reserve(const size_t count)
+	{
+		objects.reserve(count);
+		aabbPositions.reserve(count);
+		types.reserve(count);
+		positions.reserve(count);
+		dirtyFlags.reserve(count);
+		worldSpaceAabbFlags.reserve(count);
+	}
+
+	// removes all objects, the handles returned so far become invalid
+	void clear()
+	{
+		objects.clear();
+		aabbPositions.clear();
+		types.clear();
+		positions.clear();
+		dirtyFlags.clear();
+		worldSpaceAabbFlags.clear();
+		generation++;
+	}
+
+	[[nodiscard]] size_t size() const
+	{
+		return objects.size();
+	}
+
+	[[nodiscard]] bool isValid(const ObjectHandle<T> handle) const
+	{
+		return handle.generation == generation && handle.index < objects.size();
+	}
+
+	[[nodiscard]] ObjectHandle<T> getHandle(const size_t index) const
+	{
+		assert(index < objects.size());
+		return {.index = static_cast<uint32_t>(index), .generation = generation};
+	}
+
+	[[nodiscard]] const T& get(const ObjectHandle<T> handle) const
+	{
+		assert(isValid(handle) && "ObjectPool::get - stale handle");
+		return objects[handle.index];
+	}
+
+	// marks the object as dirty, it is uploaded with the next incremental update
+	[[nodiscard]] T& modify(const ObjectHandle<T> handle)
+	{
+		assert(isValid(handle) && "ObjectPool::modify - stale handle");
+		dirtyFlags[handle.index] = 1;
+		return objects[handle.index];
+	}
+
+	// only spheres store their position inside the object data, the other objects are moved with
+	// the transform of their SceneObject. The AABB of a sphere added in world space moves along,
+	// the BLAS only picks it up if its SceneObject is dynamic or on the next full rebuild
+	void setPosition(const ObjectHandle<T> handle, const glm::vec3 position)
+	{
+		assert(isValid(handle) && "ObjectPool::setPosition - stale handle");
+		positions[handle.index] = position;
+		if constexpr (std::is_same_v<T, Sphere>)
+		{
+			objects[handle.index].center = position;
+			dirtyFlags[handle.index] = 1;
+			updateWorldSpaceSphereAabb(handle.index);
+		}
+	}
+
+	void translate(const ObjectHandle<T> handle, const glm::vec3 translation)
+	{
+		assert(isValid(handle) && "ObjectPool::translate - stale handle");
+		positions[handle.index] += translation;
+		if constexpr (std::is_same_v<T, Sphere>)
+		{
+			objects[handle.index].center += translation;
+			dirtyFlags[handle.index] = 1;
+			updateWorldSpaceSphereAabb(handle.index);
+		}
+	}
+
+	// replaces the AABB of the object after its geometry changed (e.g. edited control points),
+	// it is written into the BLAS with the next refit of a dynamic SceneObject
+	void setAabb(const ObjectHandle<T> handle, const AABB& aabb)
+	{
+		assert(isValid(handle) && "ObjectPool::setAabb - stale handle");
+		aabbPositions[handle.index] = aabb.getAabbPositions();
+	}
+
+	[[nodiscard]] glm::vec3 getPosition(const ObjectHandle<T> handle) const
+	{
+		assert(isValid(handle) && "ObjectPool::getPosition - stale handle");
+		return positions[handle.index];
+	}
+
+	[[nodiscard]] VkTransformMatrixKHR getTransformMatrix(const ObjectHandle<T> handle) const
+	{
+		return Transform(getPosition(handle)).getTransformMatrix();
+	}
+
+	// the objects in the layout of the storage buffer
+	[[nodiscard]] const std::vector<T>& getObjects() const
+	{
+		return objects;
+	}
+
+	[[nodiscard]] const std::vector<VkAabbPositionsKHR>& getAabbPositions() const
+	{
+		return aabbPositions;
+	}
+
+	[[nodiscard]] ObjectType getType(const size_t index) const
+	{
+		return types[index];
+	}
+
+	[[nodiscard]] bool isDirty(const size_t index) const
+	{
+		return dirtyFlags[index] != 0;
+	}
+
+	void clearDirty(const ObjectRange range)
+	{
+		assert(range.end() <= dirtyFlags.size());
+		std::fill(dirtyFlags.begin() + static_cast<std::ptrdiff_t>(range.offset),
+		          dirtyFlags.begin() + static_cast<std::ptrdiff_t>(range.end()),
+		          uint8_t{0});
+	}
+
+	void clearAllDirty()
+	{
+		std::fill(dirtyFlags.begin(), dirtyFlags.end(), uint8_t{0});
+	}
+
+  private:
+	void updateWorldSpaceSphereAabb(const size_t index)
+	{
+		if (worldSpaceAabbFlags[index] != 0)
+		{
+			aabbPositions[index] = AABB::fromSphere(objects[index], false).getAabbPositions();
+		}
+	}
+
+	std::vector<T> objects;
+	std::vector<VkAabbPositionsKHR> aabbPositions;
+	std::vector<ObjectType> types;
+	std::vector<glm::vec3> positions;
+	// uint8_t instead of bool, std::vector<bool> can't be filled/read as plain bytes
+	std::vector<uint8_t> dirtyFlags;
+	std::vector<uint8_t> worldSpaceAabbFlags;
+
+	// incremented by clear(), handles of a previous generation are rejected
+	uint32_t generation = 1;
+};
+
+} // namespace rt
+} // namespace tracer
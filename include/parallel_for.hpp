@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tracer
+{
+
+/**
+ * @brief Splits [0, count) into contiguous chunks and calls function(begin, end) for every chunk
+ * on its own thread, returns once all chunks are done. Small counts run on the calling thread.
+ *
+ * @param minChunkSize the minimum amount of elements per thread, keeps the thread creation from
+ * dominating cheap loops
+ */
+template <typename F>
+void parallelFor(const size_t count, const size_t minChunkSize, F&& function)
+{
+	const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	const size_t threadCount
+	    = std::clamp<size_t>(count / std::max<size_t>(minChunkSize, 1), 1, hardwareThreads);
+
+	if (threadCount == 1)
+	{
+		function(size_t{0}, count);
+		return;
+	}
+
+	const size_t chunkSize = (count + threadCount - 1) / threadCount;
+	std::vector<std::jthread> threads;
+	threads.reserve(threadCount - 1);
+	// the calling thread takes the first chunk
+	for (size_t begin = chunkSize; begin < count; begin += chunkSize)
+	{
+		const size_t end = std::min(begin + chunkSize, count);
+		threads.emplace_back([&function, begin, end]() { function(begin, end); });
+	}
+	function(size_t{0}, std::min(chunkSize, count));
+	// the jthreads join when they go out of scope
+}
+
+/**
+ * @brief Calls function(taskIndex) for every task of [0, taskCount) on all cores. Every thread
+ * starts with a contiguous share of the tasks and steals from the back of the shares of the other
+ * threads once its own share is done, this balances tasks of very different cost (e.g. image
+ * tiles with and without geometry).
+ *
+ * @param function called as function(taskIndex, threadIndex)
+ */
+template <typename F>
+void parallelForTasks(const size_t taskCount, F&& function)
+{
+	const size_t threadCount = std::clamp<size_t>(
+	    std::thread::hardware_concurrency(), 1, std::max<size_t>(taskCount, 1));
+
+	if (threadCount == 1)
+	{
+		for (size_t task = 0; task < taskCount; task++)
+		{
+			function(task, size_t{0});
+		}
+		return;
+	}
+
+	// the remaining tasks [begin, end) of a thread, the owner takes them from the front and the
+	// other threads steal from the back
+	struct TaskRange
+	{
+		std::mutex mutex{};
+		size_t begin = 0;
+		size_t end = 0;
+	};
+	std::vector<TaskRange> taskRanges(threadCount);
+	for (size_t thread = 0; thread < threadCount; thread++)
+	{
+		taskRanges[thread].begin = thread * taskCount / threadCount;
+		taskRanges[thread].end = (thread + 1) * taskCount / threadCount;
+	}
+
+	auto worker = [&function, &taskRanges, threadCount](const size_t threadIndex)
+	{
+		for (size_t offset = 0; offset < threadCount; offset++)
+		{
+			const bool ownRange = offset == 0;
+			TaskRange& taskRange = taskRanges[(threadIndex + offset) % threadCount];
+			while (true)
+			{
+				size_t task = 0;
+				{
+					std::scoped_lock lock(taskRange.mutex);
+					if (taskRange.begin >= taskRange.end)
+					{
+						break;
+					}
+					task = ownRange ? taskRange.begin++ : --taskRange.end;
+				}
+				function(task, threadIndex);
+			}
+		}
+	};
+
+	std::vector<std::jthread> threads;
+	threads.reserve(threadCount - 1);
+	for (size_t thread = 1; thread < threadCount; thread++)
+	{
+		threads.emplace_back(worker, thread);
+	}
+	worker(0);
+}
+
+} // namespace tracer
@@ -39,7 +39,8 @@ namespace rt
 
 /**
  * @brief Updates the buffers used in the ray tracing shaders, e.g. acceleration structure handle,
- * image handle, etc.
+ * image handle, etc. While submitted frames might still use the descriptor set, a new set is
+ * written instead and the old one is retired on the frame timeline.
  *
  * @param logicalDevice
  * @param raytracingInfo
@@ -47,7 +48,7 @@ namespace rt
  * AABBs with intersection shader
  */
 void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
-                                              const rt::RaytracingScene& raytracingScene,
+                                              rt::RaytracingScene& raytracingScene,
                                               RaytracingInfo& raytracingInfo);
 
 /**
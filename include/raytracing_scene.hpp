@@ -2,20 +2,30 @@
 
 #include <cstdint>
 #include <cstdio>
+#include <span>
 #include <stdexcept>
+#include <type_traits>
 #include <vector>
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vulkan/vulkan_core.h>
 
+#include "bezier_math.hpp"
 #include "blas.hpp"
+#include "blas_cache.hpp"
 #include "common_types.h"
 #include "deletion_queue.hpp"
 #include "model.hpp"
-#include "raytracing_worldobject.hpp"
+#include "object_pool.hpp"
+#include "retirement_queue.hpp"
+#include "staging_uploader.hpp"
+#include "storage_buffer_pool.hpp"
 #include "tlas.hpp"
+#include "transform_hierarchy.hpp"
 #include "ui.hpp"
 #include "vk_utils.hpp"
 #include "tetrahedron.hpp"
@@ -32,6 +42,9 @@ struct SceneConfig
 	bool visualizeControlPoints;
 	bool visualizeSampledSurface;
 	bool visualizeSampledVolume;
+	bool compactAccelerationStructures;
+	uint32_t blasClusterSize;
+	bool tightBezierPatchBounds;
 
 	static const SceneConfig fromUIData(const ui::UIData& uiData)
 	{
@@ -42,6 +55,9 @@ struct SceneConfig
 		    = uiData.raytracingDataConstants.debugVisualizeSampledSurface > 0.0f,
 		    .visualizeSampledVolume
 		    = uiData.raytracingDataConstants.debugVisualizeSampledVolume > 0.0f,
+		    .compactAccelerationStructures = uiData.compactAccelerationStructures,
+		    .blasClusterSize = static_cast<uint32_t>(std::max(uiData.blasClusterSize, 0)),
+		    .tightBezierPatchBounds = uiData.tightBezierPatchBounds,
 		};
 	}
 };
@@ -49,6 +65,13 @@ struct SceneConfig
 namespace rt
 {
 
+// forward declaration
+class SceneBuilder;
+
+// only the first 24 bits of the instance custom index are available in vulkan, the custom index is
+// the offset of the SceneObject inside the gpuObjects
+inline constexpr size_t MAX_INSTANCE_CUSTOM_INDEX = (1u << 24) - 1;
+
 // TODO: give this a more fitting name, since its not really a singular scene but actually
 // controlling the current scene and its objects
 // Holds and manages the objects in the scene
@@ -56,18 +79,9 @@ namespace rt
 class RaytracingScene
 {
   public:
-	static const int SCENE_COUNT = 8;
+	static const int SCENE_COUNT = 9;
 	static const int INITIAL_SCENE = 1;
 
-	VkBuffer gpuObjectsBufferHandle = VK_NULL_HANDLE;
-	VkBuffer slicingPlanesBufferHandle = VK_NULL_HANDLE;
-
-	VkBuffer spheresBufferHandle = VkBuffer(0);
-	// VkBuffer tetrahedronsBufferHandle = VkBuffer(0);
-	VkBuffer bezierTriangles2BufferHandle = VkBuffer(0);
-	VkBuffer bezierTriangles3BufferHandle = VkBuffer(0);
-	VkBuffer bezierTriangles4BufferHandle = VkBuffer(0);
-	VkBuffer rectangularBezierSurfaces2x2BufferHandle = VkBuffer(0);
 	inline static const std::vector<std::string> sceneNames = {
 	    "Tetrahedron degree 2 deformed slightly",
 	    "Tetrahedron degree 2 deformed strongly",
@@ -77,12 +91,15 @@ class RaytracingScene
 	    "A bunch of random tetrahedrons degree 2",
 	    "Tetrahedron degree 4",
 	    "Tetrahedron degree 4 - inside volume pulled out",
+	    "Tetrahedron degree 2 instanced",
 	};
 
 	RaytracingScene(const VkPhysicalDevice& physicalDevice,
 	                const VkDevice logicalDevice,
 	                const VmaAllocator vmaAllocator)
-	    : physicalDevice(physicalDevice), logicalDevice(logicalDevice), vmaAllocator(vmaAllocator)
+	    : physicalDevice(physicalDevice), logicalDevice(logicalDevice), vmaAllocator(vmaAllocator),
+	      storageBufferPool(physicalDevice, logicalDevice, vmaAllocator),
+	      stagingUploader(physicalDevice, logicalDevice, vmaAllocator)
 	{
 		// TODO: allow multiple slicing planes
 		// we always wanna create one slicing plane
@@ -100,11 +117,23 @@ class RaytracingScene
 	RaytracingScene(RaytracingScene&&) noexcept = delete;
 	RaytracingScene& operator=(RaytracingScene&&) noexcept = delete;
 
+	// loads the scene, its light sphere becomes the light of the renderer
 	static void loadScene(Renderer& renderer,
 	                      RaytracingScene& raytracingScene,
 	                      const SceneConfig sceneConfig,
 	                      const int index);
 
+	/**
+	 * @brief Loads the scene without a Renderer, only the objects and SceneObjects are created.
+	 * The scene can be rendered by the ReferenceRenderer without a vulkan device.
+	 *
+	 * @return the SceneObject of the light sphere, nullptr if the scene does not exist
+	 */
+	static std::shared_ptr<SceneObject> loadScene(RaytracingScene& raytracingScene,
+	                                              const SceneConfig sceneConfig,
+	                                              const int index,
+	                                              const glm::vec3 lightPosition);
+
 	inline static int getSceneCount()
 	{
 		return SCENE_COUNT;
@@ -120,10 +149,88 @@ class RaytracingScene
 		return sceneNames[static_cast<size_t>(sceneNr - 1)];
 	}
 
-	void cleanup(VkQueue graphicsQueneHandle)
+	void cleanup(const RaytracingInfo& raytracingInfo)
 	{
-		vkQueueWaitIdle(graphicsQueneHandle);
+		stagingUploader.cleanup();
+		waitForFrameTimeline(logicalDevice,
+		                     raytracingInfo.frameTimeline,
+		                     raytracingInfo.frameTimeline.lastSubmittedValue);
+		retirementQueue.flush();
+		retiredResources.flush();
 		deletionQueueForAccelerationStructure.flush();
+		blasCache.clear();
+		storageBufferPool.clear();
+	}
+
+	// the resources might still be used by the submitted frames, they are destroyed once those
+	// are done
+	void retireResources(DeletionQueue&& resources)
+	{
+		assert(frameTimeline != nullptr);
+		retirementQueue.retire(std::move(resources), frameTimeline->lastSubmittedValue);
+	}
+
+	// destroys the retired resources of the frames that are done, has to be called once per frame
+	void collectRetiredResources(const RaytracingInfo& raytracingInfo)
+	{
+		if (retirementQueue.getBatchCount() > 0)
+		{
+			retirementQueue.collect(
+			    getCompletedFrameTimelineValue(logicalDevice, raytracingInfo.frameTimeline));
+		}
+	}
+
+	// blocks until the submitted frames are done and destroys all retired resources, used by the
+	// memory leak check so the retired buffers of earlier builds are not counted as allocated
+	void flushRetiredResources(const RaytracingInfo& raytracingInfo)
+	{
+		waitForFrameTimeline(logicalDevice,
+		                     raytracingInfo.frameTimeline,
+		                     raytracingInfo.frameTimeline.lastSubmittedValue);
+		retirementQueue.flush();
+	}
+
+	// VK_NULL_HANDLE if the buffer was never needed
+	[[nodiscard]] inline VkBuffer getStorageBufferHandle(const SceneStorageBuffer type) const
+	{
+		return storageBufferPool.getBufferHandle(type);
+	}
+
+	// @return whether the buffer was reallocated since the last call, its descriptor has to be
+	// updated then
+	[[nodiscard]] inline bool takeStorageBufferReallocated(const SceneStorageBuffer type)
+	{
+		return storageBufferPool.takeReallocated(type);
+	}
+
+	[[nodiscard]] inline const StorageBufferPool& getStorageBufferPool() const
+	{
+		return storageBufferPool;
+	}
+
+	// the device local storage buffers are uploaded on the transfer queue, has to be called once
+	// the queues and the frame timeline of the raytracingInfo are known
+	void initStagingUploader(const RaytracingInfo& raytracingInfo)
+	{
+		frameTimeline = &raytracingInfo.frameTimeline;
+		const uint32_t graphicsFamilyIndex
+		    = raytracingInfo.queueFamilyIndices.graphicsFamily.value();
+		stagingUploader.init(
+		    raytracingInfo.transferQueueHandle,
+		    raytracingInfo.queueFamilyIndices.transferFamily.value_or(graphicsFamilyIndex),
+		    graphicsFamilyIndex);
+	}
+
+	// the frame that traces the rays has to wait for this semaphore to reach
+	// getUploadTimelineValue(), VK_NULL_HANDLE if ray tracing is not initialized
+	[[nodiscard]] inline VkSemaphore getUploadTimelineSemaphore() const
+	{
+		return stagingUploader.getTimelineSemaphore();
+	}
+
+	[[nodiscard]] inline uint64_t getUploadTimelineValue() const
+	{
+		return stagingUploader.getLastSubmittedValue();
 	}
 
 	inline const size_t& getBLASInstancesCount() const
@@ -131,18 +238,64 @@ class RaytracingScene
 		return blasInstancesCount;
 	}
 
+	// SceneObjects with more objects than this are split into several BLAS's (0 disables it),
+	// only applies on the next full rebuild
+	inline void setBLASClusterSize(const uint32_t clusterSize)
+	{
+		blasClusterSize = clusterSize;
+	}
+
+	// amount of refits after which a dynamic BLAS gets rebuilt
+	inline void setMaxBLASRefits(const uint32_t maxRefits)
+	{
+		maxBLASRefits = maxRefits;
+	}
+
+	// whether the BLAS's are compacted after building them, only applies on the next full
+	// rebuild
+	inline void setCompactAccelerationStructures(const bool compact)
+	{
+		compactAccelerationStructures = compact;
+	}
+
+	// how the AABBs of the bezier patches are computed, only applies to the patches added
+	// afterwards
+	inline void setBezierBoundsMode(const BezierBoundsMode mode)
+	{
+		bezierBoundsMode = mode;
+	}
+
+	// the AABB volumes of the bezier patches of the current scene
+	[[nodiscard]] inline const BezierBoundsTelemetry& getBezierBoundsTelemetry() const
+	{
+		return bezierBoundsTelemetry;
+	}
+
+	// BLAS counts, sizes and build times per build policy of the last full rebuild
+	[[nodiscard]] inline const BLASBuildTelemetry& getBLASBuildTelemetry() const
+	{
+		return blasBuildTelemetry;
+	}
+
 	// MeshObject& addObjectMesh(const MeshObject& meshObject)
 	// {
 	// 	meshObjects.push_back(meshObject);
 	// 	return meshObjects.back();
 	// }
 
-	std::shared_ptr<RaytracingWorldObject<Sphere>> addObjectSphere(SceneObject& sceneObject,
-	                                                               const glm::vec3 position,
-	                                                               const bool localSpace,
-	                                                               const float radius,
-	                                                               const ColorIdx colorIdx)
+	ObjectHandle<Sphere> addObjectSphere(SceneObject& sceneObject,
+	                                     const glm::vec3 position,
+	                                     const bool localSpace,
+	                                     const float radius,
+	                                     const ColorIdx colorIdx)
 	{
+		// the sphere would be tested against the same world space center by every instance
+		if (!sceneObject.instanceTransforms.empty())
+		{
+			throw std::runtime_error(
+			    "addObjectSphere - spheres can not be added to instanced SceneObjects");
+		}
+
 		Sphere sphere{
 		    .center = position,
 		    .radius = radius,
@@ -152,79 +305,159 @@ class RaytracingScene
 		debug_printFmt("Adding sphere to sceneObject %d (%s)\n",
 		               sceneObject.instanceCustomIndex,
 		               sceneObject.name.c_str());
-		spheres.emplace_back(std::make_shared<RaytracingWorldObject<Sphere>>(
-		    ObjectType::t_Sphere, AABB::fromSphere(sphere, localSpace), sphere, position));
-		auto& obj = spheres.back();
-		sceneObject.spheres.push_back(obj);
-		return obj;
+		return addObject(sceneObject,
+		                 sphere,
+		                 ObjectType::t_Sphere,
+		                 AABB::fromSphere(sphere, localSpace),
+		                 position,
+		                 !localSpace);
 	}
 
-	template <typename S>
-	std::vector<std::shared_ptr<RaytracingWorldObject<S>>>&
-	getTriangleListForSceneObject(SceneObject& sceneObject);
-
-	template <typename S>
-	std::vector<std::shared_ptr<RaytracingWorldObject<S>>>& getTriangleList();
-
-	template <typename S>
-	std::shared_ptr<RaytracingWorldObject<S>> addObjectBezierTriangle(SceneObject& sceneObject,
-	                                                                  const S& bezierTriangle,
-	                                                                  const bool markAsInside)
+	// the pool holding all objects of type T (Sphere, BezierPatch, RectangularBezierSurface2x2)
+	template <typename T>
+	ObjectPool<T>& getObjectPool()
 	{
-		AABB aabb = AABB::fromBezierTriangle(bezierTriangle);
-		constexpr auto objectType = getObjectType<S>();
+		if constexpr (std::is_same_v<T, Sphere>)
+		{
+			return spheres;
+		}
+		else if constexpr (std::is_same_v<T, BezierPatch>)
+		{
+			return bezierPatches;
+		}
+		else
+		{
+			static_assert(std::is_same_v<T, RectangularBezierSurface2x2>);
+			return rectangularBezierSurfaces2x2;
+		}
+	}
 
-		ObjectType type = objectType;
+	// the objects of type T inside the SceneObject, they are stored in getObjectPool<T>()
+	template <typename T, typename SceneObjectType>
+	static auto& getObjectRange(SceneObjectType& sceneObject)
+	{
+		if constexpr (std::is_same_v<T, Sphere>)
+		{
+			return sceneObject.spheres;
+		}
+		else if constexpr (std::is_same_v<T, BezierPatch>)
+		{
+			return sceneObject.bezierPatches;
+		}
+		else
+		{
+			static_assert(std::is_same_v<T, RectangularBezierSurface2x2>);
+			return sceneObject.rectangularBezierSurfaces2x2;
+		}
+	}
 
-		// mark as inside for the slicing plane calculations
-		if (markAsInside)
+	/**
+	 * @brief Adds a bezier triangle of any degree, the control points are appended to the shared
+	 * control point buffer.
+	 *
+	 * @param controlPoints (degree + 1)(degree + 2) / 2 control points in the order of the
+	 * BezierTriangle structs
+	 * @param markAsInside marks the patch as inside for the slicing plane calculations
+	 */
+	ObjectHandle<BezierPatch> addObjectBezierPatch(SceneObject& sceneObject,
+	                                               const uint32_t degree,
+	                                               const std::span<const glm::vec3> controlPoints,
+	                                               const bool markAsInside)
+	{
+		if (degree < 1 || degree > MAX_BEZIER_PATCH_DEGREE)
 		{
-			switch (objectType)
-			{
-			case ObjectType::t_BezierTriangle1:
-				type = ObjectType::t_BezierTriangleInside1;
-				break;
-			case ObjectType::t_BezierTriangle2:
-				type = ObjectType::t_BezierTriangleInside2;
-				break;
-			case ObjectType::t_BezierTriangle3:
-				type = ObjectType::t_BezierTriangleInside3;
-				break;
-			case ObjectType::t_BezierTriangle4:
-				type = ObjectType::t_BezierTriangleInside4;
-				break;
-			default:
-				throw std::runtime_error(
-				    "addObjectBezierTriangle - Object type has no inside variant");
-			}
+			throw std::runtime_error("addObjectBezierPatch - Unsupported degree");
 		}
+		if (controlPoints.size() != getBezierTriangleControlPointCount(degree))
+		{
+			throw std::runtime_error("addObjectBezierPatch - Wrong amount of control points");
+		}
+
+		const AABB aabb = AABB::fromBezierPatch(controlPoints, degree, bezierBoundsMode);
+		bezierBoundsTelemetry.add(controlPoints, aabb);
+		const BezierPatch patch{
+		    .controlPointOffset = static_cast<uint>(bezierControlPoints.size()),
+		    .degree = degree,
+		    .flags = markAsInside ? static_cast<uint>(BezierPatchFlags::t_BezierPatchFlagInside)
+		                          : 0u,
+		    .aabb = {.minimum = aabb.min, .maximum = aabb.max},
+		};
+		bezierControlPoints.insert(
+		    bezierControlPoints.end(), controlPoints.begin(), controlPoints.end());
 
-		debug_printFmt("Adding bezierTriangle of type %d to sceneObject (%s): %d\n",
-		               static_cast<int>(objectType),
+		debug_printFmt("Adding bezier patch of degree %u to sceneObject (%s): %d\n",
+		               degree,
 		               sceneObject.name.c_str(),
 		               sceneObject.instanceCustomIndex);
 
-		auto& trianglesList = getTriangleList<S>();
-		trianglesList.emplace_back(
-		    std::make_shared<RaytracingWorldObject<S>>(type, aabb, bezierTriangle, glm::vec3(0)));
-		auto& obj = trianglesList.back();
+		return addObject(sceneObject, patch, ObjectType::t_BezierPatch, aabb, glm::vec3(0));
+	}
 
-		auto& trianglesListForSceneObject = getTriangleListForSceneObject<S>(sceneObject);
-		trianglesListForSceneObject.push_back(obj);
-		return obj;
+	template <typename S>
+	ObjectHandle<BezierPatch> addObjectBezierTriangle(SceneObject& sceneObject,
+	                                                  const S& bezierTriangle,
+	                                                  const bool markAsInside)
+	{
+		constexpr auto n = static_cast<uint32_t>(degree<S>());
+		return addObjectBezierPatch(sceneObject, n, bezierTriangle.controlPoints, markAsInside);
+	}
+
+	// the control points of the patch in the order of the BezierTriangle structs
+	[[nodiscard]] std::span<const glm::vec3>
+	getBezierPatchControlPoints(const ObjectHandle<BezierPatch> handle) const
+	{
+		const BezierPatch& patch = bezierPatches.get(handle);
+		return std::span<const glm::vec3>(bezierControlPoints)
+		    .subspan(patch.controlPointOffset, getBezierTriangleControlPointCount(patch.degree));
+	}
+
+	/**
+	 * @brief Replaces the control points of the patch and recomputes its bounds (the AABB header
+	 * read by the shaders, the AABB of the BLAS and the bezier bounds telemetry). Its SceneObject
+	 * becomes dynamic, the patch is written and the BLAS refitted with the next incremental update.
+	 *
+	 * @param controlPoints the same amount of control points the patch already has
+	 */
+	void modifyBezierPatchControlPoints(const ObjectHandle<BezierPatch> handle,
+	                                    const std::span<const glm::vec3> controlPoints)
+	{
+		const uint32_t degree = bezierPatches.get(handle).degree;
+		if (controlPoints.size() != getBezierTriangleControlPointCount(degree))
+		{
+			throw std::runtime_error(
+			    "modifyBezierPatchControlPoints - Wrong amount of control points");
+		}
+
+		const AABB aabb = AABB::fromBezierPatch(controlPoints, degree, bezierBoundsMode);
+		const BezierPatch& previousPatch = bezierPatches.get(handle);
+		bezierBoundsTelemetry.remove(
+		    getBezierPatchControlPoints(handle),
+		    AABB{.min = previousPatch.aabb.minimum, .max = previousPatch.aabb.maximum});
+		bezierBoundsTelemetry.add(controlPoints, aabb);
+
+		BezierPatch& patch = bezierPatches.modify(handle);
+		patch.aabb = {.minimum = aabb.min, .maximum = aabb.max};
+		bezierPatches.setAabb(handle, aabb);
+		std::copy(controlPoints.begin(),
+		          controlPoints.end(),
+		          bezierControlPoints.begin()
+		              + static_cast<std::ptrdiff_t>(patch.controlPointOffset));
+
+		const auto sceneObject = findSceneObjectOfObject<BezierPatch>(handle.index);
+		assert(sceneObject != nullptr);
+		markSceneObjectDynamic(*sceneObject);
+		requestDirtyObjectsUpload(sceneObject);
 	}
 
-	std::shared_ptr<RaytracingWorldObject<RectangularBezierSurface2x2>>
+	ObjectHandle<RectangularBezierSurface2x2>
 	addObjectRectangularBezierSurface2x2(SceneObject& sceneObject,
 	                                     const RectangularBezierSurface2x2& surface)
 	{
-		AABB aabb = AABB::fromRectangularBezierSurface2x2(surface);
-		rectangularBezierSurfaces2x2.emplace_back(
-		    std::make_shared<RaytracingWorldObject<RectangularBezierSurface2x2>>(
-		        ObjectType::t_RectangularBezierSurface2x2, aabb, surface, glm::vec3(0)));
-		auto& obj = rectangularBezierSurfaces2x2.back();
-		sceneObject.rectangularBezierSurfaces2x2.emplace_back(obj);
-		return obj;
+		return addObject(sceneObject,
+		                 surface,
+		                 ObjectType::t_RectangularBezierSurface2x2,
+		                 AABB::fromRectangularBezierSurface2x2(surface),
+		                 glm::vec3(0));
 	}
 
 	void addSlicingPlane(const SlicingPlane& slicingPlane)
@@ -316,143 +549,160 @@ class RaytracingScene
 		}
 	}
 
-	std::vector<std::shared_ptr<RaytracingWorldObject<Sphere>>>&
-	getWorldObjectSpheres(SceneObject& sceneObject)
+	std::vector<SlicingPlane>& getSlicingPlanes()
 	{
-		return sceneObject.spheres;
+		return slicingPlanes;
 	}
 
-	template <typename S>
-	std::vector<std::shared_ptr<RaytracingWorldObject<S>>>&
-	getWorldObjectBezierTriangles(SceneObject& sceneObject)
+	std::vector<std::shared_ptr<SceneObject>>& getSceneObjects()
 	{
-		return getTriangleListForSceneObject<S>(sceneObject);
+		return sceneObjects;
 	}
 
-	std::vector<std::shared_ptr<RaytracingWorldObject<RectangularBezierSurface2x2>>>&
-	getWorldObjectRectangularBezierSurfaces2x2(SceneObject& sceneObject)
+	// sets the transform of the TLAS instances of all clusters of the SceneObject
+	inline void setTransformMatrixForSceneObject(const SceneObject& sceneObject,
+	                                             const VkTransformMatrixKHR& matrix)
 	{
-		return sceneObject.rectangularBezierSurfaces2x2;
+		setTransformMatrixForInstance(sceneObject, 0, matrix);
 	}
 
-	std::vector<SlicingPlane>& getSlicingPlanes()
+	/**
+	 * @brief Adds another TLAS instance of the SceneObject's BLAS's with its own transform. The
+	 * instance shares the objects, their storage buffer data and the gpuObjects with the
+	 * SceneObject, so only the TLAS grows with the instance count. The bezier patches are
+	 * intersected in object space, any affine transform can be used. Spheres are intersected with
+	 * their world space center, so SceneObjects with spheres can not be instanced.
+	 *
+	 * Only applies on the next full rebuild.
+	 *
+	 * @return the index of the instance, 0 is the SceneObject itself (its transformMatrix)
+	 * @throws std::runtime_error if the SceneObject has spheres
+	 */
+	size_t addSceneObjectInstance(SceneObject& sceneObject, const VkTransformMatrixKHR& matrix)
 	{
-		return slicingPlanes;
+		if (!sceneObject.spheres.empty())
+		{
+			throw std::runtime_error(
+			    "addSceneObjectInstance - SceneObjects with spheres can not be instanced");
+		}
+
+		sceneObject.instanceTransforms.push_back(matrix);
+		return sceneObject.instanceCount() - 1;
 	}
 
-	std::vector<std::shared_ptr<SceneObject>>& getSceneObjects()
+	// sets the transform of the TLAS instances of all clusters of one instance of the
+	// SceneObject, the stored transform of the SceneObject is not changed
+	inline void setTransformMatrixForInstance(const SceneObject& sceneObject,
+	                                          const size_t instanceIndex,
+	                                          const VkTransformMatrixKHR& matrix)
 	{
-		return sceneObjects;
+		assert(instanceIndex < sceneObject.instanceCount());
+		const size_t firstInstance
+		    = sceneObject.blasInstanceOffset + instanceIndex * sceneObject.clusters.size();
+		for (size_t i = 0; i < sceneObject.clusters.size(); i++)
+		{
+			blasInstances[firstInstance + i].transform = matrix;
+		}
+		markTopLevelAccelerationStructureInstancesDirty(
+		    tlasInstanceBuffers, firstInstance, firstInstance + sceneObject.clusters.size());
+		tlasUpdatePending = true;
 	}
 
-	inline void setTransformMatrixForInstance(const size_t instanceIndex,
-	                                          const VkTransformMatrixKHR& matrix)
+	// the nodes are cleared together with the scene
+	[[nodiscard]] inline TransformHierarchy& getTransformHierarchy()
+	{
+		return transformHierarchy;
+	}
+
+	/**
+	 * @brief Lets the node of the transform hierarchy drive the transform of the instance, e.g.
+	 * for the parts of an animated assembly. The changed world matrices are collected once per
+	 * frame by recordPendingUpdates() and applied with a single TLAS update, no
+	 * recreateAccelerationStructures() call is needed.
+	 *
+	 * @param instanceIndex see addSceneObjectInstance(), 0 is the SceneObject itself
+	 */
+	void attachInstanceToTransformNode(const std::shared_ptr<SceneObject>& sceneObject,
+	                                   const size_t instanceIndex,
+	                                   const TransformNodeId node)
 	{
-		blasInstances[instanceIndex].transform = matrix;
+		assert(instanceIndex < sceneObject->instanceCount());
+		assert(node < transformHierarchy.size());
+		transformBindings.push_back({
+		    .sceneObject = sceneObject,
+		    .instanceIndex = instanceIndex,
+		    .node = node,
+		});
 	}
 
-	void createSlicingPlanesBuffer()
+	// the dirty objects of the SceneObject are uploaded with the next recordPendingUpdates()
+	// call, used for objects that move every frame (e.g. the rotating light)
+	void requestDirtyObjectsUpload(const std::shared_ptr<SceneObject>& sceneObject)
 	{
-		if (slicingPlanes.size() > 0)
+		pendingDirtyObjectsUploads.push_back(sceneObject);
+	}
+
+	/**
+	 * @brief Records the ownership acquires of the staged uploads, the dirty object uploads, the
+	 * refits of the dynamic BLAS's and the TLAS
+	 * update into the frame command buffer, has to be called before the rays are traced. Unlike
+	 * the other update paths this does not wait for the GPU, barriers order the writes against
+	 * the previous frames.
+	 *
+	 * @param frameIndex the current frame in flight, selects the TLAS instance buffer
+	 */
+	void recordPendingUpdates(VkCommandBuffer commandBuffer,
+	                          const uint32_t frameIndex,
+	                          RaytracingInfo& raytracingInfo)
+	{
+		// the buffers uploaded on the transfer queue are read by the ray tracing shaders
+		stagingUploader.recordOwnershipAcquires(commandBuffer);
+
+		// the instances moved by the transform hierarchy are part of the TLAS update below
+		applyTransformHierarchy(!tlasInstanceBuffers.empty());
+
+		if (!pendingDirtyObjectsUploads.empty())
 		{
-			createBuffer(physicalDevice,
-			             logicalDevice,
-			             vmaAllocator,
-			             deletionQueueForAccelerationStructure,
-			             slicingPlanes.size() * sizeof(SlicingPlane),
-			             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-			             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			             memoryAllocateFlagsInfo,
-			             slicingPlanesBufferHandle,
-			             slicingPlanesBufferAllocation);
-		}
-	}
-
-	void createBuffers()
-	{
-		if (spheres.size() > 0)
-		{
-			createBuffer(physicalDevice,
-			             logicalDevice,
-			             vmaAllocator,
-			             deletionQueueForAccelerationStructure,
-			             spheres.size() * sizeof(Sphere),
-			             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-			             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			             memoryAllocateFlagsInfo,
-			             spheresBufferHandle,
-			             spheresBufferAllocation);
-		}
-
-		// if (tetrahedrons2.size() > 0)
-		// {
-		// 	createBuffer(physicalDevice,
-		// 	             logicalDevice,
-		// 	             vmaAllocator,
-		// 	             deletionQueueForAccelerationStructure,
-		// 	             tetrahedrons2.size() * sizeof(Tetrahedron2),
-		// 	             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-		// 	             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
-		// VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, 	             memoryAllocateFlagsInfo,
-		// 	             tetrahedronsBufferHandle,
-		// 	             tetrahedronsBufferAllocation);
-		// }
-
-		if (bezierTriangles2.size() > 0)
-		{
-			createBuffer(physicalDevice,
-			             logicalDevice,
-			             vmaAllocator,
-			             deletionQueueForAccelerationStructure,
-			             bezierTriangles2.size() * sizeof(BezierTriangle2),
-			             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-			             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			             memoryAllocateFlagsInfo,
-			             bezierTriangles2BufferHandle,
-			             bezierTriangles2BufferAllocation);
-		}
-
-		if (bezierTriangles3.size() > 0)
-		{
-			createBuffer(physicalDevice,
-			             logicalDevice,
-			             vmaAllocator,
-			             deletionQueueForAccelerationStructure,
-			             bezierTriangles3.size() * sizeof(BezierTriangle3),
-			             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-			             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			             memoryAllocateFlagsInfo,
-			             bezierTriangles3BufferHandle,
-			             bezierTriangles3BuffersAllocation);
-		}
-
-		if (bezierTriangles4.size() > 0)
-		{
-			createBuffer(physicalDevice,
-			             logicalDevice,
-			             vmaAllocator,
-			             deletionQueueForAccelerationStructure,
-			             bezierTriangles4.size() * sizeof(BezierTriangle4),
-			             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-			             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			             memoryAllocateFlagsInfo,
-			             bezierTriangles4BufferHandle,
-			             bezierTriangles4BuffersAllocation);
-		}
-
-		if (rectangularBezierSurfaces2x2.size() > 0)
-		{
-			createBuffer(physicalDevice,
-			             logicalDevice,
-			             vmaAllocator,
-			             deletionQueueForAccelerationStructure,
-			             rectangularBezierSurfaces2x2.size() * sizeof(RectangularBezierSurface2x2),
-			             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-			             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			             memoryAllocateFlagsInfo,
-			             rectangularBezierSurfaces2x2BufferHandle,
-			             rectangularBezierSurfaces2x2BufferAllocation);
+			recordDirtyObjectsUploads(commandBuffer);
 		}
+		pendingDirtyObjectsUploads.clear();
+
+		recordDynamicBLASRefits(commandBuffer);
+
+		if (tlasUpdatePending && !tlasInstanceBuffers.empty())
+		{
+			assert(frameIndex < tlasInstanceBuffers.size());
+			recordTopLevelAccelerationStructureUpdate(
+			    commandBuffer,
+			    blasInstances,
+			    tlasInstanceBuffers[frameIndex],
+			    raytracingInfo.topLevelAccelerationStructureGeometry,
+			    raytracingInfo.topLevelAccelerationStructureBuildGeometryInfo,
+			    raytracingInfo.topLevelAccelerationStructureBuildRangeInfo);
+		}
+		tlasUpdatePending = false;
+	}
+
+	// makes sure the storage buffers can hold the objects of the scene, buffers that are too
+	// small are reallocated, the old ones are retired once the rebuild is done
+	void reserveBuffers()
+	{
+		storageBufferPool.reserve(SceneStorageBuffer::SlicingPlanes,
+		                          slicingPlanes.size() * sizeof(SlicingPlane),
+		                          retiredResources);
+		storageBufferPool.reserve(SceneStorageBuffer::Spheres,
+		                          spheres.size() * sizeof(Sphere),
+		                          retiredResources);
+		storageBufferPool.reserve(SceneStorageBuffer::BezierPatches,
+		                          bezierPatches.size() * sizeof(BezierPatch),
+		                          retiredResources);
+		storageBufferPool.reserve(SceneStorageBuffer::BezierControlPoints,
+		                          bezierControlPoints.size() * sizeof(glm::vec3),
+		                          retiredResources);
+		storageBufferPool.reserve(SceneStorageBuffer::RectangularBezierSurfaces2x2,
+		                          rectangularBezierSurfaces2x2.size()
+		                              * sizeof(RectangularBezierSurface2x2),
+		                          retiredResources);
 	}
 
 	// NOTE:  we assume we add the objects directly after creating the SceneObject
@@ -464,6 +714,47 @@ class RaytracingScene
 		return createNamedSceneObject("", pos, rotation, scale);
 	}
 
+	// the BLAS's of the SceneObject are refitted from now on, for SceneObjects whose AABBs change
+	// (edited control points, moved world space spheres). The BLAS's are rebuilt with the new
+	// build flags by the next recreateAccelerationStructures(), even an incremental one
+	void markSceneObjectDynamic(SceneObject& sceneObject)
+	{
+		if (sceneObject.buildPolicy == BLASBuildPolicy::Dynamic)
+		{
+			return;
+		}
+		sceneObject.buildPolicy = BLASBuildPolicy::Dynamic;
+		buildPolicyChanged = true;
+	}
+
+	// the SceneObject that owns the object at the index of getObjectPool<T>(), nullptr if there
+	// is none
+	template <typename T>
+	[[nodiscard]] std::shared_ptr<SceneObject> findSceneObjectOfObject(const size_t index) const
+	{
+		for (const auto& sceneObject : sceneObjects)
+		{
+			const ObjectRange& range = getObjectRange<T>(*sceneObject);
+			if (index >= range.offset && index < range.end())
+			{
+				return sceneObject;
+			}
+		}
+		return nullptr;
+	}
+
+	// creates a SceneObject for debug visualizations (control points, sampled surfaces etc.), its
+	// BLAS's are built for fast builds instead of fast tracing and shadow rays skip it
+	// NOTE:  we assume we add the objects directly after creating the SceneObject
+	// it it NOT possible to add objects after a new instance of SceneObject has been created
+	std::shared_ptr<SceneObject> createDebugSceneObject(const glm::vec3 pos = glm::vec3(0))
+	{
+		auto sceneObject = createNamedSceneObject("", pos);
+		sceneObject->buildPolicy = BLASBuildPolicy::Debug;
+		sceneObject->instanceMask = InstanceMask::t_DebugInstance;
+		return sceneObject;
+	}
+
 	// NOTE:  we assume we add the objects directly after creating the SceneObject
 	// it it NOT possible to add objects after a new instance of SceneObject has been created
 	std::shared_ptr<SceneObject> createNamedSceneObject(const std::string& name = "",
@@ -473,18 +764,17 @@ class RaytracingScene
 	{
 		Transform identityTransform(pos, rotation, scale);
 
-		// get the next instance index by seeing how many objects are already in the scene
-		size_t instanceCustomIndex = 0;
-		for (auto& obj : sceneObjects)
-		{
-			instanceCustomIndex += obj->totalElementsCount();
-		}
+		// the objects of the SceneObjects are consecutive inside the pools, the next instance
+		// index is therefore the amount of objects already in the scene
+		const size_t instanceCustomIndex = getObjectCount();
 
 		// only the first 24 bits are used for the instance custom index in vulkan
 		// therefore this ensures that the index is not larger than 24 bits
-		[[maybe_unused]] constexpr auto indexLimit24Bit = (1u << 24) - 1;
-		assert(instanceCustomIndex <= indexLimit24Bit
-		       && "instanceCustomIndex exceeds 24 bit limit");
+		if (instanceCustomIndex > MAX_INSTANCE_CUSTOM_INDEX)
+		{
+			throw std::runtime_error(
+			    "createSceneObject - instanceCustomIndex exceeds 24 bit limit");
+		}
 
 		if (!name.empty() && getSceneObject(name))
 		{
@@ -497,9 +787,7 @@ class RaytracingScene
 		const auto transformMatrix = identityTransform.getTransformMatrix();
 
 		const auto& spheresBufferOffset = spheres.size();
-		const auto& bezierTriangles2BufferOffset = bezierTriangles2.size();
-		const auto& bezierTriangles3BufferOffset = bezierTriangles3.size();
-		const auto& bezierTriangles4BufferOffset = bezierTriangles4.size();
+		const auto& bezierPatchesBufferOffset = bezierPatches.size();
 		const auto& rectangularBezierSurfaces2x2BufferOffset = rectangularBezierSurfaces2x2.size();
 
 		// TODO: we could order the objects that are inside the scene object later on before we move
@@ -509,9 +797,7 @@ class RaytracingScene
 		                                  transformMatrix,
 		                                  instanceIndex,
 		                                  spheresBufferOffset,
-		                                  bezierTriangles2BufferOffset,
-		                                  bezierTriangles3BufferOffset,
-		                                  bezierTriangles4BufferOffset,
+		                                  bezierPatchesBufferOffset,
 		                                  rectangularBezierSurfaces2x2BufferOffset));
 
 		auto& obj = sceneObjects[sceneObjects.size() - 1];
@@ -519,103 +805,60 @@ class RaytracingScene
 		return obj;
 	}
 
-	void recreateAccelerationStructures(RaytracingInfo& raytracingInfo, const bool fullRebuild)
+	// neither path waits for the submitted frames, the replaced resources are retired on the frame
+	// timeline and the updates are recorded into the next frame command buffer
+	// @return whether a full rebuild was done (also if an incremental one had to fall back to
+	// it), the descriptor set has to be updated then
+	bool recreateAccelerationStructures(RaytracingInfo& raytracingInfo, const bool fullRebuild)
 	{
-		// update the lists and copy then to the GPU buffer
-		spheresList.clear();
-		bezierTriangles2List.clear();
-		bezierTriangles3List.clear();
-		bezierTriangles4List.clear();
-		rectangularSurfaces2x2List.clear();
-
 		// We dont want to recreate the BLAS's but only update the related transform matrix
 		// inside the TLAS that links to the particular BLAS
 		if (fullRebuild)
 		{
-			// WARNING:	USE A POOL OF BUFFERS INSTEAD!!
-			// TODO: Reuse created buffers instead of throwing them away and recreating them,
-			// this e.g. instead of recreating 1000 buffers for each sphere, just reuse the
-			// buffer and can save a lot of time, assign  them new if the amount of spheres
-			// changes, only create new buffers for the new spheres
-			deletionQueueForAccelerationStructure.flush();
-
-			gpuObjectsBufferAllocation = VK_NULL_HANDLE;
-			gpuObjectsBufferHandle = VK_NULL_HANDLE;
-
-			// TODO: do we need to recreate the slicing planes buffer?
-			slicingPlanesBufferHandle = VK_NULL_HANDLE;
-			slicingPlanesBufferAllocation = VK_NULL_HANDLE;
-			createSlicingPlanesBuffer();
-
-			// tetrahedronsBufferHandle = VK_NULL_HANDLE;
-			// tetrahedronsBufferAllocation = VK_NULL_HANDLE;
-
-			spheresBufferHandle = VK_NULL_HANDLE;
-			spheresBufferAllocation = VK_NULL_HANDLE;
-
-			rectangularBezierSurfaces2x2BufferHandle = VK_NULL_HANDLE;
-			rectangularBezierSurfaces2x2BufferAllocation = VK_NULL_HANDLE;
-
-			bezierTriangles2BufferHandle = VK_NULL_HANDLE;
-			bezierTriangles2BufferAllocation = VK_NULL_HANDLE;
-
-			bezierTriangles3BufferHandle = VK_NULL_HANDLE;
-			bezierTriangles3BuffersAllocation = VK_NULL_HANDLE;
-
-			bezierTriangles4BufferHandle = VK_NULL_HANDLE;
-			bezierTriangles4BuffersAllocation = VK_NULL_HANDLE;
-
-			spheresList.clear();
-			bezierTriangles2List.clear();
-			bezierTriangles3List.clear();
-			bezierTriangles4List.clear();
-			rectangularSurfaces2x2List.clear();
+			// the old acceleration structures and buffers might still be used by the submitted
+			// frames, they are retired instead of waiting for the queue to be idle. The storage
+			// buffers are kept in the storageBufferPool and reused if the objects still fit, the
+			// staged copies into them wait for the submitted frames on the GPU
+			const FrameTimeline& timeline = raytracingInfo.frameTimeline;
+			retirementQueue.retire(std::move(deletionQueueForAccelerationStructure),
+			                       timeline.lastSubmittedValue);
+			stagingUploader.setSubmitWait(timeline.semaphore, timeline.lastSubmittedValue);
+			raytracingInfo.uniformBufferView = {};
+			tlasInstanceBuffers.clear();
+			dynamicBLASs.clear();
+			buildPolicyChanged = false;
+
+			// the instances are created with the transforms stored in the SceneObjects
+			applyTransformHierarchy(false);
 
 			gpuObjects.clear();
 			blasInstances.clear();
 
-			// the objects that are rendered using ray tracing (with an intersection shader)
-			RaytracingObjectAABBBuffers aabbBuffers{};
-
 			for (const auto& sceneObject : sceneObjects)
 			{
-				vkQueueWaitIdle(raytracingInfo.graphicsQueueHandle);
-				aabbBuffers.clearAllHandles();
-
-				copyAABBsToBuffer(aabbBuffers, *sceneObject);
+				updateSceneObjectClusters(*sceneObject);
 				addSceneObjectToGpuObjects(*sceneObject);
-
-				const std::vector<BLASBuildData> buildData
-				    = createBLASBuildDataForSceneObject(aabbBuffers, *sceneObject);
-				auto blasBuildData = BLASSceneObjectBuildData{
-				    .blasData = buildData,
-				    .transformMatrix = sceneObject->transformMatrix,
-				    .instanceCustomIndex = sceneObject->instanceCustomIndex,
-				};
-
-				vkQueueWaitIdle(raytracingInfo.graphicsQueueHandle);
-				auto blasInstance = buildBLASInstancesFromBuildDataList(
-				    blasBuildData,
-				    raytracingInfo.commandBufferBuildTopAndBottomLevel,
-				    raytracingInfo.graphicsQueueHandle,
-				    raytracingInfo.accelerationStructureBuildFence,
-				    raytracingInfo.minAccelerationStructureScratchOffsetAlignment);
-
-				blasInstances.push_back(blasInstance);
+				addSceneObjectToGPUInstances(*sceneObject);
 			}
 
-			createBuffers();
+			// the geometry is uploaded on the transfer queue while the BLAS's are built on the
+			// graphics queue
+			reserveBuffers();
 			copyGPUObjectsToBuffers();
 			copySlicingPlaneToBuffers();
 			copyGPUInstancesToBuffer(fullRebuild);
+			stagingUploader.submit();
+
+			buildBLASInstances(raytracingInfo.commandBufferBuildTopAndBottomLevel,
+			                   raytracingInfo.graphicsQueueHandle,
+			                   raytracingInfo.accelerationStructureBuildFence,
+			                   raytracingInfo.minAccelerationStructureScratchOffsetAlignment);
 
 			blasInstancesCount = blasInstances.size();
 
 			// TODO: create a dedicated struct that holds all the information for the
 			// acceleration structure that is actually needed
-			createTLAS(false,
-			           raytracingInfo.blasGeometryInstancesDeviceMemoryHandle,
-			           raytracingInfo.topLevelAccelerationStructureGeometry,
+			createTLAS(raytracingInfo.topLevelAccelerationStructureGeometry,
 			           raytracingInfo.topLevelAccelerationStructureBuildGeometryInfo,
 			           raytracingInfo.topLevelAccelerationStructureHandle,
 			           raytracingInfo.topLevelAccelerationStructureBuildSizesInfo,
@@ -626,113 +869,91 @@ class RaytracingScene
 			           raytracingInfo.topLevelAccelerationStructureBuildRangeInfo,
 			           raytracingInfo.commandBufferBuildTopAndBottomLevel,
 			           raytracingInfo.graphicsQueueHandle,
+			           raytracingInfo.accelerationStructureBuildFence,
 			           raytracingInfo.uniformBufferHandle,
 			           raytracingInfo.uniformBufferAllocation,
+			           raytracingInfo.uniformBufferView,
 			           raytracingInfo.uniformStructure,
 			           raytracingInfo.minAccelerationStructureScratchOffsetAlignment);
+
+			// the TLAS and the object buffers were just created with the current data
+			tlasUpdatePending = false;
+			pendingDirtyObjectsUploads.clear();
+
+			// the replaced storage buffers are destroyed once the submitted frames are done, the
+			// descriptor set referencing them is replaced the same way
+			retirementQueue.retire(std::move(retiredResources), timeline.lastSubmittedValue);
+			retirementQueue.collect(getCompletedFrameTimelineValue(logicalDevice, timeline));
+			return true;
 		}
 		else
 		{
-			vkQueueWaitIdle(raytracingInfo.graphicsQueueHandle);
+			// moved AABBs of dynamic objects are refitted inside the next frame command buffer,
+			// SceneObjects that just became dynamic don't have a refittable BLAS yet
+			if (buildPolicyChanged || !updateDynamicBLASAABBs())
+			{
+				return recreateAccelerationStructures(raytracingInfo, true);
+			}
+
+			// only the objects that changed since their last upload are written, the dirty ranges
+			// are recorded into the next frame command buffer
 			for (const auto& sceneObject : sceneObjects)
 			{
-				addSceneObjectToGpuObjects(*sceneObject);
+				requestDirtyObjectsUpload(sceneObject);
 			}
-			copyGPUObjectsToBuffers();
 
+			// the slicing planes are staged while frames are in flight, the copy waits for them
+			// on the GPU and the next frame waits for the copy
+			const FrameTimeline& timeline = raytracingInfo.frameTimeline;
+			stagingUploader.setSubmitWait(timeline.semaphore, timeline.lastSubmittedValue);
 			copySlicingPlaneToBuffers();
+			stagingUploader.submit();
 
-			createTLAS(true,
-			           raytracingInfo.blasGeometryInstancesDeviceMemoryHandle,
-			           raytracingInfo.topLevelAccelerationStructureGeometry,
-			           raytracingInfo.topLevelAccelerationStructureBuildGeometryInfo,
-			           raytracingInfo.topLevelAccelerationStructureHandle,
-			           raytracingInfo.topLevelAccelerationStructureBuildSizesInfo,
-			           raytracingInfo.topLevelAccelerationStructureBufferHandle,
-			           raytracingInfo.topLevelAccelerationStructureDeviceMemoryHandle,
-			           raytracingInfo.topLevelAccelerationStructureScratchBufferHandle,
-			           raytracingInfo.topLevelAccelerationStructureDeviceScratchMemoryHandle,
-			           raytracingInfo.topLevelAccelerationStructureBuildRangeInfo,
-			           raytracingInfo.commandBufferBuildTopAndBottomLevel,
-			           raytracingInfo.graphicsQueueHandle,
-			           raytracingInfo.uniformBufferHandle,
-			           raytracingInfo.uniformBufferAllocation,
-			           raytracingInfo.uniformStructure,
-			           raytracingInfo.minAccelerationStructureScratchOffsetAlignment);
+			// the TLAS is updated inside the next frame command buffer
+			tlasUpdatePending = true;
+			return false;
 		}
 	}
 
 	/// Copies the spheres, tetrhedrons and rectangular bezier surfaces to the corresponding
-	/// buffers on the GPU
+	/// buffers on the GPU, the device local buffers are written with the next
+	/// stagingUploader.submit()
 	void copyGPUObjectsToBuffers()
 	{
-		if (spheresList.size() > 0)
+		copyObjectPoolToBuffer(SceneStorageBuffer::Spheres, spheres);
+		copyObjectPoolToBuffer(SceneStorageBuffer::BezierPatches, bezierPatches);
+		if (bezierControlPoints.size() > 0)
 		{
-			copyDataToBuffer(vmaAllocator,
-			                 spheresBufferAllocation,
-			                 spheresList.data(),
-			                 sizeof(Sphere) * spheresList.size());
-		}
-
-		// if (tetrahedrons2.size() > 0)
-		// {
-		// 	std::vector<Tetrahedron2> tetrahedrons2List;
-		// 	for (size_t i = 0; i < tetrahedrons2.size(); i++)
-		// 	{
-		// 		auto& obj = tetrahedrons2[i];
-		// 		tetrahedrons2List.push_back(obj.getGeometry().getData());
-		// 	}
-		// 	copyDataToBuffer(vmaAllocator,
-		// 	                 aabbBuffers.tetrahedronsBufferAllocation,
-		// 	                 tetrahedrons2List.data(),
-		// 	                 sizeof(Tetrahedron2) * tetrahedrons2List.size());
-		// }
-
-		if (bezierTriangles2List.size() > 0)
-		{
-			copyDataToBuffer(vmaAllocator,
-			                 bezierTriangles2BufferAllocation,
-			                 bezierTriangles2List.data(),
-			                 sizeof(BezierTriangle2) * bezierTriangles2List.size());
-		}
-
-		if (bezierTriangles3List.size() > 0)
-		{
-			copyDataToBuffer(vmaAllocator,
-			                 bezierTriangles3BuffersAllocation,
-			                 bezierTriangles3List.data(),
-			                 sizeof(BezierTriangle3) * bezierTriangles3List.size());
-		}
-
-		if (bezierTriangles4List.size() > 0)
-		{
-			copyDataToBuffer(vmaAllocator,
-			                 bezierTriangles4BuffersAllocation,
-			                 bezierTriangles4List.data(),
-			                 sizeof(BezierTriangle4) * bezierTriangles4List.size());
-		}
-
-		if (rectangularSurfaces2x2List.size() > 0)
-		{
-			copyDataToBuffer(vmaAllocator,
-			                 rectangularBezierSurfaces2x2BufferAllocation,
-			                 rectangularSurfaces2x2List.data(),
-			                 sizeof(RectangularBezierSurface2x2)
-			                     * rectangularSurfaces2x2List.size());
+			writeStorageBuffer(SceneStorageBuffer::BezierControlPoints,
+			                   bezierControlPoints.data(),
+			                   sizeof(glm::vec3) * bezierControlPoints.size());
 		}
+		copyObjectPoolToBuffer(SceneStorageBuffer::RectangularBezierSurfaces2x2,
+		                       rectangularBezierSurfaces2x2);
 	}
 
 	void copySlicingPlaneToBuffers()
 	{
 		if (slicingPlanes.size() > 0)
 		{
-			copyDataToBuffer(vmaAllocator,
-			                 slicingPlanesBufferAllocation,
-			                 slicingPlanes.data(),
-			                 sizeof(SlicingPlane) * slicingPlanes.size());
+			writeStorageBuffer(SceneStorageBuffer::SlicingPlanes,
+			                   slicingPlanes.data(),
+			                   sizeof(SlicingPlane) * slicingPlanes.size());
 		}
 	}
 
+	// the amount of objects of all SceneObjects
+	[[nodiscard]] size_t getObjectCount() const
+	{
+		return spheres.size() + bezierPatches.size() + rectangularBezierSurfaces2x2.size();
+	}
+
+	// the control points of all bezier patches, see BezierPatch::controlPointOffset
+	[[nodiscard]] const std::vector<glm::vec3>& getBezierControlPoints() const
+	{
+		return bezierControlPoints;
+	}
+
 	std::optional<std::shared_ptr<SceneObject>> getSceneObject(const std::string& name)
 	{
 		auto sceneObjectItr = objectNameToSceneObjectMap.find(name);
@@ -747,204 +968,253 @@ class RaytracingScene
 	}
 
   private:
+	// appends the patches of a SceneBuilder
+	friend class SceneBuilder;
+
+	// appends the object to its pool, the objects of a SceneObject have to be consecutive inside
+	// the pool so they can be referenced by an ObjectRange
 	template <typename T>
-	void addObjectsToBLASBuildDataListAndGPUObjectsList(
-	    size_t indexStart,
-	    std::vector<BLASBuildData>& blasBuildDataList,
-	    const std::vector<std::shared_ptr<RaytracingWorldObject<T>>>& sceneObjectObjects,
-	    std::vector<VkBuffer>& aabbBufferHandles)
+	ObjectHandle<T> addObject(SceneObject& sceneObject,
+	                          const T& object,
+	                          const ObjectType type,
+	                          const AABB& aabb,
+	                          const glm::vec3 position,
+	                          const bool worldSpaceAabb = false)
 	{
-		// for each object in the SceneObject, create an entry in the gpuObjects vector to
-		// reference later inside the shader also create the BLAS build data for the entry and
-		// add it to the list
-		for (size_t i = 0; i < sceneObjectObjects.size(); i++)
+		// a cluster can start at any object of the SceneObject, the index of every object has to
+		// fit into the 24 bit instance custom index
+		if (getObjectCount() > MAX_INSTANCE_CUSTOM_INDEX)
 		{
-			auto buildData = createBottomLevelAccelerationStructureBuildDataAABB(
-			    logicalDevice, aabbBufferHandles[i]);
+			throw std::runtime_error(
+			    "addObject - The object exceeds the 24 bit instance custom index");
+		}
 
-			auto objectType = sceneObjectObjects[i]->getType();
-			debug_printFmt("Added object %zu with type %d and bufferIndex %zu to gpuObjects\n",
-			               gpuObjects.size(),
-			               static_cast<int>(objectType),
-			               indexStart + i);
-			gpuObjects.push_back(GPUInstance(objectType, indexStart + i));
-			blasBuildDataList.push_back(buildData);
+		auto& pool = getObjectPool<T>();
+		auto& range = getObjectRange<T>(sceneObject);
+		assert(range.end() == pool.size()
+		       && "objects have to be added directly after creating their SceneObject");
+		range.count++;
+		return pool.add(object, type, aabb, position, worldSpaceAabb);
+	}
+
+	// appends the patches to the pool with one copy per array, the control point offsets of the
+	// patches have to point behind the control points already in the scene
+	void appendBezierPatches(SceneObject& sceneObject,
+	                         const std::span<const BezierPatch> patches,
+	                         const std::span<const VkAabbPositionsKHR> aabbPositions,
+	                         const std::span<const glm::vec3> controlPoints)
+	{
+		assert(sceneObject.bezierPatches.end() == bezierPatches.size()
+		       && "objects have to be added directly after creating their SceneObject");
+		bezierControlPoints.insert(
+		    bezierControlPoints.end(), controlPoints.begin(), controlPoints.end());
+		bezierPatches.append(patches, aabbPositions, ObjectType::t_BezierPatch, glm::vec3(0));
+		sceneObject.bezierPatches.count += patches.size();
+
+		for (size_t i = 0; i < patches.size(); i++)
+		{
+			const VkAabbPositionsKHR& positions = aabbPositions[i];
+			bezierBoundsTelemetry.add(
+			    std::span<const glm::vec3>(bezierControlPoints)
+			        .subspan(patches[i].controlPointOffset,
+			                 getBezierTriangleControlPointCount(patches[i].degree)),
+			    AABB{
+			        .min = glm::vec3(positions.minX, positions.minY, positions.minZ),
+			        .max = glm::vec3(positions.maxX, positions.maxY, positions.maxZ),
+			    });
 		}
 	}
 
-	// Extracts the data of the objects from the std::shared_ptr<RaytracingWorldObject<T>> vector
-	// into a vector and creates and copies the AABB to the corresponding buffer
+	// the pool already has the layout of the storage buffer, it is written with a single copy
 	template <typename T>
-	void extractAndCopyAABBsToBuffer(
-	    const std::vector<std::shared_ptr<RaytracingWorldObject<T>>>& objects,
-	    std::vector<VkBuffer>& aabbBufferHandles,
-	    std::vector<VmaAllocation>& aabbBufferAllocations,
-	    std::vector<AABB>& objectsAABBs)
+	void copyObjectPoolToBuffer(const SceneStorageBuffer buffer, const ObjectPool<T>& pool)
 	{
-		if (objects.size() > 0)
+		if (pool.size() > 0)
 		{
-			aabbBufferHandles.resize(objects.size());
-			aabbBufferAllocations.resize(objects.size());
-			for (size_t i = 0; i < objects.size(); i++)
-			{
-				auto& obj = objects[i];
-				objectsAABBs.push_back(obj->getGeometry().getAABB());
-
-				createBuffer(physicalDevice,
-				             logicalDevice,
-				             vmaAllocator,
-				             deletionQueueForAccelerationStructure,
-				             sizeof(VkAabbPositionsKHR),
-				             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR
-				                 | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-				             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-				             memoryAllocateFlagsInfo,
-				             aabbBufferHandles[i],
-				             aabbBufferAllocations[i]);
-
-				// Note: for now, all instances only contain one AABB, so we only need to copy
-				// one object into the buffer
-				const auto aabbPositions = obj->getGeometry().getAABB().getAabbPositions();
-				copyDataToBuffer(
-				    vmaAllocator, aabbBufferAllocations[i], &aabbPositions, sizeof(AABB));
-			}
+			writeStorageBuffer(buffer, pool.getObjects().data(), sizeof(T) * pool.size());
 		}
 	}
 
-	void addSceneObjectToGpuObjects(const SceneObject& sceneObject)
+	template <typename T>
+	void addObjectsToGPUObjectsList(std::vector<GPUInstance>& sceneObjectGPUObjects,
+	                                const ObjectPool<T>& pool,
+	                                const ObjectRange range)
 	{
-		for (size_t i = 0; i < sceneObject.spheres.size(); i++)
+		// for each object in the SceneObject, create an entry in the gpuObjects vector to
+		// reference later inside the shader (via gl_InstanceCustomIndexEXT + gl_PrimitiveID)
+		for (size_t i = range.offset; i < range.end(); i++)
 		{
-			auto& obj = sceneObject.spheres[i];
-			spheresList.push_back(obj->getGeometry().getData());
+			auto objectType = pool.getType(i);
+			debug_printFmt("Added object %zu with type %d and bufferIndex %zu to gpuObjects\n",
+			               gpuObjects.size() + sceneObjectGPUObjects.size(),
+			               static_cast<int>(objectType),
+			               i);
+			sceneObjectGPUObjects.push_back(GPUInstance(objectType, i));
 		}
+	}
+
+	// appends the AABBs of the objects in range to the packed list of AABB positions
+	template <typename T>
+	static void extractAABBs(const ObjectPool<T>& pool,
+	                         const ObjectRange range,
+	                         std::vector<VkAabbPositionsKHR>& aabbPositions)
+	{
+		const auto& poolAabbPositions = pool.getAabbPositions();
+		aabbPositions.insert(aabbPositions.end(),
+		                     poolAabbPositions.begin() + static_cast<std::ptrdiff_t>(range.offset),
+		                     poolAabbPositions.begin() + static_cast<std::ptrdiff_t>(range.end()));
+	}
 
-		for (size_t i = 0; i < sceneObject.bezierTriangles2.size(); i++)
+	// the objects are written to the buffers with the full rebuild, this clears their dirty
+	// flags
+	void addSceneObjectToGpuObjects(const SceneObject& sceneObject)
+	{
+		spheres.clearDirty(sceneObject.spheres);
+		bezierPatches.clearDirty(sceneObject.bezierPatches);
+		rectangularBezierSurfaces2x2.clearDirty(sceneObject.rectangularBezierSurfaces2x2);
+	}
+
+	// Packs all AABBs of the SceneObject into a single list (without applying the
+	// primitiveOrder)
+	[[nodiscard]] std::vector<VkAabbPositionsKHR>
+	collectUnorderedAABBs(const SceneObject& sceneObject)
+	{
+		std::vector<VkAabbPositionsKHR> aabbPositions;
+		aabbPositions.reserve(sceneObject.totalElementsCount());
+
+		extractAABBs(spheres, sceneObject.spheres, aabbPositions);
+		extractAABBs(bezierPatches, sceneObject.bezierPatches, aabbPositions);
+		extractAABBs(rectangularBezierSurfaces2x2,
+		             sceneObject.rectangularBezierSurfaces2x2,
+		             aabbPositions);
+		return aabbPositions;
+	}
+
+	// Packs all AABBs of the SceneObject into a single list, the order has to match the order
+	// of the gpuObjects created in addSceneObjectToGPUInstances
+	[[nodiscard]] std::vector<VkAabbPositionsKHR> collectAABBs(const SceneObject& sceneObject)
+	{
+		return applyPrimitiveOrder(sceneObject, collectUnorderedAABBs(sceneObject));
+	}
+
+	template <typename T>
+	[[nodiscard]] static std::vector<T> applyPrimitiveOrder(const SceneObject& sceneObject,
+	                                                        std::vector<T> elements)
+	{
+		if (sceneObject.primitiveOrder.empty())
 		{
-			auto& obj = sceneObject.bezierTriangles2[i];
-			bezierTriangles2List.push_back(obj->getGeometry().getData());
+			return elements;
 		}
-		for (size_t i = 0; i < sceneObject.bezierTriangles3.size(); i++)
+
+		assert(sceneObject.primitiveOrder.size() == elements.size());
+		std::vector<T> orderedElements;
+		orderedElements.reserve(elements.size());
+		for (const uint32_t index : sceneObject.primitiveOrder)
 		{
-			auto& obj = sceneObject.bezierTriangles3[i];
-			bezierTriangles3List.push_back(obj->getGeometry().getData());
+			orderedElements.push_back(elements[index]);
 		}
-		for (size_t i = 0; i < sceneObject.bezierTriangles4.size(); i++)
+		return orderedElements;
+	}
+
+	// sorts the objects of large SceneObjects along a Morton curve and splits them into
+	// clusters of blasClusterSize objects, each cluster gets its own BLAS
+	void updateSceneObjectClusters(SceneObject& sceneObject)
+	{
+		const auto primitiveCount = static_cast<uint32_t>(sceneObject.totalElementsCount());
+		if (blasClusterSize > 0 && primitiveCount > blasClusterSize)
 		{
-			auto& obj = sceneObject.bezierTriangles4[i];
-			bezierTriangles4List.push_back(obj->getGeometry().getData());
+			sceneObject.primitiveOrder = computeMortonOrder(collectUnorderedAABBs(sceneObject));
+			sceneObject.clusters = createClusters(primitiveCount, blasClusterSize);
 		}
-
-		for (size_t i = 0; i < sceneObject.rectangularBezierSurfaces2x2.size(); i++)
+		else
 		{
-			auto& obj = sceneObject.rectangularBezierSurfaces2x2[i];
-			rectangularSurfaces2x2List.push_back(obj->getGeometry().getData());
+			sceneObject.primitiveOrder.clear();
+			sceneObject.clusters = createClusters(primitiveCount, 0);
 		}
 	}
 
-	void copyAABBsToBuffer(RaytracingObjectAABBBuffers& aabbBuffers, const SceneObject& sceneObject)
+	[[nodiscard]] static size_t getClusteredPrimitiveCount(const SceneObject& sceneObject)
 	{
-		// extract and copy AABBs to buffers
-		extractAndCopyAABBsToBuffer(sceneObject.spheres,
-		                            aabbBuffers.spheresAABBBufferHandles,
-		                            aabbBuffers.spheresAABBBufferAllocations,
-		                            aabbsSpheres);
-
-		// std::vector<Tetrahedron2> tetrahedrons2List
-		//     = extractAndCopyAABBsToBuffer(tetrahedrons2,
-		//                                   aabbBuffers.tetrahedronsAABBBufferHandles,
-		//                                   aabbBuffers.tetrahedronsAABBBufferAllocations,
-		//                                   aabbsTetrahedrons);
+		return sceneObject.clusters.empty() ? 0
+		                                    : sceneObject.clusters.back().primitiveOffset
+		                                          + sceneObject.clusters.back().primitiveCount;
+	}
 
-		extractAndCopyAABBsToBuffer(sceneObject.bezierTriangles2,
-		                            aabbBuffers.bezierTriangles2AABBBufferHandles,
-		                            aabbBuffers.bezierTriangles2AABBBufferAllocations,
-		                            aabbsBezierTriangles2);
+	// @param refittable the buffer of a dynamic BLAS, the refits copy the moved AABBs into it
+	[[nodiscard]] RaytracingObjectAABBBuffer
+	copyAABBsToBuffer(const std::vector<VkAabbPositionsKHR>& aabbPositions,
+	                  const bool refittable = false)
+	{
+		RaytracingObjectAABBBuffer aabbBuffer{};
+		aabbBuffer.primitiveCount = static_cast<uint32_t>(aabbPositions.size());
 
-		extractAndCopyAABBsToBuffer(sceneObject.bezierTriangles3,
-		                            aabbBuffers.bezierTriangles3AABBBufferHandles,
-		                            aabbBuffers.bezierTriangles3AABBBufferAllocations,
-		                            aabbsBezierTriangles3);
+		if (aabbPositions.size() > 0)
+		{
+			VkBufferUsageFlags usage
+			    = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR
+			      | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+			if (refittable)
+			{
+				usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			}
 
-		extractAndCopyAABBsToBuffer(sceneObject.bezierTriangles4,
-		                            aabbBuffers.bezierTriangles4AABBBufferHandles,
-		                            aabbBuffers.bezierTriangles4AABBBufferAllocations,
-		                            aabbsBezierTriangles4);
+			void* mappedData = createMappedBuffer(
+			    physicalDevice,
+			    logicalDevice,
+			    vmaAllocator,
+			    deletionQueueForAccelerationStructure,
+			    AllocationCategory::AABBInput,
+			    sizeof(VkAabbPositionsKHR) * aabbPositions.size(),
+			    usage,
+			    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			    memoryAllocateFlagsInfo,
+			    aabbBuffer.bufferHandle,
+			    aabbBuffer.bufferAllocation);
+			aabbBuffer.aabbs = MappedBufferView<VkAabbPositionsKHR>(
+			    vmaAllocator, aabbBuffer.bufferAllocation, mappedData, aabbPositions.size());
+
+			aabbBuffer.aabbs.write(0, aabbPositions.data(), aabbPositions.size());
+			aabbBuffer.aabbs.flush();
+		}
+		return aabbBuffer;
+	}
 
-		extractAndCopyAABBsToBuffer(
-		    sceneObject.rectangularBezierSurfaces2x2,
-		    aabbBuffers.rectangularBezierSurfacesAABB2x2BufferHandles,
-		    aabbBuffers.rectangularBezierSurfacesAABB2x2AABBBufferAllocations,
-		    aabbsRectangularSurfaces2x2);
+	// for each object add an entry to the gpuObjects vector, the order matches the packed
+	// AABB buffer so gl_PrimitiveID can be used as offset into the gpuObjects
+	void addSceneObjectToGPUInstances(const SceneObject& sceneObject)
+	{
+		std::vector<GPUInstance> sceneObjectGPUObjects;
+		sceneObjectGPUObjects.reserve(sceneObject.totalElementsCount());
+
+		addObjectsToGPUObjectsList(sceneObjectGPUObjects, spheres, sceneObject.spheres);
+		addObjectsToGPUObjectsList(sceneObjectGPUObjects, bezierPatches, sceneObject.bezierPatches);
+		addObjectsToGPUObjectsList(sceneObjectGPUObjects,
+		                           rectangularBezierSurfaces2x2,
+		                           sceneObject.rectangularBezierSurfaces2x2);
+
+		sceneObjectGPUObjects = applyPrimitiveOrder(sceneObject, std::move(sceneObjectGPUObjects));
+		gpuObjects.insert(
+		    gpuObjects.end(), sceneObjectGPUObjects.begin(), sceneObjectGPUObjects.end());
 	}
 
 	[[nodiscard]] const std::vector<BLASBuildData>
-	createBLASBuildDataForSceneObject(RaytracingObjectAABBBuffers aabbBuffers,
-	                                  const SceneObject& sceneObject)
+	createBLASBuildDataForSceneObject(const RaytracingObjectAABBBuffer& aabbBuffer)
 	{
 		std::vector<BLASBuildData> blasBuildDataList;
 
-		// for each object add the extracted object data to the gpuObjects vector and create the
-		// buildData in blasBuildDataList
-		addObjectsToBLASBuildDataListAndGPUObjectsList(sceneObject.spheresBufferOffset,
-		                                               blasBuildDataList,
-		                                               sceneObject.spheres,
-		                                               aabbBuffers.spheresAABBBufferHandles);
-
-		// addObjectsToBLASBuildDataListAndGPUObjectsList(blasBuildDataList,
-		//                                                tetrahedrons2,
-		//                                                ObjectType::t_Tetrahedron2,
-		//                                                tetrahedrons2List,
-		//                                                aabbBuffers.tetrahedronsAABBBufferHandles);
-
-		addObjectsToBLASBuildDataListAndGPUObjectsList(
-		    sceneObject.bezierTriangles2BufferOffset,
-		    blasBuildDataList,
-		    sceneObject.bezierTriangles2,
-		    aabbBuffers.bezierTriangles2AABBBufferHandles);
-
-		addObjectsToBLASBuildDataListAndGPUObjectsList(
-		    sceneObject.bezierTriangles3BufferOffset,
-		    blasBuildDataList,
-		    sceneObject.bezierTriangles3,
-		    aabbBuffers.bezierTriangles3AABBBufferHandles);
-
-		addObjectsToBLASBuildDataListAndGPUObjectsList(
-		    sceneObject.bezierTriangles4BufferOffset,
-		    blasBuildDataList,
-		    sceneObject.bezierTriangles4,
-		    aabbBuffers.bezierTriangles4AABBBufferHandles);
-
-		addObjectsToBLASBuildDataListAndGPUObjectsList(
-		    sceneObject.rectangularBezierSurfaces2x2BufferOffset,
-		    blasBuildDataList,
-		    sceneObject.rectangularBezierSurfaces2x2,
-		    aabbBuffers.rectangularBezierSurfacesAABB2x2BufferHandles);
-
-		// for (auto&& obj : meshObjects)
-		// {
-		// 	loadAndCreateVertexAndIndexBufferForModel(
-		// 	    logicalDevice, physicalDevice, deletionQueue, obj);
-
-		// 	// =========================================================================
-		// 	// Bottom Level Acceleration Structure
-		// 	BLASInstance triangleBLAS = createBottomLevelAccelerationStructureTriangle(
-		// 	    obj.primitiveCount,
-		// 	    static_cast<uint32_t>(obj.vertices.size()),
-		// 	    obj.vertexBufferDeviceAddress,
-		// 	    obj.indexBufferDeviceAddress,
-		// 	    obj.getTransform().getTransformMatrix());
-		// 	blasInstancesData.push_back(triangleBLAS);
-		// }
+		// one geometry holding all AABBs of the SceneObject
+		if (aabbBuffer.primitiveCount > 0)
+		{
+			blasBuildDataList.push_back(createBottomLevelAccelerationStructureBuildDataAABB(
+			    logicalDevice, aabbBuffer.bufferHandle, aabbBuffer.primitiveCount));
+		}
 
 		return blasBuildDataList;
 	}
 
 	void copyGPUInstancesToBuffer([[maybe_unused]] const bool isFullRebuild)
 	{
-		size_t instancesCount = spheresList.size() /*+ tetrahedrons2List.size()*/
-		                        + bezierTriangles2List.size() + bezierTriangles3List.size()
-		                        + bezierTriangles4List.size() + rectangularSurfaces2x2List.size();
+		size_t instancesCount = getObjectCount();
 
 		// NOTE: chaning the amount of objects only allowed when we do a full rebuild
 		// also this function only needs to be called when doing a full rebuild
@@ -956,32 +1226,14 @@ class RaytracingScene
 		              "not yetsceneObject. "
 		              "supported!"));
 
-		// TODO: the size of the elements does not change as of now, we need to  implement
-		// recreation/resizing of the buffer otherwise
-		assert(gpuObjectsBufferHandle == VK_NULL_HANDLE && "GPU buffer already created");
-
-		if (instancesCount > 0)
-		{
-			createBuffer(physicalDevice,
-			             logicalDevice,
-			             vmaAllocator,
-			             deletionQueueForAccelerationStructure,
-			             sizeof(GPUInstance) * instancesCount,
-			             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-			             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			             memoryAllocateFlagsInfo,
-			             gpuObjectsBufferHandle,
-			             gpuObjectsBufferAllocation);
-		}
+		// reuses the buffer of the previous scene if the objects still fit
+		storageBufferPool.reserve(SceneStorageBuffer::GPUObjects,
+		                          sizeof(GPUInstance) * instancesCount,
+		                          retiredResources);
 
 		// update buffer data
-		if (instancesCount > 0)
-		{
-			copyDataToBuffer(vmaAllocator,
-			                 gpuObjectsBufferAllocation,
-			                 gpuObjects.data(),
-			                 sizeof(GPUInstance) * instancesCount);
-		}
+		writeStorageBuffer(
+		    SceneStorageBuffer::GPUObjects, gpuObjects.data(), sizeof(GPUInstance) * instancesCount);
 	}
 
 	// const std::vector<TLASInstance> collectAllTLASInstances()
@@ -1009,58 +1261,405 @@ class RaytracingScene
 	// 	return instances;
 	// }
 
-	[[nodiscard]] const VkAccelerationStructureInstanceKHR buildBLASInstancesFromBuildDataList(
-	    const BLASSceneObjectBuildData& BLASBuildData,
-	    const VkCommandBuffer bottomLevelCommandBuffer,
-	    const VkQueue graphicsQueue,
-	    const VkFence accelerationStructureBuildFence,
-	    const VkDeviceSize minAccelerationStructureScratchOffsetAlignment)
-	{
-		//  build the BLAS on GPI
-		VkAccelerationStructureKHR bottomLevelAccelerationStructure
-		    = buildBottomLevelAccelerationStructure(physicalDevice,
-		                                            logicalDevice,
-		                                            vmaAllocator,
-		                                            deletionQueueForAccelerationStructure,
-		                                            bottomLevelCommandBuffer,
-		                                            graphicsQueue,
-		                                            BLASBuildData,
-		                                            accelerationStructureBuildFence,
-		                                            minAccelerationStructureScratchOffsetAlignment);
-
-		// retrieve the device address of the built acceleration structure
-		VkAccelerationStructureDeviceAddressInfoKHR
-		    bottomLevelAccelerationStructureDeviceAddressInfo
-		    = {
-		        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
-		        .pNext = NULL,
-		        .accelerationStructure = bottomLevelAccelerationStructure,
-		    };
-
-		VkDeviceAddress bottomLevelAccelerationStructureDeviceAddress
-		    = tracer::procedures::pvkGetAccelerationStructureDeviceAddressKHR(
-		        logicalDevice, &bottomLevelAccelerationStructureDeviceAddressInfo);
-
-		// create the blas instance
-		auto bottomLevelGeometryInstance = VkAccelerationStructureInstanceKHR{
-		    .transform = BLASBuildData.transformMatrix,
-		    // TODO: maybe add a method that makes sure objectType does not exceed 24 bits
-		    // see:
-		    // https://registry.khronos.org/vulkan/specs/latest/man/html/InstanceCustomIndexKHR.html
-		    // only grab 24 bits
-		    .instanceCustomIndex
-		    = static_cast<uint32_t>(BLASBuildData.instanceCustomIndex) & 0xFFFFFF,
-		    .mask = 0xFF,
-		    .instanceShaderBindingTableRecordOffset = 0,
-		    .flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR,
-		    .accelerationStructureReference = bottomLevelAccelerationStructureDeviceAddress,
+	// builds the BLAS's of all clusters of all SceneObjects and adds an instance for each of them
+	// to blasInstances (in the same order as the sceneObjects and their clusters). BLAS's with the
+	// same AABBs as an earlier build are taken from the blasCache, the remaining ones are built in
+	// one batch
+	void buildBLASInstances(const VkCommandBuffer bottomLevelCommandBuffer,
+	                        const VkQueue graphicsQueue,
+	                        const VkFence accelerationStructureBuildFence,
+	                        const VkDeviceSize minAccelerationStructureScratchOffsetAlignment)
+	{
+		blasCache.beginGeneration();
+		blasBuildTelemetry.policies = {};
+		blasBuildTelemetry.totalBuildTimeMs = 0.0;
+
+		// one entry per cluster, first: index into sceneObjects, second: the cluster
+		std::vector<std::pair<size_t, BLASCluster>> blasClusters;
+		for (size_t i = 0; i < sceneObjects.size(); i++)
+		{
+			for (const auto& cluster : sceneObjects[i]->clusters)
+			{
+				blasClusters.emplace_back(i, cluster);
+			}
+		}
+
+		std::vector<BLASBuildResult> clusterBLAS(blasClusters.size());
+
+		// the BLAS's that are not cached yet, clusters with the same AABBs share one build
+		std::vector<BLASSceneObjectBuildData> blasBuildDataList;
+		std::vector<std::vector<VkAabbPositionsKHR>> blasBuildAABBs;
+		std::vector<uint64_t> blasBuildKeys;
+		// first: index into blasClusters, second: index into blasBuildDataList
+		std::vector<std::pair<size_t, size_t>> pendingClusters;
+
+		// dynamic SceneObjects always get their own BLAS and AABB buffer since they are refitted
+		// later on, first: index into blasClusters, second: AABB buffer
+		std::vector<std::pair<size_t, RaytracingObjectAABBBuffer>> dynamicClusters;
+		std::vector<VkBuildAccelerationStructureFlagsKHR> blasBuildFlags;
+		std::vector<bool> blasBuildIsDynamic;
+
+		size_t aabbSceneObjectIndex = sceneObjects.size();
+		std::vector<VkAabbPositionsKHR> sceneObjectAABBs;
+		for (size_t clusterIndex = 0; clusterIndex < blasClusters.size(); clusterIndex++)
+		{
+			const auto& [sceneObjectIndex, cluster] = blasClusters[clusterIndex];
+			const auto& sceneObject = sceneObjects[sceneObjectIndex];
+
+			// the clusters of a SceneObject are consecutive, only collect its AABBs once
+			if (aabbSceneObjectIndex != sceneObjectIndex)
+			{
+				sceneObjectAABBs = collectAABBs(*sceneObject);
+				aabbSceneObjectIndex = sceneObjectIndex;
+			}
+
+			std::vector<VkAabbPositionsKHR> aabbPositions(
+			    sceneObjectAABBs.begin() + cluster.primitiveOffset,
+			    sceneObjectAABBs.begin() + cluster.primitiveOffset + cluster.primitiveCount);
+
+			const uint32_t instanceCustomIndex = static_cast<uint32_t>(
+			    sceneObject->instanceCustomIndex + cluster.primitiveOffset);
+
+			const BLASBuildPolicy buildPolicy = sceneObject->buildPolicy;
+			const VkBuildAccelerationStructureFlagsKHR buildFlags
+			    = getBLASBuildFlags(buildPolicy, compactAccelerationStructures);
+
+			if (isBLASRefittable(buildPolicy))
+			{
+				const RaytracingObjectAABBBuffer aabbBuffer
+				    = copyAABBsToBuffer(aabbPositions, true);
+
+				pendingClusters.emplace_back(clusterIndex, blasBuildDataList.size());
+				dynamicClusters.emplace_back(clusterIndex, aabbBuffer);
+				blasBuildDataList.push_back(BLASSceneObjectBuildData{
+				    .blasData = createBLASBuildDataForSceneObject(aabbBuffer),
+				    .transformMatrix = sceneObject->transformMatrix,
+				    .instanceCustomIndex = instanceCustomIndex,
+				    .buildPolicy = buildPolicy,
+				});
+				blasBuildAABBs.emplace_back();
+				blasBuildKeys.push_back(0);
+				blasBuildFlags.push_back(buildFlags);
+				blasBuildIsDynamic.push_back(true);
+				continue;
+			}
+
+			const uint64_t key = BLASCache::computeKey(aabbPositions, buildFlags);
+
+			const auto cachedBLAS = blasCache.find(key, aabbPositions, buildFlags);
+			if (cachedBLAS.has_value())
+			{
+				clusterBLAS[clusterIndex] = cachedBLAS.value();
+				blasBuildTelemetry[buildPolicy].cachedCount++;
+				continue;
+			}
+
+			bool alreadyPending = false;
+			for (size_t buildIndex = 0; buildIndex < blasBuildKeys.size(); buildIndex++)
+			{
+				if (!blasBuildIsDynamic[buildIndex] && blasBuildKeys[buildIndex] == key
+				    && blasBuildFlags[buildIndex] == buildFlags
+				    && BLASCache::isSameAABBs(blasBuildAABBs[buildIndex], aabbPositions))
+				{
+					pendingClusters.emplace_back(clusterIndex, buildIndex);
+					alreadyPending = true;
+					break;
+				}
+			}
+
+			if (alreadyPending)
+			{
+				continue;
+			}
+
+			// the objects that are rendered using ray tracing (with an intersection shader)
+			const RaytracingObjectAABBBuffer aabbBuffer = copyAABBsToBuffer(aabbPositions);
+
+			pendingClusters.emplace_back(clusterIndex, blasBuildDataList.size());
+			blasBuildDataList.push_back(BLASSceneObjectBuildData{
+			    .blasData = createBLASBuildDataForSceneObject(aabbBuffer),
+			    .transformMatrix = sceneObject->transformMatrix,
+			    .instanceCustomIndex = instanceCustomIndex,
+			    .buildPolicy = buildPolicy,
+			});
+			blasBuildAABBs.push_back(std::move(aabbPositions));
+			blasBuildKeys.push_back(key);
+			blasBuildFlags.push_back(buildFlags);
+			blasBuildIsDynamic.push_back(false);
+		}
+
+		//  build the missing BLAS's on GPU
+		std::vector<DeletionQueue> blasDeletionQueues;
+		const std::vector<BLASBuildResult> buildResults
+		    = buildBottomLevelAccelerationStructures(physicalDevice,
+		                                             logicalDevice,
+		                                             vmaAllocator,
+		                                             blasDeletionQueues,
+		                                             bottomLevelCommandBuffer,
+		                                             graphicsQueue,
+		                                             blasBuildDataList,
+		                                             accelerationStructureBuildFence,
+		                                             minAccelerationStructureScratchOffsetAlignment,
+		                                             compactAccelerationStructures,
+		                                             blasBuildTelemetry);
+
+		for (const auto& [clusterIndex, buildIndex] : pendingClusters)
+		{
+			clusterBLAS[clusterIndex] = buildResults[buildIndex];
+		}
+
+		for (const auto& [clusterIndex, aabbBuffer] : dynamicClusters)
+		{
+			const auto& sceneObject = sceneObjects[blasClusters[clusterIndex].first];
+			addDynamicBLAS(
+			    sceneObject,
+			    blasClusters[clusterIndex].second,
+			    aabbBuffer,
+			    clusterBLAS[clusterIndex],
+			    getBLASBuildFlags(sceneObject->buildPolicy, compactAccelerationStructures),
+			    minAccelerationStructureScratchOffsetAlignment);
+		}
+
+		// the cache takes ownership of the new static BLAS's, the dynamic ones live until the next
+		// full rebuild
+		for (size_t buildIndex = 0; buildIndex < buildResults.size(); buildIndex++)
+		{
+			if (blasBuildIsDynamic[buildIndex])
+			{
+				deletionQueueForAccelerationStructure.append(
+				    std::move(blasDeletionQueues[buildIndex]));
+				continue;
+			}
+
+			blasCache.insert(blasBuildKeys[buildIndex],
+			                 std::move(blasBuildAABBs[buildIndex]),
+			                 blasBuildFlags[buildIndex],
+			                 buildResults[buildIndex],
+			                 std::move(blasDeletionQueues[buildIndex]));
+		}
+
+		debug_printFmt("BLASCache - %zu hits, %zu misses, %zu BLAS's built for %zu clusters\n",
+		               blasCache.getHits(),
+		               blasCache.getMisses(),
+		               buildResults.size(),
+		               blasClusters.size());
+
+		// BLAS's not used by this scene can be evicted, they are retired together with the
+		// previous TLAS
+		blasCache.evict(retiredResources);
+
+		for (const auto& sceneObject : sceneObjects)
+		{
+			sceneObject->blasSize = 0;
+			sceneObject->blasCompactedSize = 0;
+		}
+
+		// retrieve the device addresses of the built acceleration structures
+		std::vector<VkDeviceAddress> clusterBLASDeviceAddresses(blasClusters.size());
+		for (size_t clusterIndex = 0; clusterIndex < blasClusters.size(); clusterIndex++)
+		{
+			const auto& sceneObject = sceneObjects[blasClusters[clusterIndex].first];
+
+			// store the memory usage so it can be displayed in the UI
+			sceneObject->blasSize += clusterBLAS[clusterIndex].originalSize;
+			sceneObject->blasCompactedSize += clusterBLAS[clusterIndex].compactedSize;
+
+			VkAccelerationStructureDeviceAddressInfoKHR
+			    bottomLevelAccelerationStructureDeviceAddressInfo
+			    = {
+			        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
+			        .pNext = NULL,
+			        .accelerationStructure = clusterBLAS[clusterIndex].handle,
+			    };
+
+			clusterBLASDeviceAddresses[clusterIndex]
+			    = tracer::procedures::pvkGetAccelerationStructureDeviceAddressKHR(
+			        logicalDevice, &bottomLevelAccelerationStructureDeviceAddressInfo);
+		}
+
+		// the clusters of a SceneObject are consecutive inside blasClusters, every instance of the
+		// SceneObject gets a TLAS instance per cluster referencing the same BLAS's
+		size_t firstClusterIndex = 0;
+		for (const auto& sceneObject : sceneObjects)
+		{
+			const size_t clusterCount = sceneObject->clusters.size();
+			sceneObject->blasInstanceOffset = blasInstances.size();
+
+			for (size_t instanceIndex = 0; instanceIndex < sceneObject->instanceCount();
+			     instanceIndex++)
+			{
+				for (size_t clusterIndex = firstClusterIndex;
+				     clusterIndex < firstClusterIndex + clusterCount;
+				     clusterIndex++)
+				{
+					const BLASCluster& cluster = blasClusters[clusterIndex].second;
+
+					// create the blas instance, the custom index points to the first gpuObject of
+					// the cluster so gl_InstanceCustomIndexEXT + gl_PrimitiveID stays valid. The
+					// add functions reject objects whose index exceeds the 24 bits
+					const size_t instanceCustomIndex
+					    = static_cast<size_t>(sceneObject->instanceCustomIndex)
+					      + cluster.primitiveOffset;
+					assert(instanceCustomIndex <= MAX_INSTANCE_CUSTOM_INDEX);
+
+					blasInstances.push_back(VkAccelerationStructureInstanceKHR{
+					    .transform = sceneObject->getInstanceTransform(instanceIndex),
+					    .instanceCustomIndex = static_cast<uint32_t>(instanceCustomIndex),
+					    .mask = static_cast<uint32_t>(sceneObject->instanceMask) & 0xFF,
+					    .instanceShaderBindingTableRecordOffset = 0,
+					    .flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR,
+					    .accelerationStructureReference = clusterBLASDeviceAddresses[clusterIndex],
+					});
+				}
+			}
+			firstClusterIndex += clusterCount;
+		}
+	}
+
+	// creates the scratch buffer used to refit/rebuild the BLAS of the dynamic SceneObject
+	void addDynamicBLAS(const std::shared_ptr<SceneObject>& sceneObject,
+	                    const BLASCluster& cluster,
+	                    const RaytracingObjectAABBBuffer& aabbBuffer,
+	                    const BLASBuildResult& buildResult,
+	                    const VkBuildAccelerationStructureFlagsKHR buildFlags,
+	                    const VkDeviceSize minAccelerationStructureScratchOffsetAlignment)
+	{
+		VkBuffer scratchBufferHandle = VK_NULL_HANDLE;
+		VmaAllocation scratchBufferAllocation = VK_NULL_HANDLE;
+		createBuffer(physicalDevice,
+		             logicalDevice,
+		             vmaAllocator,
+		             deletionQueueForAccelerationStructure,
+		             AllocationCategory::Scratch,
+		             std::max(buildResult.buildScratchSize, buildResult.updateScratchSize),
+		             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		             memoryAllocateFlagsInfo,
+		             scratchBufferHandle,
+		             scratchBufferAllocation,
+		             minAccelerationStructureScratchOffsetAlignment);
+
+		VkBufferDeviceAddressInfo scratchBufferDeviceAddressInfo = {
+		    .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+		    .pNext = NULL,
+		    .buffer = scratchBufferHandle,
 		};
-		return bottomLevelGeometryInstance;
+
+		const BLASBuildData buildData = createBottomLevelAccelerationStructureBuildDataAABB(
+		    logicalDevice, aabbBuffer.bufferHandle, aabbBuffer.primitiveCount);
+
+		dynamicBLASs.push_back(DynamicBLAS{
+		    .sceneObject = sceneObject,
+		    .aabbBuffer = aabbBuffer,
+		    .geometry = buildData.geometry,
+		    .buildRangeInfo = buildData.buildRangeInfo,
+		    .cluster = cluster,
+		    .handle = buildResult.handle,
+		    .buildFlags = buildFlags,
+		    .scratchBufferDeviceAddress = tracer::procedures::pvkGetBufferDeviceAddressKHR(
+		        logicalDevice, &scratchBufferDeviceAddressInfo),
+		    .refitCount = 0,
+		    .refitPending = false,
+		});
+	}
+
+	// collects the current AABBs of the dynamic SceneObjects for the clusters and marks them for a
+	// refit, they are written into the AABB buffers by recordDynamicBLASRefits()
+	// @return false if the primitive count of a dynamic SceneObject changed, its BLAS's can't be
+	// refitted then
+	[[nodiscard]] bool updateDynamicBLASAABBs()
+	{
+		const SceneObject* aabbSceneObject = nullptr;
+		std::vector<VkAabbPositionsKHR> aabbPositions;
+		for (auto& dynamicBLAS : dynamicBLASs)
+		{
+			// the clusters of a SceneObject are consecutive, only collect its AABBs once
+			if (aabbSceneObject != dynamicBLAS.sceneObject.get())
+			{
+				aabbSceneObject = dynamicBLAS.sceneObject.get();
+				if (aabbSceneObject->totalElementsCount()
+				    != getClusteredPrimitiveCount(*aabbSceneObject))
+				{
+					return false;
+				}
+				aabbPositions = collectAABBs(*aabbSceneObject);
+			}
+
+			const auto clusterBegin
+			    = aabbPositions.begin()
+			      + static_cast<std::ptrdiff_t>(dynamicBLAS.cluster.primitiveOffset);
+			dynamicBLAS.pendingAabbs.assign(
+			    clusterBegin,
+			    clusterBegin + static_cast<std::ptrdiff_t>(dynamicBLAS.cluster.primitiveCount));
+			dynamicBLAS.refitPending = true;
+		}
+		return true;
+	}
+
+	void recordDynamicBLASRefits(VkCommandBuffer commandBuffer)
+	{
+		bool anyRefitPending = false;
+		for (const auto& dynamicBLAS : dynamicBLASs)
+		{
+			anyRefitPending = anyRefitPending || dynamicBLAS.refitPending;
+		}
+
+		if (!anyRefitPending)
+		{
+			return;
+		}
+
+		std::vector<VkBuffer> aabbBuffers;
+		for (const auto& dynamicBLAS : dynamicBLASs)
+		{
+			if (dynamicBLAS.refitPending && !dynamicBLAS.pendingAabbs.empty())
+			{
+				aabbBuffers.push_back(dynamicBLAS.aabbBuffer.bufferHandle);
+			}
+		}
+
+		// the refits of the previous frames might still read the AABB buffers
+		recordStorageBuffersBarrier(commandBuffer,
+		                            aabbBuffers,
+		                            VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+		                            VK_ACCESS_2_SHADER_READ_BIT,
+		                            VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		                            VK_ACCESS_2_TRANSFER_WRITE_BIT);
+		for (auto& dynamicBLAS : dynamicBLASs)
+		{
+			if (dynamicBLAS.refitPending && !dynamicBLAS.pendingAabbs.empty())
+			{
+				recordBufferUpdate(commandBuffer,
+				                   dynamicBLAS.aabbBuffer.bufferHandle,
+				                   0,
+				                   sizeof(VkAabbPositionsKHR) * dynamicBLAS.pendingAabbs.size(),
+				                   dynamicBLAS.pendingAabbs.data());
+				dynamicBLAS.pendingAabbs.clear();
+			}
+		}
+		recordStorageBuffersBarrier(commandBuffer,
+		                            aabbBuffers,
+		                            VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		                            VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		                            VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+		                            VK_ACCESS_2_SHADER_READ_BIT);
+
+		recordAccelerationStructureWriteAfterReadBarrier(commandBuffer);
+		for (auto& dynamicBLAS : dynamicBLASs)
+		{
+			if (dynamicBLAS.refitPending)
+			{
+				recordBottomLevelAccelerationStructureRefit(
+				    commandBuffer, dynamicBLAS, maxBLASRefits);
+			}
+		}
+		recordAccelerationStructureBarrier(commandBuffer);
+
+		// the bounds of the instances changed
+		tlasUpdatePending = true;
 	}
 
 	void createTLAS(
-	    const bool onlyUpdate,
-	    VmaAllocation& blasGeometryInstancesDeviceMemoryHandle,
 	    VkAccelerationStructureGeometryKHR& topLevelAccelerationStructureGeometry,
 	    VkAccelerationStructureBuildGeometryInfoKHR& topLevelAccelerationStructureBuildGeometryInfo,
 	    VkAccelerationStructureKHR& topLevelAccelerationStructureHandle,
@@ -1072,8 +1671,10 @@ class RaytracingScene
 	    VkAccelerationStructureBuildRangeInfoKHR& topLevelAccelerationStructureBuildRangeInfo,
 	    VkCommandBuffer commandBufferBuildTopAndBottomLevel,
 	    VkQueue graphicsQueueHandle,
+	    VkFence accelerationStructureBuildFence,
 	    VkBuffer& uniformBufferHandle,
 	    VmaAllocation& uniformBufferAllocation,
+	    MappedBufferView<UniformStructure>& uniformBufferView,
 	    UniformStructure& uniformStructure,
 	    VkDeviceSize minAccelerationStructureScratchOffsetAlignment)
 	{
@@ -1085,8 +1686,7 @@ class RaytracingScene
 			    logicalDevice,
 			    physicalDevice,
 			    vmaAllocator,
-			    onlyUpdate,
-			    blasGeometryInstancesDeviceMemoryHandle,
+			    tlasInstanceBuffers,
 			    topLevelAccelerationStructureGeometry,
 			    topLevelAccelerationStructureBuildGeometryInfo,
 			    topLevelAccelerationStructureHandle,
@@ -1098,69 +1698,279 @@ class RaytracingScene
 			    topLevelAccelerationStructureBuildRangeInfo,
 			    commandBufferBuildTopAndBottomLevel,
 			    graphicsQueueHandle,
+			    accelerationStructureBuildFence,
 			    minAccelerationStructureScratchOffsetAlignment);
 			// =========================================================================
 			// Uniform Buffer
-			if (!onlyUpdate)
+			void* mappedData = createMappedBuffer(physicalDevice,
+			                                      logicalDevice,
+			                                      vmaAllocator,
+			                                      deletionQueueForAccelerationStructure,
+			                                      AllocationCategory::Uniform,
+			                                      sizeof(UniformStructure),
+			                                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			                                      memoryAllocateFlagsInfo,
+			                                      uniformBufferHandle,
+			                                      uniformBufferAllocation);
+			uniformBufferView = MappedBufferView<UniformStructure>(
+			    vmaAllocator, uniformBufferAllocation, mappedData, 1);
+
+			uniformBufferView.write(0, uniformStructure);
+			uniformBufferView.flush();
+		}
+	}
+
+  private:
+	/**
+	 * @brief Recomputes the world matrices of the transform hierarchy and stores them in the
+	 * SceneObjects of the attached instances, so the next full rebuild uses them as well.
+	 *
+	 * @param updateTLASInstances whether the TLAS instances are written too, they are only valid
+	 * once the TLAS of the current scene was built
+	 */
+	void applyTransformHierarchy(const bool updateTLASInstances)
+	{
+		if (transformBindings.empty() || !transformHierarchy.update())
+		{
+			return;
+		}
+
+		for (const auto& binding : transformBindings)
+		{
+			if (!transformHierarchy.wasChanged(binding.node))
+			{
+				continue;
+			}
+
+			const VkTransformMatrixKHR matrix
+			    = Transform::toTransformMatrixKHR(transformHierarchy.getWorldMatrix(binding.node));
+			if (binding.instanceIndex == 0)
+			{
+				binding.sceneObject->setTransformMatrix(matrix);
+			}
+			else
+			{
+				binding.sceneObject->instanceTransforms[binding.instanceIndex - 1] = matrix;
+			}
+
+			if (updateTLASInstances)
 			{
-				createBuffer(physicalDevice,
-				             logicalDevice,
-				             vmaAllocator,
-				             deletionQueueForAccelerationStructure,
-				             sizeof(UniformStructure),
-				             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-				             memoryAllocateFlagsInfo,
-				             uniformBufferHandle,
-				             uniformBufferAllocation);
-
-				copyDataToBuffer(vmaAllocator,
-				                 uniformBufferAllocation,
-				                 &uniformStructure,
-				                 sizeof(UniformStructure));
+				setTransformMatrixForInstance(*binding.sceneObject, binding.instanceIndex, matrix);
 			}
 		}
 	}
 
-  private:
+	// writes the dirty objects of the requested SceneObjects into the storage buffers, only the
+	// changed ranges are uploaded (e.g. a single moved sphere)
+	void recordDirtyObjectsUploads(VkCommandBuffer commandBuffer)
+	{
+		dirtyRanges.clear();
+		dirtyRangesData.clear();
+		for (const auto& sceneObject : pendingDirtyObjectsUploads)
+		{
+			collectDirtyRanges(SceneStorageBuffer::Spheres, spheres, sceneObject->spheres);
+			collectDirtyRanges(
+			    SceneStorageBuffer::BezierPatches, bezierPatches, sceneObject->bezierPatches);
+			collectDirtyRanges(SceneStorageBuffer::RectangularBezierSurfaces2x2,
+			                   rectangularBezierSurfaces2x2,
+			                   sceneObject->rectangularBezierSurfaces2x2);
+		}
+
+		if (dirtyRanges.empty())
+		{
+			return;
+		}
+
+		std::vector<VkBuffer> dstBuffers;
+		for (const auto& range : dirtyRanges)
+		{
+			const VkBuffer dstBuffer = getStorageBufferHandle(range.type);
+			if (std::find(dstBuffers.begin(), dstBuffers.end(), dstBuffer) == dstBuffers.end())
+			{
+				dstBuffers.push_back(dstBuffer);
+			}
+		}
+
+		// previous frames might still read the buffers
+		recordStorageBuffersBarrier(commandBuffer,
+		                            dstBuffers,
+		                            VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+		                            VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+		                            VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		                            VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+		for (const auto& range : dirtyRanges)
+		{
+			recordBufferUpdate(commandBuffer,
+			                   getStorageBufferHandle(range.type),
+			                   range.dstOffset,
+			                   range.size,
+			                   dirtyRangesData.data() + range.dataOffset);
+		}
+
+		recordStorageBuffersBarrier(commandBuffer,
+		                            dstBuffers,
+		                            VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		                            VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		                            VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+		                            VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+	}
+
+	// appends the runs of consecutive dirty objects in range to dirtyRanges and clears their
+	// dirty flags, the pool index of an object is also its index inside the storage buffer
+	template <typename T>
+	void collectDirtyRanges(const SceneStorageBuffer type,
+	                        ObjectPool<T>& pool,
+	                        const ObjectRange range)
+	{
+		static_assert(sizeof(T) % 4 == 0, "vkCmdUpdateBuffer requires a multiple of 4 bytes");
+
+		// the buffer is created with the first full rebuild, the objects are uploaded there
+		if (getStorageBufferHandle(type) == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		for (size_t i = range.offset; i < range.end(); i++)
+		{
+			if (pool.isDirty(i))
+			{
+				appendDirtyRange(type, sizeof(T) * i, &pool.getObjects()[i], sizeof(T));
+			}
+		}
+
+		// the control points of a modified patch are written as well, in a separate pass so the
+		// runs of both buffers can be merged
+		if constexpr (std::is_same_v<T, BezierPatch>)
+		{
+			for (size_t i = range.offset; i < range.end(); i++)
+			{
+				if (pool.isDirty(i))
+				{
+					const BezierPatch& patch = pool.getObjects()[i];
+					const uint32_t count = getBezierTriangleControlPointCount(patch.degree);
+					appendDirtyRange(SceneStorageBuffer::BezierControlPoints,
+					                 sizeof(glm::vec3) * patch.controlPointOffset,
+					                 &bezierControlPoints[patch.controlPointOffset],
+					                 sizeof(glm::vec3) * count);
+				}
+			}
+		}
+		pool.clearDirty(range);
+	}
+
+	// extends the last dirty range if the data directly follows it
+	void appendDirtyRange(const SceneStorageBuffer type,
+	                      const VkDeviceSize dstOffset,
+	                      const void* data,
+	                      const VkDeviceSize size)
+	{
+		const bool extendsLastRange
+		    = !dirtyRanges.empty() && dirtyRanges.back().type == type
+		      && dirtyRanges.back().dstOffset + dirtyRanges.back().size == dstOffset;
+		if (extendsLastRange)
+		{
+			dirtyRanges.back().size += size;
+		}
+		else
+		{
+			dirtyRanges.push_back({.type = type,
+			                       .dstOffset = dstOffset,
+			                       .dataOffset = dirtyRangesData.size(),
+			                       .size = size});
+		}
+
+		const auto* bytes = static_cast<const std::byte*>(data);
+		dirtyRangesData.insert(dirtyRangesData.end(), bytes, bytes + size);
+	}
+
+	// device local buffers are staged, host visible buffers are written directly unless a
+	// submitted frame might still read them, they are staged then as well
+	void writeStorageBuffer(const SceneStorageBuffer type,
+	                        const void* data,
+	                        const VkDeviceSize size)
+	{
+		const bool framesInFlight
+		    = frameTimeline != nullptr && !isFrameTimelineIdle(logicalDevice, *frameTimeline);
+		if (isDeviceLocalStorageBuffer(type) || framesInFlight)
+		{
+			stagingUploader.upload(getStorageBufferHandle(type), 0, data, size);
+		}
+		else
+		{
+			// a previously staged copy must not overwrite the data afterwards
+			stagingUploader.waitIdle();
+			storageBufferPool.write(type, data, size);
+		}
+	}
+
+	// vkCmdUpdateBuffer is limited to 65536 bytes, larger ranges are split
+	static void recordBufferUpdate(VkCommandBuffer commandBuffer,
+	                               const VkBuffer buffer,
+	                               const VkDeviceSize dstOffset,
+	                               const VkDeviceSize size,
+	                               const void* data)
+	{
+		constexpr VkDeviceSize maxUpdateSize = 65536;
+		const auto* bytes = static_cast<const std::byte*>(data);
+		for (VkDeviceSize offset = 0; offset < size; offset += maxUpdateSize)
+		{
+			vkCmdUpdateBuffer(commandBuffer,
+			                  buffer,
+			                  dstOffset + offset,
+			                  std::min(size - offset, maxUpdateSize),
+			                  bytes + offset);
+		}
+	}
+
+	void recordStorageBuffersBarrier(VkCommandBuffer commandBuffer,
+	                                 const std::vector<VkBuffer>& buffers,
+	                                 VkPipelineStageFlags2 srcStageMask,
+	                                 VkAccessFlags2 srcAccessMask,
+	                                 VkPipelineStageFlags2 dstStageMask,
+	                                 VkAccessFlags2 dstAccessMask)
+	{
+		std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+		bufferBarriers.reserve(buffers.size());
+		for (const VkBuffer buffer : buffers)
+		{
+			VkBufferMemoryBarrier2 bufferBarrier = {};
+			bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+			bufferBarrier.srcStageMask = srcStageMask;
+			bufferBarrier.srcAccessMask = srcAccessMask;
+			bufferBarrier.dstStageMask = dstStageMask;
+			bufferBarrier.dstAccessMask = dstAccessMask;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = buffer;
+			bufferBarrier.offset = 0;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(bufferBarrier);
+		}
+
+		VkDependencyInfo dependencyInfo = {};
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependencyInfo.dependencyFlags = 0;
+		dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+		dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+	}
+
 	std::vector<SlicingPlane> slicingPlanes;
 	std::vector<GPUInstance> gpuObjects;
 
-	std::vector<tracer::AABB> aabbsSpheres;
-	std::vector<tracer::AABB> aabbsTetrahedrons;
-	std::vector<tracer::AABB> aabbsBezierTriangles2;
-	std::vector<tracer::AABB> aabbsBezierTriangles3;
-	std::vector<tracer::AABB> aabbsBezierTriangles4;
-	std::vector<tracer::AABB> aabbsRectangularSurfaces2x2;
-
 	// stores the data of all objects added to the scene
 	// each SceneObject references to these objects
 	// std::vector<rt::std::shared_ptr<RaytracingWorldObject<T>>etrahedron2>> tetrahedrons2;
-	std::vector<std::shared_ptr<RaytracingWorldObject<RectangularBezierSurface2x2>>>
-	    rectangularBezierSurfaces2x2;
-	std::vector<std::shared_ptr<RaytracingWorldObject<Sphere>>> spheres;
-	std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle2>>> bezierTriangles2;
-	std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle3>>> bezierTriangles3;
-	std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle4>>> bezierTriangles4;
-
-	// TODO: does this really need to be a member variable? maybe export into some struct that
-	// holds the data temporarily and gets passed around temporarily used to collect all
-	// internal object data to write into a buffer for the GPU
-	std::vector<Sphere> spheresList;
-	std::vector<BezierTriangle2> bezierTriangles2List;
-	std::vector<BezierTriangle3> bezierTriangles3List;
-	std::vector<BezierTriangle4> bezierTriangles4List;
-	std::vector<RectangularBezierSurface2x2> rectangularSurfaces2x2List;
-
-	VmaAllocation gpuObjectsBufferAllocation = VK_NULL_HANDLE;
-	VmaAllocation slicingPlanesBufferAllocation = VK_NULL_HANDLE;
-
-	// VmaAllocation tetrahedronsBufferAllocation = VK_NULL_HANDLE;
-	VmaAllocation bezierTriangles2BufferAllocation = VK_NULL_HANDLE;
-	VmaAllocation bezierTriangles3BuffersAllocation = VK_NULL_HANDLE;
-	VmaAllocation bezierTriangles4BuffersAllocation = VK_NULL_HANDLE;
-	VmaAllocation spheresBufferAllocation = VK_NULL_HANDLE;
-	VmaAllocation rectangularBezierSurfaces2x2BufferAllocation = VK_NULL_HANDLE;
+	// all objects of the scene, the objects of a SceneObject are consecutive
+	ObjectPool<RectangularBezierSurface2x2> rectangularBezierSurfaces2x2;
+	ObjectPool<Sphere> spheres;
+	// bezier triangles of all degrees, the control points of all patches are packed into
+	// bezierControlPoints (uploaded into a single buffer, no per degree padding)
+	ObjectPool<BezierPatch> bezierPatches;
+	std::vector<glm::vec3> bezierControlPoints;
 
 	// NOTE: not used in renderer
 	// std::vector<MeshObject> meshObjects;
@@ -1180,8 +1990,65 @@ class RaytracingScene
 	VkDevice logicalDevice;
 	VmaAllocator vmaAllocator;
 	DeletionQueue deletionQueueForAccelerationStructure;
+	// storage buffers and BLAS's replaced during the current full rebuild
+	DeletionQueue retiredResources;
+	// destroys the resources of the previous full rebuilds once the frames using them are done
+	RetirementQueue retirementQueue;
+	// owned by the RaytracingInfo of the renderer, set by initStagingUploader()
+	const FrameTimeline* frameTimeline = nullptr;
+
+	// the storage buffers read by the shaders, kept alive across full rebuilds
+	StorageBufferPool storageBufferPool;
+	StagingUploader stagingUploader;
+
+	// keeps the BLAS's alive across full rebuilds, owns all BLAS's
+	BLASCache blasCache;
+
+	BLASBuildTelemetry blasBuildTelemetry{};
+
+	// one instance buffer per frame in flight, recreated on every full rebuild
+	std::vector<TLASInstanceBuffer> tlasInstanceBuffers;
+	// set when the instance transforms changed since the last TLAS build/update
+	bool tlasUpdatePending = false;
+	// set by markSceneObjectDynamic(), the BLAS's have to be rebuilt with the new build flags
+	bool buildPolicyChanged = false;
+	std::vector<std::shared_ptr<SceneObject>> pendingDirtyObjectsUploads;
+
+	// a run of consecutive dirty objects inside one of the storage buffers
+	struct DirtyRange
+	{
+		SceneStorageBuffer type;
+		VkDeviceSize dstOffset;
+		// offset of the object data inside dirtyRangesData
+		size_t dataOffset;
+		VkDeviceSize size;
+	};
+	// reused by recordDirtyObjectsUploads() to avoid allocating every frame
+	std::vector<DirtyRange> dirtyRanges;
+	std::vector<std::byte> dirtyRangesData;
+
+	// an instance of a SceneObject whose transform is driven by a node of the transformHierarchy
+	struct TransformBinding
+	{
+		std::shared_ptr<SceneObject> sceneObject;
+		size_t instanceIndex;
+		TransformNodeId node;
+	};
+	TransformHierarchy transformHierarchy;
+	std::vector<TransformBinding> transformBindings;
+
+	// BLAS's of the dynamic SceneObjects, recreated on every full rebuild
+	std::vector<DynamicBLAS> dynamicBLASs;
+	uint32_t maxBLASRefits = 16;
+
+	uint32_t blasClusterSize = DEFAULT_BLAS_CLUSTER_SIZE;
 
 	int currentSceneNr = INITIAL_SCENE;
+
+	bool compactAccelerationStructures = true;
+
+	BezierBoundsMode bezierBoundsMode = BezierBoundsMode::ControlPoints;
+	BezierBoundsTelemetry bezierBoundsTelemetry{};
 };
 
 } // namespace rt
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_RADIANS
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/ext/matrix_float4x4.hpp>
+
+#include "aabb.hpp"
+#include "common_types.h"
+#include "newton_packet.hpp"
+
+namespace tracer
+{
+namespace rt
+{
+
+// forward declaration
+class RaytracingScene;
+
+// a TLAS instance of the reference scene
+struct ReferenceInstance
+{
+	glm::mat4 objectToWorld;
+	glm::mat4 worldToObject;
+	InstanceMask mask;
+};
+
+// an object of an instance, the equivalent of an AABB inside the BLAS of a TLAS instance
+struct ReferencePrimitive
+{
+	ObjectType type;
+	// index into the spheres/bezierPatches of the ReferenceScene
+	uint32_t bufferIndex;
+	uint32_t instanceIndex;
+	// the AABB of the object transformed into world space
+	AABB bounds;
+};
+
+/**
+ * @brief The scene data the ray tracing shaders work on, without any vulkan resources. It is
+ * either taken from a RaytracingScene or filled directly, e.g. by tools that run on machines
+ * without a ray tracing GPU.
+ */
+struct ReferenceScene
+{
+	std::vector<Sphere> spheres{};
+	std::vector<BezierPatch> bezierPatches{};
+	std::vector<glm::vec3> bezierControlPoints{};
+	std::vector<ReferenceInstance> instances{};
+	std::vector<ReferencePrimitive> primitives{};
+	SlicingPlane slicingPlane{glm::vec3(0.7, 0, 0), glm::vec3(-1, 0, 0)};
+
+	// copies the objects, the instances and the slicing plane of the current scene
+	static ReferenceScene fromRaytracingScene(RaytracingScene& raytracingScene);
+
+	// @return the index of the instance
+	uint32_t addInstance(const glm::mat4& objectToWorld, const InstanceMask mask);
+
+	// @param objectSpaceAabb the AABB of the object inside the BLAS (the one the GPU traverses)
+	void addPrimitive(const ObjectType type,
+	                  const uint32_t bufferIndex,
+	                  const uint32_t instanceIndex,
+	                  const VkAabbPositionsKHR& objectSpaceAabb);
+};
+
+// render time of one tile of the reference image
+struct ReferenceTileTiming
+{
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+	size_t threadIndex;
+	double milliseconds;
+	// rays that reached the AABB of a primitive, each one is an intersection shader invocation
+	uint64_t intersectionInvocations;
+};
+
+struct ReferenceImage
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	// linear colors as written into the rgba32f image by the raygen shader, row by row
+	std::vector<glm::vec4> pixels{};
+	std::vector<ReferenceTileTiming> tileTimings{};
+	double milliseconds = 0.0;
+	uint64_t intersectionInvocations = 0;
+
+	// writes the image as binary ppm, sRGB encoded like the screenshots of the swapchain images
+	void writePPM(const std::filesystem::path& path) const;
+};
+
+/**
+ * @brief CPU ray tracer for the reference images of the ray tracing pipeline, for machines
+ * without ray tracing GPUs and to verify the shaders. Mirrors shader.rgen, shader_aabb.rint,
+ * shader.rchit and the miss shaders including the slicing plane, the shadows and the light
+ * sphere, the TLAS is replaced by a BVH over the world space AABBs of all instances.
+ *
+ * The image is split into tiles that are rendered on all cores, see parallelForTasks(). The
+ * primary rays of a tile are traced in packets of RAY_PACKET_WIDTH neighbouring pixels, the
+ * bezier patches are intersected by the SIMD kernel of getNewtonPacketKernel().
+ */
+class ReferenceRenderer
+{
+  public:
+	ReferenceRenderer(const ReferenceScene& scene,
+	                  const RaytracingDataConstants& raytracingDataConstants,
+	                  const UniformStructure& ubo);
+
+	[[nodiscard]] ReferenceImage
+	render(const uint32_t width, const uint32_t height, const uint32_t tileSize = 32) const;
+
+  private:
+	// the hit attributes of the intersection shader and the hit kind
+	struct Hit
+	{
+		float t = 0.0f;
+		uint32_t hitKind = 0;
+		uint32_t bufferIndex = 0;
+		glm::vec3 point = glm::vec3(0);
+		glm::vec2 coords = glm::vec2(0);
+		glm::vec3 normal = glm::vec3(0);
+	};
+
+	// the payload of the primary rays
+	struct Payload
+	{
+		glm::vec3 rayOrigin;
+		glm::vec3 rayDirection;
+		glm::vec3 directColor;
+		glm::vec3 indirectColor;
+		int rayDepth;
+		int rayActive;
+	};
+
+	struct BVHNode
+	{
+		AABB bounds;
+		// leaf: the primitives [first, first + count) of primitiveOrder, inner node: count is 0,
+		// the left child follows the node and first is the index of the right child
+		uint32_t first;
+		uint32_t count;
+	};
+
+	const ReferenceScene& scene;
+	const RaytracingDataConstants constants;
+	const UniformStructure ubo;
+
+	std::vector<BVHNode> bvhNodes{};
+	std::vector<uint32_t> primitiveOrder{};
+
+	uint32_t buildBVHNode(const uint32_t first, const uint32_t count);
+
+	// traceRayEXT() with gl_RayFlagsOpaqueEXT, terminateOnFirstHit for the shadow rays
+	bool traceRay(const Ray& ray,
+	              const float tMin,
+	              const float tMax,
+	              const uint32_t cullMask,
+	              const bool terminateOnFirstHit,
+	              Hit& nearestHit) const;
+
+	// traceRay() for a packet of coherent rays, the BVH nodes are visited if any of the lanes hits
+	// them. @return the lanes that hit something
+	LaneMask<RAY_PACKET_WIDTH> tracePacket(const std::array<Ray, RAY_PACKET_WIDTH>& rays,
+	                                       const LaneMask<RAY_PACKET_WIDTH> lanes,
+	                                       const float tMin,
+	                                       const float tMax,
+	                                       const uint32_t cullMask,
+	                                       std::array<Hit, RAY_PACKET_WIDTH>& nearestHits) const;
+
+	// shader_aabb.rint, @return whether a hit was reported
+	bool intersectPrimitive(const ReferencePrimitive& primitive, const Ray& ray, Hit& hit) const;
+
+	// shader_aabb.rint for a bezier patch and up to N rays, the newton iterations of all lanes run
+	// together, see newtonsMethodBezierPatchPacket(). N = 1 is the scalar path.
+	template <size_t N>
+	LaneMask<N> intersectBezierPatchPacket(const ReferencePrimitive& primitive,
+	                                       const std::array<Ray, N>& rays,
+	                                       const LaneMask<N> lanes,
+	                                       std::array<Hit, N>& hits) const;
+
+	// shader.rchit
+	void closestHit(Payload& payload, const Hit& hit) const;
+
+	// shadow ray towards the light, true if the shadow miss shader is not reached
+	bool isShadowed(const glm::vec3 origin, const glm::vec3 direction, const float tMax) const;
+
+	// the payload of the camera ray through the pixel, see shader.rgen
+	Payload primaryRayPayload(const uint32_t x,
+	                          const uint32_t y,
+	                          const uint32_t width,
+	                          const uint32_t height) const;
+
+	// shader.rgen for laneCount pixels of a row starting at x
+	void renderPacket(const uint32_t x,
+	                  const uint32_t y,
+	                  const uint32_t laneCount,
+	                  const uint32_t width,
+	                  const uint32_t height,
+	                  const std::span<glm::vec4> pixels) const;
+};
+
+/**
+ * @brief Loads the scene and renders its reference image without a window or a vulkan device,
+ * e.g. on CI or render nodes without ray tracing GPUs. The camera, the light and the raytracing
+ * constants are the ones the application starts with.
+ *
+ * @throws std::runtime_error if the scene does not exist
+ */
+[[nodiscard]] ReferenceImage
+renderReferenceScene(const int sceneNr, const uint32_t width, const uint32_t height);
+
+} // namespace rt
+} // namespace tracer
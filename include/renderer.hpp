@@ -185,6 +185,9 @@ class Renderer
 		return raytracingInfo;
 	}
 
+	// the constants the application starts with, also used by the headless reference renderer
+	[[nodiscard]] static RaytracingDataConstants getDefaultRaytracingDataConstants();
+
 	inline const RaytracingDataConstants& getRaytracingDataConstants() const
 	{
 		return raytracingInfo.raytracingConstants;
@@ -220,6 +223,11 @@ class Renderer
   private:
 	void createSyncObjects();
 
+	void createTimestampQueryPool();
+
+	// reads the trace time of the frame in flight, its fence has to be signaled
+	void readTraceTimestamps(ui::UIData& uiData);
+
 	void createCommandBuffers();
 
 	void createCommandPools();
@@ -245,9 +253,6 @@ class Renderer
 	}
 
   private:
-	// How many frames can be recorded at the same time
-	const int MAX_FRAMES_IN_FLIGHT = 3;
-
 	DeletionQueue& deletionQueue;
 	RaytracingInfo raytracingInfo = {};
 
@@ -267,16 +272,25 @@ class Renderer
 	VkQueue presentQueue = VK_NULL_HANDLE;
 
 	// TODO: maybe utilize this queue for transfer operations
-	[[maybe_unused]] VkQueue transferQueue = VK_NULL_HANDLE;
+	// used for the staged geometry uploads of the raytracing scene
+	VkQueue transferQueue = VK_NULL_HANDLE;
 
 	bool resetFrameCountRequested = false;
 	uint32_t currentFrame = 0;
+	// never reset, VMA refreshes the heap budgets when the frame index changes
+	uint32_t drawnFrameCount = 0;
 
 	std::vector<VkFramebuffer> swapChainFramebuffers;
 	std::vector<VkImageView> swapChainImageViews;
 	std::vector<VkImage> swapChainImages;
 
 	std::vector<VkFence> inFlightFences;
+
+	// two timestamps per frame in flight around the ray tracing pass, VK_NULL_HANDLE if
+	// timestamps are not supported
+	VkQueryPool traceTimestampQueryPool = VK_NULL_HANDLE;
+	std::vector<bool> traceTimestampsWritten{};
+	double timestampPeriod = 0.0;
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderFinishedSemaphores;
 
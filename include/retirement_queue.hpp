@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+#include <vulkan/vulkan_core.h>
+
+#include "deletion_queue.hpp"
+#include "types.hpp"
+#include "vk_utils.hpp"
+
+namespace tracer
+{
+
+[[nodiscard]] inline uint64_t getCompletedFrameTimelineValue(VkDevice logicalDevice,
+                                                             const FrameTimeline& frameTimeline)
+{
+	uint64_t completedValue = 0;
+	VK_CHECK_RESULT(
+	    vkGetSemaphoreCounterValue(logicalDevice, frameTimeline.semaphore, &completedValue));
+	return completedValue;
+}
+
+// blocks until the frames up to value are done
+inline void waitForFrameTimeline(VkDevice logicalDevice,
+                                 const FrameTimeline& frameTimeline,
+                                 const uint64_t value)
+{
+	if (value == 0)
+	{
+		return;
+	}
+
+	VkSemaphoreWaitInfo waitInfo = {
+	    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+	    .pNext = NULL,
+	    .flags = 0,
+	    .semaphoreCount = 1,
+	    .pSemaphores = &frameTimeline.semaphore,
+	    .pValues = &value,
+	};
+	VK_CHECK_RESULT(vkWaitSemaphores(logicalDevice, &waitInfo, UINT64_MAX));
+}
+
+// @return whether all submitted frames are done
+[[nodiscard]] inline bool isFrameTimelineIdle(VkDevice logicalDevice,
+                                              const FrameTimeline& frameTimeline)
+{
+	return frameTimeline.lastSubmittedValue == 0
+	       || getCompletedFrameTimelineValue(logicalDevice, frameTimeline)
+	              >= frameTimeline.lastSubmittedValue;
+}
+
+// Destroys resources once the GPU is done with them instead of waiting for the queue to be idle.
+// Every batch of resources is tagged with the frame timeline value of the last frame that might
+// use them, collect() destroys the batches whose value was reached.
+class RetirementQueue
+{
+  public:
+	// the resources are used by the frames up to lastUseValue, the values must not decrease
+	void retire(DeletionQueue&& resources, const uint64_t lastUseValue)
+	{
+		if (resources.empty())
+		{
+			return;
+		}
+
+		if (!batches.empty() && batches.back().lastUseValue == lastUseValue)
+		{
+			batches.back().resources.append(std::move(resources));
+			return;
+		}
+
+		assert((batches.empty() || batches.back().lastUseValue < lastUseValue)
+		       && "RetirementQueue::retire - values must not decrease");
+		batches.push_back({.lastUseValue = lastUseValue, .resources = {}});
+		batches.back().resources.append(std::move(resources));
+	}
+
+	// destroys the resources of all batches whose frames are done
+	void collect(const uint64_t completedValue)
+	{
+		while (!batches.empty() && batches.front().lastUseValue <= completedValue)
+		{
+			batches.front().resources.flush();
+			batches.pop_front();
+		}
+	}
+
+	// destroys all resources, the GPU must not use them anymore
+	void flush()
+	{
+		collect(UINT64_MAX);
+	}
+
+	[[nodiscard]] size_t getBatchCount() const
+	{
+		return batches.size();
+	}
+
+  private:
+	struct RetiredBatch
+	{
+		uint64_t lastUseValue = 0;
+		DeletionQueue resources;
+	};
+
+	std::deque<RetiredBatch> batches;
+};
+
+} // namespace tracer
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "aabb.hpp"
+#include "bezier_math.hpp"
+#include "blas.hpp"
+#include "common_types.h"
+#include "logger.hpp"
+#include "parallel_for.hpp"
+#include "raytracing_scene.hpp"
+
+namespace tracer
+{
+namespace rt
+{
+
+/**
+ * @brief Adds bezier patches to the RaytracingScene in bulk, for scenes with millions of patches
+ * where calling addObjectBezierPatch() per patch is too slow.
+ *
+ * The add calls only validate and stage the patches, commit() computes the AABBs on all cores and
+ * appends everything to a new SceneObject with one copy per array. Either all staged patches are
+ * added or none (commit() checks everything before touching the scene).
+ */
+class SceneBuilder
+{
+  public:
+	explicit SceneBuilder(RaytracingScene& scene) : scene(scene)
+	{
+	}
+
+	// reserves the staging memory for the given amount of patches/control points
+	void reserve(const size_t patchCount, const size_t controlPointCount)
+	{
+		patches.reserve(patchCount);
+		controlPoints.reserve(controlPointCount);
+	}
+
+	/**
+	 * @brief Stages patches of the same degree.
+	 *
+	 * @param patchControlPoints the control points of the patches back to back, each patch has
+	 * (degree + 1)(degree + 2) / 2 control points in the order of the BezierTriangle structs
+	 * @param markAsInside marks the patches as inside for the slicing plane calculations
+	 */
+	void addBezierPatches(const uint32_t degree,
+	                      const std::span<const glm::vec3> patchControlPoints,
+	                      const bool markAsInside = false)
+	{
+		if (degree < 1 || degree > MAX_BEZIER_PATCH_DEGREE)
+		{
+			throw std::runtime_error("SceneBuilder::addBezierPatches - Unsupported degree");
+		}
+
+		const uint32_t controlPointCount = getBezierTriangleControlPointCount(degree);
+		if (patchControlPoints.size() % controlPointCount != 0)
+		{
+			throw std::runtime_error(
+			    "SceneBuilder::addBezierPatches - Control point count is not a multiple of the "
+			    "control points per patch");
+		}
+
+		const size_t patchCount = patchControlPoints.size() / controlPointCount;
+		const auto flags = markAsInside
+		                       ? static_cast<uint>(BezierPatchFlags::t_BezierPatchFlagInside)
+		                       : 0u;
+		for (size_t i = 0; i < patchCount; i++)
+		{
+			// the offset is relative to the staged control points until the commit, the AABB is
+			// computed there as well
+			patches.push_back(BezierPatch{
+			    .controlPointOffset
+			    = static_cast<uint>(controlPoints.size() + i * controlPointCount),
+			    .degree = degree,
+			    .flags = flags,
+			    .aabb = {},
+			});
+		}
+		controlPoints.insert(
+		    controlPoints.end(), patchControlPoints.begin(), patchControlPoints.end());
+	}
+
+	template <typename S>
+	void addBezierTriangles(const std::span<const S> bezierTriangles,
+	                        const bool markAsInside = false)
+	{
+		constexpr auto n = static_cast<uint32_t>(degree<S>());
+		std::vector<glm::vec3> trianglesControlPoints;
+		trianglesControlPoints.reserve(bezierTriangles.size()
+		                               * getBezierTriangleControlPointCount(n));
+		for (const S& bezierTriangle : bezierTriangles)
+		{
+			trianglesControlPoints.insert(trianglesControlPoints.end(),
+			                              bezierTriangle.controlPoints.begin(),
+			                              bezierTriangle.controlPoints.end());
+		}
+		addBezierPatches(n, trianglesControlPoints, markAsInside);
+	}
+
+	[[nodiscard]] size_t getPatchCount() const
+	{
+		return patches.size();
+	}
+
+	/**
+	 * @brief Adds the staged patches to a new SceneObject of the scene and clears the builder.
+	 * Large SceneObjects are split into several BLAS's by the blasClusterSize of the scene.
+	 *
+	 * @throws std::runtime_error if the objects would exceed the 24 bit instance custom index or
+	 * the name is already used, the scene is not modified then
+	 */
+	std::shared_ptr<SceneObject> commit(const std::string& name = "")
+	{
+		const size_t firstObjectIndex = scene.getObjectCount();
+		// the custom index of the last cluster has to fit as well, the clusters can start at any
+		// of the patches
+		if (!patches.empty() && firstObjectIndex + patches.size() - 1 > MAX_INSTANCE_CUSTOM_INDEX)
+		{
+			throw std::runtime_error(
+			    "SceneBuilder::commit - The patches exceed the 24 bit instance custom index");
+		}
+		if (scene.bezierControlPoints.size() + controlPoints.size() > UINT32_MAX)
+		{
+			throw std::runtime_error("SceneBuilder::commit - Too many control points");
+		}
+
+		const auto controlPointBaseOffset = static_cast<uint>(scene.bezierControlPoints.size());
+		// the staged patches stay untouched until the SceneObject exists, a commit that threw can
+		// be retried
+		std::vector<BezierPatch> committedPatches(patches.size());
+		std::vector<VkAabbPositionsKHR> aabbPositions(patches.size());
+
+		// every patch only reads its own control points, the patches can be processed in parallel
+		constexpr size_t minPatchesPerThread = 16384;
+		parallelFor(
+		    patches.size(),
+		    minPatchesPerThread,
+		    [this, controlPointBaseOffset, &committedPatches, &aabbPositions](const size_t begin,
+		                                                                     const size_t end)
+		    {
+			    for (size_t i = begin; i < end; i++)
+			    {
+				    BezierPatch patch = patches[i];
+				    const AABB aabb = AABB::fromBezierPatch(
+				        std::span<const glm::vec3>(controlPoints)
+				            .subspan(patch.controlPointOffset,
+				                     getBezierTriangleControlPointCount(patch.degree)),
+				        patch.degree,
+				        scene.bezierBoundsMode);
+				    patch.aabb = {.minimum = aabb.min, .maximum = aabb.max};
+				    patch.controlPointOffset += controlPointBaseOffset;
+				    committedPatches[i] = patch;
+				    aabbPositions[i] = aabb.getAabbPositions();
+			    }
+		    });
+
+		// throws for duplicate names before anything is added
+		auto sceneObject = scene.createNamedSceneObject(name);
+		scene.appendBezierPatches(*sceneObject, committedPatches, aabbPositions, controlPoints);
+
+		debug_printFmt("SceneBuilder - committed %zu bezier patches to sceneObject (%s): %d\n",
+		               patches.size(),
+		               name.c_str(),
+		               sceneObject->instanceCustomIndex);
+
+		patches.clear();
+		controlPoints.clear();
+		return sceneObject;
+	}
+
+  private:
+	RaytracingScene& scene;
+	std::vector<BezierPatch> patches;
+	std::vector<glm::vec3> controlPoints;
+};
+
+} // namespace rt
+} // namespace tracer
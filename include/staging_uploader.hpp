@@ -0,0 +1,520 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan_core.h>
+
+#include "deletion_queue.hpp"
+#include "logger.hpp"
+#include "vk_utils.hpp"
+
+namespace tracer
+{
+namespace rt
+{
+
+// Uploads data into device local buffers through a host visible staging ring. The copies are
+// executed on the transfer queue and signal a timeline semaphore, the graphics queue has to wait
+// for getLastSubmittedValue() before it reads the uploaded data.
+//
+// If the transfer queue belongs to another queue family than the graphics queue, the ownership
+// of the uploaded ranges is released after the copies and has to be acquired on the graphics
+// queue with recordOwnershipAcquires().
+class StagingUploader
+{
+  public:
+	static constexpr VkDeviceSize STAGING_RING_SIZE_IN_BYTES = 16 * 1024 * 1024;
+
+	StagingUploader(const VkPhysicalDevice physicalDevice,
+	                const VkDevice logicalDevice,
+	                const VmaAllocator vmaAllocator)
+	    : physicalDevice(physicalDevice), logicalDevice(logicalDevice), vmaAllocator(vmaAllocator)
+	{
+	}
+
+	~StagingUploader() = default;
+
+	StagingUploader(const StagingUploader&) = delete;
+	StagingUploader& operator=(const StagingUploader&) = delete;
+
+	StagingUploader(StagingUploader&&) noexcept = delete;
+	StagingUploader& operator=(StagingUploader&&) noexcept = delete;
+
+	void init(const VkQueue queue,
+	          const uint32_t transferFamilyIndex,
+	          const uint32_t graphicsFamilyIndex)
+	{
+		assert(!isInitialized() && "StagingUploader already initialized");
+
+		transferQueue = queue;
+		transferQueueFamilyIndex = transferFamilyIndex;
+		graphicsQueueFamilyIndex = graphicsFamilyIndex;
+
+		VkCommandPoolCreateInfo commandPoolCreateInfo = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		    .pNext = NULL,
+		    .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		    .queueFamilyIndex = transferQueueFamilyIndex,
+		};
+		VK_CHECK_RESULT(
+		    vkCreateCommandPool(logicalDevice, &commandPoolCreateInfo, NULL, &commandPool));
+		VkCommandPool pool = commandPool;
+		VkDevice device = logicalDevice;
+		deletionQueue.push_function([=]() { vkDestroyCommandPool(device, pool, NULL); });
+
+		VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {
+		    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		    .pNext = NULL,
+		    .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		    .initialValue = 0,
+		};
+		VkSemaphoreCreateInfo semaphoreCreateInfo = {
+		    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		    .pNext = &semaphoreTypeCreateInfo,
+		    .flags = 0,
+		};
+		VK_CHECK_RESULT(
+		    vkCreateSemaphore(logicalDevice, &semaphoreCreateInfo, NULL, &timelineSemaphore));
+		VkSemaphore semaphore = timelineSemaphore;
+		deletionQueue.push_function([=]() { vkDestroySemaphore(device, semaphore, NULL); });
+
+		// host coherent, the ring does not need to be flushed
+		stagingMappedData = createMappedBuffer(
+		    physicalDevice,
+		    logicalDevice,
+		    vmaAllocator,
+		    deletionQueue,
+		    AllocationCategory::Staging,
+		    STAGING_RING_SIZE_IN_BYTES,
+		    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		    memoryAllocateFlagsInfo,
+		    stagingBufferHandle,
+		    stagingBufferAllocation);
+	}
+
+	// waits until all uploads are done and destroys the staging ring
+	void cleanup()
+	{
+		if (!isInitialized())
+		{
+			return;
+		}
+
+		waitForValue(lastSubmittedValue);
+		deletionQueue.flush();
+
+		commandPool = VK_NULL_HANDLE;
+		timelineSemaphore = VK_NULL_HANDLE;
+		stagingBufferHandle = VK_NULL_HANDLE;
+		stagingBufferAllocation = VK_NULL_HANDLE;
+		stagingMappedData = nullptr;
+		waitSemaphore = VK_NULL_HANDLE;
+		waitValue = 0;
+		uploadCommandBuffers.clear();
+		inFlightRegions.clear();
+		pendingCopies.clear();
+		pendingReleases.clear();
+		pendingAcquires.clear();
+		ringHead = 0;
+		batchBegin = 0;
+	}
+
+	[[nodiscard]] bool isInitialized() const
+	{
+		return commandPool != VK_NULL_HANDLE;
+	}
+
+	/**
+	 * @brief Copies the data into the staging ring and queues a copy into dstBuffer, the copy is
+	 * executed with the next submit(). Large uploads are split into chunks that fit into the
+	 * ring, if the ring is full the queued copies are submitted and the oldest uploads are waited
+	 * for.
+	 *
+	 * The range is written completely, the previous content of the range is discarded.
+	 */
+	void upload(const VkBuffer dstBuffer,
+	            const VkDeviceSize dstOffset,
+	            const void* data,
+	            const VkDeviceSize size)
+	{
+		assert(isInitialized() && "StagingUploader::upload - not initialized");
+		if (size == 0)
+		{
+			return;
+		}
+
+		const auto* bytes = static_cast<const char*>(data);
+		VkDeviceSize uploadedSize = 0;
+		while (uploadedSize < size)
+		{
+			const VkDeviceSize chunkSize
+			    = std::min(size - uploadedSize, STAGING_RING_SIZE_IN_BYTES);
+			const VkDeviceSize stagingOffset = allocate(chunkSize);
+			memcpy(static_cast<char*>(stagingMappedData) + stagingOffset,
+			       bytes + uploadedSize,
+			       chunkSize);
+
+			pendingCopies.push_back({
+			    .dstBuffer = dstBuffer,
+			    .region = {
+			        .srcOffset = stagingOffset,
+			        .dstOffset = dstOffset + uploadedSize,
+			        .size = chunkSize,
+			    },
+			});
+			uploadedSize += chunkSize;
+		}
+
+		// a single release for the whole range, the barrier also covers the chunks that were
+		// already submitted since they were submitted earlier to the same queue
+		pendingReleases.push_back({.buffer = dstBuffer, .offset = dstOffset, .size = size});
+	}
+
+	/**
+	 * @brief Submits the queued copies to the transfer queue without waiting for them.
+	 *
+	 * @return the timeline value that is signaled once the copies are done
+	 */
+	uint64_t submit()
+	{
+		if (pendingCopies.empty())
+		{
+			return lastSubmittedValue;
+		}
+
+		retireCompletedRegions();
+
+		VkCommandBuffer commandBuffer = getUploadCommandBuffer();
+
+		VkCommandBufferBeginInfo beginInfo = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		    .pNext = NULL,
+		    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		    .pInheritanceInfo = NULL,
+		};
+		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		// previous uploads might still write the same ranges
+		VkMemoryBarrier2 writeAfterWriteBarrier = {
+		    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		    .pNext = NULL,
+		    .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		    .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		    .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		};
+		VkDependencyInfo writeAfterWriteDependencyInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		    .pNext = NULL,
+		    .dependencyFlags = 0,
+		    .memoryBarrierCount = 1,
+		    .pMemoryBarriers = &writeAfterWriteBarrier,
+		    .bufferMemoryBarrierCount = 0,
+		    .pBufferMemoryBarriers = NULL,
+		    .imageMemoryBarrierCount = 0,
+		    .pImageMemoryBarriers = NULL,
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &writeAfterWriteDependencyInfo);
+
+		for (const auto& pendingCopy : pendingCopies)
+		{
+			vkCmdCopyBuffer(
+			    commandBuffer, stagingBufferHandle, pendingCopy.dstBuffer, 1, &pendingCopy.region);
+		}
+
+		if (transferQueueFamilyIndex != graphicsQueueFamilyIndex)
+		{
+			recordOwnershipReleases(commandBuffer);
+		}
+		pendingReleases.clear();
+
+		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+		const uint64_t signalValue = lastSubmittedValue + 1;
+		const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		const uint32_t waitSemaphoreCount = waitSemaphore != VK_NULL_HANDLE ? 1u : 0u;
+		VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {
+		    .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		    .pNext = NULL,
+		    .waitSemaphoreValueCount = waitSemaphoreCount,
+		    .pWaitSemaphoreValues = &waitValue,
+		    .signalSemaphoreValueCount = 1,
+		    .pSignalSemaphoreValues = &signalValue,
+		};
+		VkSubmitInfo submitInfo = {
+		    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		    .pNext = &timelineSubmitInfo,
+		    .waitSemaphoreCount = waitSemaphoreCount,
+		    .pWaitSemaphores = &waitSemaphore,
+		    .pWaitDstStageMask = &waitStage,
+		    .commandBufferCount = 1,
+		    .pCommandBuffers = &commandBuffer,
+		    .signalSemaphoreCount = 1,
+		    .pSignalSemaphores = &timelineSemaphore,
+		};
+		VK_CHECK_RESULT(vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+		lastSubmittedValue = signalValue;
+		uploadCommandBuffers.back().signalValue = signalValue;
+		inFlightRegions.push_back(
+		    {.begin = batchBegin, .end = ringHead, .signalValue = signalValue});
+		batchBegin = ringHead;
+		pendingCopies.clear();
+
+		return signalValue;
+	}
+
+	// the following submits wait for the timeline semaphore to reach value before the copies are
+	// executed, the copies overwrite buffers that the submitted frames might still read
+	void setSubmitWait(const VkSemaphore timelineSemaphoreToWaitFor, const uint64_t value)
+	{
+		waitSemaphore = timelineSemaphoreToWaitFor;
+		waitValue = value;
+	}
+
+	// blocks until all submitted uploads are done
+	void waitIdle() const
+	{
+		waitForValue(lastSubmittedValue);
+	}
+
+	// acquires the ownership of the ranges released by the previous submits, has to be recorded
+	// into a command buffer that waits for getLastSubmittedValue()
+	void recordOwnershipAcquires(VkCommandBuffer commandBuffer)
+	{
+		if (pendingAcquires.empty())
+		{
+			return;
+		}
+
+		VkDependencyInfo dependencyInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		    .pNext = NULL,
+		    .dependencyFlags = 0,
+		    .memoryBarrierCount = 0,
+		    .pMemoryBarriers = NULL,
+		    .bufferMemoryBarrierCount = static_cast<uint32_t>(pendingAcquires.size()),
+		    .pBufferMemoryBarriers = pendingAcquires.data(),
+		    .imageMemoryBarrierCount = 0,
+		    .pImageMemoryBarriers = NULL,
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		pendingAcquires.clear();
+	}
+
+	[[nodiscard]] VkSemaphore getTimelineSemaphore() const
+	{
+		return timelineSemaphore;
+	}
+
+	[[nodiscard]] uint64_t getLastSubmittedValue() const
+	{
+		return lastSubmittedValue;
+	}
+
+  private:
+	struct PendingCopy
+	{
+		VkBuffer dstBuffer = VK_NULL_HANDLE;
+		VkBufferCopy region = {};
+	};
+
+	struct BufferRange
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+	};
+
+	// part of the staging ring that is read by a submitted upload
+	struct InFlightRegion
+	{
+		VkDeviceSize begin = 0;
+		VkDeviceSize end = 0;
+		uint64_t signalValue = 0;
+	};
+
+	struct UploadCommandBuffer
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		// the command buffer can be reused once the semaphore reached this value
+		uint64_t signalValue = 0;
+	};
+
+	// @return offset of size free bytes inside the staging ring
+	VkDeviceSize allocate(const VkDeviceSize size)
+	{
+		assert(size <= STAGING_RING_SIZE_IN_BYTES);
+
+		if (ringHead + size > STAGING_RING_SIZE_IN_BYTES)
+		{
+			// the queued copies are submitted first, the batch therefore never wraps around
+			submit();
+			ringHead = 0;
+			batchBegin = 0;
+		}
+
+		const auto overlaps = [&](const InFlightRegion& region)
+		{ return region.begin < ringHead + size && ringHead < region.end; };
+		while (std::any_of(inFlightRegions.begin(), inFlightRegions.end(), overlaps))
+		{
+			// the uploads finish in order, wait for the oldest one
+			waitForValue(inFlightRegions.front().signalValue);
+			inFlightRegions.pop_front();
+		}
+
+		const VkDeviceSize offset = ringHead;
+		ringHead += size;
+		return offset;
+	}
+
+	void retireCompletedRegions()
+	{
+		uint64_t completedValue = 0;
+		VK_CHECK_RESULT(
+		    vkGetSemaphoreCounterValue(logicalDevice, timelineSemaphore, &completedValue));
+		while (!inFlightRegions.empty() && inFlightRegions.front().signalValue <= completedValue)
+		{
+			inFlightRegions.pop_front();
+		}
+	}
+
+	void waitForValue(const uint64_t value) const
+	{
+		if (value == 0)
+		{
+			return;
+		}
+
+		VkSemaphoreWaitInfo waitInfo = {
+		    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		    .pNext = NULL,
+		    .flags = 0,
+		    .semaphoreCount = 1,
+		    .pSemaphores = &timelineSemaphore,
+		    .pValues = &value,
+		};
+		VK_CHECK_RESULT(vkWaitSemaphores(logicalDevice, &waitInfo, UINT64_MAX));
+	}
+
+	// reuses a command buffer of a finished upload or allocates a new one, the returned command
+	// buffer is the last entry of uploadCommandBuffers
+	VkCommandBuffer getUploadCommandBuffer()
+	{
+		uint64_t completedValue = 0;
+		VK_CHECK_RESULT(
+		    vkGetSemaphoreCounterValue(logicalDevice, timelineSemaphore, &completedValue));
+
+		auto finished = std::find_if(uploadCommandBuffers.begin(),
+		                             uploadCommandBuffers.end(),
+		                             [completedValue](const UploadCommandBuffer& upload)
+		                             { return upload.signalValue <= completedValue; });
+		if (finished != uploadCommandBuffers.end())
+		{
+			UploadCommandBuffer upload = *finished;
+			uploadCommandBuffers.erase(finished);
+			VK_CHECK_RESULT(vkResetCommandBuffer(upload.commandBuffer, 0));
+			uploadCommandBuffers.push_back(upload);
+			return upload.commandBuffer;
+		}
+
+		VkCommandBufferAllocateInfo allocateInfo = {
+		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		    .pNext = NULL,
+		    .commandPool = commandPool,
+		    .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		    .commandBufferCount = 1,
+		};
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(logicalDevice, &allocateInfo, &commandBuffer));
+		uploadCommandBuffers.push_back({.commandBuffer = commandBuffer, .signalValue = 0});
+
+		debug_printFmt("StagingUploader - allocated upload command buffer %zu\n",
+		               uploadCommandBuffers.size());
+		return commandBuffer;
+	}
+
+	// the release and acquire barriers of a queue family ownership transfer have to match
+	void recordOwnershipReleases(VkCommandBuffer commandBuffer)
+	{
+		std::vector<VkBufferMemoryBarrier2> releases;
+		releases.reserve(pendingReleases.size());
+		for (const auto& range : pendingReleases)
+		{
+			VkBufferMemoryBarrier2 barrier = {
+			    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+			    .pNext = NULL,
+			    .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			    .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+			    .dstAccessMask = VK_ACCESS_2_NONE,
+			    .srcQueueFamilyIndex = transferQueueFamilyIndex,
+			    .dstQueueFamilyIndex = graphicsQueueFamilyIndex,
+			    .buffer = range.buffer,
+			    .offset = range.offset,
+			    .size = range.size,
+			};
+			releases.push_back(barrier);
+
+			// the acquire happens on the graphics queue before the buffers are read
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+			barrier.srcAccessMask = VK_ACCESS_2_NONE;
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+			barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+			pendingAcquires.push_back(barrier);
+		}
+
+		VkDependencyInfo dependencyInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		    .pNext = NULL,
+		    .dependencyFlags = 0,
+		    .memoryBarrierCount = 0,
+		    .pMemoryBarriers = NULL,
+		    .bufferMemoryBarrierCount = static_cast<uint32_t>(releases.size()),
+		    .pBufferMemoryBarriers = releases.data(),
+		    .imageMemoryBarrierCount = 0,
+		    .pImageMemoryBarriers = NULL,
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+	}
+
+	VkPhysicalDevice physicalDevice;
+	VkDevice logicalDevice;
+	VmaAllocator vmaAllocator;
+
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	uint32_t transferQueueFamilyIndex = 0;
+	uint32_t graphicsQueueFamilyIndex = 0;
+
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+	uint64_t lastSubmittedValue = 0;
+	// see setSubmitWait()
+	VkSemaphore waitSemaphore = VK_NULL_HANDLE;
+	uint64_t waitValue = 0;
+
+	VkBuffer stagingBufferHandle = VK_NULL_HANDLE;
+	VmaAllocation stagingBufferAllocation = VK_NULL_HANDLE;
+	void* stagingMappedData = nullptr;
+	// next free byte of the staging ring
+	VkDeviceSize ringHead = 0;
+	// first byte of the copies that are not submitted yet
+	VkDeviceSize batchBegin = 0;
+
+	std::vector<UploadCommandBuffer> uploadCommandBuffers;
+	std::deque<InFlightRegion> inFlightRegions;
+	std::vector<PendingCopy> pendingCopies;
+	std::vector<BufferRange> pendingReleases;
+	std::vector<VkBufferMemoryBarrier2> pendingAcquires;
+
+	DeletionQueue deletionQueue;
+};
+
+} // namespace rt
+} // namespace tracer
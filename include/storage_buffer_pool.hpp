@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan_core.h>
+
+#include "deletion_queue.hpp"
+#include "logger.hpp"
+#include "mapped_buffer.hpp"
+#include "vk_utils.hpp"
+
+namespace tracer
+{
+namespace rt
+{
+
+// the storage buffers of a RaytracingScene that are read by the ray tracing shaders
+enum class SceneStorageBuffer : uint8_t
+{
+	GPUObjects = 0,
+	SlicingPlanes,
+	Spheres,
+	// the headers of the bezier triangles of all degrees
+	BezierPatches,
+	// the control points of all bezier patches
+	BezierControlPoints,
+	RectangularBezierSurfaces2x2,
+};
+
+constexpr size_t SCENE_STORAGE_BUFFER_COUNT = 6;
+
+// The patches and the GPU objects are read in every intersection shader invocation, they live in
+// pure device local memory and are uploaded through the StagingUploader. The small buffers that
+// are updated often (slicing planes from the UI, moving spheres) stay host visible.
+[[nodiscard]] inline bool isDeviceLocalStorageBuffer(const SceneStorageBuffer type)
+{
+	switch (type)
+	{
+	case SceneStorageBuffer::GPUObjects:
+	case SceneStorageBuffer::BezierPatches:
+	case SceneStorageBuffer::BezierControlPoints:
+	case SceneStorageBuffer::RectangularBezierSurfaces2x2:
+		return true;
+	case SceneStorageBuffer::SlicingPlanes:
+	case SceneStorageBuffer::Spheres:
+		return false;
+	}
+	return false;
+}
+
+struct PooledStorageBuffer
+{
+	VkBuffer bufferHandle = VK_NULL_HANDLE;
+	VmaAllocation bufferAllocation = VK_NULL_HANDLE;
+	// only set for the host visible buffers, they stay mapped until they are destroyed
+	MappedBufferView<std::byte> mappedBytes{};
+	// allocated size in bytes, the used size might be smaller
+	VkDeviceSize capacity = 0;
+	// set when the buffer was (re)allocated and its descriptor was not updated yet
+	bool reallocated = false;
+	// destroys the current allocation
+	DeletionQueue deletionQueue;
+};
+
+// Keeps the storage buffers of the scene alive across full rebuilds (e.g. scene reloads). A
+// buffer is only reallocated once the data does not fit anymore, it then grows geometrically so
+// a few growing reloads don't reallocate every time. Smaller data reuses the buffer in place.
+class StorageBufferPool
+{
+  public:
+	static constexpr VkDeviceSize MIN_CAPACITY_IN_BYTES = 4096;
+	// new capacity = max(requested size, capacity * GROWTH_FACTOR)
+	static constexpr VkDeviceSize GROWTH_FACTOR = 2;
+
+	StorageBufferPool(const VkPhysicalDevice physicalDevice,
+	                  const VkDevice logicalDevice,
+	                  const VmaAllocator vmaAllocator)
+	    : physicalDevice(physicalDevice), logicalDevice(logicalDevice), vmaAllocator(vmaAllocator)
+	{
+	}
+
+	~StorageBufferPool() = default;
+
+	StorageBufferPool(const StorageBufferPool&) = delete;
+	StorageBufferPool& operator=(const StorageBufferPool&) = delete;
+
+	StorageBufferPool(StorageBufferPool&&) noexcept = delete;
+	StorageBufferPool& operator=(StorageBufferPool&&) noexcept = delete;
+
+	/**
+	 * @brief Makes sure the buffer can hold size bytes. If it can't, a new buffer with
+	 * geometrically grown capacity is created and the old one is destroyed once
+	 * retiredBuffersQueue is flushed (the GPU might still read it).
+	 *
+	 * A size of 0 keeps the current buffer.
+	 */
+	void reserve(const SceneStorageBuffer type,
+	             const VkDeviceSize size,
+	             DeletionQueue& retiredBuffersQueue)
+	{
+		auto& buffer = buffers[static_cast<size_t>(type)];
+		if (size <= buffer.capacity)
+		{
+			if (size > 0)
+			{
+				reuseCount++;
+			}
+			return;
+		}
+
+		if (buffer.bufferHandle != VK_NULL_HANDLE)
+		{
+			retiredBuffersQueue.append(std::move(buffer.deletionQueue));
+		}
+
+		buffer.capacity
+		    = std::max({size, buffer.capacity * GROWTH_FACTOR, MIN_CAPACITY_IN_BYTES});
+		// the buffers are the destination of the staging copies and of the dirty object updates
+		// recorded with vkCmdUpdateBuffer
+		const VkBufferUsageFlags usage
+		    = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		if (isDeviceLocalStorageBuffer(type))
+		{
+			createBuffer(physicalDevice,
+			             logicalDevice,
+			             vmaAllocator,
+			             buffer.deletionQueue,
+			             AllocationCategory::StorageBuffer,
+			             buffer.capacity,
+			             usage,
+			             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			             memoryAllocateFlagsInfo,
+			             buffer.bufferHandle,
+			             buffer.bufferAllocation,
+			             0,
+			             0);
+			buffer.mappedBytes = {};
+		}
+		else
+		{
+			void* mappedData = createMappedBuffer(
+			    physicalDevice,
+			    logicalDevice,
+			    vmaAllocator,
+			    buffer.deletionQueue,
+			    AllocationCategory::StorageBuffer,
+			    buffer.capacity,
+			    usage,
+			    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			    memoryAllocateFlagsInfo,
+			    buffer.bufferHandle,
+			    buffer.bufferAllocation);
+			buffer.mappedBytes = MappedBufferView<std::byte>(vmaAllocator,
+			                                                 buffer.bufferAllocation,
+			                                                 mappedData,
+			                                                 static_cast<size_t>(buffer.capacity));
+		}
+		buffer.reallocated = true;
+		allocationCount++;
+
+		debug_printFmt("StorageBufferPool - reallocated buffer %zu with %llu bytes\n",
+		               static_cast<size_t>(type),
+		               static_cast<unsigned long long>(buffer.capacity));
+	}
+
+	// the buffer has to be reserved with at least size bytes and must be host visible, device local
+	// buffers are written through the StagingUploader
+	void write(const SceneStorageBuffer type, const void* data, const VkDeviceSize size)
+	{
+		auto& buffer = buffers[static_cast<size_t>(type)];
+		assert(size <= buffer.capacity);
+		assert(!isDeviceLocalStorageBuffer(type) && buffer.mappedBytes.isMapped());
+		buffer.mappedBytes.write(0, static_cast<const std::byte*>(data), static_cast<size_t>(size));
+		buffer.mappedBytes.flush();
+	}
+
+	[[nodiscard]] VkBuffer getBufferHandle(const SceneStorageBuffer type) const
+	{
+		return buffers[static_cast<size_t>(type)].bufferHandle;
+	}
+
+	// @return whether the buffer was reallocated since the last call, its descriptor has to be
+	// updated then
+	[[nodiscard]] bool takeReallocated(const SceneStorageBuffer type)
+	{
+		auto& buffer = buffers[static_cast<size_t>(type)];
+		const bool reallocated = buffer.reallocated;
+		buffer.reallocated = false;
+		return reallocated;
+	}
+
+	[[nodiscard]] VkDeviceSize getCapacityInBytes() const
+	{
+		VkDeviceSize capacity = 0;
+		for (const auto& buffer : buffers)
+		{
+			capacity += buffer.capacity;
+		}
+		return capacity;
+	}
+
+	[[nodiscard]] size_t getAllocationCount() const
+	{
+		return allocationCount;
+	}
+
+	[[nodiscard]] size_t getReuseCount() const
+	{
+		return reuseCount;
+	}
+
+	// destroys all buffers, the GPU must not use them anymore
+	void clear()
+	{
+		for (auto& buffer : buffers)
+		{
+			buffer.deletionQueue.flush();
+			buffer = PooledStorageBuffer{};
+		}
+	}
+
+  private:
+	VkPhysicalDevice physicalDevice;
+	VkDevice logicalDevice;
+	VmaAllocator vmaAllocator;
+
+	std::array<PooledStorageBuffer, SCENE_STORAGE_BUFFER_COUNT> buffers{};
+
+	size_t allocationCount = 0;
+	size_t reuseCount = 0;
+};
+
+} // namespace rt
+} // namespace tracer
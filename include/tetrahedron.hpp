@@ -114,21 +114,10 @@ constexpr ObjectType getObjectType()
 	{
 		return ObjectType::t_Tetrahedron4;
 	}
-	else if constexpr (std::is_same_v<T, BezierTriangle1>)
+	else if constexpr (std::is_same_v<T, BezierTriangle1> || std::is_same_v<T, BezierTriangle2>
+	                   || std::is_same_v<T, BezierTriangle3> || std::is_same_v<T, BezierTriangle4>)
 	{
-		return ObjectType::t_BezierTriangle1;
-	}
-	else if constexpr (std::is_same_v<T, BezierTriangle2>)
-	{
-		return ObjectType::t_BezierTriangle2;
-	}
-	else if constexpr (std::is_same_v<T, BezierTriangle3>)
-	{
-		return ObjectType::t_BezierTriangle3;
-	}
-	else if constexpr (std::is_same_v<T, BezierTriangle4>)
-	{
-		return ObjectType::t_BezierTriangle4;
+		return ObjectType::t_BezierPatch;
 	}
 	else
 	{
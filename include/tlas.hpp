@@ -1,12 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <vector>
 
 #include <vulkan/vulkan_core.h>
 
+#include "blas.hpp"
 #include "deletion_queue.hpp"
 #include "device_procedures.hpp"
+#include "types.hpp"
 #include "vk_utils.hpp"
 
 namespace tracer
@@ -23,14 +27,99 @@ namespace rt
 // 	VkAccelerationStructureInstanceKHR instance;
 // };
 
+// creates one persistently mapped instance buffer per frame in flight, the buffers stay mapped
+// until the deletion queue is flushed
+inline std::vector<TLASInstanceBuffer> createTopLevelAccelerationStructureInstanceBuffers(
+    VkDevice logicalDevice,
+    VkPhysicalDevice physicalDevice,
+    VmaAllocator vmaAllocator,
+    DeletionQueue& deletionQueue,
+    const size_t instanceCount)
+{
+	std::vector<TLASInstanceBuffer> instanceBuffers(static_cast<size_t>(MAX_FRAMES_IN_FLIGHT));
+	for (auto& instanceBuffer : instanceBuffers)
+	{
+		void* mappedData = createMappedBuffer(
+		    physicalDevice,
+		    logicalDevice,
+		    vmaAllocator,
+		    deletionQueue,
+		    AllocationCategory::TLAS,
+		    sizeof(VkAccelerationStructureInstanceKHR) * instanceCount,
+		    VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR
+		        | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+		    memoryAllocateFlagsInfo,
+		    instanceBuffer.bufferHandle,
+		    instanceBuffer.bufferAllocation);
+		instanceBuffer.instances = MappedBufferView<VkAccelerationStructureInstanceKHR>(
+		    vmaAllocator, instanceBuffer.bufferAllocation, mappedData, instanceCount);
+
+		VkBufferDeviceAddressInfoKHR instanceBufferDeviceAddressInfo = {
+		    .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR,
+		    .pNext = NULL,
+		    .buffer = instanceBuffer.bufferHandle,
+		};
+
+		instanceBuffer.deviceAddress = tracer::procedures::pvkGetBufferDeviceAddressKHR(
+		    logicalDevice, &instanceBufferDeviceAddressInfo);
+
+		// every buffer is written completely before its first use
+		instanceBuffer.dirtyBegin = 0;
+		instanceBuffer.dirtyEnd = instanceCount;
+	}
+
+	return instanceBuffers;
+}
+
+// marks the instances [begin, end) as changed in all instance buffers, each buffer is written
+// once it is used by a frame again
+inline void markTopLevelAccelerationStructureInstancesDirty(
+    std::vector<TLASInstanceBuffer>& instanceBuffers, const size_t begin, const size_t end)
+{
+	for (auto& instanceBuffer : instanceBuffers)
+	{
+		if (instanceBuffer.dirtyBegin < instanceBuffer.dirtyEnd)
+		{
+			instanceBuffer.dirtyBegin = std::min(instanceBuffer.dirtyBegin, begin);
+			instanceBuffer.dirtyEnd = std::max(instanceBuffer.dirtyEnd, end);
+		}
+		else
+		{
+			instanceBuffer.dirtyBegin = begin;
+			instanceBuffer.dirtyEnd = end;
+		}
+	}
+}
+
+// writes the changed instances of the buffer with a single contiguous copy (the range from the
+// first to the last changed instance)
+inline void writeTopLevelAccelerationStructureInstances(
+    const std::vector<VkAccelerationStructureInstanceKHR>& instances,
+    TLASInstanceBuffer& instanceBuffer)
+{
+	if (instanceBuffer.dirtyBegin < instanceBuffer.dirtyEnd)
+	{
+		assert(instanceBuffer.dirtyEnd <= instances.size());
+		instanceBuffer.instances.write(instanceBuffer.dirtyBegin,
+		                               instances.data() + instanceBuffer.dirtyBegin,
+		                               instanceBuffer.dirtyEnd - instanceBuffer.dirtyBegin);
+		instanceBuffer.instances.flush();
+	}
+	instanceBuffer.dirtyBegin = 0;
+	instanceBuffer.dirtyEnd = 0;
+}
+
+// builds the TLAS from scratch and waits until the build is done, the first instance buffer is
+// used as the build input. Only needed when the amount of instances/BLAS's changes, for moving
+// instances use recordTopLevelAccelerationStructureUpdate() instead
 inline void createAndBuildTopLevelAccelerationStructure(
     const std::vector<VkAccelerationStructureInstanceKHR>& instances,
     DeletionQueue& deletionQueue,
     VkDevice logicalDevice,
     VkPhysicalDevice physicalDevice,
     VmaAllocator vmaAllocator,
-    const bool onlyUpdate,
-    VmaAllocation& blasGeometryInstancesBufferAllocation,
+    std::vector<TLASInstanceBuffer>& instanceBuffers,
     VkAccelerationStructureGeometryKHR& topLevelAccelerationStructureGeometry,
     VkAccelerationStructureBuildGeometryInfoKHR& topLevelAccelerationStructureBuildGeometryInfo,
     VkAccelerationStructureKHR& topLevelAccelerationStructureHandle,
@@ -42,234 +131,154 @@ inline void createAndBuildTopLevelAccelerationStructure(
     VkAccelerationStructureBuildRangeInfoKHR& topLevelAccelerationStructureBuildRangeInfo,
     VkCommandBuffer commandBufferBuildTopAndBottomLevel,
     VkQueue graphicsQueueHandle,
+    VkFence accelerationStructureBuildFence,
     VkDeviceSize minAccelerationStructureScratchOffsetAlignment)
 
 {
-	// std::vector<VkAccelerationStructureInstanceKHR> blasGeometryInstances;
-	// for (const auto& instance : blasInstances)
-	// {
-	// 	blasGeometryInstances.push_back(instance.info.bottomLevelGeometryInstance);
-	// }
-	// std::cout << "blasGeometryInstances.size(): " << blasGeometryInstances.size() << "\n";
-
 	//=================================================================================================
 	// copy acceleration structure geometry instances from array to a buffer
-	if (onlyUpdate)
-	{
-		// Copy new instances to the buffer
-		copyDataToBuffer(vmaAllocator,
-		                 blasGeometryInstancesBufferAllocation,
-		                 instances.data(),
-		                 sizeof(VkAccelerationStructureInstanceKHR) * instances.size());
-
-		// set flags to update instead of rebuild the acceleration structure
-		topLevelAccelerationStructureBuildGeometryInfo.mode
-		    = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
-		topLevelAccelerationStructureBuildGeometryInfo.srcAccelerationStructure
-		    = topLevelAccelerationStructureHandle;
-		topLevelAccelerationStructureBuildGeometryInfo.dstAccelerationStructure
-		    = topLevelAccelerationStructureHandle;
-	}
-	else
-	{
-		VkBuffer blasGeometryInstancesBufferHandle = VK_NULL_HANDLE;
-		VkDeviceSize bufferSize = sizeof(VkAccelerationStructureInstanceKHR) * instances.size();
-
-		createBuffer(physicalDevice,
-		             logicalDevice,
-		             vmaAllocator,
-		             deletionQueue,
-		             bufferSize,
-		             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR
-		                 | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-		             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-		             memoryAllocateFlagsInfo,
-		             blasGeometryInstancesBufferHandle,
-		             blasGeometryInstancesBufferAllocation);
-
-		copyDataToBuffer(
-		    vmaAllocator, blasGeometryInstancesBufferAllocation, instances.data(), bufferSize);
-
-		//=================================================================================================
-		// create top level acceleration structure geometry
-		VkBufferDeviceAddressInfoKHR blasGeometryInstancesAddressesInfo = {
-		    .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR,
-		    .pNext = NULL,
-		    .buffer = blasGeometryInstancesBufferHandle,
-		};
+	instanceBuffers = createTopLevelAccelerationStructureInstanceBuffers(
+	    logicalDevice, physicalDevice, vmaAllocator, deletionQueue, instances.size());
 
-		VkDeviceAddress blasGeometryInstancesDeviceAddress
-		    = tracer::procedures::pvkGetBufferDeviceAddressKHR(logicalDevice,
-		                                                       &blasGeometryInstancesAddressesInfo);
-
-		// VkAccelerationStructureGeometryDataKHR topLevelAccelerationStructureGeometryData = {};
-		// topLevelAccelerationStructureGeometryData.aabbs = {
-		//     .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_AABBS_DATA_KHR,
-		//     .pnext = NULL,
-		//     .data = {},
-		//     .stride = sizeof(AABB),
-		// };
-
-		topLevelAccelerationStructureGeometry = {
-			.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
-			.pNext = NULL,
-			.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
-			.geometry = {
-				.instances = {
-					.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
-					.pNext = NULL,
-					.arrayOfPointers = VK_FALSE,
-					.data = {
-						.deviceAddress = blasGeometryInstancesDeviceAddress,
-					},
+	writeTopLevelAccelerationStructureInstances(instances, instanceBuffers[0]);
+
+	//=================================================================================================
+	// create top level acceleration structure geometry
+	topLevelAccelerationStructureGeometry = {
+		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+		.pNext = NULL,
+		.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+		.geometry = {
+			.instances = {
+				.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+				.pNext = NULL,
+				.arrayOfPointers = VK_FALSE,
+				.data = {
+					.deviceAddress = instanceBuffers[0].deviceAddress,
 				},
 			},
-			.flags = VK_GEOMETRY_OPAQUE_BIT_KHR,
-		};
+		},
+		.flags = VK_GEOMETRY_OPAQUE_BIT_KHR,
+	};
 
-		topLevelAccelerationStructureBuildGeometryInfo = {
-		    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
-		    .pNext = NULL,
-		    .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
-		    .flags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR
-		             | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR,
-		    .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
-		    .srcAccelerationStructure = VK_NULL_HANDLE,
-		    .dstAccelerationStructure = VK_NULL_HANDLE,
-		    .geometryCount = 1,
-		    .pGeometries = &topLevelAccelerationStructureGeometry,
-		    .ppGeometries = NULL,
-		    .scratchData = {.deviceAddress = 0},
-		};
+	topLevelAccelerationStructureBuildGeometryInfo = {
+	    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+	    .pNext = NULL,
+	    .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+	    // every ray starts in the TLAS and it only holds a few instances, therefore fast tracing
+	    // outweighs the build time, the instance transforms are updated in place
+	    .flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR
+	             | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR,
+	    .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+	    .srcAccelerationStructure = VK_NULL_HANDLE,
+	    .dstAccelerationStructure = VK_NULL_HANDLE,
+	    .geometryCount = 1,
+	    .pGeometries = &topLevelAccelerationStructureGeometry,
+	    .ppGeometries = NULL,
+	    .scratchData = {.deviceAddress = 0},
+	};
 
-		topLevelAccelerationStructureBuildSizesInfo = {
-		    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
-		    .pNext = NULL,
-		    .accelerationStructureSize = 0,
-		    .updateScratchSize = 0,
-		    .buildScratchSize = 0,
-		};
+	topLevelAccelerationStructureBuildSizesInfo = {
+	    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
+	    .pNext = NULL,
+	    .accelerationStructureSize = 0,
+	    .updateScratchSize = 0,
+	    .buildScratchSize = 0,
+	};
 
-		std::vector<uint32_t> topLevelMaxPrimitiveCountList
-		    = {static_cast<unsigned int>(instances.size())};
+	std::vector<uint32_t> topLevelMaxPrimitiveCountList
+	    = {static_cast<unsigned int>(instances.size())};
 
-		tracer::procedures::pvkGetAccelerationStructureBuildSizesKHR(
-		    logicalDevice,
-		    VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-		    &topLevelAccelerationStructureBuildGeometryInfo,
-		    // Vulkan Docs: pMaxPrimitiveCounts is a pointer to an array of
-		    // pBuildInfo->geometryCount uint32_t values defining the number of primitives built
-		    // into each geometry.
-		    topLevelMaxPrimitiveCountList.data(),
-		    &topLevelAccelerationStructureBuildSizesInfo);
-
-		createBuffer(physicalDevice,
-		             logicalDevice,
-		             vmaAllocator,
-		             deletionQueue,
-		             topLevelAccelerationStructureBuildSizesInfo.accelerationStructureSize,
-		             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR
-		                 | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-		             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		             memoryAllocateFlagsInfo,
-		             topLevelAccelerationStructureBufferHandle,
-		             topLevelAccelerationStructureDeviceMemoryHandle);
-
-		//=================================================================================================
-		// create top level acceleration structure from geometry
-		VkAccelerationStructureCreateInfoKHR topLevelAccelerationStructureCreateInfo = {
-		    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
-		    .pNext = NULL,
-		    .createFlags = 0,
-		    .buffer = topLevelAccelerationStructureBufferHandle,
-		    .offset = 0,
-		    .size = topLevelAccelerationStructureBuildSizesInfo.accelerationStructureSize,
-		    .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
-		    .deviceAddress = 0,
-		};
+	tracer::procedures::pvkGetAccelerationStructureBuildSizesKHR(
+	    logicalDevice,
+	    VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+	    &topLevelAccelerationStructureBuildGeometryInfo,
+	    // Vulkan Docs: pMaxPrimitiveCounts is a pointer to an array of
+	    // pBuildInfo->geometryCount uint32_t values defining the number of primitives built
+	    // into each geometry.
+	    topLevelMaxPrimitiveCountList.data(),
+	    &topLevelAccelerationStructureBuildSizesInfo);
+
+	createBuffer(physicalDevice,
+	             logicalDevice,
+	             vmaAllocator,
+	             deletionQueue,
+	             AllocationCategory::TLAS,
+	             topLevelAccelerationStructureBuildSizesInfo.accelerationStructureSize,
+	             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR
+	                 | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+	             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	             memoryAllocateFlagsInfo,
+	             topLevelAccelerationStructureBufferHandle,
+	             topLevelAccelerationStructureDeviceMemoryHandle);
 
-		VK_CHECK_RESULT(tracer::procedures::pvkCreateAccelerationStructureKHR(
-		    logicalDevice,
-		    &topLevelAccelerationStructureCreateInfo,
-		    NULL,
-		    &topLevelAccelerationStructureHandle));
-
-		deletionQueue.push_function(
-		    [=]()
-		    {
-			    tracer::procedures::pvkDestroyAccelerationStructureKHR(
-			        logicalDevice, topLevelAccelerationStructureHandle, NULL);
-		    });
-
-		//=================================================================================================
-		// Build Top Level Acceleration Structure on device
-		// VkAccelerationStructureDeviceAddressInfoKHR
-		// topLevelAccelerationStructureDeviceAddressInfo =
-		// {
-		//     .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
-		//     .pNext = NULL,
-		//     .accelerationStructure = raytracingInfo.topLevelAccelerationStructureHandle,
-		// };
-
-		// VkDeviceAddress topLevelAccelerationStructureDeviceAddress
-		//     = tracer::procedures::pvkGetAccelerationStructureDeviceAddressKHR(
-		//         logicalDevice, &topLevelAccelerationStructureDeviceAddressInfo);
-
-		createBuffer(physicalDevice,
-		             logicalDevice,
-		             vmaAllocator,
-		             deletionQueue,
-		             topLevelAccelerationStructureBuildSizesInfo.buildScratchSize,
-		             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-		             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		             memoryAllocateFlagsInfo,
-		             topLevelAccelerationStructureScratchBufferHandle,
-		             topLevelAccelerationStructureScratchBufferAllocation,
-		             minAccelerationStructureScratchOffsetAlignment);
-
-		VkBufferDeviceAddressInfo topLevelAccelerationStructureScratchBufferDeviceAddressInfo = {
-		    .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
-		    .pNext = NULL,
-		    .buffer = topLevelAccelerationStructureScratchBufferHandle,
-		};
+	//=================================================================================================
+	// create top level acceleration structure from geometry
+	VkAccelerationStructureCreateInfoKHR topLevelAccelerationStructureCreateInfo = {
+	    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+	    .pNext = NULL,
+	    .createFlags = 0,
+	    .buffer = topLevelAccelerationStructureBufferHandle,
+	    .offset = 0,
+	    .size = topLevelAccelerationStructureBuildSizesInfo.accelerationStructureSize,
+	    .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+	    .deviceAddress = 0,
+	};
 
-		VkDeviceAddress topLevelAccelerationStructureScratchBufferDeviceAddress
-		    = tracer::procedures::pvkGetBufferDeviceAddressKHR(
-		        logicalDevice, &topLevelAccelerationStructureScratchBufferDeviceAddressInfo);
+	VK_CHECK_RESULT(
+	    tracer::procedures::pvkCreateAccelerationStructureKHR(logicalDevice,
+	                                                          &topLevelAccelerationStructureCreateInfo,
+	                                                          NULL,
+	                                                          &topLevelAccelerationStructureHandle));
 
-		topLevelAccelerationStructureBuildGeometryInfo.dstAccelerationStructure
-		    = topLevelAccelerationStructureHandle;
+	deletionQueue.push_acceleration_structure(logicalDevice, topLevelAccelerationStructureHandle);
 
-		// if (onlyUpdate)
-		// {
-		topLevelAccelerationStructureBuildGeometryInfo.srcAccelerationStructure
-		    = topLevelAccelerationStructureHandle;
-		// }
+	//=================================================================================================
+	// Build Top Level Acceleration Structure on device
+
+	// the scratch buffer is reused by the per frame updates
+	createBuffer(physicalDevice,
+	             logicalDevice,
+	             vmaAllocator,
+	             deletionQueue,
+	             AllocationCategory::Scratch,
+	             std::max(topLevelAccelerationStructureBuildSizesInfo.buildScratchSize,
+	                      topLevelAccelerationStructureBuildSizesInfo.updateScratchSize),
+	             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+	             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	             memoryAllocateFlagsInfo,
+	             topLevelAccelerationStructureScratchBufferHandle,
+	             topLevelAccelerationStructureScratchBufferAllocation,
+	             minAccelerationStructureScratchOffsetAlignment);
+
+	VkBufferDeviceAddressInfo topLevelAccelerationStructureScratchBufferDeviceAddressInfo = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+	    .pNext = NULL,
+	    .buffer = topLevelAccelerationStructureScratchBufferHandle,
+	};
 
-		topLevelAccelerationStructureBuildGeometryInfo.scratchData = {
-		    .deviceAddress = topLevelAccelerationStructureScratchBufferDeviceAddress,
-		};
+	VkDeviceAddress topLevelAccelerationStructureScratchBufferDeviceAddress
+	    = tracer::procedures::pvkGetBufferDeviceAddressKHR(
+	        logicalDevice, &topLevelAccelerationStructureScratchBufferDeviceAddressInfo);
 
-		topLevelAccelerationStructureBuildRangeInfo = {
-		    .primitiveCount = static_cast<uint32_t>(instances.size()),
-		    .primitiveOffset = 0,
-		    .firstVertex = 0,
-		    .transformOffset = 0,
-		};
-	}
+	topLevelAccelerationStructureBuildGeometryInfo.dstAccelerationStructure
+	    = topLevelAccelerationStructureHandle;
 
-	const VkAccelerationStructureBuildRangeInfoKHR* topLevelAccelerationStructureBuildRangeInfos
-	    = &topLevelAccelerationStructureBuildRangeInfo;
+	topLevelAccelerationStructureBuildGeometryInfo.scratchData = {
+	    .deviceAddress = topLevelAccelerationStructureScratchBufferDeviceAddress,
+	};
 
-	VkCommandBufferBeginInfo topLevelCommandBufferBeginInfo = {
-	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-	    .pNext = NULL,
-	    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-	    .pInheritanceInfo = NULL,
+	topLevelAccelerationStructureBuildRangeInfo = {
+	    .primitiveCount = static_cast<uint32_t>(instances.size()),
+	    .primitiveOffset = 0,
+	    .firstVertex = 0,
+	    .transformOffset = 0,
 	};
 
-	VK_CHECK_RESULT(
-	    vkBeginCommandBuffer(commandBufferBuildTopAndBottomLevel, &topLevelCommandBufferBeginInfo));
+	const VkAccelerationStructureBuildRangeInfoKHR* topLevelAccelerationStructureBuildRangeInfos
+	    = &topLevelAccelerationStructureBuildRangeInfo;
+
+	beginAccelerationStructureCommandBuffer(commandBufferBuildTopAndBottomLevel);
 
 	tracer::procedures::pvkCmdBuildAccelerationStructuresKHR(
 	    commandBufferBuildTopAndBottomLevel,
@@ -277,40 +286,62 @@ inline void createAndBuildTopLevelAccelerationStructure(
 	    &topLevelAccelerationStructureBuildGeometryInfo,
 	    &topLevelAccelerationStructureBuildRangeInfos);
 
-	VK_CHECK_RESULT(vkEndCommandBuffer(commandBufferBuildTopAndBottomLevel));
+	recordAccelerationStructureBarrier(commandBufferBuildTopAndBottomLevel);
 
-	VkSubmitInfo topLevelAccelerationStructureBuildSubmitInfo = {
-	    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-	    .pNext = NULL,
-	    .waitSemaphoreCount = 0,
-	    .pWaitSemaphores = NULL,
-	    .pWaitDstStageMask = NULL,
-	    .commandBufferCount = 1,
-	    .pCommandBuffers = &commandBufferBuildTopAndBottomLevel,
-	    .signalSemaphoreCount = 0,
-	    .pSignalSemaphores = NULL,
-	};
+	submitAccelerationStructureCommandBufferAndWait(logicalDevice,
+	                                                commandBufferBuildTopAndBottomLevel,
+	                                                graphicsQueueHandle,
+	                                                accelerationStructureBuildFence);
 
-	VkFenceCreateInfo topLevelAccelerationStructureBuildFenceCreateInfo = {
-	    .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-	    .pNext = NULL,
-	    .flags = 0,
-	};
+	// all following builds are updates of the TLAS we just built
+	topLevelAccelerationStructureBuildGeometryInfo.mode
+	    = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+	topLevelAccelerationStructureBuildGeometryInfo.srcAccelerationStructure
+	    = topLevelAccelerationStructureHandle;
+}
+
+/**
+ * @brief Records an update (refit) of the TLAS with the given instances into the command buffer,
+ * e.g. the frame command buffer before the rays are traced. No fence is involved, the instances
+ * are written into the instance buffer of the frame and barriers order the update against the
+ * previous frames and the following ray tracing shaders.
+ *
+ * @param instanceBuffer the instance buffer of the current frame in flight, must not be in use by
+ * the GPU anymore
+ */
+inline void recordTopLevelAccelerationStructureUpdate(
+    VkCommandBuffer commandBuffer,
+    const std::vector<VkAccelerationStructureInstanceKHR>& instances,
+    TLASInstanceBuffer& instanceBuffer,
+    VkAccelerationStructureGeometryKHR& topLevelAccelerationStructureGeometry,
+    VkAccelerationStructureBuildGeometryInfoKHR& topLevelAccelerationStructureBuildGeometryInfo,
+    const VkAccelerationStructureBuildRangeInfoKHR& topLevelAccelerationStructureBuildRangeInfo)
+{
+	assert(instances.size() == topLevelAccelerationStructureBuildRangeInfo.primitiveCount
+	       && "The amount of instances can only change with a full rebuild");
+
+	writeTopLevelAccelerationStructureInstances(instances, instanceBuffer);
 
-	VkFence topLevelAccelerationStructureBuildFenceHandle = VK_NULL_HANDLE;
-	VK_CHECK_RESULT(vkCreateFence(logicalDevice,
-	                              &topLevelAccelerationStructureBuildFenceCreateInfo,
-	                              NULL,
-	                              &topLevelAccelerationStructureBuildFenceHandle));
+	// the previous frames might still trace rays against the TLAS or update it (they share the
+	// scratch buffer), wait for them before updating it
+	recordAccelerationStructureWriteAfterReadBarrier(commandBuffer);
 
-	VK_CHECK_RESULT(vkQueueSubmit(graphicsQueueHandle,
-	                              1,
-	                              &topLevelAccelerationStructureBuildSubmitInfo,
-	                              topLevelAccelerationStructureBuildFenceHandle));
-	VK_CHECK_RESULT(vkWaitForFences(
-	    logicalDevice, 1, &topLevelAccelerationStructureBuildFenceHandle, true, UINT32_MAX));
+	topLevelAccelerationStructureGeometry.geometry.instances.data.deviceAddress
+	    = instanceBuffer.deviceAddress;
+	topLevelAccelerationStructureBuildGeometryInfo.pGeometries
+	    = &topLevelAccelerationStructureGeometry;
+
+	const VkAccelerationStructureBuildRangeInfoKHR* topLevelAccelerationStructureBuildRangeInfos
+	    = &topLevelAccelerationStructureBuildRangeInfo;
+
+	tracer::procedures::pvkCmdBuildAccelerationStructuresKHR(
+	    commandBuffer,
+	    1,
+	    &topLevelAccelerationStructureBuildGeometryInfo,
+	    &topLevelAccelerationStructureBuildRangeInfos);
 
-	vkDestroyFence(logicalDevice, topLevelAccelerationStructureBuildFenceHandle, NULL);
+	// the ray tracing shaders of this frame have to wait for the update
+	recordAccelerationStructureBarrier(commandBuffer);
 }
 
 } // namespace rt
@@ -89,12 +89,21 @@ struct Transform
 		return glm::normalize(glm::rotate(rotation, glm::vec3(1, 0, 0)));
 	}
 
-	VkTransformMatrixKHR getTransformMatrix() const
+	glm::mat4 getMatrix() const
 	{
 		glm::mat4 matrix = glm::translate(glm::identity<glm::mat4>(), position);
 		matrix = matrix * glm::toMat4(rotation);
-		matrix = glm::scale(matrix, scale);
+		return glm::scale(matrix, scale);
+	}
+
+	VkTransformMatrixKHR getTransformMatrix() const
+	{
+		return toTransformMatrixKHR(getMatrix());
+	}
 
+	// the upper 3x4 part of the matrix in the row major layout of the TLAS instances
+	static VkTransformMatrixKHR toTransformMatrixKHR(const glm::mat4& matrix)
+	{
 		VkTransformMatrixKHR transformationMatrix {
 		    .matrix = {
 				{matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]},
@@ -105,6 +114,20 @@ struct Transform
 		return transformationMatrix;
 	}
 
+	// inverse of toTransformMatrixKHR(), the last row is (0, 0, 0, 1)
+	static glm::mat4 fromTransformMatrixKHR(const VkTransformMatrixKHR& transformMatrix)
+	{
+		glm::mat4 matrix(1.0f);
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				matrix[column][row] = transformMatrix.matrix[row][column];
+			}
+		}
+		return matrix;
+	}
+
   private:
 	glm::vec3 position{0.0f, 0.0f, 0.0f};
 	glm::quat rotation = glm::quat();
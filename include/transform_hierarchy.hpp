@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_RADIANS
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/ext/matrix_float4x4.hpp"
+
+namespace tracer
+{
+namespace rt
+{
+
+using TransformNodeId = uint32_t;
+inline constexpr TransformNodeId INVALID_TRANSFORM_NODE = UINT32_MAX;
+
+// Parent/child hierarchy of transforms, e.g. the parts of an animated assembly. Only the local
+// matrices are set, update() recomputes the world matrices of the nodes whose local matrix or
+// the one of an ancestor changed. A parent is always created before its children, so a single
+// pass over the nodes in creation order propagates the changes down the hierarchy.
+class TransformHierarchy
+{
+  public:
+	// @param parent INVALID_TRANSFORM_NODE for a root node
+	TransformNodeId createNode(const glm::mat4& localMatrix = glm::mat4(1.0f),
+	                           const TransformNodeId parent = INVALID_TRANSFORM_NODE)
+	{
+		assert((parent == INVALID_TRANSFORM_NODE || parent < parents.size())
+		       && "TransformHierarchy::createNode - the parent has to be created first");
+		assert(parents.size() < INVALID_TRANSFORM_NODE);
+
+		const auto node = static_cast<TransformNodeId>(parents.size());
+		parents.push_back(parent);
+		localMatrices.push_back(localMatrix);
+		worldMatrices.push_back(glm::mat4(1.0f));
+		dirtyFlags.push_back(1);
+		changedFlags.push_back(0);
+		return node;
+	}
+
+	// the world matrix is recomputed with the next update()
+	void setLocalMatrix(const TransformNodeId node, const glm::mat4& localMatrix)
+	{
+		assert(node < parents.size());
+		localMatrices[node] = localMatrix;
+		dirtyFlags[node] = 1;
+	}
+
+	[[nodiscard]] const glm::mat4& getLocalMatrix(const TransformNodeId node) const
+	{
+		assert(node < parents.size());
+		return localMatrices[node];
+	}
+
+	// only up to date after update()
+	[[nodiscard]] const glm::mat4& getWorldMatrix(const TransformNodeId node) const
+	{
+		assert(node < parents.size());
+		return worldMatrices[node];
+	}
+
+	[[nodiscard]] TransformNodeId getParent(const TransformNodeId node) const
+	{
+		assert(node < parents.size());
+		return parents[node];
+	}
+
+	// whether the world matrix of the node was recomputed by the last update()
+	[[nodiscard]] bool wasChanged(const TransformNodeId node) const
+	{
+		assert(node < parents.size());
+		return changedFlags[node] != 0;
+	}
+
+	/**
+	 * @brief Recomputes the world matrices of the dirty nodes and their descendants, the other
+	 * nodes are skipped.
+	 *
+	 * @return whether any world matrix changed, see wasChanged()
+	 */
+	bool update()
+	{
+		bool anyChanged = false;
+		for (size_t node = 0; node < parents.size(); node++)
+		{
+			const TransformNodeId parent = parents[node];
+			const bool parentChanged = parent != INVALID_TRANSFORM_NODE && changedFlags[parent];
+			const bool changed = dirtyFlags[node] != 0 || parentChanged;
+			if (changed)
+			{
+				worldMatrices[node] = parent == INVALID_TRANSFORM_NODE
+				                          ? localMatrices[node]
+				                          : worldMatrices[parent] * localMatrices[node];
+			}
+			changedFlags[node] = static_cast<uint8_t>(changed);
+			dirtyFlags[node] = 0;
+			anyChanged = anyChanged || changed;
+		}
+		return anyChanged;
+	}
+
+	[[nodiscard]] size_t size() const
+	{
+		return parents.size();
+	}
+
+	void clear()
+	{
+		parents.clear();
+		localMatrices.clear();
+		worldMatrices.clear();
+		dirtyFlags.clear();
+		changedFlags.clear();
+	}
+
+  private:
+	std::vector<TransformNodeId> parents;
+	std::vector<glm::mat4> localMatrices;
+	std::vector<glm::mat4> worldMatrices;
+	// uint8_t instead of bool, see ObjectPool
+	// the local matrix changed since the last update()
+	std::vector<uint8_t> dirtyFlags;
+	// the world matrix was recomputed by the last update()
+	std::vector<uint8_t> changedFlags;
+};
+
+} // namespace rt
+} // namespace tracer
@@ -13,6 +13,7 @@
 #include "glm/ext/matrix_float4x4.hpp"
 
 #include "common_types.h"
+#include "mapped_buffer.hpp"
 #include "model.hpp"
 
 #include "vk_mem_alloc.h"
@@ -20,13 +21,14 @@
 namespace tracer
 {
 
-// holds the queue family indices for the graphics and present queue
-// transfer queue is not used for now
+// holds the queue family indices for the graphics, present and transfer queue
+// the transfer family is only set if the device has a dedicated transfer family (no graphics
+// bit), otherwise the graphics queue is used for transfers
 struct QueueFamilyIndices
 {
 	std::optional<uint32_t> graphicsFamily = std::nullopt;
 	std::optional<uint32_t> presentFamily = std::nullopt;
-	// std::optional<uint32_t> transferFamily = std::nullopt;
+	std::optional<uint32_t> transferFamily = std::nullopt;
 
 	bool isComplete()
 	{
@@ -50,45 +52,44 @@ struct SharedInfo
 	alignas(16) glm::mat4 proj;
 };
 
-// struct to group together all AABB objects needed for the BLAS creation
-struct RaytracingObjectAABBBuffers
+// holds the packed AABB buffer of a SceneObject needed for the BLAS creation
+// all AABBs of the SceneObject are stored consecutively (spheres, bezier triangles 2/3/4,
+// rectangular surfaces) so the primitive index inside the geometry matches the GPUInstance
+// offset relative to the instanceCustomIndex
+struct RaytracingObjectAABBBuffer
 {
+	VkBuffer bufferHandle = VK_NULL_HANDLE;
+	VmaAllocation bufferAllocation = VK_NULL_HANDLE;
+	// written once when the BLAS is built, the refits of dynamic SceneObjects update the buffer
+	// inside the frame command buffer
+	MappedBufferView<VkAabbPositionsKHR> aabbs{};
+	uint32_t primitiveCount = 0;
+};
 
-	// TODO: convert into a list of structs that hold the buffer and the device memory (maybe look
-	// at how its done in nvidia's examples)
-	std::vector<VkBuffer> tetrahedronsAABBBufferHandles = std::vector<VkBuffer>(0);
-	std::vector<VmaAllocation> tetrahedronsAABBBufferAllocations = std::vector<VmaAllocation>(0);
-
-	std::vector<VkBuffer> bezierTriangles2AABBBufferHandles = std::vector<VkBuffer>(0);
-	std::vector<VmaAllocation> bezierTriangles2AABBBufferAllocations
-	    = std::vector<VmaAllocation>(0);
-
-	std::vector<VkBuffer> bezierTriangles3AABBBufferHandles = std::vector<VkBuffer>(0);
-	std::vector<VmaAllocation> bezierTriangles3AABBBufferAllocations
-	    = std::vector<VmaAllocation>(0);
-
-	std::vector<VkBuffer> bezierTriangles4AABBBufferHandles = std::vector<VkBuffer>(0);
-	std::vector<VmaAllocation> bezierTriangles4AABBBufferAllocations
-	    = std::vector<VmaAllocation>(0);
-
-	std::vector<VkBuffer> spheresAABBBufferHandles = std::vector<VkBuffer>(0);
-	std::vector<VmaAllocation> spheresAABBBufferAllocations = std::vector<VmaAllocation>(0);
+// How many frames can be recorded at the same time
+constexpr int MAX_FRAMES_IN_FLIGHT = 3;
 
-	std::vector<VkBuffer> rectangularBezierSurfacesAABB2x2BufferHandles = std::vector<VkBuffer>(0);
-	std::vector<VmaAllocation> rectangularBezierSurfacesAABB2x2AABBBufferAllocations
-	    = std::vector<VmaAllocation>(0);
+// persistently mapped buffer holding the TLAS instances, there is one per frame in flight so the
+// instances of a frame can be written while the previous frames are still executing
+struct TLASInstanceBuffer
+{
+	VkBuffer bufferHandle = VK_NULL_HANDLE;
+	VmaAllocation bufferAllocation = VK_NULL_HANDLE;
+	MappedBufferView<VkAccelerationStructureInstanceKHR> instances{};
+	VkDeviceAddress deviceAddress = 0;
+	// the instances that changed since the buffer was last written, see
+	// markTopLevelAccelerationStructureInstancesDirty()
+	size_t dirtyBegin = 0;
+	size_t dirtyEnd = 0;
+};
 
-	inline void clearAllHandles()
-	{
-		spheresAABBBufferHandles.clear();
-		spheresAABBBufferAllocations.clear();
-		tetrahedronsAABBBufferHandles.clear();
-		tetrahedronsAABBBufferAllocations.clear();
-		bezierTriangles2AABBBufferHandles.clear();
-		bezierTriangles2AABBBufferAllocations.clear();
-		rectangularBezierSurfacesAABB2x2BufferHandles.clear();
-		rectangularBezierSurfacesAABB2x2AABBBufferAllocations.clear();
-	}
+// timeline semaphore signaled by every frame submit, the value of a frame is reached once the
+// GPU is done with it (see RetirementQueue)
+struct FrameTimeline
+{
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	// value signaled by the last submitted frame, 0 if no frame was submitted yet
+	uint64_t lastSubmittedValue = 0;
 };
 
 // TODO: split this up a bit into more sensible structs
@@ -98,6 +99,10 @@ struct RaytracingInfo
 	VkPipeline rayTracingPipelineHandle = VK_NULL_HANDLE;
 	VkPipelineLayout pipelineLayoutHandle = VK_NULL_HANDLE;
 	std::vector<VkDescriptorSet> descriptorSetHandleList{};
+	// set 0 is replaced instead of updated while submitted frames might still use it, see
+	// updateAccelerationStructureDescriptorSet()
+	VkDescriptorPool descriptorPoolHandle = VK_NULL_HANDLE;
+	VkDescriptorSetLayout descriptorSetLayoutHandle = VK_NULL_HANDLE;
 
 	VkStridedDeviceAddressRegionKHR rchitShaderBindingTable = {};
 	VkStridedDeviceAddressRegionKHR rgenShaderBindingTable = {};
@@ -110,6 +115,7 @@ struct RaytracingInfo
 	VkImageView rayTraceImageViewHandle = VK_NULL_HANDLE;
 
 	VkFence accelerationStructureBuildFence = VK_NULL_HANDLE;
+	FrameTimeline frameTimeline = {};
 
 	tracer::QueueFamilyIndices queueFamilyIndices = {};
 
@@ -126,13 +132,14 @@ struct RaytracingInfo
 	VkBuffer topLevelAccelerationStructureScratchBufferHandle = VK_NULL_HANDLE;
 	VkAccelerationStructureBuildRangeInfoKHR topLevelAccelerationStructureBuildRangeInfo;
 	VkAccelerationStructureGeometryKHR topLevelAccelerationStructureGeometry;
-	VmaAllocation blasGeometryInstancesDeviceMemoryHandle;
 
 	VmaAllocation topLevelAccelerationStructureDeviceMemoryHandle = VK_NULL_HANDLE;
 	VmaAllocation topLevelAccelerationStructureDeviceScratchMemoryHandle = VK_NULL_HANDLE;
 
 	VkBuffer uniformBufferHandle = VK_NULL_HANDLE;
 	VmaAllocation uniformBufferAllocation = VK_NULL_HANDLE;
+	// written every frame, stays mapped
+	MappedBufferView<UniformStructure> uniformBufferView{};
 
 	VkShaderModule rayMissShadowShaderModuleHandle = VK_NULL_HANDLE;
 	VkShaderModule rayMissShaderModuleHandle = VK_NULL_HANDLE;
@@ -158,6 +165,8 @@ struct RaytracingInfo
 
 	// cache sicne it wont change during the lifetime of the program (only if a new device is used)
 	VkQueue graphicsQueueHandle = VK_NULL_HANDLE;
+	// same as graphicsQueueHandle if the device has no dedicated transfer family
+	VkQueue transferQueueHandle = VK_NULL_HANDLE;
 
 	VkSampler raytraceImageSampler;
 };
@@ -9,8 +9,10 @@
 
 #include <memory>
 #include <vulkan/vk_enum_string_helper.h>
+#include "aabb.hpp"
 #include "blas.hpp"
 #include "common_types.h"
+#include "memory_telemetry.hpp"
 
 // forward declarations
 struct RaytracingDataConstants;
@@ -58,11 +60,44 @@ struct UIData
 
 	float frameTimeMilliseconds = 0.0f;
 
-	// unused
-	std::vector<glm::vec3> positions = std::vector<glm::vec3>(10);
+	// the control points of one bezier patch that are edited with the sliders, the renderer loads
+	// them from the scene every frame and writes them back once they were edited
+	struct BezierPatchEditor
+	{
+		int patchIndex = 0;
+		// the bezier patches of the current scene
+		int patchCount = 0;
+		std::vector<glm::vec3> controlPoints{};
+		bool edited = false;
+	} bezierPatchEditor;
 
 	bool renderCrosshairInCenter = true;
 
+	// compact the BLAS's after building them (applied on the next scene reload)
+	bool compactAccelerationStructures = true;
+
+	// refits of a dynamic BLAS before it gets rebuilt
+	int maxBLASRefits = 16;
+
+	// BLAS build statistics per build policy of the last full rebuild
+	tracer::rt::BLASBuildTelemetry blasBuildTelemetry{};
+	// GPU time of the ray tracing pass of the last finished frame (0 if not measured)
+	double traceTimeMilliseconds = 0.0;
+
+	// live allocations per category and the heap budgets, updated every frame
+	const tracer::MemoryTelemetry& memoryTelemetry = tracer::getMemoryTelemetry();
+	// set by the memory leak check, the allocations are compared with the baseline after the
+	// next full rebuild
+	bool memoryLeakCheckPending = false;
+
+	// SceneObjects with more objects are split into multiple BLAS's (0 disables clustering)
+	int blasClusterSize = static_cast<int>(tracer::rt::DEFAULT_BLAS_CLUSTER_SIZE);
+
+	// subdivide the bezier patches for tighter AABBs (applied on the next scene reload)
+	bool tightBezierPatchBounds = false;
+	// AABB volumes of the bezier patches of the current scene
+	tracer::BezierBoundsTelemetry bezierBoundsTelemetry{};
+
 	bool rotateLightAroundScene = false;
 	glm::vec3 rotatingLightOrigin = {0.0f, 5.0f, 0.0f};
 	float rotatingLightRadius = 5.0f;
@@ -166,6 +201,10 @@ void renderCameraProperties(const UIData& uiData);
 
 void renderBLASObjectInfo(const UIData& uiData);
 
+void renderBLASBuildTelemetry(const UIData& uiData);
+
+void renderMemoryTelemetry(const UIData& uiData);
+
 void renderGPUProperties(const UIData& uiData);
 
 void renderErrors(const UIData& uiData);
@@ -7,10 +7,12 @@
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/vector_float2.hpp>
 #include <glm/ext/vector_float3.hpp>
+#include <glm/exponential.hpp>
 #include <glm/geometric.hpp>
 #include <glm/matrix.hpp>
 #include <vulkan/vulkan_core.h>
 
+#include "bernstein_tables.hpp"
 #include "bezier_math.hpp"
 #include "blas.hpp"
 #include "common_types.h"
@@ -28,173 +30,37 @@ namespace rt
 template <unsigned int N>
 inline size_t getControlPointIndicesTetrahedron(int i, int j, int k, int l)
 {
-	if constexpr (N == 1)
+	constexpr int n = static_cast<int>(N);
+	if (i < 0 || j < 0 || k < 0 || l < 0 || i + j + k + l != n)
 	{
-		if (i == 0 && j == 0 && k == 0 && l == 1) return 0;
-		if (i == 0 && j == 0 && k == 1 && l == 0) return 1;
-		if (i == 0 && j == 1 && k == 0 && l == 0) return 2;
-		if (i == 1 && j == 0 && k == 0 && l == 0) return 3;
-	}
-	else if constexpr (N == 2)
-	{
-		if (i == 0 && j == 0 && k == 0 && l == 2) return 0;
-		if (i == 0 && j == 0 && k == 1 && l == 1) return 1;
-		if (i == 0 && j == 0 && k == 2 && l == 0) return 2;
-		if (i == 0 && j == 1 && k == 0 && l == 1) return 3;
-		if (i == 0 && j == 1 && k == 1 && l == 0) return 4;
-		if (i == 0 && j == 2 && k == 0 && l == 0) return 5;
-		if (i == 1 && j == 0 && k == 0 && l == 1) return 6;
-		if (i == 1 && j == 0 && k == 1 && l == 0) return 7;
-		if (i == 1 && j == 1 && k == 0 && l == 0) return 8;
-		if (i == 2 && j == 0 && k == 0 && l == 0) return 9;
-	}
-	else if constexpr (N == 3)
-	{
-		if (i == 0 && j == 0 && k == 0 && l == 3) return 0;
-		if (i == 0 && j == 0 && k == 1 && l == 2) return 1;
-		if (i == 0 && j == 0 && k == 2 && l == 1) return 2;
-		if (i == 0 && j == 0 && k == 3 && l == 0) return 3;
-		if (i == 0 && j == 1 && k == 0 && l == 2) return 4;
-		if (i == 0 && j == 1 && k == 1 && l == 1) return 5;
-		if (i == 0 && j == 1 && k == 2 && l == 0) return 6;
-		if (i == 0 && j == 2 && k == 0 && l == 1) return 7;
-		if (i == 0 && j == 2 && k == 1 && l == 0) return 8;
-		if (i == 0 && j == 3 && k == 0 && l == 0) return 9;
-		if (i == 1 && j == 0 && k == 0 && l == 2) return 10;
-		if (i == 1 && j == 0 && k == 1 && l == 1) return 11;
-		if (i == 1 && j == 0 && k == 2 && l == 0) return 12;
-		if (i == 1 && j == 1 && k == 0 && l == 1) return 13;
-		if (i == 1 && j == 1 && k == 1 && l == 0) return 14;
-		if (i == 1 && j == 2 && k == 0 && l == 0) return 15;
-		if (i == 2 && j == 0 && k == 0 && l == 1) return 16;
-		if (i == 2 && j == 0 && k == 1 && l == 0) return 17;
-		if (i == 2 && j == 1 && k == 0 && l == 0) return 18;
-		if (i == 3 && j == 0 && k == 0 && l == 0) return 19;
-	}
-	else if constexpr (N == 4)
-	{
-		if (i == 0 && j == 0 && k == 0 && l == 4) return 0;
-		if (i == 0 && j == 0 && k == 1 && l == 3) return 1;
-		if (i == 0 && j == 0 && k == 2 && l == 2) return 2;
-		if (i == 0 && j == 0 && k == 3 && l == 1) return 3;
-		if (i == 0 && j == 0 && k == 4 && l == 0) return 4;
-		if (i == 0 && j == 1 && k == 0 && l == 3) return 5;
-		if (i == 0 && j == 1 && k == 1 && l == 2) return 6;
-		if (i == 0 && j == 1 && k == 2 && l == 1) return 7;
-		if (i == 0 && j == 1 && k == 3 && l == 0) return 8;
-		if (i == 0 && j == 2 && k == 0 && l == 2) return 9;
-		if (i == 0 && j == 2 && k == 1 && l == 1) return 10;
-		if (i == 0 && j == 2 && k == 2 && l == 0) return 11;
-		if (i == 0 && j == 3 && k == 0 && l == 1) return 12;
-		if (i == 0 && j == 3 && k == 1 && l == 0) return 13;
-		if (i == 0 && j == 4 && k == 0 && l == 0) return 14;
-		if (i == 1 && j == 0 && k == 0 && l == 3) return 15;
-		if (i == 1 && j == 0 && k == 1 && l == 2) return 16;
-		if (i == 1 && j == 0 && k == 2 && l == 1) return 17;
-		if (i == 1 && j == 0 && k == 3 && l == 0) return 18;
-		if (i == 1 && j == 1 && k == 0 && l == 2) return 19;
-		if (i == 1 && j == 1 && k == 1 && l == 1) return 20;
-		if (i == 1 && j == 1 && k == 2 && l == 0) return 21;
-		if (i == 1 && j == 2 && k == 0 && l == 1) return 22;
-		if (i == 1 && j == 2 && k == 1 && l == 0) return 23;
-		if (i == 1 && j == 3 && k == 0 && l == 0) return 24;
-		if (i == 2 && j == 0 && k == 0 && l == 2) return 25;
-		if (i == 2 && j == 0 && k == 1 && l == 1) return 26;
-		if (i == 2 && j == 0 && k == 2 && l == 0) return 27;
-		if (i == 2 && j == 1 && k == 0 && l == 1) return 28;
-		if (i == 2 && j == 1 && k == 1 && l == 0) return 29;
-		if (i == 2 && j == 2 && k == 0 && l == 0) return 30;
-		if (i == 3 && j == 0 && k == 0 && l == 1) return 31;
-		if (i == 3 && j == 0 && k == 1 && l == 0) return 32;
-		if (i == 3 && j == 1 && k == 0 && l == 0) return 33;
-		if (i == 4 && j == 0 && k == 0 && l == 0) return 34;
-	}
-	else
-	{
-		throw std::runtime_error("Degree N: " + std::to_string(N) + " not implemented");
+		throw std::runtime_error("Invalid index: i:" + std::to_string(i) + " j:" + std::to_string(j)
+		                         + " k:" + std::to_string(k) + " l:" + std::to_string(l));
 	}
-
-	throw std::runtime_error("Invalid index: i:" + std::to_string(i) + " j:" + std::to_string(j)
-	                         + " k:" + std::to_string(k) + " l:" + std::to_string(l));
+	return BEZIER_TETRAHEDRON_TABLE<n>.indices[static_cast<size_t>(i)][static_cast<size_t>(j)]
+	                                          [static_cast<size_t>(k)];
 }
 
 template <unsigned int N>
 inline size_t getControlPointIndicesTriangle(int i, int j, int k)
 {
-	if constexpr (N == 1)
-	{
-		if (i == 0 && j == 0 && k == 1) return 0;
-		if (i == 0 && j == 1 && k == 0) return 1;
-		if (i == 1 && j == 0 && k == 0) return 2;
-	}
-	else if constexpr (N == 2)
-	{
-		if (i == 0 && j == 0 && k == 2) return 0;
-		if (i == 1 && j == 0 && k == 1) return 1;
-		if (i == 2 && j == 0 && k == 0) return 2;
-		if (i == 0 && j == 1 && k == 1) return 3;
-		if (i == 1 && j == 1 && k == 0) return 4;
-		if (i == 0 && j == 2 && k == 0) return 5;
-	}
-	else if constexpr (N == 3)
+	constexpr int n = static_cast<int>(N);
+	if (i < 0 || j < 0 || k < 0 || i + j + k != n)
 	{
-		if (i == 0 && j == 0 && k == 3) return 0;
-		if (i == 1 && j == 0 && k == 2) return 1;
-		if (i == 2 && j == 0 && k == 1) return 2;
-		if (i == 3 && j == 0 && k == 0) return 3;
-		if (i == 0 && j == 1 && k == 2) return 4;
-		if (i == 1 && j == 1 && k == 1) return 5;
-		if (i == 2 && j == 1 && k == 0) return 6;
-		if (i == 0 && j == 2 && k == 1) return 7;
-		if (i == 1 && j == 2 && k == 0) return 8;
-		if (i == 0 && j == 3 && k == 0) return 9;
-	}
-	else if constexpr (N == 4)
-	{
-		if (i == 0 && j == 0 && k == 4) return 0;
-		if (i == 1 && j == 0 && k == 3) return 1;
-		if (i == 2 && j == 0 && k == 2) return 2;
-		if (i == 3 && j == 0 && k == 1) return 3;
-		if (i == 4 && j == 0 && k == 0) return 4;
-		if (i == 0 && j == 1 && k == 3) return 5;
-		if (i == 1 && j == 1 && k == 2) return 6;
-		if (i == 2 && j == 1 && k == 1) return 7;
-		if (i == 3 && j == 1 && k == 0) return 8;
-		if (i == 0 && j == 2 && k == 2) return 9;
-		if (i == 1 && j == 2 && k == 1) return 10;
-		if (i == 2 && j == 2 && k == 0) return 11;
-		if (i == 0 && j == 3 && k == 1) return 12;
-		if (i == 1 && j == 3 && k == 0) return 13;
-		if (i == 0 && j == 4 && k == 0) return 14;
-	}
-	else
-	{
-		throw std::runtime_error("Degree N: " + std::to_string(N) + " not implemented");
+		throw std::runtime_error("Invalid index: i:" + std::to_string(i) + " j:" + std::to_string(j)
+		                         + " k:" + std::to_string(k));
 	}
-
-	throw std::runtime_error("Invalid index: i:" + std::to_string(i) + " j:" + std::to_string(j)
-	                         + " k:" + std::to_string(k));
-}
-
-inline int iter_factorial(int n)
-{
-	int ret = 1;
-	for (int i = 1; i <= n; ++i)
-		ret *= i;
-	return ret;
+	return BEZIER_TRIANGLE_TABLE<n>.indices[static_cast<size_t>(i)][static_cast<size_t>(j)];
 }
 
 inline float BernsteinPolynomialBivariate(int n, int i, int j, int k, float u, float v, float w)
 {
-	if (i < 0 || j < 0 || k < 0)
+	if (i < 0 || j < 0 || k < 0 || n > MAX_BEZIER_PATCH_DEGREE)
 	{
 		throw std::runtime_error("Invalid index: i:" + std::to_string(i) + " j:" + std::to_string(j)
 		                         + " k:" + std::to_string(k));
 	}
 
-	float fraction
-	    = static_cast<float>(iter_factorial(n))
-	      / static_cast<float>((iter_factorial(i) * iter_factorial(j) * iter_factorial(k)));
+	const float fraction = getBernsteinCoefficient(n, i, j);
 
 	float powi = static_cast<float>(glm::pow(u, i));
 	float powj = static_cast<float>(glm::pow(v, j));
@@ -207,14 +73,15 @@ template <int N>
 inline float
 BernsteinPolynomialTrivariate(int i, int j, int k, int l, float u, float v, float w, float s)
 {
-	if (i < 0 || j < 0 || k < 0 || l < 0 || i > N || j > N || k > N || l > N)
+	if (i < 0 || j < 0 || k < 0 || l < 0 || i + j + k + l != N)
 	{
 		return 0;
 	}
 
-	float fraction = static_cast<float>(iter_factorial(N))
-	                 / static_cast<float>((iter_factorial(i) * iter_factorial(j) * iter_factorial(k)
-	                                       * iter_factorial(l)));
+	constexpr const auto& table = BEZIER_TETRAHEDRON_TABLE<N>;
+	const float fraction = table.coefficients[table.indices[static_cast<size_t>(i)]
+	                                                       [static_cast<size_t>(j)]
+	                                                       [static_cast<size_t>(k)]];
 
 	float powi = static_cast<float>(glm::pow(u, i));
 	float powj = static_cast<float>(glm::pow(v, j));
@@ -319,12 +186,9 @@ partialBezierTriangleDirectional(const T& triangle, vec3 direction, float u, flo
 			{
 				if (i + j + k == N - 1)
 				{
-					size_t be1 = static_cast<size_t>(
-					    getControlPointIndicesBezierTriangle2(i + 1, j + 0, k + 0));
-					size_t be2 = static_cast<size_t>(
-					    getControlPointIndicesBezierTriangle2(i + 0, j + 1, k + 0));
-					size_t be3 = static_cast<size_t>(
-					    getControlPointIndicesBezierTriangle2(i + 0, j + 0, k + 1));
+					size_t be1 = getControlPointIndicesTriangle<N>(i + 1, j + 0, k + 0);
+					size_t be2 = getControlPointIndicesTriangle<N>(i + 0, j + 1, k + 0);
+					size_t be3 = getControlPointIndicesTriangle<N>(i + 0, j + 0, k + 1);
 					vec3 x = triangle.controlPoints[be1] * direction.x;
 					vec3 y = triangle.controlPoints[be2] * direction.y;
 					vec3 z = triangle.controlPoints[be3] * direction.z;
@@ -357,15 +221,13 @@ template <typename T>
 inline glm::mat2x2 jacobianBezierTriangle(
     const T& triangle, const vec3 n1, const vec3 n2, const float u, const float v)
 {
-	vec3 dirU = vec3(1, 0, -1);
-	vec3 dirV = vec3(0, 1, -1);
-	vec3 partialDerivative1 = partialBezierTriangleDirectional(triangle, dirU, u, v);
-	vec3 partialDerivative2 = partialBezierTriangleDirectional(triangle, dirV, u, v);
-
-	return glm::mat2x2(dot(n1, partialDerivative1),
-	                   dot(n2, partialDerivative1),
-	                   dot(n1, partialDerivative2),
-	                   dot(n2, partialDerivative2));
+	const BezierPatchEvaluation evaluation
+	    = evaluateBezierPatch<degree<T>()>(triangle.controlPoints, u, v);
+
+	return glm::mat2x2(dot(n1, evaluation.partialU),
+	                   dot(n2, evaluation.partialU),
+	                   dot(n1, evaluation.partialV),
+	                   dot(n2, evaluation.partialV));
 }
 
 inline glm::mat2x2 inverseJacobian(const glm::mat2x2 J)
@@ -408,9 +270,19 @@ inline bool newtonsMethodTriangle2([[maybe_unused]] RaytracingScene& raytracingS
 	float previousErrorF = 100000.0;
 	float errorF = 100000.0;
 
+	// project onto planes
+	const float d1 = dot(-n1, origin);
+	const float d2 = dot(-n2, origin);
+
 	for (; c < raytracingDataConstants.newtonMaxIterations; c++)
 	{
-		glm::mat2x2 j = jacobianBezierTriangle(triangle, n1, n2, u[c].x, u[c].y);
+		// the point and the jacobian from one evaluation of the triangle
+		const BezierPatchEvaluation evaluation
+		    = evaluateBezierPatch<degree<T>()>(triangle.controlPoints, u[c].x, u[c].y);
+		glm::mat2x2 j = glm::mat2x2(dot(n1, evaluation.partialU),
+		                            dot(n2, evaluation.partialU),
+		                            dot(n1, evaluation.partialV),
+		                            dot(n2, evaluation.partialV));
 		glm::mat2x2 inv_j = inverseJacobian(j);
 		if (inv_j == glm::mat2x2(0, 0, 0, 0))
 		{
@@ -419,7 +291,7 @@ inline bool newtonsMethodTriangle2([[maybe_unused]] RaytracingScene& raytracingS
 		}
 
 		glm::vec2 f_value
-		    = fBezierTriangle(triangle, origin, n1, n2, u[c].x, u[c].y, 1.0f - u[c].x - u[c].y);
+		    = glm::vec2(dot(n1, evaluation.point) + d1, dot(n2, evaluation.point) + d2);
 
 		previousErrorF = errorF;
 		errorF = glm::abs(f_value.x) + glm::abs(f_value.y);
@@ -427,8 +299,8 @@ inline bool newtonsMethodTriangle2([[maybe_unused]] RaytracingScene& raytracingS
 		vec2 differenceInUV = inv_j * f_value;
 		u[c + 1] = u[c] - differenceInUV;
 
-		vec3 surfacePoint = BezierTrianglePoint(triangle, u[c].x, u[c].y, 1.0f - u[c].x - u[c].y);
-		auto sceneObject = raytracingScene.createSceneObject(surfacePoint);
+		vec3 surfacePoint = evaluation.point;
+		auto sceneObject = raytracingScene.createDebugSceneObject(surfacePoint);
 		raytracingScene.addObjectSphere(
 		    *sceneObject,
 		    surfacePoint,
@@ -511,7 +383,8 @@ inline void visualizePlane(RaytracingScene& raytracingScene,
 	glm::vec3 b2 = glm::normalize(glm::cross(normal, b1));
 	glm::vec3 b3 = glm::normalize(glm::cross(normal, b2));
 
-	auto sceneObject = raytracingScene.createSceneObject();
+	auto sceneObject = raytracingScene.createDebugSceneObject();
+	sceneObject->instanceMask = InstanceMask::t_SlicingPlaneHelperInstance;
 	float stepSize = 0.1f;
 	for (float x = 0; x <= sizeX; x += stepSize)
 	{
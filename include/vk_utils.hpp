@@ -11,6 +11,7 @@
 #include "vk_mem_alloc.h"
 
 #include "deletion_queue.hpp"
+#include "memory_telemetry.hpp"
 #include "types.hpp"
 
 namespace tracer
@@ -126,27 +127,30 @@ inline tracer::QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDev
 		//           << std::endl;
 
 		bool hasGraphicsBit = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
-		if (hasGraphicsBit)
+		if (hasGraphicsBit && !indices.graphicsFamily.has_value())
 		{
 			indices.graphicsFamily = i;
 		}
 
-		// bool hasTransferBit = queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
-		// if (!hasGraphicsBit && hasTransferBit)
-		// {
-		// 	indices.transferFamily = i;
-		// }
+		// a dedicated transfer family usually maps to the DMA engines of the GPU
+		bool hasTransferBit = queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
+		bool hasComputeBit = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+		if (!hasGraphicsBit && !hasComputeBit && hasTransferBit
+		    && !indices.transferFamily.has_value())
+		{
+			indices.transferFamily = i;
+		}
 
 		VkBool32 presentCapabilitiesSupported = false;
 		vkGetPhysicalDeviceSurfaceSupportKHR(
 		    physicalDevice, i, vulkanSurface, &presentCapabilitiesSupported);
 
-		if (presentCapabilitiesSupported)
+		if (presentCapabilitiesSupported && !indices.presentFamily.has_value())
 		{
 			indices.presentFamily = i;
 		}
 
-		if (indices.isComplete()) break;
+		if (indices.isComplete() && indices.transferFamily.has_value()) break;
 
 		i++;
 	}
@@ -165,19 +169,25 @@ inline tracer::QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDev
 	return indices;
 }
 
-// creates a buffer and allocates memory for it on the GPU
+// creates a buffer and allocates memory for it on the GPU, the allocation is tracked in the
+// MemoryTelemetry under the given category until the deletion queue destroys it
+// allocationFlags: pass 0 for buffers that are never mapped so VMA does not prefer host visible
+// memory for them
 inline void
 createBuffer([[maybe_unused]] VkPhysicalDevice physicalDevice,
              [[maybe_unused]] VkDevice logicalDevice,
              VmaAllocator allocator,
              DeletionQueue& deletionQueue,
+             AllocationCategory category,
              VkDeviceSize size,
              VkBufferUsageFlags usage,
              VkMemoryPropertyFlags properties,
              [[maybe_unused]] const VkMemoryAllocateFlagsInfo& additionalMemoryAllocateFlagsInfo,
              VkBuffer& buffer,
              VmaAllocation& allocation,
-             VkDeviceSize alignment = 0)
+             VkDeviceSize alignment = 0,
+             VmaAllocationCreateFlags allocationFlags
+             = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT)
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -191,7 +201,7 @@ createBuffer([[maybe_unused]] VkPhysicalDevice physicalDevice,
 	allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
 	allocInfo.requiredFlags = properties;
 
-	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+	allocInfo.flags = allocationFlags;
 	allocInfo.memoryTypeBits = 0; // no restrictions
 
 	if (alignment == 0)
@@ -205,22 +215,66 @@ createBuffer([[maybe_unused]] VkPhysicalDevice physicalDevice,
 		    allocator, &bufferInfo, &allocInfo, alignment, &buffer, &allocation, nullptr));
 	}
 
-	deletionQueue.push_function([=]() { vmaDestroyBuffer(allocator, buffer, allocation); });
+	VmaAllocationInfo allocationInfo = {};
+	vmaGetAllocationInfo(allocator, allocation, &allocationInfo);
+	const VkDeviceSize allocationSize = allocationInfo.size;
+	getMemoryTelemetry().trackAllocation(category, allocationSize);
+
+	deletionQueue.push_buffer(allocator, buffer, allocation, category, allocationSize);
+}
+
+// creates a host visible buffer that stays mapped until it is destroyed
+// (VMA_ALLOCATION_CREATE_MAPPED_BIT), wrap the returned pointer into a MappedBufferView to write
+// into it
+// @return the mapped memory of the buffer
+[[nodiscard]] inline void*
+createMappedBuffer(VkPhysicalDevice physicalDevice,
+                   VkDevice logicalDevice,
+                   VmaAllocator allocator,
+                   DeletionQueue& deletionQueue,
+                   AllocationCategory category,
+                   VkDeviceSize size,
+                   VkBufferUsageFlags usage,
+                   VkMemoryPropertyFlags properties,
+                   const VkMemoryAllocateFlagsInfo& additionalMemoryAllocateFlagsInfo,
+                   VkBuffer& buffer,
+                   VmaAllocation& allocation)
+{
+	createBuffer(physicalDevice,
+	             logicalDevice,
+	             allocator,
+	             deletionQueue,
+	             category,
+	             size,
+	             usage,
+	             properties | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+	             additionalMemoryAllocateFlagsInfo,
+	             buffer,
+	             allocation,
+	             0,
+	             VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+	                 | VMA_ALLOCATION_CREATE_MAPPED_BIT);
 
 	VmaAllocationInfo allocationInfo = {};
 	vmaGetAllocationInfo(allocator, allocation, &allocationInfo);
+	assert(allocationInfo.pMappedData != nullptr);
+	return allocationInfo.pMappedData;
 }
 
+// maps, copies and unmaps, only meant for buffers that are written once, buffers that are written
+// repeatedly should be created with createMappedBuffer()
 inline void copyDataToBuffer(VmaAllocator vmaAllocator,
                              VmaAllocation allocation,
                              const void* data,
                              VkDeviceSize size)
 {
 	void* memoryBuffer;
-	vmaMapMemory(vmaAllocator, allocation, &memoryBuffer);
+	VK_CHECK_RESULT(vmaMapMemory(vmaAllocator, allocation, &memoryBuffer));
 	// VK_CHECK_RESULT(vkMapMemory(logicalDevice, bufferMemory, 0, size, 0, &memoryBuffer));
 
 	memcpy(memoryBuffer, data, size);
+	// no-op if the memory is host coherent
+	VK_CHECK_RESULT(vmaFlushAllocation(vmaAllocator, allocation, 0, size));
 	vmaUnmapMemory(vmaAllocator, allocation);
 }
 
@@ -275,9 +329,32 @@ inline void addImageMemoryBarrier(VkCommandBuffer commandBuffer,
 	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
 }
 
+[[nodiscard]] inline bool isDeviceExtensionSupported(VkPhysicalDevice physicalDevice,
+                                                     const char* extensionName)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(
+	    physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+	for (const auto& extension : availableExtensions)
+	{
+		if (strcmp(extension.extensionName, extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// memoryBudget: VK_EXT_memory_budget has to be enabled on the device, VMA then queries the real
+// heap budgets instead of estimating them
 inline VmaAllocator createVMAAllocator(VkPhysicalDevice _physicalDevice,
                                        VkInstance _vulkanInstance,
-                                       VkDevice _logicalDevice)
+                                       VkDevice _logicalDevice,
+                                       const bool memoryBudget)
 {
 
 	VmaVulkanFunctions vulkanFunctions = {};
@@ -290,6 +367,10 @@ inline VmaAllocator createVMAAllocator(VkPhysicalDevice _physicalDevice,
 	allocatorInfo.instance = _vulkanInstance;
 	allocatorInfo.device = _logicalDevice;
 	allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+	if (memoryBudget)
+	{
+		allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+	}
 	allocatorInfo.pVulkanFunctions = &vulkanFunctions;
 
 	VmaAllocator allocator;
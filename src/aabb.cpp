@@ -1,5 +1,11 @@
 #include "aabb.hpp"
 
+#include <array>
+#include <vector>
+
+#include <glm/geometric.hpp>
+
+#include "bernstein_tables.hpp"
 #include "tetrahedron.hpp"
 #include "rectangularBezierSurface.hpp"
 #include "common_types.h"
@@ -143,4 +149,141 @@ AABB AABB::fromSphere(const Sphere& sphere, const bool localSpace)
 			},
 		};
 }
+namespace
+{
+
+// the barycentric (u, v, w) parameters of the corners of a sub triangle of a bezier patch, the
+// corner cornerU belongs to the control point b_n00 of the sub patch
+struct SubTriangle
+{
+	glm::vec3 cornerU;
+	glm::vec3 cornerV;
+	glm::vec3 cornerW;
+};
+
+// the control point b'_ijk of the sub patch is the blossom of the patch at cornerU (i times),
+// cornerV (j times) and cornerW (k times), de Casteljau with a different parameter per step
+void getSubPatchControlPoints(const std::span<const glm::vec3> controlPoints,
+                              const int n,
+                              const SubTriangle& triangle,
+                              std::vector<glm::vec3>& subControlPoints,
+                              std::vector<glm::vec3>& scratch)
+{
+	for (int j = 0; j <= n; j++)
+	{
+		for (int i = 0; i <= n - j; i++)
+		{
+			scratch.assign(controlPoints.begin(), controlPoints.end());
+			for (int step = 0; step < n; step++)
+			{
+				const glm::vec3 t = step < i       ? triangle.cornerU
+				                    : step < i + j ? triangle.cornerV
+				                                   : triangle.cornerW;
+				// the points of degree m are written in place, every point only reads points of
+				// degree m + 1 at the same or a higher index
+				const int m = n - step - 1;
+				for (int b = 0; b <= m; b++)
+				{
+					for (int a = 0; a <= m - b; a++)
+					{
+						scratch[getBezierPatchControlPointIndex(m, a, b)]
+						    = t.x * scratch[getBezierPatchControlPointIndex(m + 1, a + 1, b)]
+						      + t.y * scratch[getBezierPatchControlPointIndex(m + 1, a, b + 1)]
+						      + t.z * scratch[getBezierPatchControlPointIndex(m + 1, a, b)];
+					}
+				}
+			}
+			subControlPoints[getBezierPatchControlPointIndex(n, i, j)] = scratch[0];
+		}
+	}
+}
+
+// the largest distance of the control points to the flat triangle through the corners
+float getFlatnessError(const std::span<const glm::vec3> controlPoints, const int n)
+{
+	const glm::vec3 cornerU = controlPoints[getBezierPatchControlPointIndex(n, n, 0)];
+	const glm::vec3 cornerV = controlPoints[getBezierPatchControlPointIndex(n, 0, n)];
+	const glm::vec3 cornerW = controlPoints[getBezierPatchControlPointIndex(n, 0, 0)];
+	const float degree = static_cast<float>(n);
+
+	float error = 0.0f;
+	for (int j = 0; j <= n; j++)
+	{
+		for (int i = 0; i <= n - j; i++)
+		{
+			const glm::vec3 flat
+			    = (static_cast<float>(i) * cornerU + static_cast<float>(j) * cornerV
+			       + static_cast<float>(n - i - j) * cornerW)
+			      / degree;
+			const glm::vec3 point = controlPoints[getBezierPatchControlPointIndex(n, i, j)];
+			error = glm::max(error, glm::distance(point, flat));
+		}
+	}
+	return error;
+}
+
+void unionSubdividedBounds(const std::span<const glm::vec3> controlPoints,
+                           const int n,
+                           const SubTriangle& triangle,
+                           const float tolerance,
+                           const int depth,
+                           AABB& bounds,
+                           std::vector<glm::vec3>& subControlPoints,
+                           std::vector<glm::vec3>& scratch)
+{
+	// the sub patches are always taken from the whole patch, so the rounding errors do not add up
+	getSubPatchControlPoints(controlPoints, n, triangle, subControlPoints, scratch);
+	if (depth <= 0 || getFlatnessError(subControlPoints, n) <= tolerance)
+	{
+		const AABB subBounds = AABB::fromControlPoints(subControlPoints);
+		bounds.min = glm::min(bounds.min, subBounds.min);
+		bounds.max = glm::max(bounds.max, subBounds.max);
+		return;
+	}
+
+	const glm::vec3 midpointUV = 0.5f * (triangle.cornerU + triangle.cornerV);
+	const glm::vec3 midpointVW = 0.5f * (triangle.cornerV + triangle.cornerW);
+	const glm::vec3 midpointWU = 0.5f * (triangle.cornerW + triangle.cornerU);
+	const std::array<SubTriangle, 4> children = {
+	    SubTriangle{triangle.cornerU, midpointUV, midpointWU},
+	    SubTriangle{midpointUV, triangle.cornerV, midpointVW},
+	    SubTriangle{midpointWU, midpointVW, triangle.cornerW},
+	    SubTriangle{midpointVW, midpointWU, midpointUV},
+	};
+	for (const SubTriangle& child : children)
+	{
+		unionSubdividedBounds(
+		    controlPoints, n, child, tolerance, depth - 1, bounds, subControlPoints, scratch);
+	}
+}
+
+} // namespace
+
+AABB AABB::fromBezierPatchSubdivision(const std::span<const glm::vec3> controlPoints,
+                                      const uint32_t degree,
+                                      const float relativeTolerance,
+                                      const int maxDepth)
+{
+	assert(controlPoints.size() == getBezierTriangleControlPointCount(degree));
+	const AABB controlPointBounds = fromControlPoints(controlPoints);
+	const float tolerance
+	    = relativeTolerance * glm::length(controlPointBounds.max - controlPointBounds.min);
+
+	AABB bounds{
+	    .min = controlPointBounds.max,
+	    .max = controlPointBounds.min,
+	};
+	std::vector<glm::vec3> subControlPoints(controlPoints.size());
+	std::vector<glm::vec3> scratch(controlPoints.size());
+	unionSubdividedBounds(controlPoints,
+	                      static_cast<int>(degree),
+	                      SubTriangle{glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1)},
+	                      tolerance,
+	                      maxDepth,
+	                      bounds,
+	                      subControlPoints,
+	                      scratch);
+	return bounds;
+}
+
 } // namespace tracer
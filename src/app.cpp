@@ -56,7 +56,9 @@ void Application::run()
 
 	initVulkan();
 
-	vmaAllocator = tracer::createVMAAllocator(physicalDevice, vulkanInstance, logicalDevice);
+	vmaAllocator = tracer::createVMAAllocator(
+	    physicalDevice, vulkanInstance, logicalDevice, memoryBudgetSupported);
+	tracer::getMemoryTelemetry().setMemoryBudgetExtensionEnabled(memoryBudgetSupported);
 
 	raytracingScene = std::make_unique<tracer::rt::RaytracingScene>(
 	    physicalDevice, logicalDevice, vmaAllocator);
@@ -225,10 +227,17 @@ bool Application::loadOpenVolumeMeshFile(std::filesystem::path path,
 	}
 
 	raytracingScene.clearScene();
+	raytracingScene.setCompactAccelerationStructures(sceneConfig.compactAccelerationStructures);
+	raytracingScene.setBLASClusterSize(sceneConfig.blasClusterSize);
+	raytracingScene.setBezierBoundsMode(sceneConfig.tightBezierPatchBounds
+	                                        ? tracer::BezierBoundsMode::Subdivision
+	                                        : tracer::BezierBoundsMode::ControlPoints);
 
 	// first sphere represents light
 	auto sceneObjectLight = raytracingScene.createNamedSceneObject(
 	    "light", renderer.getRaytracingDataConstants().globalLightPosition);
+	// shadow rays never traverse the light
+	sceneObjectLight->instanceMask = InstanceMask::t_LightInstance;
 	raytracingScene.addObjectSphere(*sceneObjectLight,
 	                                renderer.getRaytracingDataConstants().globalLightPosition,
 	                                true,
@@ -408,7 +417,7 @@ bool Application::loadOpenVolumeMeshFile(std::filesystem::path path,
 
 	if (sceneConfig.visualizeControlPoints)
 	{
-		auto sceneObjectControlPoints = raytracingScene.createSceneObject();
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 		for (auto& point : allControlPoints)
 		{
 			raytracingScene.addObjectSphere(
@@ -416,7 +425,7 @@ bool Application::loadOpenVolumeMeshFile(std::filesystem::path path,
 		}
 	}
 
-	auto sceneObjectControlPoints = raytracingScene.createSceneObject();
+	auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 	for (auto& bezierTriangle : allBezierTriangles2)
 	{
 		tracer::rt::visualizeTriangleSide(*sceneObjectControlPoints,
@@ -526,7 +535,6 @@ void Application::setupScene()
 	// Rebuild Bottom and Top Level Acceleration Structure
 	if (raytracingSupported)
 	{
-		vkQueueWaitIdle(renderer->getRaytracingInfo().graphicsQueueHandle);
 		raytracingScene->recreateAccelerationStructures(renderer->getRaytracingInfo(), true);
 
 		// =========================================================================
@@ -671,7 +679,16 @@ void Application::initVulkan()
 		throw std::runtime_error("failed to find a suitable GPU!");
 
 	assert(deviceExtensions != NULL);
-	createLogicalDevice(*deviceExtensions);
+
+	// optional extensions are only enabled when the selected device supports them
+	std::vector<const char*> enabledDeviceExtensions = *deviceExtensions;
+	memoryBudgetSupported
+	    = tracer::isDeviceExtensionSupported(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (memoryBudgetSupported)
+	{
+		enabledDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+	createLogicalDevice(enabledDeviceExtensions);
 
 	vulkan_initialized = true;
 }
@@ -695,14 +712,14 @@ void Application::createLogicalDevice(const std::vector<const char*>& requiredDe
 		uniqueQueueFamilies.insert(indices.graphicsFamily.value());
 	if (indices.presentFamily.has_value())
 		uniqueQueueFamilies.insert(indices.presentFamily.value());
-	// if (indices.transferFamily.has_value())
-	// 	uniqueQueueFamilies.insert(indices.transferFamily.value());
+	if (indices.transferFamily.has_value())
+		uniqueQueueFamilies.insert(indices.transferFamily.value());
 
-	// add the unique families into a list
+	// add the unique families into a list, the priority has to outlive the loop since the create
+	// infos point to it
+	const float queuePriority = 1.0f;
 	for (auto const queueFamily : uniqueQueueFamilies)
 	{
-		float queuePriority = 1.0f;
-
 		VkDeviceQueueCreateInfo queueCreateInfo{};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		queueCreateInfo.queueFamilyIndex = queueFamily;
@@ -836,9 +853,12 @@ void Application::createLogicalDevice(const std::vector<const char*>& requiredDe
 		vkGetDeviceQueue(logicalDevice, indices.presentFamily.value(), 0, &presentQueue);
 	debug_printFmt("Present queue: %p\n", static_cast<void*>(presentQueue));
 
-	// if (indices.transferFamily.has_value())
-	// 	vkGetDeviceQueue(logicalDevice, indices.transferFamily.value(), 0, &transferQueue);
-	// debug_print("Transfer queue: %p\n", static_cast<void*>(transferQueue));
+	// without a dedicated transfer family the uploads are executed on the graphics queue
+	if (indices.transferFamily.has_value())
+		vkGetDeviceQueue(logicalDevice, indices.transferFamily.value(), 0, &transferQueue);
+	else
+		transferQueue = graphicsQueue;
+	debug_printFmt("Transfer queue: %p\n", static_cast<void*>(transferQueue));
 }
 
 bool Application::checkDeviceExtensionSupport(
@@ -1198,7 +1218,7 @@ void Application::cleanupApp()
 
 	vkDeviceWaitIdle(logicalDevice);
 
-	raytracingScene->cleanup(graphicsQueue);
+	raytracingScene->cleanup(renderer->getRaytracingInfo());
 	renderer->cleanupRenderer();
 
 	window.cleanupSwapChain(logicalDevice);
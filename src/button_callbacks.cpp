@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <chrono>
 #include <cstdio>
+#include <fstream>
 #include <utility>
 #include <format>
 
@@ -16,6 +18,7 @@
 #include "renderer.hpp"
 #include "raytracing_scene.hpp"
 #include "input.hpp"
+#include "reference_renderer.hpp"
 #include "visualizations.hpp"
 
 namespace tracer
@@ -120,6 +123,77 @@ static void loadScene(Renderer& renderer, ui::UIData& uiData, const int sceneNr)
 	uiData.recreateAccelerationStructures.requestRecreate(true);
 };
 
+// reloads the current scene (clearScene() + full rebuild), afterwards the allocations of every
+// category have to match the ones of the current build again, see Renderer::drawFrame()
+static void checkMemoryLeaks(Renderer& renderer, ui::UIData& uiData)
+{
+	// buffers of earlier builds that are still retired would be part of the baseline
+	renderer.getCurrentRaytracingScene().flushRetiredResources(renderer.getRaytracingInfo());
+	getMemoryTelemetry().captureBaseline();
+	loadScene(renderer, uiData, renderer.getCurrentRaytracingScene().getCurrentSceneNr());
+	uiData.memoryLeakCheckPending = true;
+};
+
+static void dumpMemoryTelemetry()
+{
+	auto timenow = std::chrono::system_clock::now();
+	const auto timestamp = std::format("{:%d-%m-%Y_%H-%M-%S}", timenow);
+
+	std::filesystem::create_directories("telemetry");
+	std::filesystem::path path = std::format("telemetry/memory_{}.json", timestamp);
+	std::ofstream file(path);
+	file << getMemoryTelemetry().toJSON();
+
+	std::cout << "Memory telemetry saved to disk: " << std::filesystem::absolute(path)
+	          << std::endl;
+};
+
+// renders the current scene with the camera of the last frame on the CPU, the image can be
+// compared with a screenshot of the same resolution
+static void renderReferenceImage(Renderer& renderer, const Window& window)
+{
+	auto timenow = std::chrono::system_clock::now();
+	const auto timestamp = std::format("{:%d-%m-%Y_%H-%M-%S}", timenow);
+
+	const auto width = static_cast<uint32_t>(window.getWidth());
+	const auto height = static_cast<uint32_t>(window.getHeight());
+	const ReferenceScene scene
+	    = ReferenceScene::fromRaytracingScene(renderer.getCurrentRaytracingScene());
+	const ReferenceRenderer referenceRenderer(scene,
+	                                          renderer.getRaytracingDataConstants(),
+	                                          renderer.getRaytracingInfo().uniformStructure);
+	const ReferenceImage image = referenceRenderer.render(width, height);
+
+	std::filesystem::create_directories("screenshots");
+	std::filesystem::path path = std::format("screenshots/reference_{}_{}x{}_{}ms.ppm",
+	                                         timestamp,
+	                                         width,
+	                                         height,
+	                                         static_cast<int>(image.milliseconds));
+	image.writePPM(path);
+
+	const auto slowestTile = std::max_element(image.tileTimings.begin(),
+	                                          image.tileTimings.end(),
+	                                          [](const auto& a, const auto& b)
+	                                          { return a.milliseconds < b.milliseconds; });
+	std::printf("Reference image rendered in %.1f ms (%s kernel, %zu tiles, slowest tile at %u,%u: "
+	            "%.1f ms)\n",
+	            image.milliseconds,
+	            getNewtonPacketKernel().name,
+	            image.tileTimings.size(),
+	            slowestTile != image.tileTimings.end() ? slowestTile->x : 0,
+	            slowestTile != image.tileTimings.end() ? slowestTile->y : 0,
+	            slowestTile != image.tileTimings.end() ? slowestTile->milliseconds : 0.0);
+
+	// compare runs with and without the tight bezier patch bounds
+	const auto& boundsTelemetry = renderer.getCurrentRaytracingScene().getBezierBoundsTelemetry();
+	std::printf("Intersection shader invocations: %llu (bezier patch AABB volume: %.1f %% of the "
+	            "control point boxes)\n",
+	            static_cast<unsigned long long>(image.intersectionInvocations),
+	            boundsTelemetry.getVolumeRatio() * 100.0);
+	std::cout << "Reference image saved to disk: " << std::filesystem::absolute(path) << std::endl;
+};
+
 void registerButtonFunctions(Window& window, Renderer& renderer, Camera& camera, ui::UIData& uiData)
 {
 
@@ -155,6 +229,13 @@ void registerButtonFunctions(Window& window, Renderer& renderer, Camera& camera,
 	                    tracer::KeyListeningMode::UI_AND_FLYING_CAMERA,
 	                    takeScreenshot);
 
+	uiData.buttonCallbacks.push_back(ui::ButtonData{
+	    .label = "Render CPU Reference Image",
+	    .tooltip = "Renders the current frame on the CPU and saves it to a .ppm file in the "
+	               "directory ./screenshots/, to compare the shaders with the reference renderer",
+	    .callback = [&]() { renderReferenceImage(renderer, window); },
+	});
+
 	uiData.buttonCallbacks.push_back(ui::ButtonData{
 	    .label = "Set Window Resolution 1920x1080",
 	    .tooltip = "Sets the window Resolution to 1920x1080",
@@ -209,6 +290,20 @@ void registerButtonFunctions(Window& window, Renderer& renderer, Camera& camera,
 	    .callback = [&]() { visualizeSlicingPlanes(renderer, uiData); },
 	});
 
+	uiData.buttonCallbacks.push_back(ui::ButtonData{
+	    .label = "Dump Memory Telemetry",
+	    .tooltip = "Saves the allocations per category and the heap budgets to a .json file in the "
+	               "directory ./telemetry/",
+	    .callback = dumpMemoryTelemetry,
+	});
+
+	uiData.buttonCallbacks.push_back(ui::ButtonData{
+	    .label = "Check Memory Leaks",
+	    .tooltip = "Reloads the current scene and checks that the allocations return to the "
+	               "current values after the rebuild. For debugging only.",
+	    .callback = [&]() { checkMemoryLeaks(renderer, uiData); },
+	});
+
 	auto moveCameraHome = [&]() { camera.resetPositionAndOrientation(); };
 	uiData.buttonCallbacks.push_back(ui::ButtonData{
 	    .label = "[H] move camera [H]ome",
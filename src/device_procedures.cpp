@@ -17,6 +17,9 @@ PFN_vkGetAccelerationStructureDeviceAddressKHR pvkGetAccelerationStructureDevice
 PFN_vkCmdBuildAccelerationStructuresKHR pvkCmdBuildAccelerationStructuresKHR = NULL;
 PFN_vkDestroyAccelerationStructureKHR pvkDestroyAccelerationStructureKHR = NULL;
 PFN_vkGetRayTracingShaderGroupHandlesKHR pvkGetRayTracingShaderGroupHandlesKHR = NULL;
+PFN_vkCmdWriteAccelerationStructuresPropertiesKHR pvkCmdWriteAccelerationStructuresPropertiesKHR
+    = NULL;
+PFN_vkCmdCopyAccelerationStructureKHR pvkCmdCopyAccelerationStructureKHR = NULL;
 
 void grabDeviceProcAddr(VkDevice logicalDevice)
 {
@@ -95,6 +98,24 @@ void grabDeviceProcAddr(VkDevice logicalDevice)
 		                         "enabled?");
 	}
 
+	pvkCmdWriteAccelerationStructuresPropertiesKHR
+	    = (PFN_vkCmdWriteAccelerationStructuresPropertiesKHR)vkGetDeviceProcAddr(
+	        logicalDevice, "vkCmdWriteAccelerationStructuresPropertiesKHR");
+	if (pvkCmdWriteAccelerationStructuresPropertiesKHR == nullptr)
+	{
+		throw std::runtime_error("Error: grabDeviceProcAddr - "
+		                         "vkCmdWriteAccelerationStructuresPropertiesKHR is NULL. Is this "
+		                         "feature enabled?");
+	}
+
+	pvkCmdCopyAccelerationStructureKHR = (PFN_vkCmdCopyAccelerationStructureKHR)vkGetDeviceProcAddr(
+	    logicalDevice, "vkCmdCopyAccelerationStructureKHR");
+	if (pvkCmdCopyAccelerationStructureKHR == nullptr)
+	{
+		throw std::runtime_error("Error: grabDeviceProcAddr - vkCmdCopyAccelerationStructureKHR is "
+		                         "NULL. Is this feature enabled?");
+	}
+
 	pvkCmdTraceRaysKHR
 	    = (PFN_vkCmdTraceRaysKHR)vkGetDeviceProcAddr(logicalDevice, "vkCmdTraceRaysKHR");
 	if (pvkCmdTraceRaysKHR == nullptr)
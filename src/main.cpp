@@ -1,8 +1,66 @@
+#include <cstdio>
 #include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "app.hpp"
+#include "reference_renderer.hpp"
 
-int main()
+// renders the reference image of a scene on the CPU without creating a window or a vulkan device
+// usage: --render-reference <scene> <out.ppm> [<width> <height>]
+static int renderReferenceImage(const std::vector<std::string_view>& arguments)
+{
+	if (arguments.size() != 3 && arguments.size() != 5)
+	{
+		std::cerr << "usage: vulkan_raytracer --render-reference <scene> <out.ppm> [<width> "
+		             "<height>]"
+		          << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		const int sceneNr = std::stoi(std::string(arguments[1]));
+		const std::filesystem::path path(arguments[2]);
+		uint32_t width = 1280;
+		uint32_t height = 720;
+		if (arguments.size() == 5)
+		{
+			width = static_cast<uint32_t>(std::stoul(std::string(arguments[3])));
+			height = static_cast<uint32_t>(std::stoul(std::string(arguments[4])));
+		}
+		if (width == 0 || height == 0)
+		{
+			throw std::runtime_error("renderReferenceImage - width and height must not be 0");
+		}
+
+		const tracer::rt::ReferenceImage image
+		    = tracer::rt::renderReferenceScene(sceneNr, width, height);
+		image.writePPM(path);
+
+		std::printf("Reference image of scene %d rendered in %.1f ms (%s kernel, %zu tiles, %llu "
+		            "intersection shader invocations)\n",
+		            sceneNr,
+		            image.milliseconds,
+		            tracer::rt::getNewtonPacketKernel().name,
+		            image.tileTimings.size(),
+		            static_cast<unsigned long long>(image.intersectionInvocations));
+		std::cout << "Reference image saved to disk: " << std::filesystem::absolute(path)
+		          << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
 {
 
 #ifdef NDEBUG
@@ -11,6 +69,12 @@ int main()
 	std::cout << "Running in debug mode" << '\n';
 #endif
 
+	const std::vector<std::string_view> arguments(argv + 1, argv + argc);
+	if (!arguments.empty() && arguments[0] == "--render-reference")
+	{
+		return renderReferenceImage(arguments);
+	}
+
 	Application app;
 
 	try
@@ -0,0 +1,202 @@
+#include "newton_packet.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define NEWTON_PACKET_SSE2
+// the AVX2 kernel is compiled with the target attribute, the rest of the project stays SSE2
+#if defined(__GNUC__)
+#define NEWTON_PACKET_AVX2
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NEWTON_PACKET_NEON
+#endif
+
+namespace tracer
+{
+namespace rt
+{
+
+namespace
+{
+
+#if defined(NEWTON_PACKET_SSE2)
+namespace sse2
+{
+
+#define NEWTON_KERNEL_TARGET
+
+using Float = __m128;
+using Mask = __m128;
+constexpr size_t SIMD_WIDTH = 4;
+
+// clang-format off
+inline Float broadcast(const float value) { return _mm_set1_ps(value); }
+inline Float load(const float* values) { return _mm_loadu_ps(values); }
+inline void store(float* values, const Float a) { _mm_storeu_ps(values, a); }
+inline Float add(const Float a, const Float b) { return _mm_add_ps(a, b); }
+inline Float sub(const Float a, const Float b) { return _mm_sub_ps(a, b); }
+inline Float mul(const Float a, const Float b) { return _mm_mul_ps(a, b); }
+inline Float div(const Float a, const Float b) { return _mm_div_ps(a, b); }
+inline Float absolute(const Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline Float negate(const Float a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+inline Mask lessThan(const Float a, const Float b) { return _mm_cmplt_ps(a, b); }
+inline Mask lessEqual(const Float a, const Float b) { return _mm_cmple_ps(a, b); }
+inline Mask greaterThan(const Float a, const Float b) { return _mm_cmpgt_ps(a, b); }
+inline Mask noLanes() { return _mm_setzero_ps(); }
+inline Mask maskAnd(const Mask a, const Mask b) { return _mm_and_ps(a, b); }
+inline Mask maskOr(const Mask a, const Mask b) { return _mm_or_ps(a, b); }
+// a and not b
+inline Mask maskAndNot(const Mask a, const Mask b) { return _mm_andnot_ps(b, a); }
+inline int maskBits(const Mask mask) { return _mm_movemask_ps(mask); }
+// blendv needs SSE4.1
+inline Float select(const Mask mask, const Float a, const Float b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+// clang-format on
+
+#include "newton_packet_kernel.inl"
+
+#undef NEWTON_KERNEL_TARGET
+
+} // namespace sse2
+#endif
+
+#if defined(NEWTON_PACKET_AVX2)
+namespace avx2
+{
+
+#define NEWTON_KERNEL_TARGET __attribute__((target("avx2")))
+
+using Float = __m256;
+using Mask = __m256;
+constexpr size_t SIMD_WIDTH = 8;
+
+// clang-format off
+NEWTON_KERNEL_TARGET
+inline Float broadcast(const float value) { return _mm256_set1_ps(value); }
+NEWTON_KERNEL_TARGET
+inline Float load(const float* values) { return _mm256_loadu_ps(values); }
+NEWTON_KERNEL_TARGET
+inline void store(float* values, const Float a) { _mm256_storeu_ps(values, a); }
+NEWTON_KERNEL_TARGET
+inline Float add(const Float a, const Float b) { return _mm256_add_ps(a, b); }
+NEWTON_KERNEL_TARGET
+inline Float sub(const Float a, const Float b) { return _mm256_sub_ps(a, b); }
+NEWTON_KERNEL_TARGET
+inline Float mul(const Float a, const Float b) { return _mm256_mul_ps(a, b); }
+NEWTON_KERNEL_TARGET
+inline Float div(const Float a, const Float b) { return _mm256_div_ps(a, b); }
+NEWTON_KERNEL_TARGET
+inline Float absolute(const Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+NEWTON_KERNEL_TARGET
+inline Float negate(const Float a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+NEWTON_KERNEL_TARGET
+inline Mask lessThan(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+NEWTON_KERNEL_TARGET
+inline Mask lessEqual(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+NEWTON_KERNEL_TARGET
+inline Mask greaterThan(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+NEWTON_KERNEL_TARGET
+inline Mask noLanes() { return _mm256_setzero_ps(); }
+NEWTON_KERNEL_TARGET
+inline Mask maskAnd(const Mask a, const Mask b) { return _mm256_and_ps(a, b); }
+NEWTON_KERNEL_TARGET
+inline Mask maskOr(const Mask a, const Mask b) { return _mm256_or_ps(a, b); }
+// a and not b
+NEWTON_KERNEL_TARGET
+inline Mask maskAndNot(const Mask a, const Mask b) { return _mm256_andnot_ps(b, a); }
+NEWTON_KERNEL_TARGET
+inline int maskBits(const Mask mask) { return _mm256_movemask_ps(mask); }
+// clang-format on
+NEWTON_KERNEL_TARGET
+inline Float select(const Mask mask, const Float a, const Float b)
+{
+	return _mm256_blendv_ps(b, a, mask);
+}
+
+#include "newton_packet_kernel.inl"
+
+#undef NEWTON_KERNEL_TARGET
+
+} // namespace avx2
+#endif
+
+#if defined(NEWTON_PACKET_NEON)
+namespace neon
+{
+
+#define NEWTON_KERNEL_TARGET
+
+using Float = float32x4_t;
+using Mask = uint32x4_t;
+constexpr size_t SIMD_WIDTH = 4;
+
+// clang-format off
+inline Float broadcast(const float value) { return vdupq_n_f32(value); }
+inline Float load(const float* values) { return vld1q_f32(values); }
+inline void store(float* values, const Float a) { vst1q_f32(values, a); }
+inline Float add(const Float a, const Float b) { return vaddq_f32(a, b); }
+inline Float sub(const Float a, const Float b) { return vsubq_f32(a, b); }
+inline Float mul(const Float a, const Float b) { return vmulq_f32(a, b); }
+inline Float div(const Float a, const Float b) { return vdivq_f32(a, b); }
+inline Float absolute(const Float a) { return vabsq_f32(a); }
+inline Float negate(const Float a) { return vnegq_f32(a); }
+inline Mask lessThan(const Float a, const Float b) { return vcltq_f32(a, b); }
+inline Mask lessEqual(const Float a, const Float b) { return vcleq_f32(a, b); }
+inline Mask greaterThan(const Float a, const Float b) { return vcgtq_f32(a, b); }
+inline Mask noLanes() { return vdupq_n_u32(0); }
+inline Mask maskAnd(const Mask a, const Mask b) { return vandq_u32(a, b); }
+inline Mask maskOr(const Mask a, const Mask b) { return vorrq_u32(a, b); }
+// a and not b
+inline Mask maskAndNot(const Mask a, const Mask b) { return vbicq_u32(a, b); }
+inline Float select(const Mask mask, const Float a, const Float b) { return vbslq_f32(mask, a, b); }
+// clang-format on
+
+inline int maskBits(const Mask mask)
+{
+	const uint32_t laneBits[SIMD_WIDTH] = {1, 2, 4, 8};
+	return static_cast<int>(vaddvq_u32(vandq_u32(mask, vld1q_u32(laneBits))));
+}
+
+#include "newton_packet_kernel.inl"
+
+#undef NEWTON_KERNEL_TARGET
+
+} // namespace neon
+#endif
+
+NewtonPacketKernelInfo selectNewtonPacketKernel()
+{
+#if defined(NEWTON_PACKET_AVX2)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return {.solve = &avx2::newtonsMethodBezierPatchKernel, .name = "AVX2"};
+	}
+#endif
+
+#if defined(NEWTON_PACKET_SSE2)
+	return {.solve = &sse2::newtonsMethodBezierPatchKernel, .name = "SSE2"};
+#elif defined(NEWTON_PACKET_NEON)
+	return {.solve = &neon::newtonsMethodBezierPatchKernel, .name = "NEON"};
+#else
+	return {.solve = &newtonsMethodBezierPatchPacket<RAY_PACKET_WIDTH>, .name = "scalar"};
+#endif
+}
+
+} // namespace
+
+const NewtonPacketKernelInfo& getNewtonPacketKernel()
+{
+	static const NewtonPacketKernelInfo kernel = selectNewtonPacketKernel();
+	return kernel;
+}
+
+} // namespace rt
+} // namespace tracer
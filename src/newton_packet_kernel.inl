@@ -0,0 +1,234 @@
+// The SIMD version of newtonsMethodBezierPatchPacket(), included by newton_packet.cpp once per
+// instruction set. The including namespace provides Float, Mask, SIMD_WIDTH, the operations on
+// them and NEWTON_KERNEL_TARGET, the attribute that compiles the functions for the instruction
+// set. The operations are done in the same order as in the scalar version so all kernels return
+// the same results.
+
+NEWTON_KERNEL_TARGET inline Mask maskFromLanes(const uint8_t* lanes)
+{
+	alignas(32) float values[SIMD_WIDTH];
+	for (size_t lane = 0; lane < SIMD_WIDTH; lane++)
+	{
+		values[lane] = lanes[lane] != 0 ? 1.0f : 0.0f;
+	}
+	return greaterThan(load(values), broadcast(0.0f));
+}
+
+NEWTON_KERNEL_TARGET inline void storeMask(const Mask mask, uint8_t* lanes)
+{
+	const int bits = maskBits(mask);
+	for (size_t lane = 0; lane < SIMD_WIDTH; lane++)
+	{
+		lanes[lane] = static_cast<uint8_t>((bits >> lane) & 1);
+	}
+}
+
+NEWTON_KERNEL_TARGET inline Float dot(const Float (&a)[3], const Float (&b)[3])
+{
+	return add(add(mul(a[0], b[0]), mul(a[1], b[1])), mul(a[2], b[2]));
+}
+
+// evaluateBezierPatchPacket() for SIMD_WIDTH lanes
+NEWTON_KERNEL_TARGET inline void evaluateBezierPatchLanes(
+    const std::span<const glm::vec3> controlPoints,
+    const int n,
+    const Float u,
+    const Float v,
+    Float (&point)[3],
+    Float (&partialU)[3],
+    Float (&partialV)[3])
+{
+	const Float w = sub(sub(broadcast(1.0f), u), v);
+
+	// the powers 0 to n - 1 of u, v and w of all lanes, same values as customPow()
+	Float powU[MAX_BEZIER_PATCH_DEGREE];
+	Float powV[MAX_BEZIER_PATCH_DEGREE];
+	Float powW[MAX_BEZIER_PATCH_DEGREE];
+	powU[0] = broadcast(1.0f);
+	powV[0] = broadcast(1.0f);
+	powW[0] = broadcast(1.0f);
+	for (size_t e = 1; e < static_cast<size_t>(n); e++)
+	{
+		powU[e] = mul(powU[e - 1], u);
+		powV[e] = mul(powV[e - 1], v);
+		powW[e] = mul(powW[e - 1], w);
+	}
+
+	Float cornerU[3] = {broadcast(0.0f), broadcast(0.0f), broadcast(0.0f)};
+	Float cornerV[3] = {broadcast(0.0f), broadcast(0.0f), broadcast(0.0f)};
+	Float cornerW[3] = {broadcast(0.0f), broadcast(0.0f), broadcast(0.0f)};
+	for (int j = 0; j <= n - 1; j++)
+	{
+		for (int i = 0; i <= n - 1 - j; i++)
+		{
+			const glm::vec3 bU = controlPoints[getBezierPatchControlPointIndex(n, i + 1, j)];
+			const glm::vec3 bV = controlPoints[getBezierPatchControlPointIndex(n, i, j + 1)];
+			const glm::vec3 bW = controlPoints[getBezierPatchControlPointIndex(n, i, j)];
+			const Float basis = mul(mul(mul(broadcast(getBernsteinCoefficient(n - 1, i, j)),
+			                                powU[static_cast<size_t>(i)]),
+			                            powV[static_cast<size_t>(j)]),
+			                        powW[static_cast<size_t>(n - 1 - i - j)]);
+			for (glm::length_t axis = 0; axis < 3; axis++)
+			{
+				cornerU[axis] = add(cornerU[axis], mul(broadcast(bU[axis]), basis));
+				cornerV[axis] = add(cornerV[axis], mul(broadcast(bV[axis]), basis));
+				cornerW[axis] = add(cornerW[axis], mul(broadcast(bW[axis]), basis));
+			}
+		}
+	}
+
+	const Float degree = broadcast(static_cast<float>(n));
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		point[axis] = add(add(mul(u, cornerU[axis]), mul(v, cornerV[axis])), mul(w, cornerW[axis]));
+		partialU[axis] = mul(degree, sub(cornerU[axis], cornerW[axis]));
+		partialV[axis] = mul(degree, sub(cornerV[axis], cornerW[axis]));
+	}
+}
+
+// the newton iterations of the lanes firstLane to firstLane + SIMD_WIDTH - 1, the lanes are
+// stopped with masks instead of branches
+NEWTON_KERNEL_TARGET inline void
+newtonsMethodBezierPatchLanes(const std::span<const glm::vec3> controlPoints,
+                              const int n,
+                              const PacketVec3<RAY_PACKET_WIDTH>& rayOrigin,
+                              const PacketVec3<RAY_PACKET_WIDTH>& rayN1,
+                              const PacketVec3<RAY_PACKET_WIDTH>& rayN2,
+                              const glm::vec2 initialGuess,
+                              const LaneMask<RAY_PACKET_WIDTH>& activeLanes,
+                              const NewtonSettings& settings,
+                              const size_t firstLane,
+                              NewtonPacketResult<RAY_PACKET_WIDTH>& result)
+{
+	const Float origin[3] = {load(&rayOrigin.x[firstLane]),
+	                         load(&rayOrigin.y[firstLane]),
+	                         load(&rayOrigin.z[firstLane])};
+	const Float n1[3]
+	    = {load(&rayN1.x[firstLane]), load(&rayN1.y[firstLane]), load(&rayN1.z[firstLane])};
+	const Float n2[3]
+	    = {load(&rayN2.x[firstLane]), load(&rayN2.y[firstLane]), load(&rayN2.z[firstLane])};
+
+	// project onto planes
+	const Float d1 = sub(sub(mul(negate(n1[0]), origin[0]), mul(n1[1], origin[1])),
+	                     mul(n1[2], origin[2]));
+	const Float d2 = sub(sub(mul(negate(n2[0]), origin[0]), mul(n2[1], origin[1])),
+	                     mul(n2[2], origin[2]));
+
+	const Float minDeterminant = broadcast(settings.minDeterminant);
+	const Float toleranceF = broadcast(settings.toleranceF);
+
+	Mask active = maskFromLanes(&activeLanes[firstLane]);
+	Mask hit = noLanes();
+	Float u = broadcast(initialGuess.x);
+	Float v = broadcast(initialGuess.y);
+	Float iterations = broadcast(static_cast<float>(settings.maxIterations));
+	Float errorF = broadcast(100000.0f);
+
+	Float point[3] = {broadcast(0.0f), broadcast(0.0f), broadcast(0.0f)};
+	Float partialU[3] = {broadcast(0.0f), broadcast(0.0f), broadcast(0.0f)};
+	Float partialV[3] = {broadcast(0.0f), broadcast(0.0f), broadcast(0.0f)};
+	for (int c = 0; c < settings.maxIterations; c++)
+	{
+		if (maskBits(active) == 0)
+		{
+			break;
+		}
+
+		Float p[3];
+		Float pu[3];
+		Float pv[3];
+		evaluateBezierPatchLanes(controlPoints, n, u, v, p, pu, pv);
+
+		// the columns of the jacobian
+		const Float j00 = dot(n1, pu);
+		const Float j01 = dot(n2, pu);
+		const Float j10 = dot(n1, pv);
+		const Float j11 = dot(n2, pv);
+
+		const Float determinant = sub(mul(j00, j11), mul(j10, j01));
+		const Float fx = add(dot(n1, p), d1);
+		const Float fy = add(dot(n2, p), d2);
+		const Float previousErrorF = errorF;
+		errorF = add(absolute(fx), absolute(fy));
+
+		const Mask singular = lessThan(absolute(determinant), minDeterminant);
+		const Mask increased
+		    = settings.abortOnIncrease ? greaterThan(errorF, previousErrorF) : noLanes();
+		const Mask converged = lessEqual(errorF, toleranceF);
+		const Mask stopping = maskOr(maskOr(singular, increased), converged);
+		const Mask stopped = maskAnd(active, stopping);
+
+		const Mask stoppedHit = settings.hitBelowTolerance
+		                            ? maskAndNot(maskAndNot(stopped, singular), increased)
+		                            : noLanes();
+		hit = maskOr(hit, stoppedHit);
+		iterations = select(stopped, broadcast(static_cast<float>(c + 1)), iterations);
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			point[axis] = select(stopped, p[axis], point[axis]);
+			partialU[axis] = select(stopped, pu[axis], partialU[axis]);
+			partialV[axis] = select(stopped, pv[axis], partialV[axis]);
+		}
+		active = maskAndNot(active, stopping);
+
+		// inverse of the jacobian times f, the stopped lanes keep their solution
+		const Float inverseDeterminant = div(broadcast(1.0f), determinant);
+		const Float stepU = add(mul(mul(inverseDeterminant, j11), fx),
+		                        mul(mul(inverseDeterminant, negate(j10)), fy));
+		const Float stepV = add(mul(mul(inverseDeterminant, negate(j01)), fx),
+		                        mul(mul(inverseDeterminant, j00), fy));
+		u = select(active, sub(u, stepU), u);
+		v = select(active, sub(v, stepV), v);
+	}
+
+	const Mask outside = maskOr(maskOr(lessThan(u, broadcast(0.0f)), lessThan(v, broadcast(0.0f))),
+	                            greaterThan(add(u, v), broadcast(1.0f)));
+	storeMask(maskAndNot(hit, outside), &result.hit[firstLane]);
+
+	alignas(32) float laneIterations[SIMD_WIDTH];
+	store(laneIterations, iterations);
+	for (size_t lane = 0; lane < SIMD_WIDTH; lane++)
+	{
+		result.iterations[firstLane + lane] = static_cast<int>(laneIterations[lane]);
+	}
+	store(&result.u[firstLane], u);
+	store(&result.v[firstLane], v);
+	store(&result.point.x[firstLane], point[0]);
+	store(&result.point.y[firstLane], point[1]);
+	store(&result.point.z[firstLane], point[2]);
+	store(&result.partialU.x[firstLane], partialU[0]);
+	store(&result.partialU.y[firstLane], partialU[1]);
+	store(&result.partialU.z[firstLane], partialU[2]);
+	store(&result.partialV.x[firstLane], partialV[0]);
+	store(&result.partialV.y[firstLane], partialV[1]);
+	store(&result.partialV.z[firstLane], partialV[2]);
+}
+
+NEWTON_KERNEL_TARGET NewtonPacketResult<RAY_PACKET_WIDTH>
+newtonsMethodBezierPatchKernel(const std::span<const glm::vec3> controlPoints,
+                               const int n,
+                               const PacketVec3<RAY_PACKET_WIDTH>& rayOrigin,
+                               const PacketVec3<RAY_PACKET_WIDTH>& n1,
+                               const PacketVec3<RAY_PACKET_WIDTH>& n2,
+                               const glm::vec2 initialGuess,
+                               const LaneMask<RAY_PACKET_WIDTH> active,
+                               const NewtonSettings& settings)
+{
+	static_assert(RAY_PACKET_WIDTH % SIMD_WIDTH == 0);
+
+	NewtonPacketResult<RAY_PACKET_WIDTH> result;
+	for (size_t firstLane = 0; firstLane < RAY_PACKET_WIDTH; firstLane += SIMD_WIDTH)
+	{
+		newtonsMethodBezierPatchLanes(controlPoints,
+		                              n,
+		                              rayOrigin,
+		                              n1,
+		                              n2,
+		                              initialGuess,
+		                              active,
+		                              settings,
+		                              firstLane,
+		                              result);
+	}
+	return result;
+}
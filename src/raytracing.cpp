@@ -13,7 +13,6 @@
 #include "raytracing.hpp"
 #include "logger.hpp"
 #include "raytracing_scene.hpp"
-#include "raytracing_worldobject.hpp"
 #include "shader_module.hpp"
 #include "tetrahedron.hpp"
 #include "visualizations.hpp"
@@ -90,9 +89,62 @@ void createCommandBufferBuildTopAndBottomLevel(VkDevice logicalDevice,
 }
 
 void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
-                                              const rt::RaytracingScene& raytracingScene,
+                                              rt::RaytracingScene& raytracingScene,
                                               RaytracingInfo& raytracingInfo)
 {
+	// the submitted frames might still use the set, it must not be updated then. A new set is
+	// written instead, the old one is freed once the frames are done
+	bool descriptorSetReplaced = false;
+	if (!isFrameTimelineIdle(logicalDevice, raytracingInfo.frameTimeline))
+	{
+		VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {
+		    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		    .pNext = NULL,
+		    .descriptorPool = raytracingInfo.descriptorPoolHandle,
+		    .descriptorSetCount = 1,
+		    .pSetLayouts = &raytracingInfo.descriptorSetLayoutHandle,
+		};
+
+		VkDescriptorSet descriptorSetHandle = VK_NULL_HANDLE;
+		const VkResult result = vkAllocateDescriptorSets(
+		    logicalDevice, &descriptorSetAllocateInfo, &descriptorSetHandle);
+		if (result == VK_SUCCESS)
+		{
+			const VkDescriptorPool descriptorPoolHandle = raytracingInfo.descriptorPoolHandle;
+			const VkDescriptorSet retiredDescriptorSetHandle
+			    = raytracingInfo.descriptorSetHandleList[0];
+			DeletionQueue retiredDescriptorSet;
+			retiredDescriptorSet.push_function(
+			    [=]()
+			    {
+				    vkFreeDescriptorSets(
+				        logicalDevice, descriptorPoolHandle, 1, &retiredDescriptorSetHandle);
+			    });
+			raytracingScene.retireResources(std::move(retiredDescriptorSet));
+
+			raytracingInfo.descriptorSetHandleList[0] = descriptorSetHandle;
+			descriptorSetReplaced = true;
+		}
+		else
+		{
+			// all spare sets are still used by the submitted frames (several full rebuilds
+			// within one frame)
+			waitForFrameTimeline(logicalDevice,
+			                     raytracingInfo.frameTimeline,
+			                     raytracingInfo.frameTimeline.lastSubmittedValue);
+		}
+	}
+
+	// the storage buffers are kept across full rebuilds, only the reallocated ones need a new
+	// descriptor unless the whole set was replaced
+	const auto isStorageBufferDescriptorOutdated = [&](const rt::SceneStorageBuffer type)
+	{
+		const bool reallocated = raytracingScene.takeStorageBufferReallocated(type);
+		return reallocated
+		       || (descriptorSetReplaced
+		           && raytracingScene.getStorageBufferHandle(type) != VK_NULL_HANDLE);
+	};
+
 	VkWriteDescriptorSetAccelerationStructureKHR accelerationStructureDescriptorInfo = {
 	    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
 	    .pNext = NULL,
@@ -107,13 +159,13 @@ void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
 	};
 
 	VkDescriptorBufferInfo gpuObjectsDescriptorInfo = {
-	    .buffer = raytracingScene.gpuObjectsBufferHandle,
+	    .buffer = raytracingScene.getStorageBufferHandle(rt::SceneStorageBuffer::GPUObjects),
 	    .offset = 0,
 	    .range = VK_WHOLE_SIZE,
 	};
 
 	VkDescriptorBufferInfo spheresDescriptorInfo = {
-	    .buffer = raytracingScene.spheresBufferHandle,
+	    .buffer = raytracingScene.getStorageBufferHandle(rt::SceneStorageBuffer::Spheres),
 	    .offset = 0,
 	    .range = VK_WHOLE_SIZE,
 	};
@@ -125,31 +177,27 @@ void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
 	// };
 
 	VkDescriptorBufferInfo rectangularBezierSurfaces2x2DescriptorInfo = {
-	    .buffer = raytracingScene.rectangularBezierSurfaces2x2BufferHandle,
+	    .buffer = raytracingScene.getStorageBufferHandle(
+	        rt::SceneStorageBuffer::RectangularBezierSurfaces2x2),
 	    .offset = 0,
 	    .range = VK_WHOLE_SIZE,
 	};
 
 	VkDescriptorBufferInfo slicingPlanesDescriptorInfo = {
-	    .buffer = raytracingScene.slicingPlanesBufferHandle,
-	    .offset = 0,
-	    .range = VK_WHOLE_SIZE,
-	};
-
-	VkDescriptorBufferInfo bezierTriangles2DescriptorInfo = {
-	    .buffer = raytracingScene.bezierTriangles2BufferHandle,
+	    .buffer = raytracingScene.getStorageBufferHandle(rt::SceneStorageBuffer::SlicingPlanes),
 	    .offset = 0,
 	    .range = VK_WHOLE_SIZE,
 	};
 
-	VkDescriptorBufferInfo bezierTriangles3DescriptorInfo = {
-	    .buffer = raytracingScene.bezierTriangles3BufferHandle,
+	VkDescriptorBufferInfo bezierPatchesDescriptorInfo = {
+	    .buffer = raytracingScene.getStorageBufferHandle(rt::SceneStorageBuffer::BezierPatches),
 	    .offset = 0,
 	    .range = VK_WHOLE_SIZE,
 	};
 
-	VkDescriptorBufferInfo bezierTriangles4DescriptorInfo = {
-	    .buffer = raytracingScene.bezierTriangles4BufferHandle,
+	VkDescriptorBufferInfo bezierControlPointsDescriptorInfo = {
+	    .buffer
+	    = raytracingScene.getStorageBufferHandle(rt::SceneStorageBuffer::BezierControlPoints),
 	    .offset = 0,
 	    .range = VK_WHOLE_SIZE,
 	};
@@ -270,7 +318,7 @@ void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
 	// 	});
 	// }
 
-	if (raytracingScene.spheresBufferHandle != VK_NULL_HANDLE)
+	if (isStorageBufferDescriptorOutdated(rt::SceneStorageBuffer::Spheres))
 	{
 		writeDescriptorSetList.push_back({
 		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -286,7 +334,7 @@ void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
 		});
 	}
 
-	if (raytracingScene.rectangularBezierSurfaces2x2BufferHandle != VK_NULL_HANDLE)
+	if (isStorageBufferDescriptorOutdated(rt::SceneStorageBuffer::RectangularBezierSurfaces2x2))
 	{
 		writeDescriptorSetList.push_back({
 		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -302,7 +350,7 @@ void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
 		});
 	}
 
-	if (raytracingScene.slicingPlanesBufferHandle != VK_NULL_HANDLE)
+	if (isStorageBufferDescriptorOutdated(rt::SceneStorageBuffer::SlicingPlanes))
 	{
 		writeDescriptorSetList.push_back({
 		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -318,7 +366,7 @@ void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
 		});
 	}
 
-	if (raytracingScene.gpuObjectsBufferHandle != VK_NULL_HANDLE)
+	if (isStorageBufferDescriptorOutdated(rt::SceneStorageBuffer::GPUObjects))
 	{
 		writeDescriptorSetList.push_back({
 		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -334,7 +382,7 @@ void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
 		});
 	}
 
-	if (raytracingScene.bezierTriangles2BufferHandle != VK_NULL_HANDLE)
+	if (isStorageBufferDescriptorOutdated(rt::SceneStorageBuffer::BezierPatches))
 	{
 		writeDescriptorSetList.push_back({
 		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -345,12 +393,12 @@ void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
 		    .descriptorCount = 1,
 		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 		    .pImageInfo = NULL,
-		    .pBufferInfo = &bezierTriangles2DescriptorInfo,
+		    .pBufferInfo = &bezierPatchesDescriptorInfo,
 		    .pTexelBufferView = NULL,
 		});
 	}
 
-	if (raytracingScene.bezierTriangles3BufferHandle != VK_NULL_HANDLE)
+	if (isStorageBufferDescriptorOutdated(rt::SceneStorageBuffer::BezierControlPoints))
 	{
 		writeDescriptorSetList.push_back({
 		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -361,23 +409,7 @@ void updateAccelerationStructureDescriptorSet(VkDevice logicalDevice,
 		    .descriptorCount = 1,
 		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 		    .pImageInfo = NULL,
-		    .pBufferInfo = &bezierTriangles3DescriptorInfo,
-		    .pTexelBufferView = NULL,
-		});
-	}
-
-	if (raytracingScene.bezierTriangles4BufferHandle != VK_NULL_HANDLE)
-	{
-		writeDescriptorSetList.push_back({
-		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-		    .pNext = NULL,
-		    .dstSet = raytracingInfo.descriptorSetHandleList[0],
-		    .dstBinding = 12,
-		    .dstArrayElement = 0,
-		    .descriptorCount = 1,
-		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-		    .pImageInfo = NULL,
-		    .pBufferInfo = &bezierTriangles4DescriptorInfo,
+		    .pBufferInfo = &bezierControlPointsDescriptorInfo,
 		    .pTexelBufferView = NULL,
 		});
 	}
@@ -750,6 +782,8 @@ void initRayTracing(VkPhysicalDevice physicalDevice,
 
 	raytracingInfo.descriptorSetHandleList = allocateDescriptorSetLayouts(
 	    logicalDevice, descriptorPoolHandle, descriptorSetLayoutHandleList);
+	raytracingInfo.descriptorPoolHandle = descriptorPoolHandle;
+	raytracingInfo.descriptorSetLayoutHandle = descriptorSetLayoutHandle;
 
 	// =========================================================================
 	// Pipeline Layout
@@ -1051,6 +1085,7 @@ void initRayTracing(VkPhysicalDevice physicalDevice,
 	             logicalDevice,
 	             vmaAllocator,
 	             deletionQueue,
+	             AllocationCategory::ShaderBindingTable,
 	             shaderBindingTableSize,
 	             VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR
 	                 | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
@@ -1212,12 +1247,16 @@ VkCommandPool createCommandPool(VkDevice logicalDevice,
 
 VkDescriptorPool createDescriptorPool(VkDevice logicalDevice, DeletionQueue& deletionQueue)
 {
+	// the main and the material set, every frame in flight might additionally still use a main
+	// set that was replaced by a full rebuild
+	constexpr uint32_t setCopies = 1 + static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
 	VkDescriptorPool descriptorPoolHandle = VK_NULL_HANDLE;
 	std::vector<VkDescriptorPoolSize> descriptorPoolSizeList = {
-	    {.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .descriptorCount = 1},
-	    {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1},
-	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 12},
-	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1},
+	    {.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .descriptorCount = setCopies},
+	    {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = setCopies},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 11 * setCopies},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = setCopies},
 	    {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1},
 	};
 
@@ -1225,7 +1264,7 @@ VkDescriptorPool createDescriptorPool(VkDevice logicalDevice, DeletionQueue& del
 	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 	    .pNext = NULL,
 	    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-	    .maxSets = 2,
+	    .maxSets = 1 + setCopies,
 	    .poolSizeCount = static_cast<uint32_t>(descriptorPoolSizeList.size()),
 	    .pPoolSizes = descriptorPoolSizeList.data(),
 	};
@@ -1398,14 +1437,6 @@ VkDescriptorSetLayout createDescriptorSetLayout(VkDevice logicalDevice,
 	        = VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_INTERSECTION_BIT_KHR,
 	        .pImmutableSamplers = NULL,
 	    },
-	    {
-	        .binding = 12,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-	        .descriptorCount = 1,
-	        .stageFlags
-	        = VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_INTERSECTION_BIT_KHR,
-	        .pImmutableSamplers = NULL,
-	    },
 	};
 
 	std::vector<VkDescriptorBindingFlags> bindingFlags = std::vector<VkDescriptorBindingFlags>(
@@ -1503,7 +1534,7 @@ VkDescriptorSetLayout createRaytracingImageDescriptorSetLayout(VkDevice logicalD
 }
 
 void updateRaytraceBuffer([[maybe_unused]] VkDevice logicalDevice,
-                          VmaAllocator vmaAllocator,
+                          [[maybe_unused]] VmaAllocator vmaAllocator,
                           RaytracingInfo& raytracingInfo,
                           const bool resetFrameCountRequested)
 {
@@ -1517,15 +1548,11 @@ void updateRaytraceBuffer([[maybe_unused]] VkDevice logicalDevice,
 	}
 
 	// TODO: we need some synchronization here probably
-	if (raytracingInfo.uniformBufferAllocation != VK_NULL_HANDLE)
+	// the uniform buffer stays mapped, only the written range is flushed
+	if (raytracingInfo.uniformBufferView.isMapped())
 	{
-		void* hostUniformMemoryBuffer;
-		VK_CHECK_RESULT(vmaMapMemory(
-		    vmaAllocator, raytracingInfo.uniformBufferAllocation, &hostUniformMemoryBuffer));
-
-		memcpy(hostUniformMemoryBuffer, &raytracingInfo.uniformStructure, sizeof(UniformStructure));
-
-		vmaUnmapMemory(vmaAllocator, raytracingInfo.uniformBufferAllocation);
+		raytracingInfo.uniformBufferView.write(0, raytracingInfo.uniformStructure);
+		raytracingInfo.uniformBufferView.flush();
 	}
 }
 
@@ -1613,6 +1640,7 @@ void createRaytracingImage([[maybe_unused]] VkPhysicalDevice physicalDevice,
 	                               &raytracingInfo.rayTraceImageHandle,
 	                               &raytracingInfo.rayTraceImageDeviceMemoryHandle,
 	                               &allocationInfo));
+	getMemoryTelemetry().trackAllocation(AllocationCategory::Image, allocationInfo.size);
 
 }
 
@@ -1729,7 +1757,10 @@ void freeRaytraceImageAndImageView(VkDevice logicalDevice,
 	       && "This should only be called when recreating the image and imageview");
 	assert(rayTraceImageAllocation != VK_NULL_HANDLE
 	       && "This should only be called when recreating the image and imageview");
+	VmaAllocationInfo allocationInfo = {};
+	vmaGetAllocationInfo(vmaAllocator, rayTraceImageAllocation, &allocationInfo);
 	vmaDestroyImage(vmaAllocator, rayTraceImageHandle, rayTraceImageAllocation);
+	getMemoryTelemetry().trackFree(AllocationCategory::Image, allocationInfo.size);
 
 	assert(rayTraceImageViewHandle != VK_NULL_HANDLE
 	       && "This should only be called when recreating the image and imageview");
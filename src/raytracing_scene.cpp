@@ -18,29 +18,18 @@ static glm::vec3 getRandomOffset(const int min, const int max)
 
 void RaytracingScene::clearScene()
 {
-	for (auto& sceneObject : sceneObjects)
-	{
-		getWorldObjectSpheres(*sceneObject).clear();
-		// raytracingScene.getWorldObjectTetrahedrons().clear();
-		getWorldObjectBezierTriangles<BezierTriangle2>(*sceneObject).clear();
-		getWorldObjectBezierTriangles<BezierTriangle3>(*sceneObject).clear();
-		getWorldObjectBezierTriangles<BezierTriangle4>(*sceneObject).clear();
-		getWorldObjectRectangularBezierSurfaces2x2(*sceneObject).clear();
-	}
 	sceneObjects.clear();
 	objectNameToSceneObjectMap.clear();
 
-	spheresList.clear();
-	bezierTriangles2List.clear();
-	bezierTriangles3List.clear();
-	bezierTriangles4List.clear();
-	rectangularSurfaces2x2List.clear();
-
+	// invalidates all ObjectHandles of the previous scene
 	spheres.clear();
-	bezierTriangles2.clear();
-	bezierTriangles3.clear();
-	bezierTriangles4.clear();
+	bezierPatches.clear();
+	bezierControlPoints.clear();
 	rectangularBezierSurfaces2x2.clear();
+	bezierBoundsTelemetry = {};
+
+	transformHierarchy.clear();
+	transformBindings.clear();
 
 	/// we add the slicing plane once in the RaytracingScene constructor instead of adding it
 	/// per scene
@@ -49,31 +38,47 @@ void RaytracingScene::clearScene()
 
 /// Loads the scene with the given index. A manual rebuild of the acceleration
 /// structure is still required
-void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
+void RaytracingScene::loadScene(Renderer& renderer,
                                 RaytracingScene& raytracingScene,
                                 const SceneConfig sceneConfig,
                                 const int sceneNr)
+{
+	auto sceneObjectLight = loadScene(raytracingScene,
+	                                  sceneConfig,
+	                                  sceneNr,
+	                                  renderer.getRaytracingDataConstants().globalLightPosition);
+	if (sceneObjectLight != nullptr)
+	{
+		renderer.setCurrentLightSceneObject(sceneObjectLight);
+	}
+}
+
+std::shared_ptr<SceneObject> RaytracingScene::loadScene(RaytracingScene& raytracingScene,
+                                                        const SceneConfig sceneConfig,
+                                                        const int sceneNr,
+                                                        const glm::vec3 lightPosition)
 {
 	if (sceneNr <= 0 || sceneNr > SCENE_COUNT)
 	{
 		std::printf("Scene %d not implemented\n", sceneNr);
-		return;
+		return nullptr;
 	}
 
 	raytracingScene.clearScene();
 	raytracingScene.currentSceneNr = sceneNr;
+	raytracingScene.setCompactAccelerationStructures(sceneConfig.compactAccelerationStructures);
+	raytracingScene.setBLASClusterSize(sceneConfig.blasClusterSize);
+	raytracingScene.setBezierBoundsMode(sceneConfig.tightBezierPatchBounds
+	                                        ? BezierBoundsMode::Subdivision
+	                                        : BezierBoundsMode::ControlPoints);
 
 	// first sphere represents light
 	// TODO: add into its own BLAS Instance
-	auto sceneObjectLight = raytracingScene.createNamedSceneObject(
-	    "light", renderer.getRaytracingDataConstants().globalLightPosition);
-	raytracingScene.addObjectSphere(*sceneObjectLight,
-	                                renderer.getRaytracingDataConstants().globalLightPosition,
-	                                true,
-	                                0.2f,
-	                                ColorIdx::t_yellow);
-
-	renderer.setCurrentLightSceneObject(sceneObjectLight);
+	auto sceneObjectLight = raytracingScene.createNamedSceneObject("light", lightPosition);
+	// shadow rays never traverse the light
+	sceneObjectLight->instanceMask = InstanceMask::t_LightInstance;
+	raytracingScene.addObjectSphere(
+	    *sceneObjectLight, lightPosition, true, 0.2f, ColorIdx::t_yellow);
 
 	// TODO: support multiple slicing planes
 	// raytracingScene.addSlicingPlane(SlicingPlane{
@@ -98,7 +103,7 @@ void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
 		auto sceneObject = raytracingScene.createNamedSceneObject("model");
 		raytracingScene.addSidesFromTetrahedronAsBezierTriangles(*sceneObject, tetrahedron2);
 
-		auto sceneObjectControlPoints = raytracingScene.createNamedSceneObject();
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 		if (sceneConfig.visualizeControlPoints)
 		{
 			visualizeTetrahedronControlPoints(
@@ -134,7 +139,7 @@ void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
 		auto sceneObject = raytracingScene.createNamedSceneObject("model");
 		raytracingScene.addSidesFromTetrahedronAsBezierTriangles(*sceneObject, tetrahedron2);
 
-		auto sceneObjectControlPoints = raytracingScene.createNamedSceneObject();
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 		if (sceneConfig.visualizeControlPoints)
 		{
 			visualizeTetrahedronControlPoints(
@@ -194,7 +199,7 @@ void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
 		raytracingScene.addSidesFromTetrahedronAsBezierTriangles(
 		    *sceneObject, tetrahedron2_2, {true, true, true, true}, {false, false, false, true});
 
-		auto sceneObjectControlPoints = raytracingScene.createNamedSceneObject();
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 		// second add all the spheres
 		if (sceneConfig.visualizeControlPoints)
 		{
@@ -234,7 +239,7 @@ void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
 		auto sceneObject = raytracingScene.createNamedSceneObject("model");
 		raytracingScene.addSidesFromTetrahedronAsBezierTriangles(*sceneObject, tetrahedron3);
 
-		auto sceneObjectControlPoints = raytracingScene.createNamedSceneObject();
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 		if (sceneConfig.visualizeControlPoints)
 		{
 			visualizeTetrahedronControlPoints(
@@ -266,7 +271,7 @@ void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
 		auto sceneObject = raytracingScene.createNamedSceneObject("model");
 		raytracingScene.addSidesFromTetrahedronAsBezierTriangles(*sceneObject, tetrahedron2);
 
-		auto sceneObjectControlPoints = raytracingScene.createNamedSceneObject();
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 		if (sceneConfig.visualizeControlPoints)
 		{
 			visualizeTetrahedronControlPoints(
@@ -310,7 +315,7 @@ void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
 			}
 		}
 
-		auto sceneObjectControlPoints = raytracingScene.createSceneObject();
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 		// after creating all the tetrahedrons (in one chunk), we can add the spheres
 		for (const auto& tetrahedron2 : tetrahedrons)
 		{
@@ -343,7 +348,7 @@ void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
 		auto sceneObject = raytracingScene.createNamedSceneObject("model");
 		raytracingScene.addSidesFromTetrahedronAsBezierTriangles(*sceneObject, tetrahedron4);
 
-		auto sceneObjectControlPoints = raytracingScene.createSceneObject();
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 		if (sceneConfig.visualizeControlPoints)
 		{
 			visualizeTetrahedronControlPoints(
@@ -372,7 +377,7 @@ void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
 		auto sceneObject = raytracingScene.createNamedSceneObject("model");
 		raytracingScene.addSidesFromTetrahedronAsBezierTriangles(*sceneObject, tetrahedron4);
 
-		auto sceneObjectControlPoints = raytracingScene.createSceneObject();
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
 		if (sceneConfig.visualizeControlPoints)
 		{
 			visualizeTetrahedronControlPoints(
@@ -385,52 +390,73 @@ void RaytracingScene::loadScene([[maybe_unused]] Renderer& renderer,
 		                          sceneConfig.visualizeSampledVolume,
 		                          0.05f);
 	}
-	else
+	else if (sceneNr == 9)
 	{
-		std::printf("Scene %d not implemented\n", sceneNr);
-	}
-}
-
-template <>
-std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle2>>>&
-RaytracingScene::getTriangleListForSceneObject(SceneObject& sceneObject)
-{
-	return sceneObject.bezierTriangles2;
-}
+		// one reference tetrahedron instanced 100 times, only the TLAS grows with the instances
+		[[maybe_unused]] auto tetrahedron2 = tracer::createTetrahedron2(std::to_array({
+		    glm::vec3(0.0f, 0.0f, 0.0f),
+		    glm::vec3(0.0f, 0.0f, 1.0f),
+		    glm::vec3(0.0f, 0.0f, 2.0f),
+		    glm::vec3(0.0f, 1.0f, 0.0f),
+		    glm::vec3(0.0f, 1.0f, 1.0f),
+		    glm::vec3(0.0f, 2.0f, 0.0f),
+		    glm::vec3(1.0f, 0.0f, 0.0f),
+		    glm::vec3(1.0f, 0.0f, 1.0f),
+		    glm::vec3(1.0f, 1.0f, 0.0f),
+		    glm::vec3(2.0f, 0.0f, 0.0f),
+		}));
 
-template <>
-std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle3>>>&
-RaytracingScene::getTriangleListForSceneObject(SceneObject& sceneObject)
-{
-	return sceneObject.bezierTriangles3;
-}
+		auto sceneObject = raytracingScene.createNamedSceneObject("model");
+		raytracingScene.addSidesFromTetrahedronAsBezierTriangles(*sceneObject, tetrahedron2);
 
-template <>
-std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle4>>>&
-RaytracingScene::getTriangleListForSceneObject(SceneObject& sceneObject)
-{
-	return sceneObject.bezierTriangles4;
-}
+		// all instances are children of one root node, moving the root moves the whole grid
+		auto& transformHierarchy = raytracingScene.getTransformHierarchy();
+		const TransformNodeId rootNode = transformHierarchy.createNode();
 
-template <>
-std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle2>>>&
-RaytracingScene::getTriangleList()
-{
-	return bezierTriangles2;
-}
+		for (int x = 0; x < 10; x++)
+		{
+			for (int z = 0; z < 10; z++)
+			{
+				const auto fx = static_cast<float>(x);
+				const auto fz = static_cast<float>(z);
+				const Transform transform(glm::vec3(5.0f * fx, 0, 5.0f * fz),
+				                          glm::angleAxis(0.3f * (fx + fz), glm::vec3(0, 1, 0)),
+				                          glm::vec3(1.0f + 0.05f * fx));
+
+				// the first instance is the SceneObject itself
+				const size_t instanceIndex
+				    = x == 0 && z == 0 ? 0
+				                       : raytracingScene.addSceneObjectInstance(
+				                             *sceneObject, transform.getTransformMatrix());
+				raytracingScene.attachInstanceToTransformNode(
+				    sceneObject,
+				    instanceIndex,
+				    transformHierarchy.createNode(transform.getMatrix(), rootNode));
+			}
+		}
 
-template <>
-std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle3>>>&
-RaytracingScene::getTriangleList()
-{
-	return bezierTriangles3;
-}
+		// only the reference tetrahedron is visualized
+		auto sceneObjectControlPoints = raytracingScene.createDebugSceneObject();
+		if (sceneConfig.visualizeControlPoints)
+		{
+			visualizeTetrahedronControlPoints(
+			    *sceneObjectControlPoints, raytracingScene, tetrahedron2);
+		}
+		visualizeTetrahedronSides(*sceneObjectControlPoints,
+		                          raytracingScene,
+		                          tetrahedron2,
+		                          sceneConfig.visualizeSampledSurface,
+		                          sceneConfig.visualizeSampledVolume);
+	}
+	else
+	{
+		std::printf("Scene %d not implemented\n", sceneNr);
+	}
 
-template <>
-std::vector<std::shared_ptr<RaytracingWorldObject<BezierTriangle4>>>&
-RaytracingScene::getTriangleList()
-{
-	return bezierTriangles4;
+	// the SceneObjects get the world transforms of their transform nodes right away, the scene
+	// might be used without building the acceleration structures
+	raytracingScene.applyTransformHierarchy(false);
+	return sceneObjectLight;
 }
 
 } // namespace rt
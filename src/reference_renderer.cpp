@@ -0,0 +1,1064 @@
+#include "reference_renderer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include "blas.hpp"
+#include "camera.hpp"
+#include "parallel_for.hpp"
+#include "raytracing_scene.hpp"
+#include "renderer.hpp"
+#include "transform.hpp"
+
+namespace tracer
+{
+namespace rt
+{
+
+namespace
+{
+
+// leaves with more primitives are split
+constexpr uint32_t BVH_MAX_LEAF_SIZE = 4;
+constexpr size_t BVH_MAX_DEPTH = 64;
+
+// the intersection shader invocations of the tile the thread renders
+thread_local uint64_t intersectionInvocations = 0;
+
+// the normals are transformed with the inverse transpose, like "normal * mat3(matrix)" in the
+// shaders
+glm::vec3 multiplyTransposed(const glm::vec3 normal, const glm::mat4& matrix)
+{
+	return glm::transpose(glm::mat3(matrix)) * normal;
+}
+
+// whether the ray hits the box inside [tMin, tMax]
+bool rayHitsAABB(
+    const Ray& ray, const glm::vec3 inverseDirection, const AABB& box, float tMin, float tMax)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float t0 = (box.min[axis] - ray.origin[axis]) * inverseDirection[axis];
+		float t1 = (box.max[axis] - ray.origin[axis]) * inverseDirection[axis];
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+		tMin = std::max(tMin, t0);
+		tMax = std::min(tMax, t1);
+		if (tMin > tMax)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// see intersectAABB() in common_shader_functions.glsl
+bool intersectAABB(const glm::vec3 rayOrigin,
+                   const glm::vec3 rayDir,
+                   const glm::vec3 boxMin,
+                   const glm::vec3 boxMax,
+                   float& tHit,
+                   glm::vec3& normal)
+{
+	const glm::vec3 invDir = 1.0f / rayDir;
+	const glm::vec3 t0 = (boxMin - rayOrigin) * invDir;
+	const glm::vec3 t1 = (boxMax - rayOrigin) * invDir;
+	const glm::vec3 tmin = glm::min(t0, t1);
+	const glm::vec3 tmax = glm::max(t0, t1);
+	const float tEntry = std::max(std::max(tmin.x, tmin.y), tmin.z);
+	const float tExit = std::min(std::min(tmax.x, tmax.y), tmax.z);
+
+	// missed box
+	if (tEntry > tExit || tExit < 0.0f)
+	{
+		return false;
+	}
+
+	tHit = tEntry;
+
+	// normal is based on which axis contributed to tEntry
+	if (tmin.x >= tmin.y && tmin.x >= tmin.z)
+	{
+		normal = glm::vec3(glm::sign(rayDir.x), 0.0f, 0.0f);
+	}
+	else if (tmin.y >= tmin.z)
+	{
+		normal = glm::vec3(0.0f, glm::sign(rayDir.y), 0.0f);
+	}
+	else
+	{
+		normal = glm::vec3(0.0f, 0.0f, glm::sign(rayDir.z));
+	}
+	return true;
+}
+
+// see hitSphere() in common_shader_functions.glsl
+float hitSphere(const Sphere& s, const Ray& r)
+{
+	const glm::vec3 oc = r.origin - s.center;
+	const float a = glm::dot(r.direction, r.direction);
+	const float b = 2.0f * glm::dot(oc, r.direction);
+	const float c = glm::dot(oc, oc) - s.radius * s.radius;
+	const float discriminant = b * b - 4 * a * c;
+	if (discriminant < 0)
+	{
+		return -1.0f;
+	}
+	return (-b - std::sqrt(discriminant)) / (2.0f * a);
+}
+
+// see intersectWithPlane() in common_shader_functions.glsl
+bool intersectWithPlane(const glm::vec3 planeNormal,
+                        const glm::vec3 planeOrigin,
+                        const glm::vec3 rayOrigin,
+                        const glm::vec3 rayDirection,
+                        float& t)
+{
+	const float denom = glm::dot(-planeNormal, rayDirection);
+	if (denom > 1e-6f)
+	{
+		const glm::vec3 rayToPlanePoint = planeOrigin - rayOrigin;
+		t = glm::dot(rayToPlanePoint, -planeNormal) / denom;
+		return t >= 0;
+	}
+	return false;
+}
+
+bool hitPosInFrontOfPlane(const SlicingPlane& plane, const glm::vec3 hitPos)
+{
+	return glm::dot(hitPos - plane.planeOrigin, plane.normal) > 0;
+}
+
+float linearToSRGB(const float value)
+{
+	const float c = std::clamp(value, 0.0f, 1.0f);
+	return c <= 0.0031308f ? 12.92f * c : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+} // namespace
+
+ReferenceScene ReferenceScene::fromRaytracingScene(RaytracingScene& raytracingScene)
+{
+	const auto& spheres = raytracingScene.getObjectPool<Sphere>();
+	const auto& bezierPatches = raytracingScene.getObjectPool<BezierPatch>();
+	const auto& rectangularBezierSurfaces2x2
+	    = raytracingScene.getObjectPool<RectangularBezierSurface2x2>();
+
+	ReferenceScene scene;
+	scene.spheres = spheres.getObjects();
+	scene.bezierPatches = bezierPatches.getObjects();
+	scene.bezierControlPoints = raytracingScene.getBezierControlPoints();
+	if (!raytracingScene.getSlicingPlanes().empty())
+	{
+		scene.slicingPlane = raytracingScene.getSlicingPlanes()[0];
+	}
+
+	auto addPrimitives
+	    = [&scene](const auto& pool, const ObjectRange range, const uint32_t instance)
+	{
+		for (size_t i = range.offset; i < range.end(); i++)
+		{
+			scene.addPrimitive(
+			    pool.getType(i), static_cast<uint32_t>(i), instance, pool.getAabbPositions()[i]);
+		}
+	};
+
+	for (const auto& sceneObject : raytracingScene.getSceneObjects())
+	{
+		for (size_t i = 0; i < sceneObject->instanceCount(); i++)
+		{
+			const uint32_t instance = scene.addInstance(
+			    Transform::fromTransformMatrixKHR(sceneObject->getInstanceTransform(i)),
+			    sceneObject->instanceMask);
+			addPrimitives(spheres, sceneObject->spheres, instance);
+			addPrimitives(bezierPatches, sceneObject->bezierPatches, instance);
+			addPrimitives(rectangularBezierSurfaces2x2,
+			              sceneObject->rectangularBezierSurfaces2x2,
+			              instance);
+		}
+	}
+	return scene;
+}
+
+uint32_t ReferenceScene::addInstance(const glm::mat4& objectToWorld, const InstanceMask mask)
+{
+	instances.push_back(ReferenceInstance{
+	    .objectToWorld = objectToWorld,
+	    .worldToObject = glm::inverse(objectToWorld),
+	    .mask = mask,
+	});
+	return static_cast<uint32_t>(instances.size() - 1);
+}
+
+void ReferenceScene::addPrimitive(const ObjectType type,
+                                  const uint32_t bufferIndex,
+                                  const uint32_t instanceIndex,
+                                  const VkAabbPositionsKHR& objectSpaceAabb)
+{
+	assert(instanceIndex < instances.size());
+	const glm::mat4& objectToWorld = instances[instanceIndex].objectToWorld;
+
+	AABB bounds{.min = glm::vec3(INFINITY), .max = glm::vec3(-INFINITY)};
+	for (int corner = 0; corner < 8; corner++)
+	{
+		const glm::vec3 point = glm::vec3(objectToWorld
+		                                  * glm::vec4((corner & 1) ? objectSpaceAabb.maxX
+		                                                           : objectSpaceAabb.minX,
+		                                              (corner & 2) ? objectSpaceAabb.maxY
+		                                                           : objectSpaceAabb.minY,
+		                                              (corner & 4) ? objectSpaceAabb.maxZ
+		                                                           : objectSpaceAabb.minZ,
+		                                              1.0f));
+		bounds.min = glm::min(bounds.min, point);
+		bounds.max = glm::max(bounds.max, point);
+	}
+
+	primitives.push_back(ReferencePrimitive{
+	    .type = type,
+	    .bufferIndex = bufferIndex,
+	    .instanceIndex = instanceIndex,
+	    .bounds = bounds,
+	});
+}
+
+void ReferenceImage::writePPM(const std::filesystem::path& path) const
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary);
+	if (!file)
+	{
+		throw std::runtime_error("ReferenceImage::writePPM - failed to open " + path.string());
+	}
+
+	// ppm header
+	file << "P6\n" << width << "\n" << height << "\n" << 255 << "\n";
+
+	std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const glm::vec4& pixel = pixels[static_cast<size_t>(y) * width + x];
+			for (int c = 0; c < 3; c++)
+			{
+				row[static_cast<size_t>(x) * 3 + static_cast<size_t>(c)]
+				    = static_cast<unsigned char>(linearToSRGB(pixel[c]) * 255.0f + 0.5f);
+			}
+		}
+		file.write(reinterpret_cast<const char*>(row.data()),
+		           static_cast<std::streamsize>(row.size()));
+	}
+}
+
+ReferenceRenderer::ReferenceRenderer(const ReferenceScene& scene,
+                                     const RaytracingDataConstants& raytracingDataConstants,
+                                     const UniformStructure& ubo)
+    : scene(scene), constants(raytracingDataConstants), ubo(ubo)
+{
+	primitiveOrder.resize(scene.primitives.size());
+	std::iota(primitiveOrder.begin(), primitiveOrder.end(), 0u);
+	if (!primitiveOrder.empty())
+	{
+		bvhNodes.reserve(2 * primitiveOrder.size());
+		buildBVHNode(0, static_cast<uint32_t>(primitiveOrder.size()));
+	}
+}
+
+// median split along the longest axis of the centroids
+uint32_t ReferenceRenderer::buildBVHNode(const uint32_t first, const uint32_t count)
+{
+	AABB bounds{.min = glm::vec3(INFINITY), .max = glm::vec3(-INFINITY)};
+	AABB centroidBounds = bounds;
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const AABB& primitiveBounds = scene.primitives[primitiveOrder[i]].bounds;
+		const glm::vec3 centroid = (primitiveBounds.min + primitiveBounds.max) * 0.5f;
+		bounds.min = glm::min(bounds.min, primitiveBounds.min);
+		bounds.max = glm::max(bounds.max, primitiveBounds.max);
+		centroidBounds.min = glm::min(centroidBounds.min, centroid);
+		centroidBounds.max = glm::max(centroidBounds.max, centroid);
+	}
+
+	const auto nodeIndex = static_cast<uint32_t>(bvhNodes.size());
+	bvhNodes.push_back(BVHNode{.bounds = bounds, .first = first, .count = count});
+	if (count <= BVH_MAX_LEAF_SIZE)
+	{
+		return nodeIndex;
+	}
+
+	const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+	const int axis
+	    = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+	const uint32_t leftCount = count / 2;
+	const auto begin = primitiveOrder.begin() + first;
+	std::nth_element(begin,
+	                 begin + leftCount,
+	                 begin + count,
+	                 [this, axis](const uint32_t a, const uint32_t b)
+	                 {
+		                 const AABB& boundsA = scene.primitives[a].bounds;
+		                 const AABB& boundsB = scene.primitives[b].bounds;
+		                 return boundsA.min[axis] + boundsA.max[axis]
+		                        < boundsB.min[axis] + boundsB.max[axis];
+	                 });
+
+	// the left child directly follows its parent
+	buildBVHNode(first, leftCount);
+	const uint32_t rightChild = buildBVHNode(first + leftCount, count - leftCount);
+	bvhNodes[nodeIndex].first = rightChild;
+	bvhNodes[nodeIndex].count = 0;
+	return nodeIndex;
+}
+
+bool ReferenceRenderer::traceRay(const Ray& ray,
+                                 const float tMin,
+                                 const float tMax,
+                                 const uint32_t cullMask,
+                                 const bool terminateOnFirstHit,
+                                 Hit& nearestHit) const
+{
+	if (bvhNodes.empty())
+	{
+		return false;
+	}
+
+	const glm::vec3 inverseDirection = 1.0f / ray.direction;
+	float tClosest = tMax;
+	bool anyHit = false;
+
+	std::array<uint32_t, BVH_MAX_DEPTH> stack;
+	size_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const BVHNode& node = bvhNodes[stack[--stackSize]];
+		if (!rayHitsAABB(ray, inverseDirection, node.bounds, tMin, tClosest))
+		{
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			const auto nodeIndex = static_cast<uint32_t>(&node - bvhNodes.data());
+			assert(stackSize + 2 <= stack.size());
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = nodeIndex + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			const ReferencePrimitive& primitive = scene.primitives[primitiveOrder[i]];
+			if ((static_cast<uint32_t>(scene.instances[primitive.instanceIndex].mask) & cullMask)
+			        == 0
+			    || !rayHitsAABB(ray, inverseDirection, primitive.bounds, tMin, tClosest))
+			{
+				continue;
+			}
+
+			// reportIntersectionEXT() only accepts hits inside [tMin, closest hit]
+			Hit hit;
+			intersectionInvocations++;
+			if (intersectPrimitive(primitive, ray, hit) && hit.t >= tMin && hit.t <= tClosest)
+			{
+				nearestHit = hit;
+				tClosest = hit.t;
+				anyHit = true;
+				if (terminateOnFirstHit)
+				{
+					return true;
+				}
+			}
+		}
+	}
+	return anyHit;
+}
+
+LaneMask<RAY_PACKET_WIDTH>
+ReferenceRenderer::tracePacket(const std::array<Ray, RAY_PACKET_WIDTH>& rays,
+                               const LaneMask<RAY_PACKET_WIDTH> lanes,
+                               const float tMin,
+                               const float tMax,
+                               const uint32_t cullMask,
+                               std::array<Hit, RAY_PACKET_WIDTH>& nearestHits) const
+{
+	LaneMask<RAY_PACKET_WIDTH> anyHit{};
+	if (bvhNodes.empty())
+	{
+		return anyHit;
+	}
+
+	std::array<glm::vec3, RAY_PACKET_WIDTH> inverseDirections;
+	std::array<float, RAY_PACKET_WIDTH> tClosest;
+	for (size_t lane = 0; lane < RAY_PACKET_WIDTH; lane++)
+	{
+		inverseDirections[lane] = 1.0f / rays[lane].direction;
+		tClosest[lane] = tMax;
+	}
+
+	std::array<uint32_t, BVH_MAX_DEPTH> stack;
+	size_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const BVHNode& node = bvhNodes[stack[--stackSize]];
+		LaneMask<RAY_PACKET_WIDTH> nodeLanes{};
+		bool anyLane = false;
+		for (size_t lane = 0; lane < RAY_PACKET_WIDTH; lane++)
+		{
+			nodeLanes[lane]
+			    = lanes[lane] != 0
+			      && rayHitsAABB(
+			          rays[lane], inverseDirections[lane], node.bounds, tMin, tClosest[lane]);
+			anyLane = anyLane || nodeLanes[lane] != 0;
+		}
+		if (!anyLane)
+		{
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			const auto nodeIndex = static_cast<uint32_t>(&node - bvhNodes.data());
+			assert(stackSize + 2 <= stack.size());
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = nodeIndex + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			const ReferencePrimitive& primitive = scene.primitives[primitiveOrder[i]];
+			if ((static_cast<uint32_t>(scene.instances[primitive.instanceIndex].mask) & cullMask)
+			    == 0)
+			{
+				continue;
+			}
+
+			LaneMask<RAY_PACKET_WIDTH> primitiveLanes{};
+			size_t laneCount = 0;
+			for (size_t lane = 0; lane < RAY_PACKET_WIDTH; lane++)
+			{
+				if (nodeLanes[lane] != 0
+				    && rayHitsAABB(rays[lane],
+				                   inverseDirections[lane],
+				                   primitive.bounds,
+				                   tMin,
+				                   tClosest[lane]))
+				{
+					primitiveLanes[lane] = 1;
+					laneCount++;
+				}
+			}
+			intersectionInvocations += laneCount;
+
+			// lanes that hit the same patch share the newton iterations, a single lane takes the
+			// scalar path
+			std::array<Hit, RAY_PACKET_WIDTH> hits;
+			LaneMask<RAY_PACKET_WIDTH> reported{};
+			if (laneCount > 1 && primitive.type == ObjectType::t_BezierPatch
+			    && constants.debugShowAABBs <= 0.0f)
+			{
+				reported = intersectBezierPatchPacket<RAY_PACKET_WIDTH>(
+				    primitive, rays, primitiveLanes, hits);
+			}
+			else if (laneCount > 0)
+			{
+				for (size_t lane = 0; lane < RAY_PACKET_WIDTH; lane++)
+				{
+					reported[lane] = primitiveLanes[lane] != 0
+					                 && intersectPrimitive(primitive, rays[lane], hits[lane]);
+				}
+			}
+
+			// reportIntersectionEXT() only accepts hits inside [tMin, closest hit]
+			for (size_t lane = 0; lane < RAY_PACKET_WIDTH; lane++)
+			{
+				if (reported[lane] != 0 && hits[lane].t >= tMin && hits[lane].t <= tClosest[lane])
+				{
+					nearestHits[lane] = hits[lane];
+					tClosest[lane] = hits[lane].t;
+					anyHit[lane] = 1;
+				}
+			}
+		}
+	}
+	return anyHit;
+}
+
+bool ReferenceRenderer::intersectPrimitive(const ReferencePrimitive& primitive,
+                                           const Ray& ray,
+                                           Hit& hit) const
+{
+	const ReferenceInstance& instance = scene.instances[primitive.instanceIndex];
+	hit.bufferIndex = primitive.bufferIndex;
+
+	// Debugging, display aabb boxes
+	if (constants.debugShowAABBs > 0.0f)
+	{
+		hit.hitKind = static_cast<uint32_t>(ObjectType::t_AABBDebug);
+		if (primitive.type != ObjectType::t_BezierPatch)
+		{
+			hit.point = ray.origin + 0.1f * ray.direction;
+			hit.normal = glm::vec3(0, 1, 0);
+			hit.t = 0.1f;
+			return true;
+		}
+
+		const Aabb& aabb = scene.bezierPatches[primitive.bufferIndex].aabb;
+		const glm::vec3 objectOrigin
+		    = glm::vec3(instance.worldToObject * glm::vec4(ray.origin, 1));
+		const glm::vec3 objectDirection
+		    = glm::vec3(instance.worldToObject * glm::vec4(ray.direction, 0));
+		float tHit = 0;
+		glm::vec3 hitNormal = glm::vec3(0);
+		if (!intersectAABB(
+		        objectOrigin, objectDirection, aabb.minimum, aabb.maximum, tHit, hitNormal))
+		{
+			return false;
+		}
+		hit.t = tHit;
+		hit.point = ray.origin + tHit * ray.direction;
+		hit.normal = glm::normalize(multiplyTransposed(hitNormal, instance.worldToObject));
+		return true;
+	}
+
+	if (primitive.type == ObjectType::t_BezierPatch)
+	{
+		std::array<Hit, 1> hits{hit};
+		const LaneMask<1> reported = intersectBezierPatchPacket<1>(
+		    primitive, std::array<Ray, 1>{ray}, LaneMask<1>{1}, hits);
+		hit = hits[0];
+		return reported[0] != 0;
+	}
+	else if (primitive.type == ObjectType::t_Sphere)
+	{
+		const Sphere& sphere = scene.spheres[primitive.bufferIndex];
+		hit.hitKind = static_cast<uint32_t>(ObjectType::t_Sphere);
+		hit.t = hitSphere(sphere, ray);
+		if (hit.t > 0)
+		{
+			hit.point = ray.origin + hit.t * ray.direction;
+			hit.normal = hit.point - sphere.center;
+			return true;
+		}
+		return false;
+	}
+
+	// always mark as hit
+	hit.hitKind = static_cast<uint32_t>(primitive.type);
+	hit.t = 1;
+	return true;
+}
+
+template <size_t N>
+LaneMask<N> ReferenceRenderer::intersectBezierPatchPacket(const ReferencePrimitive& primitive,
+                                                          const std::array<Ray, N>& rays,
+                                                          const LaneMask<N> lanes,
+                                                          std::array<Hit, N>& hits) const
+{
+	const ReferenceInstance& instance = scene.instances[primitive.instanceIndex];
+	const BezierPatch& patch = scene.bezierPatches[primitive.bufferIndex];
+
+	// the closest hit shader treats the inside patches differently
+	const uint32_t hitKind
+	    = (patch.flags & static_cast<uint>(BezierPatchFlags::t_BezierPatchFlagInside)) != 0
+	          ? static_cast<uint32_t>(ObjectType::t_BezierPatchInside)
+	          : static_cast<uint32_t>(ObjectType::t_BezierPatch);
+
+	// the bezier patches are intersected in object space
+	PacketVec3<N> objectOrigins;
+	PacketVec3<N> objectDirections;
+	PacketVec3<N> n1;
+	PacketVec3<N> n2;
+	std::array<float, N> tHit;
+	for (size_t lane = 0; lane < N; lane++)
+	{
+		const glm::vec3 origin
+		    = glm::vec3(instance.worldToObject * glm::vec4(rays[lane].origin, 1));
+		const glm::vec3 direction
+		    = glm::vec3(instance.worldToObject * glm::vec4(rays[lane].direction, 0));
+		const float dx = direction.x;
+		const float dy = direction.y;
+		const float dz = direction.z;
+		const glm::vec3 laneN1 = std::abs(dx) > std::abs(dy) && std::abs(dx) > std::abs(dz)
+		                             ? glm::vec3(dy, -dx, 0)
+		                             : glm::vec3(0, dz, -dy);
+
+		objectOrigins.set(lane, origin);
+		objectDirections.set(lane, direction);
+		n1.set(lane, laneN1);
+		n2.set(lane, glm::cross(direction, laneN1));
+		tHit[lane] = -1;
+		hits[lane].bufferIndex = primitive.bufferIndex;
+		hits[lane].hitKind = hitKind;
+	}
+
+	if (constants.renderSideTriangle > 0.0f)
+	{
+		// initial guesses of the newton iterations, the same for all degrees
+		const std::array<glm::vec2, 6> guesses = {
+		    glm::vec2(.5, .5),
+		    glm::vec2(.5, 0),
+		    glm::vec2(0, .5),
+		    glm::vec2(0, 0),
+		    glm::vec2(0, 1),
+		    glm::vec2(1, 0),
+		};
+
+		// the slicing plane in object space, see slicingPlaneToObjectSpace()
+		const SlicingPlane plane{
+		    .planeOrigin
+		    = glm::vec3(instance.worldToObject * glm::vec4(scene.slicingPlane.planeOrigin, 1)),
+		    .normal = multiplyTransposed(scene.slicingPlane.normal, instance.objectToWorld),
+		};
+
+		// if whole aabb is in front of the slicing plane, ignore completely
+		const bool slicingPlaneEnabled = constants.enableSlicingPlanes > 0.0f;
+		const bool aabbIsFullyInFrontOfSlicingPlane
+		    = hitPosInFrontOfPlane(plane, patch.aabb.minimum)
+		      && hitPosInFrontOfPlane(plane, patch.aabb.maximum);
+		const bool aabbIsFullyBehindSlicingPlane
+		    = slicingPlaneEnabled && !hitPosInFrontOfPlane(plane, patch.aabb.minimum)
+		      && !hitPosInFrontOfPlane(plane, patch.aabb.maximum);
+
+		if (!slicingPlaneEnabled || !aabbIsFullyInFrontOfSlicingPlane)
+		{
+			const std::span<const glm::vec3> controlPoints
+			    = std::span<const glm::vec3>(scene.bezierControlPoints)
+			          .subspan(patch.controlPointOffset,
+			                   getBezierTriangleControlPointCount(patch.degree));
+
+			const NewtonSettings settings{
+			    .toleranceF = constants.debugFastRenderMode > 0.0f && ubo.frameCount < 10
+			                      ? 100000.0f
+			                      : constants.newtonErrorFTolerance,
+			    // the quadratic patches are flatter, their jacobian gets close to singular later
+			    .minDeterminant = patch.degree <= 2 ? 0.000001f : 0.00001f,
+			    .maxIterations = std::min(constants.newtonMaxIterations, MAX_NEWTON_ITERATIONS),
+			    .abortOnIncrease = std::abs(constants.newtonErrorFIgnoreIncrease) < 1e-8f,
+			    .hitBelowTolerance = constants.newtonErrorFHitBelowTolerance > 0.0f,
+			};
+
+			const auto guessesAmount = static_cast<size_t>(
+			    std::clamp(constants.newtonGuessesAmount, 0, static_cast<int>(guesses.size())));
+			for (size_t i = 0; i < guessesAmount; i++)
+			{
+				const NewtonPacketResult<N> result
+				    = solveNewtonPacket<N>(controlPoints,
+				                           static_cast<int>(patch.degree),
+				                           objectOrigins,
+				                           n1,
+				                           n2,
+				                           guesses[i],
+				                           lanes,
+				                           settings);
+
+				for (size_t lane = 0; lane < N; lane++)
+				{
+					if (result.hit[lane] == 0)
+					{
+						continue;
+					}
+
+					// make sure hitPos is in front of ray
+					const glm::vec3 hitPoint = result.point.get(lane);
+					if (glm::dot(hitPoint - objectOrigins.get(lane), objectDirections.get(lane))
+					    <= 0)
+					{
+						continue;
+					}
+
+					// see verifyHit(), hits in front of the slicing plane are ignored
+					const bool hitValid = !slicingPlaneEnabled || aabbIsFullyBehindSlicingPlane
+					                      || !hitPosInFrontOfPlane(plane, hitPoint);
+					if (!hitValid)
+					{
+						continue;
+					}
+
+					const glm::vec3 worldHitPoint
+					    = glm::vec3(instance.objectToWorld * glm::vec4(hitPoint, 1));
+					const float dist = glm::distance(worldHitPoint, rays[lane].origin);
+					if (tHit[lane] < 0 || dist < tHit[lane])
+					{
+						const glm::vec3 hitNormal = glm::normalize(
+						    glm::cross(result.partialU.get(lane), result.partialV.get(lane)));
+						tHit[lane] = dist;
+						hits[lane].point = worldHitPoint;
+						hits[lane].coords = glm::vec2(result.u[lane], result.v[lane]);
+						hits[lane].normal
+						    = glm::normalize(multiplyTransposed(hitNormal, instance.worldToObject));
+					}
+				}
+			}
+		}
+	}
+
+	LaneMask<N> reported{};
+	for (size_t lane = 0; lane < N; lane++)
+	{
+		hits[lane].t = tHit[lane];
+		reported[lane] = lanes[lane] != 0 && tHit[lane] > 0;
+	}
+	return reported;
+}
+
+bool ReferenceRenderer::isShadowed(const glm::vec3 origin,
+                                   const glm::vec3 direction,
+                                   const float tMax) const
+{
+	Hit hit;
+	return traceRay(Ray{.origin = origin, .direction = direction},
+	                0.001f,
+	                tMax,
+	                static_cast<uint32_t>(InstanceMask::t_ShadowRayCullMask),
+	                true,
+	                hit);
+}
+
+void ReferenceRenderer::closestHit(Payload& payload, const Hit& hit) const
+{
+	if (payload.rayActive == 0)
+	{
+		return;
+	}
+
+	const glm::vec3 lightColor = constants.globalLightColor * constants.globalLightIntensity;
+	const glm::vec3 environmentLight
+	    = constants.environmentColor * constants.environmentLightIntensity;
+	const auto hitKind = static_cast<ObjectType>(hit.hitKind);
+
+	if (hitKind == ObjectType::t_AABBDebug)
+	{
+		// we hit a AABB (debugging)
+		const glm::vec3 surfaceColor = glm::vec3(0.8, 0.8, 0.8);
+		const glm::vec3 positionToLightDirection
+		    = glm::normalize(constants.globalLightPosition - hit.point);
+
+		payload.indirectColor = surfaceColor * environmentLight;
+		payload.directColor = surfaceColor * lightColor
+		                      * std::max(0.0f, glm::dot(-hit.normal, positionToLightDirection));
+	}
+	else if (hitKind == ObjectType::t_BezierPatch || hitKind == ObjectType::t_BezierPatchInside)
+	{
+		const glm::vec3 surfaceColor = glm::vec3(1.0, 1.0, 0.0);
+		payload.indirectColor = surfaceColor * environmentLight;
+
+		glm::vec3 actualHitpoint = hit.point;
+		glm::vec3 actualNormal = hit.normal;
+		bool hitSlicingPlane = false;
+
+		// we hit the inside of the object, move the hitpoint to the slicing plane instead
+		if (constants.enableSlicingPlanes > 0.0f
+		    && (hitKind == ObjectType::t_BezierPatchInside
+		        || glm::dot(hit.normal, payload.rayDirection) > 0.0f))
+		{
+			const SlicingPlane& plane = scene.slicingPlane;
+			const glm::vec3 cameraOrigin = glm::vec3(ubo.viewInverse * glm::vec4(0, 0, 0, 1));
+			float t = 0;
+			if (intersectWithPlane(
+			        plane.normal, plane.planeOrigin, cameraOrigin, payload.rayDirection, t))
+			{
+				payload.rayOrigin = payload.rayOrigin + payload.rayDirection * t;
+				actualHitpoint = payload.rayOrigin;
+				actualNormal = plane.normal;
+				hitSlicingPlane = true;
+			}
+			else
+			{
+				// calculation of the hit point failed, color red
+				payload.directColor = glm::vec3(1.0, 0.0, 0.0);
+				payload.indirectColor = glm::vec3(0.0, 0.0, 0.0);
+			}
+		}
+
+		// fire a ray to the light to check if we are in shadow
+		const glm::vec3 positionToLightDirection
+		    = glm::normalize(constants.globalLightPosition - actualHitpoint);
+		const float tMax = glm::length(constants.globalLightPosition - actualHitpoint) - 0.005f;
+		const bool isShadow = constants.renderShadows > 0.0f
+		                      && isShadowed(actualHitpoint, positionToLightDirection, tMax);
+
+		payload.directColor
+		    = isShadow ? glm::vec3(0.0)
+		               : surfaceColor * lightColor
+		                     * std::max(0.0f, glm::dot(actualNormal, positionToLightDirection));
+
+		if (hitSlicingPlane && constants.debugSlicingPlanes > 0.0f)
+		{
+			payload.directColor = glm::vec3(1.0, 0.0, 1.0);
+			payload.indirectColor = glm::vec3(0.0, 0.0, 0.0);
+		}
+
+		if (!hitSlicingPlane && constants.debugHighlightObjectEdges > 0.0f)
+		{
+			const float u = hit.coords.x;
+			const float v = hit.coords.y;
+			if (u < 1e-2f || v < 1e-2f || std::abs(1.0f - u - v) < 1e-2f)
+			{
+				payload.directColor = glm::vec3(0, 0, 0);
+				payload.indirectColor = glm::vec3(0, 0, 0);
+			}
+		}
+	}
+	else if (hitKind == ObjectType::t_Sphere)
+	{
+		const Sphere& s = scene.spheres[hit.bufferIndex];
+
+		// the first sphere is the light
+		if (hit.bufferIndex == 0)
+		{
+			payload.directColor = glm::vec3(1.0, 0.9, 0.3);
+			payload.indirectColor = glm::vec3(0, 0, 0);
+		}
+		else
+		{
+			const glm::vec3 positionToLightDirection
+			    = glm::normalize(constants.globalLightPosition - hit.point);
+			const float tMax = glm::length(constants.globalLightPosition - hit.point) - 0.005f;
+			const bool isShadow = isShadowed(hit.point, positionToLightDirection, tMax);
+
+			// see ColorIdx in common_types.h
+			const std::array<glm::vec3, 9> colorlist = {
+			    glm::vec3(1.0, 1.0, 1.0), // t_white
+			    glm::vec3(1.0, 0.0, 0.0), // t_red
+			    glm::vec3(0.0, 0.0, 1.0), // t_blue
+			    glm::vec3(0.0, 1.0, 0.0), // t_green
+			    glm::vec3(1.0, 1.0, 0.0), // t_yellow
+			    glm::vec3(1.0, 0.5, 0.0), // t_orange
+			    glm::vec3(1.0, 0.5, 0.8), // t_pink
+			    glm::vec3(0.5, 0.0, 1.0), // t_purple
+			    glm::vec3(0.0, 0.0, 0.0)  // t_black
+			};
+			assert(s.colorIdx >= 1 && static_cast<size_t>(s.colorIdx) <= colorlist.size());
+			const glm::vec3 surfaceColor = colorlist[static_cast<size_t>(s.colorIdx - 1)];
+			const glm::vec3 normal = glm::normalize(hit.point - s.center);
+
+			payload.indirectColor = surfaceColor * environmentLight;
+			payload.directColor
+			    = isShadow ? glm::vec3(0.0)
+			               : surfaceColor * lightColor
+			                     * std::max(0.0f, glm::dot(normal, positionToLightDirection));
+		}
+	}
+	payload.rayDepth += 1;
+}
+
+ReferenceRenderer::Payload ReferenceRenderer::primaryRayPayload(const uint32_t x,
+                                                               const uint32_t y,
+                                                               const uint32_t width,
+                                                               const uint32_t height) const
+{
+	glm::vec2 uv = glm::vec2(static_cast<float>(x), static_cast<float>(y)) + glm::vec2(0.5);
+	uv /= glm::vec2(static_cast<float>(width), static_cast<float>(height));
+	uv = uv * 2.0f - 1.0f;
+
+	const glm::vec4 origin = ubo.viewInverse * glm::vec4(0, 0, 0, 1);
+	const glm::vec4 target = ubo.projInverse * glm::vec4(uv.x, uv.y, 1, 1);
+	const glm::vec4 direction = ubo.viewInverse * glm::vec4(glm::normalize(glm::vec3(target)), 0);
+
+	return Payload{
+	    .rayOrigin = glm::vec3(origin),
+	    .rayDirection = glm::vec3(direction),
+	    .directColor = constants.environmentColor,
+	    .indirectColor = glm::vec3(0.0),
+	    .rayDepth = 0,
+	    .rayActive = 1,
+	};
+}
+
+void ReferenceRenderer::renderPacket(const uint32_t x,
+                                     const uint32_t y,
+                                     const uint32_t laneCount,
+                                     const uint32_t width,
+                                     const uint32_t height,
+                                     const std::span<glm::vec4> pixels) const
+{
+	assert(laneCount > 0 && laneCount <= RAY_PACKET_WIDTH && pixels.size() == laneCount);
+	const auto primaryRayCullMask = static_cast<uint32_t>(InstanceMask::t_PrimaryRayCullMask);
+
+	// the unused lanes repeat the first pixel and are masked out
+	std::array<Payload, RAY_PACKET_WIDTH> payloads;
+	std::array<Ray, RAY_PACKET_WIDTH> rays;
+	LaneMask<RAY_PACKET_WIDTH> lanes{};
+	for (uint32_t lane = 0; lane < RAY_PACKET_WIDTH; lane++)
+	{
+		payloads[lane] = primaryRayPayload(lane < laneCount ? x + lane : x, y, width, height);
+		rays[lane] = Ray{
+		    .origin = payloads[lane].rayOrigin,
+		    .direction = payloads[lane].rayDirection,
+		};
+		lanes[lane] = lane < laneCount;
+	}
+
+	for (int i = 0; i < constants.recursiveRaysPerPixel; i++)
+	{
+		// the camera rays are traced as packet, the rays after a slicing plane hit start at
+		// different points and are traced per pixel
+		std::array<Hit, RAY_PACKET_WIDTH> hits;
+		LaneMask<RAY_PACKET_WIDTH> hitLanes{};
+		if (i == 0)
+		{
+			hitLanes = tracePacket(rays, lanes, 0.001f, 1000.0f, primaryRayCullMask, hits);
+		}
+		else
+		{
+			for (uint32_t lane = 0; lane < laneCount; lane++)
+			{
+				hitLanes[lane] = traceRay(Ray{.origin = payloads[lane].rayOrigin,
+				                              .direction = payloads[lane].rayDirection},
+				                          0.001f,
+				                          1000.0f,
+				                          primaryRayCullMask,
+				                          false,
+				                          hits[lane]);
+			}
+		}
+
+		for (uint32_t lane = 0; lane < laneCount; lane++)
+		{
+			if (hitLanes[lane] != 0)
+			{
+				closestHit(payloads[lane], hits[lane]);
+			}
+			else
+			{
+				// shader.rmiss
+				payloads[lane].rayActive = 0;
+			}
+		}
+	}
+
+	for (uint32_t lane = 0; lane < laneCount; lane++)
+	{
+		pixels[lane] = glm::vec4(payloads[lane].directColor + payloads[lane].indirectColor, 1.0);
+	}
+}
+
+ReferenceImage ReferenceRenderer::render(const uint32_t width,
+                                        const uint32_t height,
+                                        const uint32_t tileSize) const
+{
+	assert(tileSize > 0);
+	const auto startTime = std::chrono::steady_clock::now();
+
+	ReferenceImage image{
+	    .width = width,
+	    .height = height,
+	    .pixels = std::vector<glm::vec4>(static_cast<size_t>(width) * height),
+	    .tileTimings = {},
+	    .milliseconds = 0.0,
+	    .intersectionInvocations = 0,
+	};
+
+	const uint32_t tilesX = (width + tileSize - 1) / tileSize;
+	const uint32_t tilesY = (height + tileSize - 1) / tileSize;
+	image.tileTimings.resize(static_cast<size_t>(tilesX) * tilesY);
+	constexpr auto packetWidth = static_cast<uint32_t>(RAY_PACKET_WIDTH);
+
+	// every tile writes its own pixels and timing, no synchronization needed
+	parallelForTasks(image.tileTimings.size(),
+	                 [&](const size_t tile, const size_t threadIndex)
+	                 {
+		                 const auto tileStartTime = std::chrono::steady_clock::now();
+		                 intersectionInvocations = 0;
+		                 const auto tileX = static_cast<uint32_t>(tile % tilesX) * tileSize;
+		                 const auto tileY = static_cast<uint32_t>(tile / tilesX) * tileSize;
+		                 const uint32_t tileWidth = std::min(tileSize, width - tileX);
+		                 const uint32_t tileHeight = std::min(tileSize, height - tileY);
+
+		                 for (uint32_t y = tileY; y < tileY + tileHeight; y++)
+		                 {
+			                 for (uint32_t x = tileX; x < tileX + tileWidth; x += packetWidth)
+			                 {
+				                 const uint32_t laneCount
+				                     = std::min(packetWidth, tileX + tileWidth - x);
+				                 const size_t pixelIndex = static_cast<size_t>(y) * width + x;
+				                 renderPacket(x,
+				                              y,
+				                              laneCount,
+				                              width,
+				                              height,
+				                              std::span<glm::vec4>(image.pixels)
+				                                  .subspan(pixelIndex, laneCount));
+			                 }
+		                 }
+
+		                 image.tileTimings[tile] = ReferenceTileTiming{
+		                     .x = tileX,
+		                     .y = tileY,
+		                     .width = tileWidth,
+		                     .height = tileHeight,
+		                     .threadIndex = threadIndex,
+		                     .milliseconds = std::chrono::duration<double, std::milli>(
+		                                         std::chrono::steady_clock::now() - tileStartTime)
+		                                         .count(),
+		                     .intersectionInvocations = intersectionInvocations,
+		                 };
+	                 });
+
+	for (const ReferenceTileTiming& tileTiming : image.tileTimings)
+	{
+		image.intersectionInvocations += tileTiming.intersectionInvocations;
+	}
+
+	image.milliseconds
+	    = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime)
+	          .count();
+	return image;
+}
+
+ReferenceImage renderReferenceScene(const int sceneNr, const uint32_t width, const uint32_t height)
+{
+	// the scene only fills its object pools, the vulkan handles are never used since no
+	// acceleration structures are built
+	const VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	RaytracingScene raytracingScene(physicalDevice, VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+	const RaytracingDataConstants raytracingDataConstants
+	    = Renderer::getDefaultRaytracingDataConstants();
+	const SceneConfig sceneConfig{
+	    .visualizeControlPoints = raytracingDataConstants.debugVisualizeControlPoints > 0.0f,
+	    .visualizeSampledSurface = raytracingDataConstants.debugVisualizeSampledSurface > 0.0f,
+	    .visualizeSampledVolume = raytracingDataConstants.debugVisualizeSampledVolume > 0.0f,
+	    .compactAccelerationStructures = false,
+	    .blasClusterSize = DEFAULT_BLAS_CLUSTER_SIZE,
+	    .tightBezierPatchBounds = false,
+	};
+	if (RaytracingScene::loadScene(
+	        raytracingScene, sceneConfig, sceneNr, raytracingDataConstants.globalLightPosition)
+	    == nullptr)
+	{
+		throw std::runtime_error("renderReferenceScene - scene " + std::to_string(sceneNr)
+		                         + " does not exist");
+	}
+
+	// same matrices as Renderer::updateUniformBuffer() writes for the initial camera
+	Camera camera;
+	camera.updateScreenSize(width, height);
+	UniformStructure ubo{};
+	ubo.viewProj = camera.getProjectionMatrix() * camera.getViewMatrix();
+	ubo.viewInverse = glm::inverse(camera.getViewMatrix());
+	ubo.projInverse = glm::inverse(camera.getProjectionMatrix());
+	ubo.frameCount = 0;
+
+	const ReferenceScene scene = ReferenceScene::fromRaytracingScene(raytracingScene);
+	const ReferenceRenderer referenceRenderer(scene, raytracingDataConstants, ubo);
+	return referenceRenderer.render(width, height);
+}
+
+} // namespace rt
+} // namespace tracer
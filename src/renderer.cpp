@@ -1,3 +1,5 @@
+#include <array>
+#include <cstdio>
 #include <glm/ext/matrix_transform.hpp>
 #include <stdexcept>
 #include <vk_mem_alloc.h>
@@ -59,6 +61,7 @@ void Renderer::initRenderer(VkInstance& vulkanInstance, rt::RaytracingScene& ray
 	// createDescriptorSetsModels();
 	createCommandBuffers();
 	createSyncObjects();
+	createTimestampQueryPool();
 
 	// for (tracer::MeshObject &obj : *worldObjects) {
 	//   createVertexBuffer(obj);
@@ -85,6 +88,7 @@ void Renderer::initRenderer(VkInstance& vulkanInstance, rt::RaytracingScene& ray
 	{
 		throw std::runtime_error("initRenderer - no valid graphicsFamily index");
 	}
+	raytracingInfo.transferQueueHandle = transferQueue;
 
 	tracer::createRaytracingImage(
 	    physicalDevice, vmaAllocator, window.getSwapChainExtent(), raytracingInfo);
@@ -107,12 +111,24 @@ void Renderer::initRenderer(VkInstance& vulkanInstance, rt::RaytracingScene& ray
 		                           raytracingInfo,
 		                           physicalDeviceAccelerationStructureProperties);
 
+		raytracingScene.initStagingUploader(raytracingInfo);
+
 		raytracingInfo.minAccelerationStructureScratchOffsetAlignment
 		    = physicalDeviceAccelerationStructureProperties
 		          .minAccelerationStructureScratchOffsetAlignment;
 	}
 
-	raytracingInfo.raytracingConstants = {
+	raytracingInfo.raytracingConstants = getDefaultRaytracingDataConstants();
+
+	// auto& cameraTransform = camera->transform;
+	// tracer::updateUniformStructure(
+	//     cameraTransform.position, cameraTransform.getRight(),
+	//     cameraTransform.getUp(), cameraTransform.getForward());
+}
+
+RaytracingDataConstants Renderer::getDefaultRaytracingDataConstants()
+{
+	return RaytracingDataConstants{
 	    .newtonErrorXTolerance = 1e-8f,
 	    .newtonErrorFTolerance = 1e-4f,
 	    .newtonErrorFIgnoreIncrease = 0.0f,
@@ -140,11 +156,6 @@ void Renderer::initRenderer(VkInstance& vulkanInstance, rt::RaytracingScene& ray
 	    .debugVisualizeSampledVolume = 0.0f,
 	    .cameraDir = glm::vec3(0),
 	};
-
-	// auto& cameraTransform = camera->transform;
-	// tracer::updateUniformStructure(
-	//     cameraTransform.position, cameraTransform.getRight(),
-	//     cameraTransform.getUp(), cameraTransform.getForward());
 }
 
 void Renderer::updateRaytracingDescriptorSet()
@@ -278,6 +289,14 @@ void Renderer::drawFrame(Camera& camera,
 	}
 	vkResetFences(logicalDevice, 1, &inFlightFences[currentFrame]);
 
+	if (raytracingSupported)
+	{
+		getCurrentRaytracingScene().collectRetiredResources(raytracingInfo);
+	}
+
+	readTraceTimestamps(uiData);
+	getMemoryTelemetry().updateHeapBudgets(vmaAllocator, drawnFrameCount++);
+
 	uint32_t imageIndex;
 	result = vkAcquireNextImageKHR(logicalDevice,
 	                               window.getSwapChain(),
@@ -300,18 +319,24 @@ void Renderer::drawFrame(Camera& camera,
 
 	if (raytracingSupported)
 	{
+		// the edited control points are written back before the incremental rebuild, it refits
+		// the BLAS of the patch with the recomputed AABB
+		auto& bezierPatchEditor = uiData.bezierPatchEditor;
+		auto& bezierPatches = getCurrentRaytracingScene().getObjectPool<BezierPatch>();
+		if (bezierPatchEditor.edited
+		    && static_cast<size_t>(bezierPatchEditor.patchIndex) < bezierPatches.size())
+		{
+			getCurrentRaytracingScene().modifyBezierPatchControlPoints(
+			    bezierPatches.getHandle(static_cast<size_t>(bezierPatchEditor.patchIndex)),
+			    bezierPatchEditor.controlPoints);
+		}
+		bezierPatchEditor.edited = false;
+
 		if (uiData.recreateAccelerationStructures.isRecreateNeeded())
 		{
+			// the scene retires the resources of the previous build instead of waiting for the
+			// queue to be idle
 			bool fullRebuild = uiData.recreateAccelerationStructures.isFullRebuildNeeded();
-			if (fullRebuild)
-			{
-				// TODO: replace this with a fence to improve performance
-				vkQueueWaitIdle(raytracingInfo.graphicsQueueHandle);
-			}
-			else
-			{
-				getCurrentRaytracingScene().copyGPUObjectsToBuffers();
-			}
 
 			// make sure the light position is up-to-date
 			{
@@ -324,14 +349,17 @@ void Renderer::drawFrame(Camera& camera,
 				{
 					currentLightSceneObject = lightSceneObject.value();
 
-					auto& lightSphere = lightSceneObject.value()->spheres[0];
 					// we assume the first sphere always represents the light
-					lightSphere->setPosition(uiData.raytracingDataConstants.globalLightPosition);
-					auto transformMatrix = lightSphere->getTransform().getTransformMatrix();
+					auto& spheres = getCurrentRaytracingScene().getObjectPool<Sphere>();
+					const auto lightSphere
+					    = spheres.getHandle(lightSceneObject.value()->spheres.offset);
+					spheres.setPosition(lightSphere,
+					                    uiData.raytracingDataConstants.globalLightPosition);
+					auto transformMatrix = spheres.getTransformMatrix(lightSphere);
 
 					lightSceneObject.value()->setTransformMatrix(transformMatrix);
-					getCurrentRaytracingScene().setTransformMatrixForInstance(
-					    lightSceneObject.value()->instanceCustomIndex + 0, transformMatrix);
+					getCurrentRaytracingScene().setTransformMatrixForSceneObject(
+					    *lightSceneObject.value(), transformMatrix);
 				}
 				else
 				{
@@ -339,19 +367,55 @@ void Renderer::drawFrame(Camera& camera,
 				}
 			}
 
-			getCurrentRaytracingScene().recreateAccelerationStructures(raytracingInfo, fullRebuild);
+			getCurrentRaytracingScene().setMaxBLASRefits(
+			    static_cast<uint32_t>(std::max(uiData.maxBLASRefits, 1)));
+			fullRebuild = getCurrentRaytracingScene().recreateAccelerationStructures(raytracingInfo,
+			                                                                         fullRebuild);
+
+			// an incremental rebuild keeps the TLAS and the buffers, the descriptor set only has
+			// to be written after a full rebuild
+			if (fullRebuild)
+			{
+				updateAccelerationStructureDescriptorSet(
+				    logicalDevice, getCurrentRaytracingScene(), raytracingInfo);
+			}
 
-			updateAccelerationStructureDescriptorSet(
-			    logicalDevice, getCurrentRaytracingScene(), raytracingInfo);
+			uiData.blasBuildTelemetry = getCurrentRaytracingScene().getBLASBuildTelemetry();
+			uiData.bezierBoundsTelemetry = getCurrentRaytracingScene().getBezierBoundsTelemetry();
+
+			// the scene was reloaded by the leak check, everything allocated for the previous
+			// build has to be freed again
+			if (fullRebuild && uiData.memoryLeakCheckPending)
+			{
+				uiData.memoryLeakCheckPending = false;
+				// the previous build was only retired by the rebuild, it is still in use by the
+				// submitted frames
+				getCurrentRaytracingScene().flushRetiredResources(raytracingInfo);
+				[[maybe_unused]] const bool matchesBaseline
+				    = getMemoryTelemetry().matchesBaseline();
+				std::printf("Memory leak check %s\n", matchesBaseline ? "passed" : "failed");
+				assert(matchesBaseline && "allocations did not return to the baseline");
+			}
 
 			uiData.recreateAccelerationStructures.reset();
 			resetFrameCountRequested = true;
 		}
 
+		// reloaded every frame, the scene or the selected patch might have changed
+		bezierPatchEditor.patchCount = static_cast<int>(bezierPatches.size());
+		bezierPatchEditor.controlPoints.clear();
+		if (static_cast<size_t>(bezierPatchEditor.patchIndex) < bezierPatches.size())
+		{
+			const auto controlPoints = getCurrentRaytracingScene().getBezierPatchControlPoints(
+			    bezierPatches.getHandle(static_cast<size_t>(bezierPatchEditor.patchIndex)));
+			bezierPatchEditor.controlPoints.assign(controlPoints.begin(), controlPoints.end());
+		}
+
 		if (uiData.rotateLightAroundScene && currentLightSceneObject != nullptr)
 		{
 			// we assume the first sphere always represents the light
-			auto& lightSphere = currentLightSceneObject->spheres[0];
+			auto& spheres = getCurrentRaytracingScene().getObjectPool<Sphere>();
+			const auto lightSphere = spheres.getHandle(currentLightSceneObject->spheres.offset);
 
 			static auto time = 0.0;
 			time += delta;
@@ -362,14 +426,15 @@ void Renderer::drawFrame(Camera& camera,
 			    = uiData.rotatingLightOrigin
 			      + vec3(radius * glm::sin(time * speed), 0, radius * glm::cos(time * speed));
 			uiData.raytracingDataConstants.globalLightPosition = position;
-			lightSphere->setPosition(position);
-			auto transformMatrix = lightSphere->getTransform().getTransformMatrix();
+			spheres.setPosition(lightSphere, position);
+			auto transformMatrix = spheres.getTransformMatrix(lightSphere);
 
 			currentLightSceneObject->setTransformMatrix(transformMatrix);
-			getCurrentRaytracingScene().setTransformMatrixForInstance(
-			    currentLightSceneObject->instanceCustomIndex + 0, transformMatrix);
+			getCurrentRaytracingScene().setTransformMatrixForSceneObject(
+			    *currentLightSceneObject, transformMatrix);
 
-			getCurrentRaytracingScene().recreateAccelerationStructures(raytracingInfo, false);
+			// the sphere data and the TLAS are updated inside the frame command buffer
+			getCurrentRaytracingScene().requestDirtyObjectsUpload(currentLightSceneObject);
 		}
 
 		tracer::updateRaytraceBuffer(
@@ -387,22 +452,51 @@ void Renderer::drawFrame(Camera& camera,
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
+	// the rays must not be traced and the dirty objects must not be written before the staged
+	// geometry uploads are done, waiting for an already reached value is free
+	VkSemaphore uploadTimelineSemaphore = VK_NULL_HANDLE;
+	if (raytracingSupported)
+	{
+		uploadTimelineSemaphore = getCurrentRaytracingScene().getUploadTimelineSemaphore();
+	}
+
+	VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame],
+	                                uploadTimelineSemaphore};
 	VkPipelineStageFlags waitStages[] = {
 	    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+	    VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
 	};
-	submitInfo.waitSemaphoreCount = 1;
+	// the value of the binary semaphore is ignored
+	const uint64_t waitValues[] = {
+	    0,
+	    raytracingSupported ? getCurrentRaytracingScene().getUploadTimelineValue() : 0,
+	};
+	submitInfo.waitSemaphoreCount = uploadTimelineSemaphore != VK_NULL_HANDLE ? 2 : 1;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
-	VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-	submitInfo.signalSemaphoreCount = 1;
+	// every frame signals the next value of the frame timeline, resources retired by the scene
+	// are destroyed once the frames that might use them reached their value
+	const uint64_t frameTimelineValue = raytracingInfo.frameTimeline.lastSubmittedValue + 1;
+	VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame],
+	                                  raytracingInfo.frameTimeline.semaphore};
+	const uint64_t signalValues[] = {0, frameTimelineValue};
+	submitInfo.signalSemaphoreCount = 2;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+	timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSubmitInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+	timelineSubmitInfo.pWaitSemaphoreValues = waitValues;
+	timelineSubmitInfo.signalSemaphoreValueCount = 2;
+	timelineSubmitInfo.pSignalSemaphoreValues = signalValues;
+	submitInfo.pNext = &timelineSubmitInfo;
+
 	VK_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]));
+	raytracingInfo.frameTimeline.lastSubmittedValue = frameTimelineValue;
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -429,6 +523,59 @@ void Renderer::drawFrame(Camera& camera,
 	currentFrame = (currentFrame + 1) % static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 }
 
+void Renderer::createTimestampQueryPool()
+{
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+	if (physicalDeviceProperties.limits.timestampComputeAndGraphics != VK_TRUE)
+	{
+		std::printf("Timestamps are not supported, the trace time is not measured\n");
+		return;
+	}
+
+	timestampPeriod = static_cast<double>(physicalDeviceProperties.limits.timestampPeriod);
+	traceTimestampsWritten.assign(static_cast<size_t>(MAX_FRAMES_IN_FLIGHT), false);
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {
+	    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+	    .pNext = NULL,
+	    .flags = 0,
+	    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+	    .queryCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 2,
+	    .pipelineStatistics = 0,
+	};
+
+	VK_CHECK_RESULT(
+	    vkCreateQueryPool(logicalDevice, &queryPoolCreateInfo, NULL, &traceTimestampQueryPool));
+
+	deletionQueue.push_function(
+	    [=, this]() { vkDestroyQueryPool(logicalDevice, traceTimestampQueryPool, NULL); });
+}
+
+void Renderer::readTraceTimestamps(ui::UIData& uiData)
+{
+	if (traceTimestampQueryPool == VK_NULL_HANDLE || !traceTimestampsWritten[currentFrame])
+	{
+		return;
+	}
+
+	// the frame already finished, therefore the results are available without waiting
+	std::array<uint64_t, 2> timestamps{};
+	const VkResult result = vkGetQueryPoolResults(logicalDevice,
+	                                              traceTimestampQueryPool,
+	                                              currentFrame * 2,
+	                                              2,
+	                                              timestamps.size() * sizeof(uint64_t),
+	                                              timestamps.data(),
+	                                              sizeof(uint64_t),
+	                                              VK_QUERY_RESULT_64_BIT);
+	if (result == VK_SUCCESS)
+	{
+		uiData.traceTimeMilliseconds
+		    = static_cast<double>(timestamps[1] - timestamps[0]) * timestampPeriod / 1e6;
+	}
+}
+
 void Renderer::createSyncObjects()
 {
 	imageAvailableSemaphores.resize(static_cast<size_t>(MAX_FRAMES_IN_FLIGHT));
@@ -461,6 +608,25 @@ void Renderer::createSyncObjects()
 		}
 	}
 
+	VkSemaphoreTypeCreateInfo timelineTypeInfo{};
+	timelineTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineTypeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo timelineSemaphoreInfo{};
+	timelineSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	timelineSemaphoreInfo.pNext = &timelineTypeInfo;
+
+	if (vkCreateSemaphore(logicalDevice,
+	                      &timelineSemaphoreInfo,
+	                      nullptr,
+	                      &raytracingInfo.frameTimeline.semaphore)
+	    != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create frame timeline semaphore");
+	}
+	raytracingInfo.frameTimeline.lastSubmittedValue = 0;
+
 	deletionQueue.push_function(
 	    [=, this]()
 	    {
@@ -481,6 +647,10 @@ void Renderer::createSyncObjects()
 		    for (size_t i = 0; i < inFlightFences.size(); i++)
 			    vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
 	    });
+
+	deletionQueue.push_function(
+	    [=, this]()
+	    { vkDestroySemaphore(logicalDevice, raytracingInfo.frameTimeline.semaphore, nullptr); });
 }
 
 void Renderer::createCommandBuffers()
@@ -983,7 +1153,29 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
 
 	if (raytracingSupported)
 	{
+		getCurrentRaytracingScene().recordPendingUpdates(
+		    commandBuffer, currentFrame, raytracingInfo);
+
+		const uint32_t firstTimestampQuery = currentFrame * 2;
+		if (traceTimestampQueryPool != VK_NULL_HANDLE)
+		{
+			vkCmdResetQueryPool(commandBuffer, traceTimestampQueryPool, firstTimestampQuery, 2);
+			vkCmdWriteTimestamp(commandBuffer,
+			                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			                    traceTimestampQueryPool,
+			                    firstTimestampQuery);
+		}
+
 		tracer::rt::recordRaytracingCommandBuffer(commandBuffer, swapChainExtent, raytracingInfo);
+
+		if (traceTimestampQueryPool != VK_NULL_HANDLE)
+		{
+			vkCmdWriteTimestamp(commandBuffer,
+			                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			                    traceTimestampQueryPool,
+			                    firstTimestampQuery + 1);
+			traceTimestampsWritten[currentFrame] = true;
+		}
 	}
 
 	VkRenderPassBeginInfo renderPassInfo{};
@@ -1102,6 +1294,7 @@ void Renderer::saveFrameToFile(const std::filesystem::path& path)
 	                               &dstImage,
 	                               &dstImageAllocation,
 	                               &dstImageAllocInfo));
+	getMemoryTelemetry().trackAllocation(AllocationCategory::Readback, dstImageAllocInfo.size);
 
 	VkCommandPool commandPool2 = VK_NULL_HANDLE;
 	VkCommandPoolCreateInfo poolInfo{};
@@ -1295,5 +1488,6 @@ void Renderer::saveFrameToFile(const std::filesystem::path& path)
 	// Clean up resources
 	vmaUnmapMemory(vmaAllocator, dstImageAllocation);
 	vmaDestroyImage(vmaAllocator, dstImage, dstImageAllocation);
+	getMemoryTelemetry().trackFree(AllocationCategory::Readback, dstImageAllocInfo.size);
 }
 }; // namespace tracer
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <array>
 #include <imgui.h>
 #include <string>
@@ -154,6 +155,21 @@ void renderErrors(const UIData& uiData)
 	{
 		ImGui::Text("Hardware ray tracing not supported!");
 	}
+
+	// warn before the allocations start to fail (or get moved to system memory)
+	const auto& telemetry = uiData.memoryTelemetry;
+	for (uint32_t i = 0; i < telemetry.getHeapCount(); i++)
+	{
+		const auto& budget = telemetry.getHeapBudget(i);
+		if (budget.budget > 0 && budget.usage * 10 > budget.budget * 9)
+		{
+			ImGui::TextColored(ImVec4(1.0f, 0.2f, 0.2f, 1.0f),
+			                   "Memory heap %u is at %.0f%% of its budget!",
+			                   i,
+			                   100.0 * static_cast<double>(budget.usage)
+			                       / static_cast<double>(budget.budget));
+		}
+	}
 }
 
 void renderRaytracingOptions(UIData& uiData)
@@ -343,18 +359,100 @@ void renderBLASObjectInfo(const UIData& uiData)
 			ImGui::Text("Scene Object [%d]: %s", i, sceneObject->name.c_str());
 			ImGui::Text("Instance Custom Index: %d", sceneObject->instanceCustomIndex);
 			ImGui::Text("Spheres: %ld", sceneObject->spheres.size());
-			ImGui::Text("Bezier Triangles 2: %ld", sceneObject->bezierTriangles2.size());
-			ImGui::Text("Bezier Triangles 3: %ld", sceneObject->bezierTriangles3.size());
-			ImGui::Text("Bezier Triangles 4: %ld", sceneObject->bezierTriangles4.size());
+			ImGui::Text("Bezier Patches: %ld", sceneObject->bezierPatches.size());
 			ImGui::Text("Rectangular Bezier Surfaces 2x2: %ld",
 			            sceneObject->rectangularBezierSurfaces2x2.size());
 			ImGui::Text("Total Elements: %ld", sceneObject->totalElementsCount());
+			ImGui::Text("BLAS Clusters: %ld", sceneObject->clusters.size());
+			ImGui::Text("Instances: %ld", sceneObject->instanceCount());
+			ImGui::Text("BLAS Build Policy: %s",
+			            tracer::rt::getBLASBuildPolicyName(sceneObject->buildPolicy));
+			ImGui::Text("Instance Mask: 0x%02x", static_cast<uint32_t>(sceneObject->instanceMask));
+			if (sceneObject->blasCompactedSize > 0)
+			{
+				ImGui::Text("BLAS Size: %.2f KB (compacted: %.2f KB, %.1f%%)",
+				            static_cast<double>(sceneObject->blasSize) / 1024.0,
+				            static_cast<double>(sceneObject->blasCompactedSize) / 1024.0,
+				            100.0 * static_cast<double>(sceneObject->blasCompactedSize)
+				                / static_cast<double>(sceneObject->blasSize));
+			}
+			else
+			{
+				ImGui::Text("BLAS Size: %.2f KB (not compacted)",
+				            static_cast<double>(sceneObject->blasSize) / 1024.0);
+			}
 			ImGui::Separator();
 			i++;
 		}
 	}
 }
 
+void renderBLASBuildTelemetry(const UIData& uiData)
+{
+	if (ImGui::CollapsingHeader("BLAS - Build Telemetry"))
+	{
+		const auto& telemetry = uiData.blasBuildTelemetry;
+		ImGui::Text("Trace Time: %.3f ms", uiData.traceTimeMilliseconds);
+		ImGui::Text("Total Build Time (CPU): %.3f ms", telemetry.totalBuildTimeMs);
+		const auto& boundsTelemetry = uiData.bezierBoundsTelemetry;
+		ImGui::Text("Bezier Patch AABB Volume: %.1f %% of the control point boxes (%zu patches)",
+		            boundsTelemetry.getVolumeRatio() * 100.0,
+		            boundsTelemetry.patchCount);
+		ImGui::Separator();
+
+		for (size_t i = 0; i < tracer::rt::BLAS_BUILD_POLICY_COUNT; i++)
+		{
+			const auto policy = static_cast<tracer::rt::BLASBuildPolicy>(i);
+			const auto& statistics = telemetry[policy];
+			ImGui::Text("Policy: %s", tracer::rt::getBLASBuildPolicyName(policy));
+			ImGui::Text("BLAS's built: %u (cached: %u)",
+			            statistics.builtCount,
+			            statistics.cachedCount);
+			ImGui::Text("Primitives built: %llu",
+			            static_cast<unsigned long long>(statistics.primitiveCount));
+			ImGui::Text("Build Time (GPU): %.3f ms", statistics.buildTimeMs);
+			ImGui::Text("Built Size: %.2f KB",
+			            static_cast<double>(statistics.sizeInBytes) / 1024.0);
+			ImGui::Separator();
+		}
+	}
+}
+
+void renderMemoryTelemetry(const UIData& uiData)
+{
+	if (ImGui::CollapsingHeader("Memory - Budget & Allocations"))
+	{
+		const auto& telemetry = uiData.memoryTelemetry;
+		ImGui::Text("VK_EXT_memory_budget: %s",
+		            telemetry.isMemoryBudgetExtensionEnabled() ? "enabled"
+		                                                       : "not supported (estimated)");
+		ImGui::SeparatorText("Heaps");
+		for (uint32_t i = 0; i < telemetry.getHeapCount(); i++)
+		{
+			const auto& budget = telemetry.getHeapBudget(i);
+			const double usageMB = static_cast<double>(budget.usage) / (1024.0 * 1024.0);
+			const double budgetMB = static_cast<double>(budget.budget) / (1024.0 * 1024.0);
+			ImGui::Text("Heap %u (%s): %.1f / %.1f MB",
+			            i,
+			            telemetry.isDeviceLocalHeap(i) ? "device local" : "host",
+			            usageMB,
+			            budgetMB);
+			ImGui::ProgressBar(budgetMB > 0.0 ? static_cast<float>(usageMB / budgetMB) : 0.0f);
+		}
+
+		ImGui::SeparatorText("Allocations");
+		for (size_t i = 0; i < tracer::ALLOCATION_CATEGORY_COUNT; i++)
+		{
+			const auto category = static_cast<tracer::AllocationCategory>(i);
+			const auto& statistics = telemetry[category];
+			ImGui::Text("%s: %.2f MB (%u allocations)",
+			            tracer::getAllocationCategoryName(category),
+			            static_cast<double>(statistics.sizeInBytes) / (1024.0 * 1024.0),
+			            statistics.allocationCount);
+		}
+	}
+}
+
 void renderButtons(const tracer::ui::UIData& uiData)
 {
 	for (const auto& button : uiData.buttonCallbacks)
@@ -413,14 +511,24 @@ void renderRaytracingProperties(const tracer::ui::UIData& uiData)
 
 void renderPositionSliders(tracer::ui::UIData& uiData)
 {
-	if (ImGui::CollapsingHeader("Raytracing - Positions"))
+	if (ImGui::CollapsingHeader("Raytracing - Control Points"))
 	{
+		auto& editor = uiData.bezierPatchEditor;
+		if (editor.patchCount == 0)
+		{
+			ImGui::Text("The scene has no bezier patches");
+			return;
+		}
+
+		// the control points of the selected patch are loaded with the next frame
+		ImGui::SliderInt("Bezier Patch", &editor.patchIndex, 0, editor.patchCount - 1);
+		editor.patchIndex = std::clamp(editor.patchIndex, 0, editor.patchCount - 1);
 
 		bool valueChanged = false;
-		for (size_t i = 0; i < uiData.positions.size(); i++)
+		for (size_t i = 0; i < editor.controlPoints.size(); i++)
 		{
 			valueChanged = ImGui::SliderFloat3(("ControlPoint " + std::to_string(i)).c_str(),
-			                                   &uiData.positions[i].x,
+			                                   &editor.controlPoints[i].x,
 			                                   -10.0,
 			                                   10.0,
 			                                   "%.2f")
@@ -428,6 +536,8 @@ void renderPositionSliders(tracer::ui::UIData& uiData)
 		}
 		if (valueChanged)
 		{
+			// the edited patch becomes dynamic, its BLAS is refitted instead of rebuilt
+			editor.edited = true;
 			uiData.recreateAccelerationStructures.requestRecreate(false);
 		}
 	}
@@ -550,6 +660,30 @@ void renderSceneOptions(UIData& uiData)
 		// NOTE: since this is not passed the shader, we don't need to set configurationChanged
 		ImGui::Checkbox("Render Crosshair in center of screen", &uiData.renderCrosshairInCenter);
 		TOOLTIP("Whether or not to render the crosshair in the center of the screen");
+
+		sceneReloadNeeded
+		    = ImGui::Checkbox("Compact BLAS", &uiData.compactAccelerationStructures)
+		      || sceneReloadNeeded;
+		TOOLTIP("Whether to compact the bottom level acceleration structures after building them "
+		        "(reduces device memory usage, reloads the scene)");
+
+		// NOTE: applied with the next acceleration structure update, no reload needed
+		ImGui::SliderInt("Max BLAS Refits", &uiData.maxBLASRefits, 1, 128);
+		TOOLTIP("How often the BLAS of a dynamic object is refitted before it gets rebuilt. "
+		        "Refitting is faster but the BLAS quality drops with every refit.");
+
+		sceneReloadNeeded
+		    = ImGui::SliderInt("BLAS Cluster Size", &uiData.blasClusterSize, 0, 65536)
+		      || sceneReloadNeeded;
+		TOOLTIP("Scene objects with more elements are split into multiple spatially sorted BLAS's "
+		        "(0 disables the splitting, reloads the scene)");
+
+		sceneReloadNeeded
+		    = ImGui::Checkbox("Tight Bezier Patch Bounds", &uiData.tightBezierPatchBounds)
+		      || sceneReloadNeeded;
+		TOOLTIP("Computes the AABBs of the bezier patches by subdividing the patches instead of "
+		        "using the box of the control points. Strongly curved patches get smaller boxes, "
+		        "so fewer rays run the intersection shader (reloads the scene)");
 	}
 
 	uiData.configurationChanged = uiData.configurationChanged || valueChanged;
@@ -605,9 +739,10 @@ void renderMainPanel(UIData& uiData)
 
 	ImGui::Separator();
 	renderBLASObjectInfo(uiData);
+	renderBLASBuildTelemetry(uiData);
+	renderMemoryTelemetry(uiData);
 
-	// TODO: display the control points in the ui and make them editable
-	// renderPositionSliders(uiData);
+	renderPositionSliders(uiData);
 
 	ImGui::SeparatorText("Configuration");
 	renderRaytracingOptions(uiData);
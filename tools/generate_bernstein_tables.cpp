@@ -0,0 +1,26 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "bernstein_tables.hpp"
+
+// writes bernstein_tables.glsl for the shaders, called by the build before the shaders are
+// compiled (see CMakeLists.txt)
+int main(int argc, char* argv[])
+{
+	if (argc != 2)
+	{
+		std::cerr << "usage: generate_bernstein_tables <output file>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream file(argv[1]);
+	if (!file)
+	{
+		std::cerr << "generate_bernstein_tables - failed to open " << argv[1] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	writeBernsteinTablesGLSL(file);
+	return EXIT_SUCCESS;
+}